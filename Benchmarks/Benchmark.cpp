@@ -0,0 +1,602 @@
+#include "Benchmark.h"
+#include "AllocationCounter.h"
+#include "CpuFeatures.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <regex>
+#include <thread>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#include <x86intrin.h>
+#endif
+
+using std::chrono::steady_clock;
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+
+namespace
+{
+	const uint64_t MAX_ITERATIONS = 1000000000;
+
+	int64_t GetRealNs()
+	{
+		return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+	}
+
+	// of the whole process, so worker threads of the pool are included
+	int64_t GetCpuNs()
+	{
+#if defined(_WIN32)
+		FILETIME creation, exitTime, kernel, user;
+		GetProcessTimes(GetCurrentProcess(), &creation, &exitTime, &kernel, &user);
+		uint64_t kernelTicks = (static_cast<uint64_t>(kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime;
+		uint64_t userTicks = (static_cast<uint64_t>(user.dwHighDateTime) << 32) | user.dwLowDateTime;
+		return static_cast<int64_t>((kernelTicks + userTicks) * 100);
+#else
+		timespec time;
+		clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+		return static_cast<int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+#endif
+	}
+
+	// invariant TSC, ticks at a constant reference rate whatever the core clock
+	uint64_t GetCycles()
+	{
+		return __rdtsc();
+	}
+
+	struct BenchmarkOptions
+	{
+		std::string filter;
+		double minTime;
+		bool json;
+		std::string outPath;
+		bool listOnly;
+	};
+
+	struct BenchmarkResult
+	{
+		std::string name;
+		uint64_t iterations;
+		double realNs;	// per iteration
+		double cpuNs;
+		double itemsPerSecond;
+		double bytesPerSecond;
+		double cyclesPerItem;
+		double allocationsPerIteration;
+		std::vector<std::pair<std::string, double>> counters;
+		std::string label;
+		std::string error;
+	};
+
+	std::vector<std::unique_ptr<Benchmark>>& GetRegistry()
+	{
+		static std::vector<std::unique_ptr<Benchmark>> registry;
+		return registry;
+	}
+
+	bool ParseFlag(const char* arg, const char* name, std::string* value)
+	{
+		size_t length = strlen(name);
+		if (strncmp(arg, name, length) != 0 || arg[length] != '=')
+		{
+			return false;
+		}
+		*value = arg + length + 1;
+		return true;
+	}
+
+	// 1234567 -> 1.23457M, for the console only
+	std::string FormatSi(double value)
+	{
+		const char* suffixes[] = { "", "k", "M", "G", "T" };
+		size_t suffix = 0;
+		while (value >= 1000.0 && suffix + 1 < sizeof(suffixes) / sizeof(suffixes[0]))
+		{
+			value /= 1000.0;
+			++suffix;
+		}
+
+		char text[32];
+		snprintf(text, sizeof(text), "%.4g%s", value, suffixes[suffix]);
+		return text;
+	}
+
+	std::string EscapeJson(const std::string& text)
+	{
+		std::string escaped;
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\')
+			{
+				escaped += '\\';
+			}
+			escaped += c;
+		}
+		return escaped;
+	}
+
+	// TSC ticks per microsecond, measured against the steady clock
+	double MeasureCycleMhz()
+	{
+		int64_t startNs = GetRealNs();
+		uint64_t startCycles = GetCycles();
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		uint64_t cycles = GetCycles() - startCycles;
+		int64_t ns = GetRealNs() - startNs;
+		return ns > 0 ? static_cast<double>(cycles) * 1000.0 / static_cast<double>(ns) : 0.0;
+	}
+
+	void PrintConsoleHeader()
+	{
+		printf("%-56s %13s %13s %12s\n", "Benchmark", "Time", "CPU", "Iterations");
+		printf("%s\n", std::string(97, '-').c_str());
+	}
+
+	void PrintConsoleResult(const BenchmarkResult& result)
+	{
+		if (!result.error.empty())
+		{
+			printf("%-56s ERROR: %s\n", result.name.c_str(), result.error.c_str());
+			return;
+		}
+
+		printf("%-56s %10.0f ns %10.0f ns %12llu", result.name.c_str(), result.realNs, result.cpuNs,
+			static_cast<unsigned long long>(result.iterations));
+		if (result.itemsPerSecond > 0.0)
+		{
+			printf(" items/s=%s", FormatSi(result.itemsPerSecond).c_str());
+		}
+		if (result.bytesPerSecond > 0.0)
+		{
+			printf(" bytes/s=%s", FormatSi(result.bytesPerSecond).c_str());
+		}
+		printf(" cycles/item=%.4g allocs/iter=%.4g", result.cyclesPerItem, result.allocationsPerIteration);
+		for (const std::pair<std::string, double>& counter : result.counters)
+		{
+			printf(" %s=%.4g", counter.first.c_str(), counter.second);
+		}
+		if (!result.label.empty())
+		{
+			printf(" %s", result.label.c_str());
+		}
+		printf("\n");
+		fflush(stdout);
+	}
+
+	void WriteJson(FILE* file, const char* executable, double cycleMhz, const std::vector<BenchmarkResult>& results)
+	{
+		char date[64];
+		time_t now = time(nullptr);
+		strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+		fprintf(file, "{\n  \"context\": {\n");
+		fprintf(file, "    \"date\": \"%s\",\n", date);
+		fprintf(file, "    \"executable\": \"%s\",\n", EscapeJson(executable).c_str());
+		fprintf(file, "    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+		fprintf(file, "    \"mhz_per_cpu\": %.0f,\n", cycleMhz);
+		fprintf(file, "    \"simd_level\": \"%s\",\n", GetSimdLevelName(GetCpuSimdLevel()));
+#if defined(NDEBUG)
+		fprintf(file, "    \"library_build_type\": \"release\"\n");
+#else
+		fprintf(file, "    \"library_build_type\": \"debug\"\n");
+#endif
+		fprintf(file, "  },\n  \"benchmarks\": [");
+
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			const BenchmarkResult& result = results[i];
+			fprintf(file, "%s\n    {\n", i > 0 ? "," : "");
+			fprintf(file, "      \"name\": \"%s\",\n", EscapeJson(result.name).c_str());
+			fprintf(file, "      \"run_name\": \"%s\",\n", EscapeJson(result.name).c_str());
+			fprintf(file, "      \"run_type\": \"iteration\",\n");
+			if (!result.error.empty())
+			{
+				fprintf(file, "      \"error_occurred\": true,\n");
+				fprintf(file, "      \"error_message\": \"%s\"\n    }", EscapeJson(result.error).c_str());
+				continue;
+			}
+
+			fprintf(file, "      \"iterations\": %llu,\n", static_cast<unsigned long long>(result.iterations));
+			fprintf(file, "      \"real_time\": %.6g,\n", result.realNs);
+			fprintf(file, "      \"cpu_time\": %.6g,\n", result.cpuNs);
+			fprintf(file, "      \"time_unit\": \"ns\",\n");
+			if (result.itemsPerSecond > 0.0)
+			{
+				fprintf(file, "      \"items_per_second\": %.6g,\n", result.itemsPerSecond);
+			}
+			if (result.bytesPerSecond > 0.0)
+			{
+				fprintf(file, "      \"bytes_per_second\": %.6g,\n", result.bytesPerSecond);
+			}
+			for (const std::pair<std::string, double>& counter : result.counters)
+			{
+				fprintf(file, "      \"%s\": %.6g,\n", EscapeJson(counter.first).c_str(), counter.second);
+			}
+			if (!result.label.empty())
+			{
+				fprintf(file, "      \"label\": \"%s\",\n", EscapeJson(result.label).c_str());
+			}
+			fprintf(file, "      \"cycles_per_item\": %.6g,\n", result.cyclesPerItem);
+			fprintf(file, "      \"allocations_per_iteration\": %.6g\n    }", result.allocationsPerIteration);
+		}
+
+		fprintf(file, "\n  ]\n}\n");
+	}
+}
+
+BenchmarkState::BenchmarkState(const std::vector<int64_t>* args, uint64_t iterations)
+	: m_args(args), m_iterations(iterations), m_remaining(iterations), m_started(false), m_running(false),
+	m_realSec(0.0), m_cpuSec(0.0), m_cycles(0), m_allocations(0),
+	m_startRealNs(0), m_startCpuNs(0), m_startCycles(0), m_startAllocations(0),
+	m_itemsProcessed(0), m_bytesProcessed(0)
+{
+}
+
+void BenchmarkState::StartTimer()
+{
+	m_running = true;
+	m_startAllocations = GetHeapAllocationCount();
+	m_startCpuNs = GetCpuNs();
+	m_startRealNs = GetRealNs();
+	m_startCycles = GetCycles();
+}
+
+void BenchmarkState::StopTimer()
+{
+	uint64_t cycles = GetCycles();
+	int64_t realNs = GetRealNs();
+	int64_t cpuNs = GetCpuNs();
+
+	m_cycles += cycles - m_startCycles;
+	m_realSec += (realNs - m_startRealNs) * 1e-9;
+	m_cpuSec += (cpuNs - m_startCpuNs) * 1e-9;
+	m_allocations += GetHeapAllocationCount() - m_startAllocations;
+	m_running = false;
+}
+
+bool BenchmarkState::KeepRunning()
+{
+	if (m_remaining > 0 && m_error.empty())
+	{
+		if (!m_started)
+		{
+			m_started = true;
+			StartTimer();
+		}
+		--m_remaining;
+		return true;
+	}
+
+	if (m_running)
+	{
+		StopTimer();
+	}
+	return false;
+}
+
+void BenchmarkState::PauseTiming()
+{
+	if (m_running)
+	{
+		StopTimer();
+	}
+}
+
+void BenchmarkState::ResumeTiming()
+{
+	if (!m_running)
+	{
+		StartTimer();
+	}
+}
+
+int64_t BenchmarkState::GetArg(size_t index) const
+{
+	return index < m_args->size() ? (*m_args)[index] : 0;
+}
+
+uint64_t BenchmarkState::GetIterations() const
+{
+	return m_iterations;
+}
+
+void BenchmarkState::SetItemsProcessed(int64_t items)
+{
+	m_itemsProcessed = items;
+}
+
+void BenchmarkState::SetBytesProcessed(int64_t bytes)
+{
+	m_bytesProcessed = bytes;
+}
+
+void BenchmarkState::SetCounter(const char* name, double value)
+{
+	for (std::pair<std::string, double>& counter : m_counters)
+	{
+		if (counter.first == name)
+		{
+			counter.second = value;
+			return;
+		}
+	}
+	m_counters.emplace_back(name, value);
+}
+
+void BenchmarkState::SetLabel(const std::string& label)
+{
+	m_label = label;
+}
+
+void BenchmarkState::SkipWithError(const char* message)
+{
+	m_error = message;
+	m_remaining = 0;
+}
+
+Benchmark::Benchmark(const char* name, BenchmarkFunction function)
+	: m_name(name), m_function(function), m_minTime(0.0), m_iterations(0), m_noAllocations(false)
+{
+}
+
+Benchmark* Benchmark::Arg(int64_t arg)
+{
+	m_args.push_back(std::vector<int64_t>(1, arg));
+	return this;
+}
+
+Benchmark* Benchmark::Args(std::initializer_list<int64_t> args)
+{
+	m_args.push_back(std::vector<int64_t>(args));
+	return this;
+}
+
+Benchmark* Benchmark::Range(int64_t start, int64_t limit, int64_t multiplier)
+{
+	for (int64_t arg = start; arg < limit; arg *= multiplier)
+	{
+		Arg(arg);
+	}
+	return Arg(limit);
+}
+
+Benchmark* Benchmark::ArgNames(std::initializer_list<const char*> names)
+{
+	m_argNames.assign(names.begin(), names.end());
+	return this;
+}
+
+Benchmark* Benchmark::MinTime(double seconds)
+{
+	m_minTime = seconds;
+	return this;
+}
+
+Benchmark* Benchmark::Iterations(uint64_t iterations)
+{
+	m_iterations = iterations;
+	return this;
+}
+
+Benchmark* Benchmark::Apply(void (*function)(Benchmark* benchmark))
+{
+	function(this);
+	return this;
+}
+
+Benchmark* Benchmark::NoAllocations()
+{
+	m_noAllocations = true;
+	return this;
+}
+
+Benchmark* RegisterBenchmark(const char* name, BenchmarkFunction function)
+{
+	GetRegistry().emplace_back(new Benchmark(name, function));
+	return GetRegistry().back().get();
+}
+
+class BenchmarkRunner
+{
+public:
+	static std::string GetRunName(const Benchmark& benchmark, const std::vector<int64_t>& args)
+	{
+		std::string name = benchmark.m_name;
+		for (size_t i = 0; i < args.size(); ++i)
+		{
+			name += "/";
+			if (i < benchmark.m_argNames.size())
+			{
+				name += benchmark.m_argNames[i] + ":";
+			}
+			name += std::to_string(args[i]);
+		}
+		return name;
+	}
+
+	static const std::vector<std::vector<int64_t>>& GetArgSets(const Benchmark& benchmark)
+	{
+		static const std::vector<std::vector<int64_t>> noArgs(1);
+		return benchmark.m_args.empty() ? noArgs : benchmark.m_args;
+	}
+
+	// grows the iteration count like Google Benchmark: tenfold while the run
+	// is too short to extrapolate from, then straight to the predicted count
+	static BenchmarkResult Run(const Benchmark& benchmark, const std::vector<int64_t>& args, double minTime)
+	{
+		BenchmarkResult result = {};
+		result.name = GetRunName(benchmark, args);
+
+		double runMinTime = benchmark.m_minTime > 0.0 ? benchmark.m_minTime : minTime;
+		uint64_t iterations = benchmark.m_iterations > 0 ? benchmark.m_iterations : 1;
+
+		for (;;)
+		{
+			BenchmarkState state(&args, iterations);
+			benchmark.m_function(state);
+			if (state.m_running)
+			{
+				state.StopTimer();
+			}
+
+			if (state.m_error.empty() && !state.m_started)
+			{
+				state.m_error = "the loop never called KeepRunning";
+			}
+
+			bool isDone = benchmark.m_iterations > 0 || !state.m_error.empty() ||
+				state.m_realSec >= runMinTime || iterations >= MAX_ITERATIONS;
+			if (!isDone)
+			{
+				double multiplier = runMinTime * 1.4 / (state.m_realSec > 1e-9 ? state.m_realSec : 1e-9);
+				if (state.m_realSec / runMinTime <= 0.1 && multiplier > 10.0)
+				{
+					multiplier = 10.0;
+				}
+				uint64_t next = static_cast<uint64_t>(iterations * multiplier);
+				iterations = next > iterations ? (next < MAX_ITERATIONS ? next : MAX_ITERATIONS) : iterations + 1;
+				continue;
+			}
+
+			if (state.m_error.empty() && benchmark.m_noAllocations && state.m_allocations > 0)
+			{
+				state.m_error = "allocated " + std::to_string(state.m_allocations) + " times in the timed loop";
+			}
+
+			double items = state.m_itemsProcessed > 0 ? static_cast<double>(state.m_itemsProcessed) : static_cast<double>(iterations);
+			result.iterations = iterations;
+			result.realNs = state.m_realSec * 1e9 / iterations;
+			result.cpuNs = state.m_cpuSec * 1e9 / iterations;
+			result.itemsPerSecond = state.m_itemsProcessed > 0 && state.m_realSec > 0.0 ? state.m_itemsProcessed / state.m_realSec : 0.0;
+			result.bytesPerSecond = state.m_bytesProcessed > 0 && state.m_realSec > 0.0 ? state.m_bytesProcessed / state.m_realSec : 0.0;
+			result.cyclesPerItem = static_cast<double>(state.m_cycles) / items;
+			result.allocationsPerIteration = static_cast<double>(state.m_allocations) / iterations;
+			result.counters = state.m_counters;
+			result.label = state.m_label;
+			result.error = state.m_error;
+			return result;
+		}
+	}
+};
+
+BenchmarkRandom::BenchmarkRandom(uint32_t seed)
+	: m_state(seed != 0 ? seed : 1)
+{
+}
+
+uint32_t BenchmarkRandom::Next()
+{
+	m_state ^= m_state << 13;
+	m_state ^= m_state >> 17;
+	m_state ^= m_state << 5;
+	return m_state;
+}
+
+float BenchmarkRandom::NextFloat(float minimum, float maximum)
+{
+	return minimum + (Next() >> 8) * (1.0f / 16777216.0f) * (maximum - minimum);
+}
+
+int RunBenchmarks(int argc, char** argv)
+{
+	BenchmarkOptions options = { "", 0.5, false, "", false };
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string value;
+		if (ParseFlag(argv[i], "--benchmark_filter", &value))
+		{
+			options.filter = value == "all" ? "" : value;
+		}
+		else if (ParseFlag(argv[i], "--benchmark_min_time", &value))
+		{
+			options.minTime = atof(value.c_str());
+		}
+		else if (ParseFlag(argv[i], "--benchmark_format", &value))
+		{
+			options.json = value == "json";
+		}
+		else if (ParseFlag(argv[i], "--benchmark_out", &value))
+		{
+			options.outPath = value;
+		}
+		else if (strcmp(argv[i], "--benchmark_list_tests") == 0 || ParseFlag(argv[i], "--benchmark_list_tests", &value))
+		{
+			options.listOnly = value.empty() || value == "true";
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [--benchmark_filter=<regex>] [--benchmark_min_time=<seconds>] "
+				"[--benchmark_format=console|json] [--benchmark_out=<file.json>] [--benchmark_list_tests]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	std::regex filter(options.filter.empty() ? "." : options.filter);
+	std::vector<std::pair<const Benchmark*, const std::vector<int64_t>*>> runs;
+	for (const std::unique_ptr<Benchmark>& benchmark : GetRegistry())
+	{
+		for (const std::vector<int64_t>& args : BenchmarkRunner::GetArgSets(*benchmark))
+		{
+			if (std::regex_search(BenchmarkRunner::GetRunName(*benchmark, args), filter))
+			{
+				runs.emplace_back(benchmark.get(), &args);
+			}
+		}
+	}
+
+	if (options.listOnly)
+	{
+		for (const std::pair<const Benchmark*, const std::vector<int64_t>*>& run : runs)
+		{
+			printf("%s\n", BenchmarkRunner::GetRunName(*run.first, *run.second).c_str());
+		}
+		return 0;
+	}
+
+	double cycleMhz = MeasureCycleMhz();
+	if (!options.json)
+	{
+		printf("%u threads, %s, TSC %.0f MHz\n", std::thread::hardware_concurrency(), GetSimdLevelName(GetCpuSimdLevel()), cycleMhz);
+		PrintConsoleHeader();
+	}
+
+	std::vector<BenchmarkResult> results;
+	bool failed = false;
+	for (const std::pair<const Benchmark*, const std::vector<int64_t>*>& run : runs)
+	{
+		results.push_back(BenchmarkRunner::Run(*run.first, *run.second, options.minTime));
+		failed |= !results.back().error.empty();
+		if (!options.json)
+		{
+			PrintConsoleResult(results.back());
+		}
+	}
+
+	if (options.json)
+	{
+		WriteJson(stdout, argv[0], cycleMhz, results);
+	}
+
+	if (!options.outPath.empty())
+	{
+		FILE* file = fopen(options.outPath.c_str(), "w");
+		if (file == nullptr)
+		{
+			fprintf(stderr, "cannot write %s\n", options.outPath.c_str());
+			return 1;
+		}
+		WriteJson(file, argv[0], cycleMhz, results);
+		fclose(file);
+	}
+
+	return failed ? 1 : 0;
+}
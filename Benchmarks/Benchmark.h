@@ -0,0 +1,175 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Small harness in the style of Google Benchmark, so the suite builds with
+// nothing but the compiler. Benchmarks register with BENCHMARK, do their
+// setup before the loop and put the measured work inside KeepRunning:
+//
+//	void BM_Example(BenchmarkState& state)
+//	{
+//		std::vector<float> data(state.GetArg(0));
+//		while (state.KeepRunning())
+//		{
+//			DoNotOptimize(Sum(data));
+//		}
+//		state.SetItemsProcessed(state.GetIterations() * data.size());
+//	}
+//	BENCHMARK(BM_Example)->Arg(1000)->Arg(100000);
+//
+// Each argument set runs with a growing iteration count until it takes
+// the minimum time. Besides wall and CPU time it reports time stamp counter
+// cycles and heap allocations per item, and writes the same JSON layout as
+// Google Benchmark, so its compare.py can diff two commits.
+
+class BenchmarkState
+{
+private:
+
+	const std::vector<int64_t>* m_args;
+	uint64_t m_iterations;
+	uint64_t m_remaining;
+	bool m_started;
+	bool m_running;
+
+	// accumulated while the timer runs
+	double m_realSec;
+	double m_cpuSec;
+	uint64_t m_cycles;
+	uint64_t m_allocations;
+
+	int64_t m_startRealNs;
+	int64_t m_startCpuNs;
+	uint64_t m_startCycles;
+	uint64_t m_startAllocations;
+
+	int64_t m_itemsProcessed;
+	int64_t m_bytesProcessed;
+	std::vector<std::pair<std::string, double>> m_counters;
+	std::string m_label;
+	std::string m_error;
+
+	void StartTimer();
+	void StopTimer();
+
+	friend class BenchmarkRunner;
+
+public:
+	BenchmarkState(const std::vector<int64_t>* args, uint64_t iterations);
+
+	// true once per iteration, starts the timer on the first call and stops it after the last
+	bool KeepRunning();
+
+	// for setup that has to be repeated inside the loop
+	void PauseTiming();
+	void ResumeTiming();
+
+	int64_t GetArg(size_t index) const;
+	uint64_t GetIterations() const;
+
+	// totals over all iterations, per second rates are derived from them
+	void SetItemsProcessed(int64_t items);
+	void SetBytesProcessed(int64_t bytes);
+
+	// reported as is, for results that are not rates
+	void SetCounter(const char* name, double value);
+	void SetLabel(const std::string& label);
+
+	// the run is reported as failed, the caller should return right away
+	void SkipWithError(const char* message);
+};
+
+typedef void (*BenchmarkFunction)(BenchmarkState& state);
+
+class Benchmark
+{
+private:
+
+	std::string m_name;
+	BenchmarkFunction m_function;
+	std::vector<std::vector<int64_t>> m_args;
+	std::vector<std::string> m_argNames;
+	double m_minTime;
+	uint64_t m_iterations;
+	bool m_noAllocations;
+
+	friend class BenchmarkRunner;
+
+public:
+	Benchmark(const char* name, BenchmarkFunction function);
+
+	Benchmark* Arg(int64_t arg);
+	Benchmark* Args(std::initializer_list<int64_t> args);
+	// start, start * multiplier, ... up to and including limit
+	Benchmark* Range(int64_t start, int64_t limit, int64_t multiplier = 8);
+	// names the arguments in the reported name, e.g. BM_Pack/level:2/count:1000
+	Benchmark* ArgNames(std::initializer_list<const char*> names);
+
+	// seconds the measured run has to last at least, overrides --benchmark_min_time
+	Benchmark* MinTime(double seconds);
+	// fixed iteration count, for benchmarks that are a single long measurement
+	Benchmark* Iterations(uint64_t iterations);
+	// calls function(this), for argument sets built in a loop
+	Benchmark* Apply(void (*function)(Benchmark* benchmark));
+
+	// fails the run if the timed loop allocates from the heap, for the
+	// paths the engine runs every frame; warm up caches before the loop
+	Benchmark* NoAllocations();
+};
+
+Benchmark* RegisterBenchmark(const char* name, BenchmarkFunction function);
+
+#define BENCHMARK_CONCAT_(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT_(a, b)
+#define BENCHMARK(function) \
+	static Benchmark* BENCHMARK_CONCAT(g_benchmark, __LINE__) = RegisterBenchmark(#function, function)
+
+// accepts the Google Benchmark flags --benchmark_filter, --benchmark_min_time,
+// --benchmark_format, --benchmark_out and --benchmark_list_tests; returns the
+// process exit code, nonzero if a benchmark failed
+int RunBenchmarks(int argc, char** argv);
+
+// keeps the compiler from removing a computation whose result is unused
+template<typename T>
+inline void DoNotOptimize(const T& value)
+{
+#if defined(_MSC_VER)
+	const volatile char* volatile sink = reinterpret_cast<const volatile char*>(&value);
+	(void)sink;
+#else
+	asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+// forces pending writes to memory to be treated as observed
+inline void ClobberMemory()
+{
+#if defined(_MSC_VER)
+	_ReadWriteBarrier();
+#else
+	asm volatile("" : : : "memory");
+#endif
+}
+
+// xorshift32, the same generator the conformance checks use, so inputs are
+// identical on every run and machine
+class BenchmarkRandom
+{
+private:
+
+	uint32_t m_state;
+
+public:
+	explicit BenchmarkRandom(uint32_t seed);
+
+	uint32_t Next();
+	float NextFloat(float minimum, float maximum);
+};
@@ -0,0 +1,293 @@
+#include "Benchmark.h"
+#include "AllocationCounter.h"
+#include "AnimationSampler.h"
+#include "Camera.h"
+#include "ClusterCuller.h"
+#include "DrawSortKey.h"
+#include "FrameArena.h"
+#include "FramePhases.h"
+#include "GeometryPool.h"
+#include "IndirectArgsBuilder.h"
+#include "ParallelCommandRecorder.h"
+#include "SceneGenerator.h"
+#include "ThreadPool.h"
+#include "TransformPacking.h"
+#include "UploadWriter.h"
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	enum class FramePhase
+	{
+		Update,
+		Cull,
+		Sort,
+		Upload,
+		Record,
+		Count
+	};
+
+	const char* const PHASE_COUNTERS[] = { "update_ms", "cull_ms", "sort_ms", "upload_ms", "record_ms" };
+
+	// wall time of each phase on the thread running the frame, workers included through the waits
+	class PhaseClock
+	{
+	private:
+		std::chrono::steady_clock::time_point m_last;
+		double m_totalSec[static_cast<size_t>(FramePhase::Count)];
+
+	public:
+		PhaseClock()
+			: m_totalSec()
+		{
+		}
+
+		void Start()
+		{
+			m_last = std::chrono::steady_clock::now();
+		}
+
+		void End(FramePhase phase)
+		{
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			m_totalSec[static_cast<size_t>(phase)] += std::chrono::duration<double>(now - m_last).count();
+			m_last = now;
+		}
+
+		double GetMilliseconds(FramePhase phase, uint64_t frames) const
+		{
+			return frames > 0 ? 1000.0 * m_totalSec[static_cast<size_t>(phase)] / frames : 0.0;
+		}
+	};
+
+	// The frame of the engine for a generated scene, without a device: Update
+	// (animation and the transform hierarchy), then the FramePhases the engine
+	// runs, culling at object level, and RecordScene into plain memory or an
+	// ExecuteIndirect argument buffer.
+	class HeadlessFrame
+	{
+	private:
+		const GeneratedScene& m_scene;
+		size_t m_objectCount;
+		bool m_indirect;
+
+		ThreadPool m_threadPool;
+		AnimationSampler m_sampler;
+		RadixSorter m_sorter;
+		IndirectArgsBuilder m_indirectArgsBuilder;
+		ParallelCommandRecorder m_recorder;
+		RecordingCommandListBackend m_backend;
+		FrameArena m_arena;
+		Camera m_camera;
+
+		GeometryPool m_geometryPool;
+		std::vector<MeshHandle> m_meshes;	// by primitive
+		std::vector<float> m_objectRadii;
+
+		std::vector<AnimationInstance> m_animations;
+		std::vector<XMFLOAT4X4> m_animatedMats;
+		std::vector<XMFLOAT4X4> m_worldMats;
+		std::vector<XMFLOAT4> m_colors;
+		std::vector<uint8_t> m_visibility;
+		std::vector<DrawItem> m_drawItems;
+		std::vector<SortableDraw> m_drawKeys;
+		std::vector<DrawItem> m_sortedDraws;
+
+		// stand-ins for the mapped upload heaps
+		std::vector<AffineTransform> m_objectBuffer;
+		std::vector<XMFLOAT4> m_colorBuffer;
+		std::vector<IndirectDrawCommand> m_indirectArgs;
+		UploadWriter m_objectWriter;
+		UploadWriter m_colorWriter;
+
+		// ranges relative to the mesh, as CullClusters leaves them
+		void AddDraw(size_t object)
+		{
+			uint32_t primitive = m_scene.primitives[object];
+			DrawItem draw = { static_cast<uint32_t>(m_scene.meshes[primitive].indices.size()), 0, 0, static_cast<uint32_t>(object), 0,
+				m_meshes[primitive] };
+			m_drawItems.push_back(draw);
+		}
+
+	public:
+		HeadlessFrame(const GeneratedScene& scene, float spacing, bool indirect)
+			: m_scene(scene), m_objectCount(scene.primitives.size()), m_indirect(indirect),
+			m_sampler(&m_threadPool), m_sorter(&m_threadPool), m_indirectArgsBuilder(&m_threadPool), m_recorder(&m_threadPool, 256),
+			m_geometryPool(64 * 1024, 256 * 1024), m_objectRadii(m_objectCount),
+			m_animations(scene.animations), m_animatedMats(m_objectCount), m_worldMats(m_objectCount), m_colors(m_objectCount),
+			m_visibility(m_objectCount), m_sortedDraws(m_objectCount),
+			m_objectBuffer(m_objectCount), m_colorBuffer(m_objectCount), m_indirectArgs(m_objectCount)
+		{
+			for (const ProceduralMesh& mesh : scene.meshes)
+			{
+				m_meshes.push_back(m_geometryPool.AddMesh(static_cast<uint32_t>(mesh.vertices.size()), static_cast<uint32_t>(mesh.indices.size())));
+			}
+			for (size_t i = 0; i < m_objectCount; ++i)
+			{
+				m_objectRadii[i] = scene.meshes[scene.primitives[i]].radius;
+			}
+			m_drawItems.reserve(m_objectCount);
+			m_drawKeys.reserve(m_objectCount);
+			m_objectWriter = UploadWriter(m_objectBuffer.data(), m_objectBuffer.size() * sizeof(AffineTransform));
+			m_colorWriter = UploadWriter(m_colorBuffer.data(), m_colorBuffer.size() * sizeof(XMFLOAT4));
+
+			// above the middle of the field, looking down and turning every frame
+			float fieldSize = spacing * sqrtf(static_cast<float>(scene.levelOffsets.size() > 1 ? scene.levelOffsets[1] : 1));
+			m_camera.SetPosition(0.0f, 0.1f * fieldSize + 2.0f, 0.0f);
+			m_camera.SetRotation(0.4f, 0.0f);
+			m_camera.SetPerspective(60.0f * (XM_PI / 180.0f), 800.0f / 600.0f, 0.01f, 1000.0f);
+		}
+
+		void Update(float deltaSec)
+		{
+			m_camera.Rotate(0.0f, 0.5f * deltaSec);
+			AnimationSampler::Advance(m_scene.clips.data(), m_animations.data(), m_objectCount, deltaSec);
+			m_sampler.Sample(m_scene.clips.data(), m_animations.data(), m_objectCount, m_animatedMats.data(), m_colors.data());
+			SceneGenerator::ComposeHierarchy(m_scene, m_animatedMats.data(), m_worldMats.data(), m_threadPool);
+		}
+
+		// frustum test of every object's bounding sphere, the survivors become draws in scene order
+		void Cull()
+		{
+			XMFLOAT4X4 viewProjection;
+			XMStoreFloat4x4(&viewProjection, m_camera.GetViewMatrix() * m_camera.GetProjectionMatrix());
+			ClusterFrustum frustum;
+			ClusterCuller::ExtractFrustum(&viewProjection.m[0][0], frustum);
+
+			FramePhases::CullObjects(m_worldMats.data(), m_objectRadii.data(), m_objectCount, frustum, m_visibility.data(), m_threadPool);
+
+			m_drawItems.clear();
+			for (size_t i = 0; i < m_objectCount; ++i)
+			{
+				if (m_visibility[i])
+				{
+					AddDraw(i);
+				}
+			}
+		}
+
+		void Sort()
+		{
+			FramePhases::SortDraws(m_drawItems.data(), m_drawItems.size(), m_worldMats.data(), m_camera.GetViewMatrix(), m_geometryPool, m_sorter,
+				m_drawKeys, m_sortedDraws.data());
+		}
+
+		// affine mode with everything animated, plus the colors; false if the arena ran out
+		bool Upload()
+		{
+			m_arena.Reset();
+			if (!FramePhases::UploadAffineTransforms(m_worldMats.data(), 0, m_objectCount, m_arena, m_objectWriter))
+			{
+				return false;
+			}
+			m_colorWriter.Write(0, m_colors.data(), m_objectCount * sizeof(XMFLOAT4));
+			m_objectWriter.Flush();
+			return true;
+		}
+
+		size_t Record()
+		{
+			if (m_indirect)
+			{
+				return m_indirectArgsBuilder.Build(m_sortedDraws.data(), m_drawKeys.size(), nullptr, m_indirectArgs.data());
+			}
+			m_recorder.Record(m_sortedDraws.data(), m_drawKeys.size(), m_backend);
+			return m_drawKeys.size();
+		}
+
+		// sizes every buffer for the case where all objects are visible
+		void Warmup()
+		{
+			Update(0.0f);
+			Cull();
+			m_drawItems.clear();
+			for (size_t i = 0; i < m_objectCount; ++i)
+			{
+				AddDraw(i);
+			}
+			Sort();
+			Upload();
+			m_recorder.Record(m_sortedDraws.data(), m_drawKeys.size(), m_backend);
+			m_indirectArgsBuilder.Build(m_sortedDraws.data(), m_drawKeys.size(), nullptr, m_indirectArgs.data());
+		}
+
+		size_t GetDrawCount() const
+		{
+			return m_drawItems.size();
+		}
+
+		uint32_t GetThreadCount() const
+		{
+			return m_threadPool.GetThreadCount();
+		}
+	};
+}
+
+// The full CPU frame for 1k to 1M generated objects. Items are objects, so
+// items_per_second is the object throughput; the *_ms counters split the
+// frame into its phases. After Warmup a frame must not heap allocate, the
+// first one that does fails the run.
+void BM_Frame(BenchmarkState& state)
+{
+	SceneDesc desc(static_cast<uint32_t>(state.GetArg(0)));
+	GeneratedScene scene;
+	SceneGenerator::Generate(desc, scene);
+	HeadlessFrame frame(scene, desc.spacing, state.GetArg(1) != 0);
+	frame.Warmup();
+
+	PhaseClock clock;
+	size_t draws = 0;
+	while (state.KeepRunning())
+	{
+		AllocationScope allocations;
+		clock.Start();
+		frame.Update(1.0f / 60.0f);
+		clock.End(FramePhase::Update);
+		frame.Cull();
+		clock.End(FramePhase::Cull);
+		frame.Sort();
+		clock.End(FramePhase::Sort);
+		if (!frame.Upload())
+		{
+			state.SkipWithError("the frame arena is out of memory");
+			return;
+		}
+		clock.End(FramePhase::Upload);
+		draws += frame.Record();
+		clock.End(FramePhase::Record);
+
+		if (allocations.GetCount() > 0)
+		{
+			state.SkipWithError(("a frame heap allocated " + std::to_string(allocations.GetCount()) + " times after warmup").c_str());
+		}
+	}
+
+	state.SetItemsProcessed(state.GetIterations() * scene.primitives.size());
+	for (size_t phase = 0; phase < static_cast<size_t>(FramePhase::Count); ++phase)
+	{
+		state.SetCounter(PHASE_COUNTERS[phase], clock.GetMilliseconds(static_cast<FramePhase>(phase), state.GetIterations()));
+	}
+	state.SetCounter("draws_per_frame", state.GetIterations() > 0 ? static_cast<double>(draws) / state.GetIterations() : 0.0);
+	state.SetCounter("levels", static_cast<double>(scene.levelOffsets.size() - 1));
+	state.SetCounter("threads", frame.GetThreadCount());
+}
+BENCHMARK(BM_Frame)->Args({ 1000, 0 })->Args({ 10000, 0 })->Args({ 100000, 0 })->Args({ 1000000, 0 })
+	->Args({ 100000, 1 })->Args({ 1000000, 1 })->ArgNames({ "objects", "indirect" })->NoAllocations();
+
+// SceneGenerator itself, the setup cost of a stress scene
+void BM_GenerateScene(BenchmarkState& state)
+{
+	SceneDesc desc(static_cast<uint32_t>(state.GetArg(0)));
+	GeneratedScene scene;
+	while (state.KeepRunning())
+	{
+		SceneGenerator::Generate(desc, scene);
+	}
+	state.SetItemsProcessed(state.GetIterations() * desc.objectCount);
+}
+BENCHMARK(BM_GenerateScene)->Arg(1000)->Arg(100000)->ArgNames({ "objects" });
@@ -0,0 +1,7 @@
+#include "Benchmark.h"
+
+// benchmarks register themselves from their translation units
+int main(int argc, char** argv)
+{
+	return RunBenchmarks(argc, argv);
+}
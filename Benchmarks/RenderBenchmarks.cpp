@@ -0,0 +1,320 @@
+#include "Benchmark.h"
+#include "Camera.h"
+#include "ClusterCuller.h"
+#include "DrawSortKey.h"
+#include "IndirectArgsBuilder.h"
+#include "MeshletBuilder.h"
+#include "OcclusionBuffer.h"
+#include "ParallelCommandRecorder.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	const uint32_t SEED = 0x3c6ef372;
+
+	// the cube of Engine::CreateVertexBuffer
+	const float CUBE_POSITIONS[] = {
+		-0.5f, -0.5f, -0.5f,	0.5f, -0.5f, -0.5f,	0.5f, 0.5f, -0.5f,	-0.5f, 0.5f, -0.5f,
+		-0.5f, -0.5f, 0.5f,	0.5f, -0.5f, 0.5f,	0.5f, 0.5f, 0.5f,	-0.5f, 0.5f, 0.5f
+	};
+	const uint32_t CUBE_INDICES[] = {
+		0, 1, 2, 0, 2, 3,
+		4, 7, 6, 4, 6, 5,
+		0, 3, 7, 0, 7, 4,
+		1, 6, 2, 1, 5, 6,
+		3, 6, 7, 3, 2, 6,
+		0, 4, 5, 0, 5, 1
+	};
+	const size_t CUBE_INDEX_COUNT = sizeof(CUBE_INDICES) / sizeof(CUBE_INDICES[0]);
+
+	void InitCamera(Camera& camera)
+	{
+		camera.SetPosition(0.0f, 0.0f, -3.0f);
+		camera.SetRotation(0.0f, 0.0f);
+		camera.SetPerspective(60.0f * (XM_PI / 180.0f), 800.0f / 600.0f, 0.01f, 1000.0f);
+	}
+
+	XMFLOAT4X4 GetViewProjection(Camera& camera)
+	{
+		XMFLOAT4X4 viewProjection;
+		XMStoreFloat4x4(&viewProjection, camera.GetViewMatrix() * camera.GetProjectionMatrix());
+		return viewProjection;
+	}
+
+	// a wall of flat boxes across the view, five units in front of the camera
+	void BuildOccluders(size_t count, std::vector<XMFLOAT4X4>& occluders)
+	{
+		size_t side = static_cast<size_t>(ceil(sqrt(static_cast<double>(count))));
+		float size = 6.0f / side;
+		occluders.resize(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			float x = -3.0f + size * (i % side + 0.5f);
+			float y = -2.0f + size * (i / side + 0.5f);
+			XMStoreFloat4x4(&occluders[i], XMMatrixScaling(size, size, 0.1f) * XMMatrixTranslation(x, y, 2.0f));
+		}
+	}
+
+	void RasterizeOccluders(OcclusionBuffer& buffer, const XMFLOAT4X4& viewProjection, const std::vector<XMFLOAT4X4>& occluders)
+	{
+		buffer.BeginFrame(&viewProjection.m[0][0]);
+		for (const XMFLOAT4X4& occluder : occluders)
+		{
+			buffer.AddOccluder(CUBE_POSITIONS, 3 * sizeof(float), CUBE_INDICES, CUBE_INDEX_COUNT, &occluder.m[0][0]);
+		}
+		buffer.Rasterize();
+	}
+
+	// UV sphere, the normal cones of its clusters point every way
+	void BuildSphere(uint32_t rings, std::vector<float>& positions, std::vector<uint32_t>& indices)
+	{
+		uint32_t segments = rings * 2;
+		positions.clear();
+		for (uint32_t ring = 0; ring <= rings; ++ring)
+		{
+			float theta = XM_PI * ring / rings;
+			for (uint32_t segment = 0; segment <= segments; ++segment)
+			{
+				float phi = XM_2PI * segment / segments;
+				positions.push_back(sinf(theta) * cosf(phi));
+				positions.push_back(cosf(theta));
+				positions.push_back(sinf(theta) * sinf(phi));
+			}
+		}
+
+		indices.clear();
+		for (uint32_t ring = 0; ring < rings; ++ring)
+		{
+			for (uint32_t segment = 0; segment < segments; ++segment)
+			{
+				uint32_t corner = ring * (segments + 1) + segment;
+				uint32_t quad[6] = { corner, corner + 1, corner + segments + 2, corner, corner + segments + 2, corner + segments + 1 };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+	}
+
+	// draws over a few pipelines and meshes, as the draw list of a larger scene would look
+	void BuildDraws(size_t count, std::vector<DrawItem>& draws)
+	{
+		BenchmarkRandom random(SEED);
+		draws.resize(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			DrawItem& draw = draws[i];
+			draw.indexCount = CUBE_INDEX_COUNT;
+			draw.startIndex = (random.Next() % 64) * CUBE_INDEX_COUNT;
+			draw.baseVertex = 0;
+			draw.objectIndex = static_cast<uint32_t>(i);
+			draw.pipeline = random.Next() % 4;
+			draw.mesh = random.Next() % 64;
+		}
+	}
+
+	void BuildVisibility(size_t count, uint32_t visiblePercent, std::vector<uint8_t>& visibility)
+	{
+		BenchmarkRandom random(SEED);
+		visibility.resize(count);
+		for (uint8_t& visible : visibility)
+		{
+			visible = random.Next() % 100 < visiblePercent ? 1 : 0;
+		}
+	}
+}
+
+// Engine::CullOccluded: rasterizing the occluders of one frame
+void BM_OcclusionRasterize(BenchmarkState& state)
+{
+	size_t count = static_cast<size_t>(state.GetArg(0));
+	ThreadPool threadPool;
+	OcclusionBuffer buffer(&threadPool);
+	Camera camera;
+	InitCamera(camera);
+	XMFLOAT4X4 viewProjection = GetViewProjection(camera);
+	std::vector<XMFLOAT4X4> occluders;
+	BuildOccluders(count, occluders);
+
+	// sizes the triangle list and tile bins
+	RasterizeOccluders(buffer, viewProjection, occluders);
+
+	while (state.KeepRunning())
+	{
+		RasterizeOccluders(buffer, viewProjection, occluders);
+	}
+	state.SetItemsProcessed(state.GetIterations() * buffer.GetOccluderTriangleCount());
+	state.SetCounter("triangles", static_cast<double>(buffer.GetOccluderTriangleCount()));
+	state.SetLabel("items are triangles");
+}
+BENCHMARK(BM_OcclusionRasterize)->Arg(1)->Arg(16)->Arg(256)->ArgNames({ "occluders" })->NoAllocations();
+
+// boxes scattered in and behind the wall tested against the hierarchy
+void BM_OcclusionTest(BenchmarkState& state)
+{
+	size_t count = static_cast<size_t>(state.GetArg(0));
+	ThreadPool threadPool;
+	OcclusionBuffer buffer(&threadPool);
+	Camera camera;
+	InitCamera(camera);
+	XMFLOAT4X4 viewProjection = GetViewProjection(camera);
+	std::vector<XMFLOAT4X4> occluders;
+	BuildOccluders(64, occluders);
+	RasterizeOccluders(buffer, viewProjection, occluders);
+
+	BenchmarkRandom random(SEED);
+	std::vector<float> bounds(count * 6);
+	for (size_t i = 0; i < count; ++i)
+	{
+		float x = random.NextFloat(-4.0f, 4.0f);
+		float y = random.NextFloat(-3.0f, 3.0f);
+		float z = random.NextFloat(1.0f, 20.0f);
+		float extent = random.NextFloat(0.05f, 0.5f);
+		float box[6] = { x - extent, y - extent, z - extent, x + extent, y + extent, z + extent };
+		std::copy(box, box + 6, &bounds[i * 6]);
+	}
+	std::vector<uint8_t> visibility(count);
+
+	while (state.KeepRunning())
+	{
+		buffer.TestVisibility(bounds.data(), count, visibility.data());
+		ClobberMemory();
+	}
+	state.SetItemsProcessed(state.GetIterations() * count);
+
+	size_t visible = 0;
+	for (uint8_t value : visibility)
+	{
+		visible += value != 0 ? 1 : 0;
+	}
+	state.SetCounter("visible_fraction", static_cast<double>(visible) / count);
+}
+BENCHMARK(BM_OcclusionTest)->Arg(1000)->Arg(100000)->ArgNames({ "count" })->NoAllocations();
+
+// Engine::CullClusters for a sphere seen from close by, clusters fail the frustum or their normal cone
+void BM_ClusterCull(BenchmarkState& state)
+{
+	uint32_t rings = static_cast<uint32_t>(state.GetArg(0));
+	std::vector<float> positions;
+	std::vector<uint32_t> indices;
+	BuildSphere(rings, positions, indices);
+	MeshletMesh mesh;
+	MeshletBuilder::Build(indices.data(), indices.size(), positions.data(), positions.size() / 3, 3 * sizeof(float), mesh);
+
+	ThreadPool threadPool;
+	ClusterCuller culler(&threadPool);
+	Camera camera;
+	camera.SetPosition(0.6f, 0.0f, -1.6f);
+	camera.SetRotation(0.0f, 0.0f);
+	camera.SetPerspective(60.0f * (XM_PI / 180.0f), 800.0f / 600.0f, 0.01f, 1000.0f);
+	XMFLOAT4X4 viewProjection = GetViewProjection(camera);
+	XMFLOAT3 eye;
+	XMStoreFloat3(&eye, camera.GetPosition());
+
+	// sizes the visibility list and the ranges
+	std::vector<ClusterRange> ranges;
+	ClusterFrustum frustum;
+	ClusterCuller::ExtractFrustum(&viewProjection.m[0][0], frustum);
+	uint32_t visible = culler.Cull(mesh, frustum, &eye.x, ranges);
+
+	while (state.KeepRunning())
+	{
+		ClusterCuller::ExtractFrustum(&viewProjection.m[0][0], frustum);
+		ranges.clear();
+		visible = culler.Cull(mesh, frustum, &eye.x, ranges);
+	}
+	state.SetItemsProcessed(state.GetIterations() * mesh.meshlets.size());
+	state.SetCounter("clusters", static_cast<double>(mesh.meshlets.size()));
+	state.SetCounter("visible_fraction", static_cast<double>(visible) / mesh.meshlets.size());
+	state.SetCounter("draws", static_cast<double>(ranges.size()));
+}
+BENCHMARK(BM_ClusterCull)->Arg(32)->Arg(128)->Arg(512)->ArgNames({ "rings" })->NoAllocations();
+
+// the ExecuteIndirect argument buffer, with all draws or with half of them culled
+void BM_IndirectArgsBuild(BenchmarkState& state)
+{
+	size_t count = static_cast<size_t>(state.GetArg(0));
+	bool masked = state.GetArg(1) != 0;
+	ThreadPool threadPool;
+	IndirectArgsBuilder builder(&threadPool);
+	std::vector<DrawItem> draws;
+	BuildDraws(count, draws);
+	std::vector<uint8_t> visibility;
+	BuildVisibility(count, 50, visibility);
+	std::vector<IndirectDrawCommand> commands(count);
+
+	// sizes the block offsets
+	builder.Build(draws.data(), count, masked ? visibility.data() : nullptr, commands.data());
+
+	uint32_t written = 0;
+	while (state.KeepRunning())
+	{
+		written = builder.Build(draws.data(), count, masked ? visibility.data() : nullptr, commands.data());
+		ClobberMemory();
+	}
+	state.SetItemsProcessed(state.GetIterations() * count);
+	state.SetBytesProcessed(state.GetIterations() * written * sizeof(IndirectDrawCommand));
+	state.SetCounter("commands", written);
+}
+BENCHMARK(BM_IndirectArgsBuild)->Args({ 10000, 0 })->Args({ 10000, 1 })->Args({ 1000000, 0 })->Args({ 1000000, 1 })
+	->ArgNames({ "count", "masked" })->NoAllocations();
+
+// Engine::SortDraws: keys built as the engine builds them, then the radix sort
+void BM_RadixSort(BenchmarkState& state)
+{
+	size_t count = static_cast<size_t>(state.GetArg(0));
+	ThreadPool threadPool;
+	RadixSorter sorter(&threadPool);
+	std::vector<DrawItem> draws;
+	BuildDraws(count, draws);
+
+	BenchmarkRandom random(SEED);
+	std::vector<SortableDraw> unsorted(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		unsorted[i].key = DrawSortKey::Make(0, draws[i].pipeline, 0, draws[i].mesh, random.NextFloat(0.0f, 1.0f));
+		unsorted[i].drawIndex = static_cast<uint32_t>(i);
+	}
+	std::vector<SortableDraw> keys = unsorted;
+	// sizes the scratch buffer and histograms
+	sorter.Sort(keys);
+
+	while (state.KeepRunning())
+	{
+		state.PauseTiming();
+		std::copy(unsorted.begin(), unsorted.end(), keys.begin());
+		state.ResumeTiming();
+		sorter.Sort(keys);
+	}
+	state.SetItemsProcessed(state.GetIterations() * count);
+}
+BENCHMARK(BM_RadixSort)->Arg(1000)->Arg(100000)->Arg(1000000)->ArgNames({ "count" })->NoAllocations();
+
+// Parallel recording into plain memory: the CPU side of a frame's command
+// lists without a device, over thread count and draw count.
+void BM_ParallelRecord(BenchmarkState& state)
+{
+	uint32_t threads = static_cast<uint32_t>(state.GetArg(0));
+	size_t count = static_cast<size_t>(state.GetArg(1));
+	ThreadPool threadPool(threads);
+	ParallelCommandRecorder recorder(&threadPool, 256);
+	RecordingCommandListBackend backend;
+	std::vector<DrawItem> draws;
+	BuildDraws(count, draws);
+
+	// sizes the command streams
+	recorder.Record(draws.data(), count, backend);
+
+	while (state.KeepRunning())
+	{
+		recorder.Record(draws.data(), count, backend);
+	}
+	state.SetItemsProcessed(state.GetIterations() * count);
+	state.SetBytesProcessed(state.GetIterations() * backend.GetRecordedWords() * sizeof(uint32_t));
+	state.SetCounter("chunks", backend.GetChunkCount());
+}
+BENCHMARK(BM_ParallelRecord)->Args({ 1, 10000 })->Args({ 4, 10000 })->Args({ 1, 100000 })->Args({ 4, 100000 })->Args({ 0, 100000 })
+	->ArgNames({ "threads", "count" })->NoAllocations();
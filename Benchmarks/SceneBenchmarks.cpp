@@ -0,0 +1,311 @@
+#include "Benchmark.h"
+#include "AnimationSampler.h"
+#include "EntityWorld.h"
+#include "ResolutionController.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	const uint32_t SEED = 0x6a09e667;
+
+	// the cube clip of Engine::CreateScene plus a bobbing position
+	AnimationClip BuildClip()
+	{
+		const float sampleRate = 4.0f;
+		const uint32_t keyCount = 33;
+
+		std::vector<XMFLOAT4> rotationKeys(keyCount);
+		std::vector<XMFLOAT4> colorKeys(keyCount);
+		std::vector<float> positionKeys(keyCount * 3);
+		for (uint32_t key = 0; key < keyCount; ++key)
+		{
+			float phase = static_cast<float>(key) / (keyCount - 1);
+			XMStoreFloat4(&rotationKeys[key], XMQuaternionRotationRollPitchYaw(0.0f, XM_2PI * phase, 0.0f));
+			colorKeys[key] = XMFLOAT4(phase, 1.0f - phase, 0.5f, 1.0f);
+			positionKeys[key * 3 + 1] = 0.25f * sinf(XM_2PI * phase);
+		}
+
+		AnimationClip clip(sampleRate, true);
+		clip.SetTrack(AnimationChannel::Rotation, &rotationKeys[0].x, keyCount);
+		clip.SetTrack(AnimationChannel::Color, &colorKeys[0].x, keyCount);
+		clip.SetTrack(AnimationChannel::Position, positionKeys.data(), keyCount);
+		return clip;
+	}
+
+	// size and precision of the quantized keys next to the sampling cost
+	void SetClipCounters(BenchmarkState& state, const AnimationClip& clip)
+	{
+		float maxError = 0.0f;
+		for (size_t channel = 0; channel < static_cast<size_t>(AnimationChannel::Count); ++channel)
+		{
+			maxError = std::max(maxError, clip.GetMaxQuantizationError(static_cast<AnimationChannel>(channel)));
+		}
+
+		state.SetCounter("clip_bytes", static_cast<double>(clip.GetMemoryBytes()));
+		state.SetCounter("uncompressed_bytes", static_cast<double>(clip.GetUncompressedBytes()));
+		state.SetCounter("compression_ratio", static_cast<double>(clip.GetUncompressedBytes()) / clip.GetMemoryBytes());
+		state.SetCounter("max_error", maxError);
+	}
+
+	void BuildInstances(std::vector<AnimationInstance>& instances, const AnimationClip& clip)
+	{
+		BenchmarkRandom random(SEED);
+		for (AnimationInstance& instance : instances)
+		{
+			instance.clip = 0;
+			instance.time = random.NextFloat(0.0f, clip.GetDuration());
+		}
+	}
+
+	struct SceneComponents
+	{
+		ComponentType world;
+		ComponentType color;
+		ComponentType animation;
+		ComponentType objectIndex;
+	};
+
+	SceneComponents RegisterSceneComponents(EntityWorld& world)
+	{
+		SceneComponents components;
+		components.world = world.RegisterComponent<XMFLOAT4X4>();
+		components.color = world.RegisterComponent<XMFLOAT4>();
+		components.animation = world.RegisterComponent<AnimationInstance>();
+		components.objectIndex = world.RegisterComponent<uint32_t>();
+		return components;
+	}
+
+	ComponentMask GetObjectMask(const SceneComponents& components)
+	{
+		return EntityWorld::MaskOf(components.world) | EntityWorld::MaskOf(components.color) | EntityWorld::MaskOf(components.objectIndex);
+	}
+
+	// a cost of fixed + perArea * scale^2 milliseconds, measured latency frames late
+	struct GpuLoad
+	{
+		float fixedMs;
+		float perAreaMs;
+	};
+
+	const uint32_t RESOLUTION_FRAMES = 240;
+	const uint32_t RESOLUTION_LATENCY = 2;
+	const uint32_t LOAD_DROP_FRAME = 120;
+
+	void SimulateResolution(ResolutionController& controller, const GpuLoad& heavy, const GpuLoad& light, float* scales)
+	{
+		controller.Reset(1.0f);
+		for (uint32_t frame = 0; frame < RESOLUTION_FRAMES; ++frame)
+		{
+			scales[frame] = controller.GetScale();
+			if (frame >= RESOLUTION_LATENCY)
+			{
+				uint32_t measured = frame - RESOLUTION_LATENCY;
+				const GpuLoad& load = measured < LOAD_DROP_FRAME ? heavy : light;
+				float scale = scales[measured];
+				controller.Update(load.fixedMs + load.perAreaMs * scale * scale, scale);
+			}
+		}
+	}
+
+	// first frame of [first, end) after which the scale stays within 1% of its final value
+	uint32_t GetSettleFrame(const float* scales, uint32_t first, uint32_t end)
+	{
+		float settled = scales[end - 1];
+		uint32_t frame = end;
+		while (frame > first && fabsf(scales[frame - 1] - settled) <= 0.01f * settled)
+		{
+			--frame;
+		}
+		return frame;
+	}
+}
+
+// the animation system of UpdateScene: sampling clips into world matrices and colors on the pool
+void BM_AnimationSample(BenchmarkState& state)
+{
+	size_t count = static_cast<size_t>(state.GetArg(0));
+	ThreadPool threadPool;
+	AnimationSampler sampler(&threadPool);
+	AnimationClip clip = BuildClip();
+	std::vector<AnimationInstance> instances(count);
+	BuildInstances(instances, clip);
+	std::vector<XMFLOAT4X4> worldMats(count);
+	std::vector<XMFLOAT4> colors(count);
+
+	while (state.KeepRunning())
+	{
+		AnimationSampler::Advance(&clip, instances.data(), count, 1.0f / 60.0f);
+		sampler.Sample(&clip, instances.data(), count, worldMats.data(), colors.data());
+	}
+	state.SetItemsProcessed(state.GetIterations() * count);
+	state.SetCounter("threads", threadPool.GetThreadCount());
+	SetClipCounters(state, clip);
+}
+BENCHMARK(BM_AnimationSample)->Arg(1000)->Arg(100000)->Arg(1000000)->ArgNames({ "count" })->NoAllocations();
+
+// decode cost on one core
+void BM_AnimationSampleRange(BenchmarkState& state)
+{
+	size_t count = static_cast<size_t>(state.GetArg(0));
+	AnimationClip clip = BuildClip();
+	std::vector<AnimationInstance> instances(count);
+	BuildInstances(instances, clip);
+	std::vector<XMFLOAT4X4> worldMats(count);
+	std::vector<XMFLOAT4> colors(count);
+
+	while (state.KeepRunning())
+	{
+		AnimationSampler::Advance(&clip, instances.data(), count, 1.0f / 60.0f);
+		AnimationSampler::SampleRange(&clip, instances.data(), 0, count, worldMats.data(), colors.data());
+	}
+	state.SetItemsProcessed(state.GetIterations() * count);
+	SetClipCounters(state, clip);
+}
+BENCHMARK(BM_AnimationSampleRange)->Arg(1000)->Arg(100000)->ArgNames({ "count" })->NoAllocations();
+
+// a two component system walking every chunk
+void BM_EntityIterate(BenchmarkState& state)
+{
+	size_t count = static_cast<size_t>(state.GetArg(0));
+	EntityWorld world;
+	SceneComponents components = RegisterSceneComponents(world);
+	for (size_t i = 0; i < count; ++i)
+	{
+		world.Create(GetObjectMask(components));
+	}
+
+	while (state.KeepRunning())
+	{
+		world.ForEachChunk(EntityWorld::MaskOf(components.world) | EntityWorld::MaskOf(components.color), 0,
+			[&components](const EntityChunkView& chunk)
+		{
+			XMFLOAT4X4* worldMats = chunk.Get<XMFLOAT4X4>(components.world);
+			const XMFLOAT4* colors = chunk.Get<XMFLOAT4>(components.color);
+			for (uint32_t i = 0; i < chunk.count; ++i)
+			{
+				worldMats[i]._42 += colors[i].y;
+			}
+		});
+		ClobberMemory();
+	}
+	state.SetItemsProcessed(state.GetIterations() * count);
+	state.SetCounter("chunks", static_cast<double>(world.GetChunkCount()));
+}
+BENCHMARK(BM_EntityIterate)->Arg(1000)->Arg(100000)->Arg(1000000)->ArgNames({ "count" })->NoAllocations();
+
+void BM_EntityParallelIterate(BenchmarkState& state)
+{
+	size_t count = static_cast<size_t>(state.GetArg(0));
+	ThreadPool threadPool;
+	EntityWorld world;
+	SceneComponents components = RegisterSceneComponents(world);
+	for (size_t i = 0; i < count; ++i)
+	{
+		world.Create(GetObjectMask(components));
+	}
+
+	// sizes the reused chunk list
+	ComponentMask required = EntityWorld::MaskOf(components.world) | EntityWorld::MaskOf(components.color);
+	std::function<void(const EntityChunkView&, uint32_t)> system = [&components](const EntityChunkView& chunk, uint32_t)
+	{
+		XMFLOAT4X4* worldMats = chunk.Get<XMFLOAT4X4>(components.world);
+		const XMFLOAT4* colors = chunk.Get<XMFLOAT4>(components.color);
+		for (uint32_t i = 0; i < chunk.count; ++i)
+		{
+			worldMats[i]._42 += colors[i].y;
+		}
+	};
+	world.ParallelForEachChunk(threadPool, required, 0, system);
+
+	while (state.KeepRunning())
+	{
+		world.ParallelForEachChunk(threadPool, required, 0, system);
+	}
+	state.SetItemsProcessed(state.GetIterations() * count);
+	state.SetCounter("threads", threadPool.GetThreadCount());
+}
+BENCHMARK(BM_EntityParallelIterate)->Arg(100000)->Arg(1000000)->ArgNames({ "count" })->NoAllocations();
+
+void BM_EntityCreateDestroy(BenchmarkState& state)
+{
+	size_t count = static_cast<size_t>(state.GetArg(0));
+	EntityWorld world;
+	SceneComponents components = RegisterSceneComponents(world);
+	std::vector<Entity> entities(count);
+
+	while (state.KeepRunning())
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			entities[i] = world.Create(GetObjectMask(components));
+		}
+		for (size_t i = 0; i < count; ++i)
+		{
+			world.Destroy(entities[i]);
+		}
+	}
+	state.SetItemsProcessed(state.GetIterations() * count);
+}
+BENCHMARK(BM_EntityCreateDestroy)->Arg(1000)->Arg(100000)->ArgNames({ "count" });
+
+// adding and removing a component moves the entity between archetypes
+void BM_EntityArchetypeMove(BenchmarkState& state)
+{
+	size_t count = static_cast<size_t>(state.GetArg(0));
+	EntityWorld world;
+	SceneComponents components = RegisterSceneComponents(world);
+	std::vector<Entity> entities(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		entities[i] = world.Create(GetObjectMask(components));
+	}
+	ComponentMask animation = EntityWorld::MaskOf(components.animation);
+
+	while (state.KeepRunning())
+	{
+		for (const Entity& entity : entities)
+		{
+			world.AddComponents(entity, animation);
+		}
+		for (const Entity& entity : entities)
+		{
+			world.RemoveComponents(entity, animation);
+		}
+	}
+	state.SetItemsProcessed(state.GetIterations() * count * 2);
+}
+BENCHMARK(BM_EntityArchetypeMove)->Arg(1000)->Arg(100000)->ArgNames({ "count" });
+
+// The convergence trace of the dynamic resolution controller: the GPU cost
+// is 2 ms + 30 ms * scale^2 against a 14 ms budget, measured two frames late,
+// and drops to 2 ms + 10 ms * scale^2 halfway. The counters report how many
+// frames the scale needs to settle after the start and after the drop,
+// currently 11 and 13. The recovery is bound by the filter relearning the
+// cost, not by MAX_RAISE, which alone would take 6 frames from 0.62 to 1.
+void BM_ResolutionConvergence(BenchmarkState& state)
+{
+	const GpuLoad heavy = { 2.0f, 30.0f };
+	const GpuLoad light = { 2.0f, 10.0f };
+	ResolutionController controller(14.0f);
+	std::vector<float> scales(RESOLUTION_FRAMES);
+
+	while (state.KeepRunning())
+	{
+		SimulateResolution(controller, heavy, light, scales.data());
+	}
+	state.SetItemsProcessed(state.GetIterations() * RESOLUTION_FRAMES);
+
+	float settledScale = scales[LOAD_DROP_FRAME - 1];
+	state.SetCounter("settle_frames", GetSettleFrame(scales.data(), 0, LOAD_DROP_FRAME));
+	state.SetCounter("settled_scale", settledScale);
+	state.SetCounter("settled_ms", heavy.fixedMs + heavy.perAreaMs * settledScale * settledScale);
+	state.SetCounter("recovery_frames", GetSettleFrame(scales.data(), LOAD_DROP_FRAME, RESOLUTION_FRAMES) - LOAD_DROP_FRAME);
+	state.SetCounter("recovered_scale", scales[RESOLUTION_FRAMES - 1]);
+	state.SetLabel("items are simulated frames");
+}
+BENCHMARK(BM_ResolutionConvergence)->NoAllocations();
@@ -0,0 +1,322 @@
+#include "Benchmark.h"
+#include "Camera.h"
+#include "TransformCore.h"
+#include "TransformPacking.h"
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	const uint32_t SEED = 0x2545f491;
+
+	// SimdLevel values with their own kernels
+	const int64_t KERNEL_LEVELS[] = { static_cast<int64_t>(SimdLevel::Scalar), static_cast<int64_t>(SimdLevel::Sse2),
+		static_cast<int64_t>(SimdLevel::Avx2) };
+	const int64_t OBJECT_COUNTS[] = { 1000, 10000, 100000 };
+
+	void FillMatrices(std::vector<XMFLOAT4X4>& matrices, BenchmarkRandom& random)
+	{
+		for (XMFLOAT4X4& matrix : matrices)
+		{
+			XMStoreFloat4x4(&matrix, ComposeWorldMatrix(
+				XMVectorReplicate(random.NextFloat(0.5f, 2.0f)),
+				XMVectorSet(random.NextFloat(-100.0f, 100.0f), random.NextFloat(-100.0f, 100.0f), random.NextFloat(-100.0f, 100.0f), 0.0f),
+				XMVectorSet(random.NextFloat(-XM_PI, XM_PI), random.NextFloat(-XM_PI, XM_PI), random.NextFloat(-XM_PI, XM_PI), 0.0f)));
+		}
+	}
+
+	void FillFloats(std::vector<float>& values, BenchmarkRandom& random, float minimum, float maximum)
+	{
+		for (float& value : values)
+		{
+			value = random.NextFloat(minimum, maximum);
+		}
+	}
+
+	// the camera of Engine::InitWvp
+	void InitCamera(Camera& camera)
+	{
+		camera.SetPosition(0.0f, 0.0f, -3.0f);
+		camera.SetRotation(0.0f, 0.0f);
+		camera.SetPerspective(60.0f * (XM_PI / 180.0f), 800.0f / 600.0f, 0.01f, 1000.0f);
+	}
+
+	const TransformKernels& GetKernels(BenchmarkState& state)
+	{
+		const TransformKernels& kernels = GetTransformKernels(static_cast<SimdLevel>(state.GetArg(0)));
+		state.SetLabel(GetSimdLevelName(kernels.level));
+		return kernels;
+	}
+
+	void LevelsAndCounts(Benchmark* benchmark)
+	{
+		for (int64_t level : KERNEL_LEVELS)
+		{
+			for (int64_t count : OBJECT_COUNTS)
+			{
+				benchmark->Args({ level, count });
+			}
+		}
+		benchmark->ArgNames({ "level", "count" });
+	}
+
+	void LevelsAccuraciesAndCounts(Benchmark* benchmark)
+	{
+		for (int64_t level : KERNEL_LEVELS)
+		{
+			for (int64_t accuracy = 0; accuracy < 2; ++accuracy)
+			{
+				for (int64_t count : OBJECT_COUNTS)
+				{
+					benchmark->Args({ level, accuracy, count });
+				}
+			}
+		}
+		benchmark->ArgNames({ "level", "precise", "count" });
+	}
+}
+
+// world matrix composition of CreateScene and InitWvp, one object at a time through DirectXMath
+void BM_ComposeWorldMatrix(BenchmarkState& state)
+{
+	size_t count = static_cast<size_t>(state.GetArg(0));
+	BenchmarkRandom random(SEED);
+	std::vector<float> scales(count);
+	std::vector<float> positions(count * 3);
+	std::vector<float> angles(count * 3);
+	FillFloats(scales, random, 0.5f, 2.0f);
+	FillFloats(positions, random, -100.0f, 100.0f);
+	FillFloats(angles, random, -XM_PI, XM_PI);
+	std::vector<XMFLOAT4X4> worldMats(count);
+
+	while (state.KeepRunning())
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			XMMATRIX worldMat = ComposeWorldMatrix(XMVectorReplicate(scales[i]),
+				XMVectorSet(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2], 0.0f),
+				XMVectorSet(angles[i * 3], angles[i * 3 + 1], angles[i * 3 + 2], 0.0f));
+			XMStoreFloat4x4(&worldMats[i], worldMat);
+		}
+		ClobberMemory();
+	}
+	state.SetItemsProcessed(state.GetIterations() * count);
+}
+BENCHMARK(BM_ComposeWorldMatrix)->Arg(1000)->Arg(10000)->Arg(100000)->ArgNames({ "count" })->NoAllocations();
+
+// the batched structure of arrays form of the same composition
+void BM_ComposeSrt(BenchmarkState& state)
+{
+	const TransformKernels& kernels = GetKernels(state);
+	TrigAccuracy accuracy = state.GetArg(1) != 0 ? TrigAccuracy::Precise : TrigAccuracy::Fast;
+	size_t count = static_cast<size_t>(state.GetArg(2));
+
+	BenchmarkRandom random(SEED);
+	std::vector<float> streams(count * 9);
+	FillFloats(streams, random, -XM_PI, XM_PI);
+	SrtStreams srt = { &streams[0], &streams[count], &streams[count * 2], &streams[count * 3], &streams[count * 4],
+		&streams[count * 5], &streams[count * 6], &streams[count * 7], &streams[count * 8] };
+	std::vector<XMFLOAT4X4> worldMats(count);
+
+	while (state.KeepRunning())
+	{
+		kernels.composeSrt(srt, worldMats.data(), count, accuracy);
+		ClobberMemory();
+	}
+	state.SetItemsProcessed(state.GetIterations() * count);
+}
+BENCHMARK(BM_ComposeSrt)->Apply(LevelsAccuraciesAndCounts)->NoAllocations();
+
+void BM_SinCos(BenchmarkState& state)
+{
+	const TransformKernels& kernels = GetKernels(state);
+	TrigAccuracy accuracy = state.GetArg(1) != 0 ? TrigAccuracy::Precise : TrigAccuracy::Fast;
+	size_t count = static_cast<size_t>(state.GetArg(2));
+
+	BenchmarkRandom random(SEED);
+	std::vector<float> angles(count);
+	FillFloats(angles, random, -4.0f * XM_PI, 4.0f * XM_PI);
+	std::vector<float> sines(count);
+	std::vector<float> cosines(count);
+
+	while (state.KeepRunning())
+	{
+		kernels.sinCos(angles.data(), sines.data(), cosines.data(), count, accuracy);
+		ClobberMemory();
+	}
+	state.SetItemsProcessed(state.GetIterations() * count);
+}
+BENCHMARK(BM_SinCos)->Apply(LevelsAccuraciesAndCounts)->NoAllocations();
+
+// transpose(world * viewProjection), the WVP upload of every object
+void BM_MultiplyTranspose(BenchmarkState& state)
+{
+	const TransformKernels& kernels = GetKernels(state);
+	size_t count = static_cast<size_t>(state.GetArg(1));
+
+	BenchmarkRandom random(SEED);
+	std::vector<XMFLOAT4X4> worldMats(count);
+	FillMatrices(worldMats, random);
+	std::vector<XMFLOAT4X4> packed(count);
+
+	Camera camera;
+	InitCamera(camera);
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection, camera.GetViewMatrix() * camera.GetProjectionMatrix());
+
+	while (state.KeepRunning())
+	{
+		kernels.multiplyTranspose(worldMats.data(), viewProjection, packed.data(), count);
+		ClobberMemory();
+	}
+	state.SetItemsProcessed(state.GetIterations() * count);
+	state.SetBytesProcessed(state.GetIterations() * count * sizeof(XMFLOAT4X4));
+}
+BENCHMARK(BM_MultiplyTranspose)->Apply(LevelsAndCounts)->NoAllocations();
+
+// the 48 byte affine upload format
+void BM_PackAffineTransforms(BenchmarkState& state)
+{
+	size_t count = static_cast<size_t>(state.GetArg(0));
+	BenchmarkRandom random(SEED);
+	std::vector<XMFLOAT4X4> worldMats(count);
+	FillMatrices(worldMats, random);
+	std::vector<AffineTransform> packed(count);
+
+	while (state.KeepRunning())
+	{
+		PackAffineTransforms(worldMats.data(), packed.data(), count);
+		ClobberMemory();
+	}
+	state.SetItemsProcessed(state.GetIterations() * count);
+	state.SetBytesProcessed(state.GetIterations() * count * sizeof(AffineTransform));
+}
+BENCHMARK(BM_PackAffineTransforms)->Arg(1000)->Arg(10000)->Arg(100000)->ArgNames({ "count" })->NoAllocations();
+
+// Engine::InitWvp: camera setup, projection and the first WVP
+void BM_InitWvp(BenchmarkState& state)
+{
+	XMFLOAT4X4 worldMat;
+	XMStoreFloat4x4(&worldMat, ComposeWorldMatrix(XMVectorReplicate(1.0f), XMVectorZero(), XMVectorZero()));
+	XMFLOAT4X4 wvp;
+
+	while (state.KeepRunning())
+	{
+		Camera camera;
+		InitCamera(camera);
+		PackWvpTransforms(&worldMat, camera.GetViewMatrix() * camera.GetProjectionMatrix(), &wvp, 1);
+		DoNotOptimize(wvp);
+	}
+	state.SetItemsProcessed(state.GetIterations());
+}
+BENCHMARK(BM_InitWvp)->NoAllocations();
+
+// Engine::UpdateWvp with the camera moving and turning every frame, for one
+// object as in the engine today and for larger scenes
+void BM_UpdateWvp(BenchmarkState& state)
+{
+	size_t count = static_cast<size_t>(state.GetArg(0));
+	BenchmarkRandom random(SEED);
+	std::vector<XMFLOAT4X4> worldMats(count);
+	FillMatrices(worldMats, random);
+	std::vector<XMFLOAT4X4> packed(count);
+
+	Camera camera;
+	InitCamera(camera);
+	const float deltaSec = 1.0f / 60.0f;
+
+	while (state.KeepRunning())
+	{
+		camera.Move(1.0f * deltaSec, 0.5f * deltaSec);
+		camera.Rotate(0.005f, 0.01f);
+		PackWvpTransforms(worldMats.data(), camera.GetViewMatrix() * camera.GetProjectionMatrix(), packed.data(), count);
+		ClobberMemory();
+	}
+	state.SetItemsProcessed(state.GetIterations() * count);
+}
+BENCHMARK(BM_UpdateWvp)->Arg(1)->Arg(1000)->Arg(100000)->ArgNames({ "count" })->NoAllocations();
+
+// the path Camera replaced, as a baseline for BM_InitWvp: world from scale, translation
+// and roll-pitch-yaw matrices, a hand built view and world * view * projection
+void BM_InitWvpBaseline(BenchmarkState& state)
+{
+	// the inputs were members, keep the compiler from folding them into constants
+	XMFLOAT4 scale(1.0f, 1.0f, 1.0f, 0.0f);
+	XMFLOAT4 position(0.0f, 0.0f, 0.0f, 0.0f);
+	XMFLOAT4 rotation(0.0f, 0.0f, 0.0f, 0.0f);
+	XMFLOAT4 cameraPosition(0.0f, 0.0f, -3.0f, 0.0f);
+	float fovAngleY = 60.0f * (XM_PI / 180.0f);
+	DoNotOptimize(scale);
+	DoNotOptimize(position);
+	DoNotOptimize(rotation);
+	DoNotOptimize(cameraPosition);
+	DoNotOptimize(fovAngleY);
+	XMFLOAT4X4 wvp;
+
+	while (state.KeepRunning())
+	{
+		ClobberMemory();
+		XMMATRIX scaleMat = XMMatrixScalingFromVector(XMLoadFloat4(&scale));
+		XMMATRIX positionMat = XMMatrixTranslationFromVector(XMLoadFloat4(&position));
+		XMMATRIX rotationMat = XMMatrixRotationRollPitchYawFromVector(XMLoadFloat4(&rotation));
+		XMMATRIX worldMat = scaleMat * positionMat * rotationMat;
+
+		XMMATRIX viewMat = XMMatrixTranslation(-cameraPosition.x, -cameraPosition.y, -cameraPosition.z);
+		XMMATRIX projectionMat = XMMatrixPerspectiveFovLH(fovAngleY, 800.0f / 600.0f, 0.01f, 1000.0f);
+
+		XMStoreFloat4x4(&wvp, XMMatrixTranspose(worldMat * viewMat * projectionMat));
+		DoNotOptimize(wvp);
+	}
+	state.SetItemsProcessed(state.GetIterations());
+}
+BENCHMARK(BM_InitWvpBaseline)->NoAllocations();
+
+// the path Camera replaced, as a baseline for BM_UpdateWvp: the move basis from a
+// roll-pitch-yaw matrix, the view as the general inverse of rotation * translation
+// and world * view * projection for every object
+void BM_UpdateWvpBaseline(BenchmarkState& state)
+{
+	size_t count = static_cast<size_t>(state.GetArg(0));
+	BenchmarkRandom random(SEED);
+	std::vector<XMFLOAT4X4> worldMats(count);
+	FillMatrices(worldMats, random);
+	std::vector<XMFLOAT4X4> packed(count);
+
+	XMFLOAT4X4 projection;
+	XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(60.0f * (XM_PI / 180.0f), 800.0f / 600.0f, 0.01f, 1000.0f));
+	XMFLOAT4 cameraPosition(0.0f, 0.0f, -3.0f, 0.0f);
+	XMFLOAT4 cameraRotation(0.0f, 0.0f, 0.0f, 0.0f);
+	const float deltaSec = 1.0f / 60.0f;
+
+	while (state.KeepRunning())
+	{
+		XMMATRIX cameraRotationMat = XMMatrixRotationRollPitchYawFromVector(XMLoadFloat4(&cameraRotation));
+		XMVECTOR forwardVec = XMVector4Transform(XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), cameraRotationMat);
+		XMVECTOR rightVec = XMVector4Transform(XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f), cameraRotationMat);
+
+		XMVECTOR cameraPositionVec = XMLoadFloat4(&cameraPosition);
+		cameraPositionVec = XMVectorAdd(cameraPositionVec, XMVectorScale(forwardVec, 1.0f * deltaSec));
+		cameraPositionVec = XMVectorAdd(cameraPositionVec, XMVectorScale(rightVec, 0.5f * deltaSec));
+		XMStoreFloat4(&cameraPosition, cameraPositionVec);
+
+		cameraRotation.y += 0.01f;
+		cameraRotation.x += 0.005f;
+		cameraRotation.x = cameraRotation.x < -XM_PIDIV2 ? -XM_PIDIV2 : (cameraRotation.x > XM_PIDIV2 ? XM_PIDIV2 : cameraRotation.x);
+		XMStoreFloat4(&cameraRotation, XMVectorModAngles(XMLoadFloat4(&cameraRotation)));
+
+		XMMATRIX rotationMat = XMMatrixRotationRollPitchYawFromVector(XMLoadFloat4(&cameraRotation));
+		XMMATRIX translationMat = XMMatrixTranslationFromVector(XMLoadFloat4(&cameraPosition));
+		XMMATRIX viewMat = XMMatrixInverse(nullptr, rotationMat * translationMat);
+		XMMATRIX projectionMat = XMLoadFloat4x4(&projection);
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			XMMATRIX worldMat = XMLoadFloat4x4(&worldMats[i]);
+			XMStoreFloat4x4(&packed[i], XMMatrixTranspose(worldMat * viewMat * projectionMat));
+		}
+		ClobberMemory();
+	}
+	state.SetItemsProcessed(state.GetIterations() * count);
+}
+BENCHMARK(BM_UpdateWvpBaseline)->Arg(1)->Arg(1000)->Arg(100000)->ArgNames({ "count" })->NoAllocations();
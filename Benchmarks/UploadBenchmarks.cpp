@@ -0,0 +1,330 @@
+#include "Benchmark.h"
+#include "DirtyTracker.h"
+#include "FrameArena.h"
+#include "GeometryPool.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include "TransformPacking.h"
+#include "UploadWriter.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	const uint32_t SEED = 0x9e3779b9;
+
+	// layout of the engine's Vertex
+	struct GridVertex
+	{
+		float pos[3];
+		float color[4];
+	};
+
+	struct GridMesh
+	{
+		std::vector<GridVertex> vertices;
+		std::vector<uint32_t> indices;
+	};
+
+	// quads x quads grid with a seeded height field, a mesh that simplifies like terrain
+	void BuildGrid(uint32_t quads, GridMesh& mesh)
+	{
+		BenchmarkRandom random(SEED);
+		uint32_t side = quads + 1;
+		mesh.vertices.resize(side * side);
+		for (uint32_t y = 0; y < side; ++y)
+		{
+			for (uint32_t x = 0; x < side; ++x)
+			{
+				GridVertex& vertex = mesh.vertices[y * side + x];
+				vertex.pos[0] = static_cast<float>(x) / quads - 0.5f;
+				vertex.pos[1] = 0.05f * sinf(x * 0.3f) * cosf(y * 0.2f) + random.NextFloat(-0.001f, 0.001f);
+				vertex.pos[2] = static_cast<float>(y) / quads - 0.5f;
+				vertex.color[0] = 0.0f;
+				vertex.color[1] = 0.0f;
+				vertex.color[2] = 1.0f;
+				vertex.color[3] = 1.0f;
+			}
+		}
+
+		mesh.indices.clear();
+		for (uint32_t y = 0; y < quads; ++y)
+		{
+			for (uint32_t x = 0; x < quads; ++x)
+			{
+				uint32_t corner = y * side + x;
+				uint32_t quad[6] = { corner, corner + side, corner + side + 1, corner, corner + side + 1, corner + 1 };
+				mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+			}
+		}
+	}
+
+	// 64 byte aligned like a mapped upload heap
+	struct AlignedBuffer
+	{
+		std::unique_ptr<uint8_t[]> memory;
+		uint8_t* data;
+
+		explicit AlignedBuffer(size_t size)
+			: memory(new uint8_t[size + 64])
+		{
+			data = memory.get() + ((64 - (reinterpret_cast<uintptr_t>(memory.get()) & 63)) & 63);
+			memset(data, 0, size);
+		}
+	};
+}
+
+// plain memcpy of constant data, what Update did before UploadWriter
+void BM_ConstantBufferMemcpy(BenchmarkState& state)
+{
+	size_t size = static_cast<size_t>(state.GetArg(0));
+	AlignedBuffer source(size);
+	AlignedBuffer destination(size);
+
+	while (state.KeepRunning())
+	{
+		memcpy(destination.data, source.data, size);
+		ClobberMemory();
+	}
+	state.SetBytesProcessed(state.GetIterations() * size);
+}
+BENCHMARK(BM_ConstantBufferMemcpy)->Range(64, 64 << 20)->ArgNames({ "bytes" })->NoAllocations();
+
+// the same copies through UploadWriter's non-temporal stores; on the device
+// the destination is write-combined memory, here it is cached, so this
+// shows the cache pollution saved rather than the PCIe behaviour
+void BM_StreamingCopy(BenchmarkState& state)
+{
+	size_t size = static_cast<size_t>(state.GetArg(0));
+	AlignedBuffer source(size);
+	AlignedBuffer destination(size);
+	UploadWriter writer(destination.data, size);
+
+	while (state.KeepRunning())
+	{
+		writer.Write(0, source.data, size);
+		writer.Flush();
+	}
+	state.SetBytesProcessed(state.GetIterations() * size);
+}
+BENCHMARK(BM_StreamingCopy)->Range(64, 64 << 20)->ArgNames({ "bytes" })->NoAllocations();
+
+// Engine::UploadObjects in affine mode: dirty ranges are collected, packed
+// through the frame arena and streamed into the frame's object buffer
+void BM_UploadObjects(BenchmarkState& state)
+{
+	uint32_t count = static_cast<uint32_t>(state.GetArg(0));
+	uint32_t dirtyPercent = static_cast<uint32_t>(state.GetArg(1));
+	const uint32_t frameCount = 2;
+
+	BenchmarkRandom random(SEED);
+	std::vector<XMFLOAT4X4> worldMats(count);
+	for (XMFLOAT4X4& worldMat : worldMats)
+	{
+		XMStoreFloat4x4(&worldMat, XMMatrixTranslation(random.NextFloat(-100.0f, 100.0f), 0.0f, random.NextFloat(-100.0f, 100.0f)));
+	}
+
+	// the same objects change every frame, as an animated subset would
+	std::vector<uint32_t> dirtyObjects;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if (random.Next() % 100 < dirtyPercent)
+		{
+			dirtyObjects.push_back(i);
+		}
+	}
+
+	DirtyTracker tracker(count, frameCount);
+	std::vector<DirtyRange> ranges;
+	ranges.reserve(count);
+	FrameArena arena;
+	AlignedBuffer objectBuffer(count * sizeof(AffineTransform));
+	UploadWriter writer(objectBuffer.data, count * sizeof(AffineTransform));
+
+	// the first frames upload everything and size the arena
+	uint32_t frameIndex = 0;
+	for (uint32_t frame = 0; frame < frameCount; ++frame)
+	{
+		tracker.CollectDirtyRanges(frameIndex, ranges);
+		arena.Allocate<AffineTransform>(count);
+		arena.Reset();
+		frameIndex = (frameIndex + 1) % frameCount;
+	}
+
+	size_t uploaded = 0;
+	while (state.KeepRunning())
+	{
+		for (uint32_t object : dirtyObjects)
+		{
+			tracker.MarkDirty(object);
+		}
+
+		tracker.CollectDirtyRanges(frameIndex, ranges);
+		for (const DirtyRange& range : ranges)
+		{
+			AffineTransform* staging = arena.Allocate<AffineTransform>(range.count);
+			PackAffineTransforms(&worldMats[range.first], staging, range.count);
+			writer.Write(range.first * sizeof(AffineTransform), staging, range.count * sizeof(AffineTransform));
+			uploaded += range.count;
+		}
+		writer.Flush();
+
+		arena.Reset();
+		frameIndex = (frameIndex + 1) % frameCount;
+	}
+	state.SetItemsProcessed(state.GetIterations() * count);
+	state.SetCounter("uploaded_per_frame", static_cast<double>(uploaded) / state.GetIterations());
+	state.SetCounter("ranges_per_frame", static_cast<double>(ranges.size()));
+}
+BENCHMARK(BM_UploadObjects)->Args({ 1000, 10 })->Args({ 10000, 10 })->Args({ 100000, 10 })->Args({ 100000, 100 })
+	->ArgNames({ "count", "dirty%" })->NoAllocations();
+
+// CreateVertexBuffer's offline work per mesh size: clusters, LOD chain,
+// a pool range and the copy into the staging buffer of the copy queue
+void BM_GeometryUpload(BenchmarkState& state)
+{
+	GridMesh grid;
+	BuildGrid(static_cast<uint32_t>(state.GetArg(0)), grid);
+	uint32_t vertexCount = static_cast<uint32_t>(grid.vertices.size());
+
+	GeometryPool pool(vertexCount * 2, static_cast<uint32_t>(grid.indices.size()) * 4);
+	MeshletMesh meshlets;
+	MeshLodChain lods;
+	std::vector<uint8_t> staging(grid.vertices.size() * sizeof(GridVertex) + grid.indices.size() * 4 * sizeof(uint32_t));
+
+	while (state.KeepRunning())
+	{
+		MeshletBuilder::Build(grid.indices.data(), grid.indices.size(), grid.vertices[0].pos, vertexCount, sizeof(GridVertex), meshlets);
+		MeshSimplifier::BuildLodChain(meshlets.indices.data(), meshlets.indices.size(), grid.vertices[0].pos, vertexCount, sizeof(GridVertex),
+			4, 0.5f, 1.0f, lods);
+
+		MeshHandle mesh = pool.AddMesh(vertexCount, static_cast<uint32_t>(lods.indices.size()));
+		if (mesh == GeometryPool::INVALID_HANDLE)
+		{
+			state.SkipWithError("the geometry pool is full");
+			return;
+		}
+
+		size_t vertexBytes = grid.vertices.size() * sizeof(GridVertex);
+		StreamingCopy(staging.data(), grid.vertices.data(), vertexBytes);
+		StreamingCopy(staging.data() + vertexBytes, lods.indices.data(), lods.indices.size() * sizeof(uint32_t));
+		pool.RemoveMesh(mesh);
+	}
+	state.SetItemsProcessed(state.GetIterations() * grid.indices.size() / 3);
+	state.SetCounter("lods", static_cast<double>(lods.lods.size()));
+	state.SetCounter("meshlets", static_cast<double>(meshlets.meshlets.size()));
+	state.SetLabel("items are triangles");
+}
+BENCHMARK(BM_GeometryUpload)->Arg(1)->Arg(16)->Arg(64)->Arg(256)->ArgNames({ "quads" });
+
+void BM_BuildMeshlets(BenchmarkState& state)
+{
+	GridMesh grid;
+	BuildGrid(static_cast<uint32_t>(state.GetArg(0)), grid);
+	MeshletMesh meshlets;
+
+	while (state.KeepRunning())
+	{
+		MeshletBuilder::Build(grid.indices.data(), grid.indices.size(), grid.vertices[0].pos, grid.vertices.size(), sizeof(GridVertex), meshlets);
+	}
+	state.SetItemsProcessed(state.GetIterations() * grid.indices.size() / 3);
+}
+BENCHMARK(BM_BuildMeshlets)->Arg(16)->Arg(64)->Arg(256)->ArgNames({ "quads" });
+
+void BM_BuildLodChain(BenchmarkState& state)
+{
+	GridMesh grid;
+	BuildGrid(static_cast<uint32_t>(state.GetArg(0)), grid);
+	MeshLodChain lods;
+
+	while (state.KeepRunning())
+	{
+		MeshSimplifier::BuildLodChain(grid.indices.data(), grid.indices.size(), grid.vertices[0].pos, grid.vertices.size(), sizeof(GridVertex),
+			4, 0.5f, 1.0f, lods);
+	}
+	state.SetItemsProcessed(state.GetIterations() * grid.indices.size() / 3);
+}
+BENCHMARK(BM_BuildLodChain)->Arg(16)->Arg(64)->Arg(256)->ArgNames({ "quads" });
+
+// streaming meshes in and out of the shared buffers with periodic compaction
+void BM_GeometryPoolChurn(BenchmarkState& state)
+{
+	uint32_t meshCount = static_cast<uint32_t>(state.GetArg(0));
+	BenchmarkRandom random(SEED);
+	GeometryPool pool(meshCount * 512, meshCount * 1536);
+	std::vector<MeshHandle> meshes(meshCount, GeometryPool::INVALID_HANDLE);
+	CompactionPlan plan;
+	uint64_t compactions = 0;
+
+	while (state.KeepRunning())
+	{
+		uint32_t slot = random.Next() % meshCount;
+		if (meshes[slot] != GeometryPool::INVALID_HANDLE)
+		{
+			pool.RemoveMesh(meshes[slot]);
+		}
+
+		uint32_t vertexCount = 24 + random.Next() % 360;
+		meshes[slot] = pool.AddMesh(vertexCount, vertexCount * 3);
+		if (meshes[slot] == GeometryPool::INVALID_HANDLE || pool.GetFragmentation() > 0.5f)
+		{
+			compactions += pool.Compact(plan) ? 1 : 0;
+			if (meshes[slot] == GeometryPool::INVALID_HANDLE)
+			{
+				meshes[slot] = pool.AddMesh(vertexCount, vertexCount * 3);
+			}
+		}
+	}
+	state.SetItemsProcessed(state.GetIterations());
+	state.SetCounter("compactions", static_cast<double>(compactions));
+}
+BENCHMARK(BM_GeometryPoolChurn)->Arg(100)->Arg(1000)->ArgNames({ "meshes" });
+
+// per-frame scratch from the arena against the heap it replaced
+void BM_FrameArenaAllocate(BenchmarkState& state)
+{
+	size_t count = static_cast<size_t>(state.GetArg(0));
+	FrameArena arena;
+	for (size_t i = 0; i < count; ++i)
+	{
+		arena.Allocate(64 + (i & 7) * 16);
+	}
+	arena.Reset();
+
+	while (state.KeepRunning())
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			DoNotOptimize(arena.Allocate(64 + (i & 7) * 16));
+		}
+		arena.Reset();
+	}
+	state.SetItemsProcessed(state.GetIterations() * count);
+}
+BENCHMARK(BM_FrameArenaAllocate)->Arg(100)->Arg(10000)->ArgNames({ "allocations" })->NoAllocations();
+
+void BM_HeapAllocate(BenchmarkState& state)
+{
+	size_t count = static_cast<size_t>(state.GetArg(0));
+	std::vector<uint8_t*> blocks(count);
+
+	while (state.KeepRunning())
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			blocks[i] = new uint8_t[64 + (i & 7) * 16];
+			DoNotOptimize(blocks[i]);
+		}
+		for (size_t i = 0; i < count; ++i)
+		{
+			delete[] blocks[i];
+		}
+	}
+	state.SetItemsProcessed(state.GetIterations() * count);
+}
+BENCHMARK(BM_HeapAllocate)->Arg(100)->Arg(10000)->ArgNames({ "allocations" });
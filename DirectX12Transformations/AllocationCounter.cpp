@@ -0,0 +1,136 @@
+#include "AllocationCounter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+
+namespace
+{
+	std::atomic<uint64_t> g_heapAllocations(0);
+
+	void* CountedAllocate(size_t size)
+	{
+		g_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+
+		// operator new must return a unique pointer even for zero bytes
+		void* memory = malloc(size != 0 ? size : 1);
+		if (memory == nullptr)
+		{
+			throw std::bad_alloc();
+		}
+		return memory;
+	}
+
+#if defined(__cpp_aligned_new)
+	// for types over __STDCPP_DEFAULT_NEW_ALIGNMENT__, freed with AlignedFree only
+	void* CountedAllocateAligned(size_t size, std::align_val_t alignment)
+	{
+		g_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+
+		size_t bytes = size != 0 ? size : 1;
+#if defined(_MSC_VER)
+		void* memory = _aligned_malloc(bytes, static_cast<size_t>(alignment));
+#else
+		void* memory = nullptr;
+		if (posix_memalign(&memory, static_cast<size_t>(alignment), bytes) != 0)
+		{
+			memory = nullptr;
+		}
+#endif
+		if (memory == nullptr)
+		{
+			throw std::bad_alloc();
+		}
+		return memory;
+	}
+
+	void AlignedFree(void* memory)
+	{
+#if defined(_MSC_VER)
+		_aligned_free(memory);
+#else
+		free(memory);
+#endif
+	}
+#endif
+}
+
+// the nothrow forms forward to these
+void* operator new(size_t size)
+{
+	return CountedAllocate(size);
+}
+
+void* operator new[](size_t size)
+{
+	return CountedAllocate(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+	free(memory);
+}
+
+#if defined(__cpp_aligned_new)
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	return CountedAllocateAligned(size, alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+	return CountedAllocateAligned(size, alignment);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+	AlignedFree(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept
+{
+	AlignedFree(memory);
+}
+
+void operator delete(void* memory, size_t, std::align_val_t) noexcept
+{
+	AlignedFree(memory);
+}
+
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept
+{
+	AlignedFree(memory);
+}
+#endif
+
+uint64_t GetHeapAllocationCount()
+{
+	return g_heapAllocations.load(std::memory_order_relaxed);
+}
+
+AllocationScope::AllocationScope()
+	: m_start(GetHeapAllocationCount())
+{
+}
+
+uint64_t AllocationScope::GetCount() const
+{
+	return GetHeapAllocationCount() - m_start;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdint>
+
+// The global operator new and delete are replaced to count heap allocations
+// made by this module, so BM_Frame can require that the steady state frame
+// loop does not allocate. The aligned forms are counted too when the compiler
+// has them (C++17). Allocations inside the OS, the D3D runtime or the driver
+// are not seen, nor are direct malloc or HeapAlloc calls.
+uint64_t GetHeapAllocationCount();
+
+// counts the allocations made by all threads while it is alive
+class AllocationScope
+{
+private:
+
+	uint64_t m_start;
+
+public:
+	AllocationScope();
+
+	uint64_t GetCount() const;
+};
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cmath>
+#include "AnimationClip.h"
+
+AnimationClip::AnimationClip(float sampleRate, bool looping)
+	: m_sampleRate(sampleRate), m_looping(looping), m_tracks{}
+{
+}
+
+uint32_t AnimationClip::GetComponentCount(AnimationChannel channel)
+{
+	return channel == AnimationChannel::Position || channel == AnimationChannel::Scale ? 3 : 4;
+}
+
+void AnimationClip::SetTrack(AnimationChannel channel, const float* keys, uint32_t keyCount)
+{
+	Track& track = m_tracks[static_cast<size_t>(channel)];
+	const uint32_t components = GetComponentCount(channel);
+
+	// drop the old keys and move the tracks stored after them
+	if (track.keyCount > 0)
+	{
+		m_keys.erase(m_keys.begin() + track.firstKey * 4, m_keys.begin() + (track.firstKey + track.keyCount) * 4);
+		for (Track& other : m_tracks)
+		{
+			if (other.keyCount > 0 && other.firstKey > track.firstKey)
+			{
+				other.firstKey -= track.keyCount;
+			}
+		}
+	}
+
+	track = Track{};
+	track.keyCount = keyCount;
+	track.firstKey = static_cast<uint32_t>(m_keys.size() / 4);
+	if (keyCount == 0)
+	{
+		return;
+	}
+
+	// neighbouring quaternions in the same hemisphere, so nlerp takes the short way
+	std::vector<float> values(keys, keys + keyCount * components);
+	if (channel == AnimationChannel::Rotation)
+	{
+		for (uint32_t key = 1; key < keyCount; ++key)
+		{
+			float* previous = &values[(key - 1) * 4];
+			float* current = &values[key * 4];
+			if (previous[0] * current[0] + previous[1] * current[1] + previous[2] * current[2] + previous[3] * current[3] < 0.0f)
+			{
+				for (int i = 0; i < 4; ++i)
+				{
+					current[i] = -current[i];
+				}
+			}
+		}
+	}
+
+	for (uint32_t component = 0; component < components; ++component)
+	{
+		float minimum = values[component];
+		float maximum = values[component];
+		for (uint32_t key = 1; key < keyCount; ++key)
+		{
+			minimum = std::min(minimum, values[key * components + component]);
+			maximum = std::max(maximum, values[key * components + component]);
+		}
+		track.minimum[component] = minimum;
+		track.step[component] = (maximum - minimum) / 65535.0f;
+	}
+
+	m_keys.resize(m_keys.size() + keyCount * 4, 0);
+	uint16_t* quantized = &m_keys[track.firstKey * 4];
+	for (uint32_t key = 0; key < keyCount; ++key)
+	{
+		for (uint32_t component = 0; component < components; ++component)
+		{
+			float step = track.step[component];
+			float value = values[key * components + component];
+			quantized[key * 4 + component] = step > 0.0f ? static_cast<uint16_t>(lrintf((value - track.minimum[component]) / step)) : 0;
+		}
+	}
+}
+
+float AnimationClip::GetSampleRate() const
+{
+	return m_sampleRate;
+}
+
+bool AnimationClip::IsLooping() const
+{
+	return m_looping;
+}
+
+float AnimationClip::GetDuration() const
+{
+	uint32_t keyCount = 0;
+	for (const Track& track : m_tracks)
+	{
+		keyCount = std::max(keyCount, track.keyCount);
+	}
+	return keyCount > 1 ? (keyCount - 1) / m_sampleRate : 0.0f;
+}
+
+const AnimationClip::Track& AnimationClip::GetTrack(AnimationChannel channel) const
+{
+	return m_tracks[static_cast<size_t>(channel)];
+}
+
+const uint16_t* AnimationClip::GetKeys(const Track& track) const
+{
+	return m_keys.data() + track.firstKey * 4;
+}
+
+size_t AnimationClip::GetMemoryBytes() const
+{
+	return sizeof(*this) + m_keys.size() * sizeof(uint16_t);
+}
+
+size_t AnimationClip::GetUncompressedBytes() const
+{
+	size_t bytes = 0;
+	for (size_t channel = 0; channel < static_cast<size_t>(AnimationChannel::Count); ++channel)
+	{
+		bytes += m_tracks[channel].keyCount * GetComponentCount(static_cast<AnimationChannel>(channel)) * sizeof(float);
+	}
+	return bytes;
+}
+
+float AnimationClip::GetMaxQuantizationError(AnimationChannel channel) const
+{
+	const Track& track = GetTrack(channel);
+	float error = 0.0f;
+	for (uint32_t component = 0; component < GetComponentCount(channel); ++component)
+	{
+		error = std::max(error, 0.5f * track.step[component]);
+	}
+	return error;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class AnimationChannel
+{
+	Position,
+	Rotation,	// quaternion xyzw
+	Scale,
+	Color,
+	Count
+};
+
+// Keyframe clip with one track per channel. Keys are sampled at a uniform
+// rate, so finding the segment for a time is a multiply, and quantized to
+// 16 bits per component against the track's range. Every key is padded to
+// four components so a segment's two keys are one 16 byte load.
+//
+// Looping clips wrap at the last key, which should repeat the first.
+class AnimationClip
+{
+public:
+	struct Track
+	{
+		uint32_t keyCount;	// 0 if the channel is not animated
+		uint32_t firstKey;
+		float minimum[4];
+		float step[4];	// value = minimum + quantized * step
+	};
+
+private:
+	float m_sampleRate;
+	bool m_looping;
+	Track m_tracks[static_cast<size_t>(AnimationChannel::Count)];
+	std::vector<uint16_t> m_keys;	// 4 per key
+
+public:
+	AnimationClip(float sampleRate, bool looping);
+
+	static uint32_t GetComponentCount(AnimationChannel channel);
+
+	// keyCount keys of GetComponentCount(channel) floats each, replaces the channel's track
+	void SetTrack(AnimationChannel channel, const float* keys, uint32_t keyCount);
+
+	float GetSampleRate() const;
+	bool IsLooping() const;
+	float GetDuration() const;	// of the longest track
+	const Track& GetTrack(AnimationChannel channel) const;
+	const uint16_t* GetKeys(const Track& track) const;
+
+	size_t GetMemoryBytes() const;
+	size_t GetUncompressedBytes() const;	// the same keys as floats
+	float GetMaxQuantizationError(AnimationChannel channel) const;
+};
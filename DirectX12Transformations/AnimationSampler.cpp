@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <cmath>
+#include <emmintrin.h>
+#include "AnimationSampler.h"
+
+using namespace DirectX;
+
+namespace
+{
+	__m128 DecodeKey(__m128i quantized, const AnimationClip::Track& track)
+	{
+		__m128 value = _mm_cvtepi32_ps(quantized);
+		return _mm_add_ps(_mm_loadu_ps(track.minimum), _mm_mul_ps(value, _mm_loadu_ps(track.step)));
+	}
+
+	// keyPosition is time * sample rate, computed once for all tracks of an instance
+	__m128 SampleTrack(const AnimationClip& clip, AnimationChannel channel, float keyPosition, __m128 defaultValue)
+	{
+		const AnimationClip::Track& track = clip.GetTrack(channel);
+		if (track.keyCount == 0)
+		{
+			return defaultValue;
+		}
+
+		const uint16_t* keys = clip.GetKeys(track);
+		const __m128i zero = _mm_setzero_si128();
+		if (track.keyCount == 1)
+		{
+			__m128i key = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(keys));
+			return DecodeKey(_mm_unpacklo_epi16(key, zero), track);
+		}
+
+		// uniform keys, the segment is the integer part of the key position
+		const float lastKey = static_cast<float>(track.keyCount - 1);
+		float position = keyPosition;
+		// Advance keeps time inside the clip, so only tracks shorter than the clip wrap
+		if (clip.IsLooping() && (position < 0.0f || position >= lastKey))
+		{
+			position = fmodf(position, lastKey);
+			position = position < 0.0f ? position + lastKey : position;
+		}
+		position = std::min(std::max(position, 0.0f), lastKey);
+
+		uint32_t segment = std::min(static_cast<uint32_t>(position), track.keyCount - 2);
+		__m128 t = _mm_set1_ps(position - segment);
+
+		// both keys of the segment in one load, 4 x 16 bits each
+		__m128i pair = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + segment * 4));
+		__m128 from = DecodeKey(_mm_unpacklo_epi16(pair, zero), track);
+		__m128 to = DecodeKey(_mm_unpackhi_epi16(pair, zero), track);
+		return _mm_add_ps(from, _mm_mul_ps(_mm_sub_ps(to, from), t));
+	}
+
+	__m128 Normalize4(__m128 v)
+	{
+		__m128 squared = _mm_mul_ps(v, v);
+		squared = _mm_add_ps(squared, _mm_shuffle_ps(squared, squared, _MM_SHUFFLE(2, 3, 0, 1)));
+		squared = _mm_add_ps(squared, _mm_shuffle_ps(squared, squared, _MM_SHUFFLE(1, 0, 3, 2)));
+		return _mm_div_ps(v, _mm_sqrt_ps(squared));
+	}
+}
+
+AnimationSampler::AnimationSampler(ThreadPool* threadPool, size_t instancesPerBlock)
+	: m_threadPool(threadPool), m_instancesPerBlock(instancesPerBlock)
+{
+}
+
+void AnimationSampler::Advance(const AnimationClip* clips, AnimationInstance* instances, size_t count, float deltaSec)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		AnimationInstance& instance = instances[i];
+		const AnimationClip& clip = clips[instance.clip];
+		float duration = clip.GetDuration();
+
+		instance.time += deltaSec;
+		if (duration <= 0.0f)
+		{
+			instance.time = 0.0f;
+		}
+		else if (clip.IsLooping())
+		{
+			// fmodf leaves times inside the clip unchanged, only call it on a wrap
+			if (fabsf(instance.time) >= duration)
+			{
+				instance.time = fmodf(instance.time, duration);
+			}
+		}
+		else
+		{
+			instance.time = std::min(instance.time, duration);
+		}
+	}
+}
+
+void AnimationSampler::Sample(const AnimationClip* clips, const AnimationInstance* instances, size_t count, XMFLOAT4X4* worldMats, XMFLOAT4* colors)
+{
+	const size_t blockCount = (count + m_instancesPerBlock - 1) / m_instancesPerBlock;
+	if (blockCount <= 1)
+	{
+		SampleRange(clips, instances, 0, count, worldMats, colors);
+		return;
+	}
+
+	m_threadPool->ParallelFor(blockCount, [&](size_t block, uint32_t)
+	{
+		SampleRange(clips, instances, block * m_instancesPerBlock, std::min(count, (block + 1) * m_instancesPerBlock), worldMats, colors);
+	});
+}
+
+void AnimationSampler::SampleRange(const AnimationClip* clips, const AnimationInstance* instances, size_t first, size_t end,
+	XMFLOAT4X4* worldMats, XMFLOAT4* colors)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 identity = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+
+	for (size_t i = first; i < end; ++i)
+	{
+		const AnimationClip& clip = clips[instances[i].clip];
+		const float keyPosition = instances[i].time * clip.GetSampleRate();
+
+		if (colors != nullptr)
+		{
+			_mm_storeu_ps(&colors[i].x, SampleTrack(clip, AnimationChannel::Color, keyPosition, one));
+		}
+
+		if (worldMats == nullptr)
+		{
+			continue;
+		}
+
+		float position[4], rotation[4], scale[4];
+		_mm_storeu_ps(position, SampleTrack(clip, AnimationChannel::Position, keyPosition, zero));
+		_mm_storeu_ps(rotation, Normalize4(SampleTrack(clip, AnimationChannel::Rotation, keyPosition, identity)));
+		_mm_storeu_ps(scale, SampleTrack(clip, AnimationChannel::Scale, keyPosition, one));
+
+		// row-vector rotation matrix of the quaternion, as XMMatrixRotationQuaternion
+		const float x = rotation[0], y = rotation[1], z = rotation[2], w = rotation[3];
+		const float xx = x * x, yy = y * y, zz = z * z;
+		const float xy = x * y, xz = x * z, yz = y * z;
+		const float xw = x * w, yw = y * w, zw = z * w;
+
+		XMFLOAT4X4& m = worldMats[i];
+		m._11 = (1.0f - 2.0f * (yy + zz)) * scale[0];
+		m._12 = 2.0f * (xy + zw) * scale[0];
+		m._13 = 2.0f * (xz - yw) * scale[0];
+		m._14 = 0.0f;
+		m._21 = 2.0f * (xy - zw) * scale[1];
+		m._22 = (1.0f - 2.0f * (xx + zz)) * scale[1];
+		m._23 = 2.0f * (yz + xw) * scale[1];
+		m._24 = 0.0f;
+		m._31 = 2.0f * (xz + yw) * scale[2];
+		m._32 = 2.0f * (yz - xw) * scale[2];
+		m._33 = (1.0f - 2.0f * (xx + yy)) * scale[2];
+		m._34 = 0.0f;
+		m._41 = position[0];
+		m._42 = position[1];
+		m._43 = position[2];
+		m._44 = 1.0f;
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+#include "AnimationClip.h"
+#include "ThreadPool.h"
+
+struct AnimationInstance
+{
+	uint32_t clip;	// index into the clip array passed to the sampler
+	float time;	// seconds
+};
+
+// Samples clips for many objects per frame. Keys are decoded and
+// interpolated with SSE, four components at a time, positions, scales and
+// colors with lerp and rotations with nlerp. Blocks of instances run on the
+// thread pool and write straight into the caller's transform and color
+// arrays.
+class AnimationSampler
+{
+private:
+	ThreadPool* m_threadPool;
+	size_t m_instancesPerBlock;
+
+public:
+	AnimationSampler(ThreadPool* threadPool, size_t instancesPerBlock = 256);
+
+	// wraps looping clips so time stays small, clamps the others to their end
+	static void Advance(const AnimationClip* clips, AnimationInstance* instances, size_t count, float deltaSec);
+
+	// world matrices are scale * rotation * translation; either output may be null,
+	// channels a clip does not animate use the identity and white
+	void Sample(const AnimationClip* clips, const AnimationInstance* instances, size_t count,
+		DirectX::XMFLOAT4X4* worldMats, DirectX::XMFLOAT4* colors);
+
+	// instances [first, end) on the calling thread, for callers that already run on the pool
+	static void SampleRange(const AnimationClip* clips, const AnimationInstance* instances, size_t first, size_t end,
+		DirectX::XMFLOAT4X4* worldMats, DirectX::XMFLOAT4* colors);
+};
@@ -0,0 +1,152 @@
+#include <cmath>
+#include "Camera.h"
+
+using namespace DirectX;
+
+Camera::Camera()
+	: m_pitch(0.0f), m_yaw(0.0f), m_viewIsDirty(true), m_reverseZ(false)
+{
+	m_position = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+	XMStoreFloat4x4(&m_projectionMat, XMMatrixIdentity());
+	UpdateOrientation();
+}
+
+void Camera::UpdateOrientation()
+{
+	XMVECTOR orientation = XMQuaternionRotationRollPitchYaw(m_pitch, m_yaw, 0.0f);
+	XMStoreFloat4(&m_orientation, orientation);
+
+	// rows of the rotation matrix are the camera basis vectors
+	XMMATRIX rotationMat = XMMatrixRotationQuaternion(orientation);
+	XMStoreFloat4(&m_right, rotationMat.r[0]);
+	XMStoreFloat4(&m_up, rotationMat.r[1]);
+	XMStoreFloat4(&m_forward, rotationMat.r[2]);
+
+	m_viewIsDirty = true;
+}
+
+void Camera::SetPosition(float x, float y, float z)
+{
+	m_position = XMFLOAT4(x, y, z, 1.0f);
+	m_viewIsDirty = true;
+}
+
+void Camera::SetRotation(float pitch, float yaw)
+{
+	m_pitch = 0.0f;
+	m_yaw = 0.0f;
+	Rotate(pitch, yaw);
+}
+
+void Camera::Rotate(float deltaPitch, float deltaYaw)
+{
+	m_pitch += deltaPitch;
+	if (m_pitch < -XM_PIDIV2)
+	{
+		m_pitch = -XM_PIDIV2;
+	}
+	else if (m_pitch > XM_PIDIV2)
+	{
+		m_pitch = XM_PIDIV2;
+	}
+
+	m_yaw = XMScalarModAngle(m_yaw + deltaYaw);
+
+	UpdateOrientation();
+}
+
+void Camera::Move(float forward, float right)
+{
+	XMVECTOR position = XMLoadFloat4(&m_position);
+	position = XMVectorMultiplyAdd(XMLoadFloat4(&m_forward), XMVectorReplicate(forward), position);
+	position = XMVectorMultiplyAdd(XMLoadFloat4(&m_right), XMVectorReplicate(right), position);
+	XMStoreFloat4(&m_position, position);
+
+	m_viewIsDirty = true;
+}
+
+void Camera::SetPerspective(float fov, float aspectRatio, float nearZ, float farZ)
+{
+	XMStoreFloat4x4(&m_projectionMat, XMMatrixPerspectiveFovLH(fov, aspectRatio, nearZ, farZ));
+	m_reverseZ = false;
+}
+
+void Camera::SetPerspectiveReverseZ(float fov, float aspectRatio, float nearZ)
+{
+	const float yScale = 1.0f / tanf(0.5f * fov);
+	const float xScale = yScale / aspectRatio;
+
+	// z_clip = nearZ, w_clip = z, so depth = nearZ / z
+	m_projectionMat = XMFLOAT4X4(
+		xScale, 0.0f, 0.0f, 0.0f,
+		0.0f, yScale, 0.0f, 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f,
+		0.0f, 0.0f, nearZ, 0.0f);
+	m_reverseZ = true;
+}
+
+XMVECTOR Camera::GetPosition() const
+{
+	return XMLoadFloat4(&m_position);
+}
+
+XMVECTOR Camera::GetOrientation() const
+{
+	return XMLoadFloat4(&m_orientation);
+}
+
+XMVECTOR Camera::GetForward() const
+{
+	return XMLoadFloat4(&m_forward);
+}
+
+XMVECTOR Camera::GetRight() const
+{
+	return XMLoadFloat4(&m_right);
+}
+
+XMVECTOR Camera::GetUp() const
+{
+	return XMLoadFloat4(&m_up);
+}
+
+XMMATRIX Camera::GetViewMatrix()
+{
+	if (m_viewIsDirty)
+	{
+		// inverse of rotation * translation is translation^-1 * rotation^T
+		XMVECTOR right = XMLoadFloat4(&m_right);
+		XMVECTOR up = XMLoadFloat4(&m_up);
+		XMVECTOR forward = XMLoadFloat4(&m_forward);
+		XMVECTOR negPosition = XMVectorNegate(XMLoadFloat4(&m_position));
+
+		XMMATRIX viewMat;
+		viewMat.r[0] = XMVectorSelect(right, g_XMZero, g_XMSelect0001);
+		viewMat.r[1] = XMVectorSelect(up, g_XMZero, g_XMSelect0001);
+		viewMat.r[2] = XMVectorSelect(forward, g_XMZero, g_XMSelect0001);
+		viewMat.r[3] = g_XMIdentityR3;
+		viewMat = XMMatrixTranspose(viewMat);
+
+		XMVECTOR translation = XMVectorSet(
+			XMVectorGetX(XMVector3Dot(negPosition, right)),
+			XMVectorGetX(XMVector3Dot(negPosition, up)),
+			XMVectorGetX(XMVector3Dot(negPosition, forward)),
+			1.0f);
+		viewMat.r[3] = translation;
+
+		XMStoreFloat4x4(&m_viewMat, viewMat);
+		m_viewIsDirty = false;
+	}
+
+	return XMLoadFloat4x4(&m_viewMat);
+}
+
+XMMATRIX Camera::GetProjectionMatrix() const
+{
+	return XMLoadFloat4x4(&m_projectionMat);
+}
+
+bool Camera::IsReverseZ() const
+{
+	return m_reverseZ;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <DirectXMath.h>
+
+// First person camera stored as a quaternion and a position.
+// The view matrix is the closed-form inverse of the rigid camera transform
+// and the basis vectors are cached until the orientation changes.
+class Camera
+{
+private:
+
+	DirectX::XMFLOAT4 m_orientation;	// quaternion
+	DirectX::XMFLOAT4 m_position;
+	float m_pitch;
+	float m_yaw;
+
+	DirectX::XMFLOAT4 m_forward;
+	DirectX::XMFLOAT4 m_right;
+	DirectX::XMFLOAT4 m_up;
+
+	DirectX::XMFLOAT4X4 m_viewMat;
+	DirectX::XMFLOAT4X4 m_projectionMat;
+	bool m_viewIsDirty;
+	bool m_reverseZ;
+
+	void UpdateOrientation();
+
+public:
+	Camera();
+
+	void SetPosition(float x, float y, float z);
+	void SetRotation(float pitch, float yaw);
+	void Rotate(float deltaPitch, float deltaYaw);	// pitch is clamped to +-90 degrees
+	void Move(float forward, float right);
+
+	// standard depth range, near maps to 0 and far to 1
+	void SetPerspective(float fov, float aspectRatio, float nearZ, float farZ);
+	// reverse-Z with an infinite far plane, near maps to 1 and infinity to 0
+	void SetPerspectiveReverseZ(float fov, float aspectRatio, float nearZ);
+
+	DirectX::XMVECTOR GetPosition() const;
+	DirectX::XMVECTOR GetOrientation() const;
+	DirectX::XMVECTOR GetForward() const;
+	DirectX::XMVECTOR GetRight() const;
+	DirectX::XMVECTOR GetUp() const;
+
+	DirectX::XMMATRIX GetViewMatrix();
+	DirectX::XMMATRIX GetProjectionMatrix() const;
+	bool IsReverseZ() const;
+};
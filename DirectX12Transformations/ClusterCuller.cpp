@@ -0,0 +1,128 @@
+#include <cmath>
+#include "ClusterCuller.h"
+
+ClusterCuller::ClusterCuller(ThreadPool* threadPool)
+	: m_threadPool(threadPool)
+{
+}
+
+void ClusterCuller::ExtractFrustum(const float viewProjection[16], ClusterFrustum& frustum)
+{
+	// clip = v * M, so every plane is a combination of matrix columns
+	const float* m = viewProjection;
+	const float column[4][4] =
+	{
+		{ m[0], m[4], m[8], m[12] },
+		{ m[1], m[5], m[9], m[13] },
+		{ m[2], m[6], m[10], m[14] },
+		{ m[3], m[7], m[11], m[15] }
+	};
+
+	for (int i = 0; i < 4; ++i)
+	{
+		frustum.planes[0][i] = column[3][i] + column[0][i];	// left
+		frustum.planes[1][i] = column[3][i] - column[0][i];	// right
+		frustum.planes[2][i] = column[3][i] + column[1][i];	// bottom
+		frustum.planes[3][i] = column[3][i] - column[1][i];	// top
+		frustum.planes[4][i] = column[2][i];	// z >= 0
+		frustum.planes[5][i] = column[3][i] - column[2][i];	// z <= w
+	}
+
+	for (float* plane : frustum.planes)
+	{
+		float length = sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		if (length > 1e-6f)
+		{
+			plane[0] /= length;
+			plane[1] /= length;
+			plane[2] /= length;
+			plane[3] /= length;
+		}
+		else
+		{
+			// the far plane of an infinite projection
+			plane[0] = 0.0f;
+			plane[1] = 0.0f;
+			plane[2] = 0.0f;
+			plane[3] = 1.0f;
+		}
+	}
+}
+
+bool ClusterCuller::IsSphereVisible(const float center[3], float radius, const ClusterFrustum& frustum)
+{
+	for (const float* plane : frustum.planes)
+	{
+		float distance = plane[0] * center[0] + plane[1] * center[1] + plane[2] * center[2] + plane[3];
+		if (distance < -radius)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ClusterCuller::IsVisible(const MeshletBounds& bounds, const ClusterFrustum& frustum, const float eye[3])
+{
+	if (!IsSphereVisible(bounds.center, bounds.radius, frustum))
+	{
+		return false;
+	}
+
+	if (bounds.coneCutoff >= 1.0f)
+	{
+		return true;
+	}
+
+	// every triangle faces away when the eye is inside the cone behind the apex
+	float toApex[3] = { bounds.coneApex[0] - eye[0], bounds.coneApex[1] - eye[1], bounds.coneApex[2] - eye[2] };
+	float distance = sqrtf(toApex[0] * toApex[0] + toApex[1] * toApex[1] + toApex[2] * toApex[2]);
+	float d = toApex[0] * bounds.coneAxis[0] + toApex[1] * bounds.coneAxis[1] + toApex[2] * bounds.coneAxis[2];
+
+	return d < bounds.coneCutoff * distance;
+}
+
+uint32_t ClusterCuller::Cull(const MeshletMesh& mesh, const ClusterFrustum& frustum, const float eye[3], std::vector<ClusterRange>& ranges)
+{
+	const size_t meshletCount = mesh.meshlets.size();
+	m_visibility.resize(meshletCount);
+
+	const size_t meshletsPerBlock = 1024;
+	const size_t blockCount = (meshletCount + meshletsPerBlock - 1) / meshletsPerBlock;
+
+	m_threadPool->ParallelFor(blockCount, [&](size_t block, uint32_t)
+	{
+		size_t end = (block + 1) * meshletsPerBlock < meshletCount ? (block + 1) * meshletsPerBlock : meshletCount;
+		for (size_t i = block * meshletsPerBlock; i < end; ++i)
+		{
+			m_visibility[i] = IsVisible(mesh.bounds[i], frustum, eye) ? 1 : 0;
+		}
+	});
+
+	// meshlets are stored in index order, consecutive survivors are one range
+	uint32_t visibleCount = 0;
+	bool extendLast = false;
+	for (size_t i = 0; i < meshletCount; ++i)
+	{
+		if (!m_visibility[i])
+		{
+			extendLast = false;
+			continue;
+		}
+
+		const Meshlet& meshlet = mesh.meshlets[i];
+		if (extendLast)
+		{
+			ranges.back().indexCount += meshlet.triangleCount * 3;
+		}
+		else
+		{
+			ClusterRange range = { meshlet.triangleOffset * 3, meshlet.triangleCount * 3 };
+			ranges.push_back(range);
+			extendLast = true;
+		}
+		++visibleCount;
+	}
+
+	return visibleCount;
+}
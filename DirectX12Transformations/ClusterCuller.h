@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "MeshletBuilder.h"
+#include "ThreadPool.h"
+
+// planes as (a, b, c, d), inside when a*x + b*y + c*z + d >= 0
+struct ClusterFrustum
+{
+	float planes[6][4];
+};
+
+// index range of MeshletMesh::indices to draw
+struct ClusterRange
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+};
+
+// Per-frame cluster culling against the view frustum and the normal cones.
+// Frustum and eye are given in the mesh's space, i.e. built from
+// world * view * projection and the inverse world transform.
+class ClusterCuller
+{
+private:
+
+	ThreadPool* m_threadPool;
+	std::vector<uint8_t> m_visibility;
+
+public:
+	explicit ClusterCuller(ThreadPool* threadPool);
+
+	// row-vector matrix as used by DirectXMath, clip space z in [0, w];
+	// planes of an infinite projection that do not exist always pass
+	static void ExtractFrustum(const float viewProjection[16], ClusterFrustum& frustum);
+
+	static bool IsVisible(const MeshletBounds& bounds, const ClusterFrustum& frustum, const float eye[3]);
+	// the frustum test alone, also for whole objects
+	static bool IsSphereVisible(const float center[3], float radius, const ClusterFrustum& frustum);
+
+	// appends the ranges of surviving clusters to ranges, merging neighbours,
+	// and returns the number of surviving clusters
+	uint32_t Cull(const MeshletMesh& mesh, const ClusterFrustum& frustum, const float eye[3], std::vector<ClusterRange>& ranges);
+};
@@ -0,0 +1,97 @@
+#include "CpuFeatures.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+namespace
+{
+	void Cpuid(int leaf, int subleaf, unsigned int regs[4])
+	{
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuidex(info, leaf, subleaf);
+		for (int i = 0; i < 4; ++i)
+		{
+			regs[i] = static_cast<unsigned int>(info[i]);
+		}
+#else
+		__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+	}
+
+	unsigned long long ReadXcr0()
+	{
+#if defined(_MSC_VER)
+		return _xgetbv(0);
+#else
+		unsigned int eax, edx;
+		__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+	}
+
+	SimdLevel DetectSimdLevel()
+	{
+		unsigned int regs[4];
+		Cpuid(0, 0, regs);
+		const unsigned int maxLeaf = regs[0];
+
+		Cpuid(1, 0, regs);
+		const bool sse2 = (regs[3] & (1u << 26)) != 0;
+		const bool sse41 = (regs[2] & (1u << 19)) != 0;
+		const bool fma = (regs[2] & (1u << 12)) != 0;
+		const bool osxsave = (regs[2] & (1u << 27)) != 0;
+
+		// the OS has to save the YMM registers on context switch
+		bool avxEnabled = false;
+		if (osxsave)
+		{
+			avxEnabled = (ReadXcr0() & 0x6) == 0x6;
+		}
+
+		bool avx2 = false;
+		if (maxLeaf >= 7)
+		{
+			Cpuid(7, 0, regs);
+			avx2 = (regs[1] & (1u << 5)) != 0;
+		}
+
+		if (avx2 && fma && avxEnabled)
+		{
+			return SimdLevel::Avx2;
+		}
+		if (sse41)
+		{
+			return SimdLevel::Sse41;
+		}
+		if (sse2)
+		{
+			return SimdLevel::Sse2;
+		}
+		return SimdLevel::Scalar;
+	}
+}
+
+SimdLevel GetCpuSimdLevel()
+{
+	static const SimdLevel level = DetectSimdLevel();
+	return level;
+}
+
+const char* GetSimdLevelName(SimdLevel level)
+{
+	switch (level)
+	{
+	case SimdLevel::Sse2:
+		return "SSE2";
+	case SimdLevel::Sse41:
+		return "SSE4.1";
+	case SimdLevel::Avx2:
+		return "AVX2+FMA";
+	default:
+		return "Scalar";
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+// instruction sets the runtime dispatchers choose between, in increasing order
+enum class SimdLevel
+{
+	Scalar,
+	Sse2,
+	Sse41,
+	Avx2	// implies FMA
+};
+
+// detected once, checks both CPUID and OS support for the wider registers
+SimdLevel GetCpuSimdLevel();
+const char* GetSimdLevelName(SimdLevel level);
+
+#if defined(_MSC_VER)
+#define SIMD_TARGET_AVX2
+#else
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
@@ -0,0 +1,100 @@
+#include "stdafx.h"
+#include "D3D12CommandListBackend.h"
+
+D3D12CommandListBackend::D3D12CommandListBackend()
+	: m_threadCount(0), m_frameIndex(0), m_pipelineState(nullptr)
+{
+}
+
+void D3D12CommandListBackend::Init(ID3D12Device* device, uint32_t threadCount, uint32_t frameCount)
+{
+	m_device = device;
+	m_threadCount = threadCount;
+	m_threadLists.resize(threadCount * frameCount);
+
+	for (ThreadLists& threadLists : m_threadLists)
+	{
+		HRESULT hr = m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&threadLists.allocator));
+		if (FAILED(hr))
+		{
+			exit(-1);
+		}
+		threadLists.used = 0;
+	}
+}
+
+void D3D12CommandListBackend::SetCallbacks(ID3D12PipelineState* pipelineState, SetupCallback setup, DrawCallback draw)
+{
+	m_pipelineState = pipelineState;
+	m_setup = setup;
+	m_draw = draw;
+}
+
+void D3D12CommandListBackend::BeginFrame(uint32_t frameIndex)
+{
+	m_frameIndex = frameIndex;
+
+	for (uint32_t i = 0; i < m_threadCount; ++i)
+	{
+		ThreadLists& threadLists = m_threadLists[frameIndex * m_threadCount + i];
+		if (threadLists.used > 0)
+		{
+			HRESULT hr = threadLists.allocator->Reset();
+			if (FAILED(hr))
+			{
+				exit(-1);
+			}
+		}
+		threadLists.used = 0;
+	}
+}
+
+void D3D12CommandListBackend::BeginRecording(uint32_t chunkCount)
+{
+	m_chunkLists.assign(chunkCount, nullptr);
+}
+
+void D3D12CommandListBackend::RecordChunk(uint32_t chunkIndex, uint32_t threadIndex, const DrawItem* draws, size_t count)
+{
+	ThreadLists& threadLists = m_threadLists[m_frameIndex * m_threadCount + threadIndex];
+	HRESULT hr;
+
+	// lists recorded one after another on this thread can share its allocator
+	if (threadLists.used == threadLists.lists.size())
+	{
+		Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList;
+		hr = m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, threadLists.allocator.Get(), m_pipelineState, IID_PPV_ARGS(&commandList));
+		if (FAILED(hr))
+		{
+			exit(-1);
+		}
+		threadLists.lists.push_back(commandList);
+	}
+	else
+	{
+		hr = threadLists.lists[threadLists.used]->Reset(threadLists.allocator.Get(), m_pipelineState);
+		if (FAILED(hr))
+		{
+			exit(-1);
+		}
+	}
+
+	ID3D12GraphicsCommandList* commandList = threadLists.lists[threadLists.used].Get();
+	++threadLists.used;
+
+	m_setup(commandList, threadIndex);
+	m_draw(commandList, threadIndex, draws, count);
+
+	hr = commandList->Close();
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
+
+	m_chunkLists[chunkIndex] = commandList;
+}
+
+void D3D12CommandListBackend::AppendCommandLists(std::vector<ID3D12CommandList*>& commandLists) const
+{
+	commandLists.insert(commandLists.end(), m_chunkLists.begin(), m_chunkLists.end());
+}
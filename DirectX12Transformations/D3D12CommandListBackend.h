@@ -0,0 +1,51 @@
+#pragma once
+#include <d3d12.h>
+#include <wrl.h>
+#include <functional>
+#include <vector>
+#include "ParallelCommandRecorder.h"
+
+// Per-thread pool of command lists. Every recording thread owns one allocator
+// per frame slot and as many lists as it recorded chunks in that frame.
+class D3D12CommandListBackend : public CommandListBackend
+{
+public:
+	typedef std::function<void(ID3D12GraphicsCommandList*, uint32_t threadIndex)> SetupCallback;
+	typedef std::function<void(ID3D12GraphicsCommandList*, uint32_t threadIndex, const DrawItem*, size_t)> DrawCallback;
+
+private:
+
+	struct ThreadLists
+	{
+		Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator;
+		std::vector<Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>> lists;
+		size_t used;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D12Device> m_device;
+	std::vector<ThreadLists> m_threadLists;	// frame slot major
+	uint32_t m_threadCount;
+	uint32_t m_frameIndex;
+
+	std::vector<ID3D12CommandList*> m_chunkLists;
+	ID3D12PipelineState* m_pipelineState;
+	SetupCallback m_setup;
+	DrawCallback m_draw;
+
+public:
+	D3D12CommandListBackend();
+
+	void Init(ID3D12Device* device, uint32_t threadCount, uint32_t frameCount);
+
+	// every chunk list starts from scratch, setup binds targets, root signature and heaps
+	void SetCallbacks(ID3D12PipelineState* pipelineState, SetupCallback setup, DrawCallback draw);
+
+	// resets the allocators of the frame slot, its previous submission must have completed
+	void BeginFrame(uint32_t frameIndex);
+
+	void BeginRecording(uint32_t chunkCount) override;
+	void RecordChunk(uint32_t chunkIndex, uint32_t threadIndex, const DrawItem* draws, size_t count) override;
+
+	// appends the recorded lists in chunk order
+	void AppendCommandLists(std::vector<ID3D12CommandList*>& commandLists) const;
+};
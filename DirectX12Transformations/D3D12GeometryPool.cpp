@@ -0,0 +1,195 @@
+#include "stdafx.h"
+#include "d3dx12.h"
+#include "D3D12GeometryPool.h"
+
+D3D12GeometryPool::D3D12GeometryPool(uint32_t vertexCapacity, uint32_t indexCapacity)
+	: m_pool(vertexCapacity, indexCapacity), m_uploadService(nullptr), m_vertexStride(0)
+{
+}
+
+HRESULT D3D12GeometryPool::CreateBuffers(D3D12_RESOURCE_STATES initialState, ID3D12Resource** ppVertexBuffer, ID3D12Resource** ppIndexBuffer)
+{
+	HRESULT hr = m_device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(static_cast<UINT64>(m_pool.GetVertexCapacity()) * m_vertexStride),
+		initialState,
+		nullptr,
+		IID_PPV_ARGS(ppVertexBuffer));
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+	(*ppVertexBuffer)->SetName(L"Geometry Pool Vertex Buffer");
+
+	hr = m_device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(static_cast<UINT64>(m_pool.GetIndexCapacity()) * sizeof(uint32_t)),
+		initialState,
+		nullptr,
+		IID_PPV_ARGS(ppIndexBuffer));
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+	(*ppIndexBuffer)->SetName(L"Geometry Pool Index Buffer");
+
+	return S_OK;
+}
+
+HRESULT D3D12GeometryPool::Init(ID3D12Device* device, UploadService* uploadService, UINT vertexStride)
+{
+	m_device = device;
+	m_uploadService = uploadService;
+	m_vertexStride = vertexStride;
+
+	// common state, the copy queue promotes them to copy dest
+	return CreateBuffers(D3D12_RESOURCE_STATE_COMMON, &m_vertexBuffer, &m_indexBuffer);
+}
+
+MeshHandle D3D12GeometryPool::AddMesh(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount)
+{
+	MeshHandle mesh = m_pool.AddMesh(vertexCount, indexCount);
+	if (mesh == GeometryPool::INVALID_HANDLE)
+	{
+		return mesh;
+	}
+
+	const MeshRange& range = m_pool.GetMesh(mesh);
+	m_uploadService->UploadBuffer(m_vertexBuffer.Get(), static_cast<UINT64>(range.baseVertex) * m_vertexStride,
+		vertices, static_cast<UINT64>(vertexCount) * m_vertexStride);
+	UploadToken token = m_uploadService->UploadBuffer(m_indexBuffer.Get(), static_cast<UINT64>(range.firstIndex) * sizeof(uint32_t),
+		indices, static_cast<UINT64>(indexCount) * sizeof(uint32_t));
+
+	if (m_uploadTokens.size() <= mesh)
+	{
+		m_uploadTokens.resize(mesh + 1, UploadService::COMPLETED_TOKEN);
+	}
+	m_uploadTokens[mesh] = token;
+
+	return mesh;
+}
+
+void D3D12GeometryPool::RemoveMesh(MeshHandle mesh)
+{
+	m_pool.RemoveMesh(mesh);
+}
+
+const MeshRange& D3D12GeometryPool::GetMesh(MeshHandle mesh) const
+{
+	return m_pool.GetMesh(mesh);
+}
+
+const GeometryPool& D3D12GeometryPool::GetPool() const
+{
+	return m_pool;
+}
+
+UploadToken D3D12GeometryPool::GetUploadToken(MeshHandle mesh) const
+{
+	return m_uploadTokens[mesh];
+}
+
+float D3D12GeometryPool::GetFragmentation() const
+{
+	return m_pool.GetFragmentation();
+}
+
+bool D3D12GeometryPool::Compact(ID3D12GraphicsCommandList* commandList, UploadToken* pWaitToken)
+{
+	// the copies read what the copy queue wrote into the old buffers
+	UploadToken waitToken = UploadService::COMPLETED_TOKEN;
+	for (MeshHandle mesh = 0; mesh < m_uploadTokens.size(); ++mesh)
+	{
+		if (m_pool.IsValid(mesh) && m_uploadTokens[mesh] > waitToken)
+		{
+			waitToken = m_uploadTokens[mesh];
+		}
+	}
+
+	if (!m_pool.Compact(m_plan))
+	{
+		*pWaitToken = UploadService::COMPLETED_TOKEN;
+		return false;
+	}
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> vertexBuffer;
+	Microsoft::WRL::ComPtr<ID3D12Resource> indexBuffer;
+	HRESULT hr = CreateBuffers(D3D12_RESOURCE_STATE_COPY_DEST, &vertexBuffer, &indexBuffer);
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
+
+	// once a range moved every later one moves too, so the ranges that stayed
+	// in place are the prefix in front of the first move
+	uint32_t vertexPrefix = m_plan.vertexMoves.empty() ? m_pool.GetUsedVertexCount() : m_plan.vertexMoves.front().destination;
+	uint32_t indexPrefix = m_plan.indexMoves.empty() ? m_pool.GetUsedIndexCount() : m_plan.indexMoves.front().destination;
+
+	// old buffers are promoted to copy source
+	if (vertexPrefix > 0)
+	{
+		commandList->CopyBufferRegion(vertexBuffer.Get(), 0, m_vertexBuffer.Get(), 0, static_cast<UINT64>(vertexPrefix) * m_vertexStride);
+	}
+	for (const GeometryMove& move : m_plan.vertexMoves)
+	{
+		commandList->CopyBufferRegion(vertexBuffer.Get(), static_cast<UINT64>(move.destination) * m_vertexStride,
+			m_vertexBuffer.Get(), static_cast<UINT64>(move.source) * m_vertexStride, static_cast<UINT64>(move.count) * m_vertexStride);
+	}
+
+	if (indexPrefix > 0)
+	{
+		commandList->CopyBufferRegion(indexBuffer.Get(), 0, m_indexBuffer.Get(), 0, static_cast<UINT64>(indexPrefix) * sizeof(uint32_t));
+	}
+	for (const GeometryMove& move : m_plan.indexMoves)
+	{
+		commandList->CopyBufferRegion(indexBuffer.Get(), static_cast<UINT64>(move.destination) * sizeof(uint32_t),
+			m_indexBuffer.Get(), static_cast<UINT64>(move.source) * sizeof(uint32_t), static_cast<UINT64>(move.count) * sizeof(uint32_t));
+	}
+
+	// from now on the data is written by this command list
+	for (UploadToken& token : m_uploadTokens)
+	{
+		token = UploadService::COMPLETED_TOKEN;
+	}
+
+	D3D12_RESOURCE_BARRIER barriers[] =
+	{
+		CD3DX12_RESOURCE_BARRIER::Transition(vertexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER),
+		CD3DX12_RESOURCE_BARRIER::Transition(indexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_INDEX_BUFFER)
+	};
+	commandList->ResourceBarrier(_countof(barriers), barriers);
+
+	m_retiredVertexBuffer = m_vertexBuffer;
+	m_retiredIndexBuffer = m_indexBuffer;
+	m_vertexBuffer = vertexBuffer;
+	m_indexBuffer = indexBuffer;
+
+	*pWaitToken = waitToken;
+	return true;
+}
+
+void D3D12GeometryPool::ReleaseRetired()
+{
+	m_retiredVertexBuffer.Reset();
+	m_retiredIndexBuffer.Reset();
+}
+
+D3D12_VERTEX_BUFFER_VIEW D3D12GeometryPool::GetVertexBufferView() const
+{
+	D3D12_VERTEX_BUFFER_VIEW view;
+	view.BufferLocation = m_vertexBuffer->GetGPUVirtualAddress();
+	view.StrideInBytes = m_vertexStride;
+	view.SizeInBytes = m_pool.GetVertexCapacity() * m_vertexStride;
+	return view;
+}
+
+D3D12_INDEX_BUFFER_VIEW D3D12GeometryPool::GetIndexBufferView() const
+{
+	D3D12_INDEX_BUFFER_VIEW view;
+	view.BufferLocation = m_indexBuffer->GetGPUVirtualAddress();
+	view.Format = DXGI_FORMAT_R32_UINT;
+	view.SizeInBytes = m_pool.GetIndexCapacity() * sizeof(uint32_t);
+	return view;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <d3d12.h>
+#include <wrl.h>
+#include <vector>
+#include "GeometryPool.h"
+#include "UploadService.h"
+
+// Shared vertex and index buffers holding every mesh. Mesh data is streamed
+// in through the upload service; compaction copies the live ranges into a
+// fresh pair of buffers on the graphics queue.
+class D3D12GeometryPool
+{
+private:
+
+	GeometryPool m_pool;
+	Microsoft::WRL::ComPtr<ID3D12Device> m_device;
+	UploadService* m_uploadService;
+	UINT m_vertexStride;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_vertexBuffer;
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_indexBuffer;
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_retiredVertexBuffer;	// source of the last compaction
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_retiredIndexBuffer;
+
+	std::vector<UploadToken> m_uploadTokens;	// per mesh handle
+	CompactionPlan m_plan;
+
+	HRESULT CreateBuffers(D3D12_RESOURCE_STATES initialState, ID3D12Resource** ppVertexBuffer, ID3D12Resource** ppIndexBuffer);
+
+public:
+	D3D12GeometryPool(uint32_t vertexCapacity, uint32_t indexCapacity);
+
+	HRESULT Init(ID3D12Device* device, UploadService* uploadService, UINT vertexStride);
+
+	// indices are 32 bit and relative to the mesh's first vertex
+	MeshHandle AddMesh(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+	void RemoveMesh(MeshHandle mesh);
+
+	const MeshRange& GetMesh(MeshHandle mesh) const;
+	// the allocator behind the buffers, for code that only resolves ranges
+	const GeometryPool& GetPool() const;
+	UploadToken GetUploadToken(MeshHandle mesh) const;
+	float GetFragmentation() const;
+
+	// Records the copies of a compaction into commandList, which has to run
+	// before any draw from the pool and before further AddMesh uploads.
+	// pWaitToken receives the upload the graphics queue must wait for.
+	// Returns false if the pool was already packed.
+	bool Compact(ID3D12GraphicsCommandList* commandList, UploadToken* pWaitToken);
+	// the previous buffers, call once the compaction submission completed
+	void ReleaseRetired();
+
+	D3D12_VERTEX_BUFFER_VIEW GetVertexBufferView() const;
+	D3D12_INDEX_BUFFER_VIEW GetIndexBufferView() const;
+};
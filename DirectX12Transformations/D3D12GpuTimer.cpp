@@ -0,0 +1,77 @@
+#include "stdafx.h"
+#include "D3D12GpuTimer.h"
+
+D3D12GpuTimer::D3D12GpuTimer()
+	: m_frequency(0), m_frameCount(0)
+{
+}
+
+HRESULT D3D12GpuTimer::Init(ID3D12Device* device, ID3D12CommandQueue* queue, uint32_t frameCount)
+{
+	m_frameCount = frameCount;
+
+	HRESULT hr = queue->GetTimestampFrequency(&m_frequency);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	D3D12_QUERY_HEAP_DESC queryHeapDesc = {};
+	queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+	queryHeapDesc.Count = 2 * frameCount;
+	hr = device->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&m_queryHeap));
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	hr = device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(2 * frameCount * sizeof(UINT64)),
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(&m_readback));
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	m_readback->SetName(L"GPU timer readback");
+	return S_OK;
+}
+
+void D3D12GpuTimer::Begin(ID3D12GraphicsCommandList* commandList, uint32_t frameIndex)
+{
+	commandList->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, 2 * frameIndex);
+}
+
+void D3D12GpuTimer::End(ID3D12GraphicsCommandList* commandList, uint32_t frameIndex)
+{
+	commandList->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, 2 * frameIndex + 1);
+	commandList->ResolveQueryData(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, 2 * frameIndex, 2,
+		m_readback.Get(), 2 * frameIndex * sizeof(UINT64));
+}
+
+float D3D12GpuTimer::GetSeconds(uint32_t frameIndex) const
+{
+	// only this slot's two timestamps are read
+	D3D12_RANGE readRange = { 2 * frameIndex * sizeof(UINT64), (2 * frameIndex + 2) * sizeof(UINT64) };
+	D3D12_RANGE writtenRange = { 0, 0 };
+
+	UINT8* data;
+	if (FAILED(m_readback->Map(0, &readRange, reinterpret_cast<void**>(&data))))
+	{
+		return 0.0f;
+	}
+	const UINT64* timestamps = reinterpret_cast<const UINT64*>(data + readRange.Begin);
+	UINT64 begin = timestamps[0];
+	UINT64 end = timestamps[1];
+	m_readback->Unmap(0, &writtenRange);
+
+	if (end <= begin || m_frequency == 0)
+	{
+		return 0.0f;
+	}
+	return static_cast<float>(static_cast<double>(end - begin) / static_cast<double>(m_frequency));
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <d3d12.h>
+#include <wrl.h>
+#include <cstdint>
+
+// Measures the GPU time between two points of a frame with timestamp queries.
+// Every frame slot has its own pair of queries and readback slots, so a result
+// can be read as soon as the fence of that slot has passed.
+class D3D12GpuTimer
+{
+private:
+
+	Microsoft::WRL::ComPtr<ID3D12QueryHeap> m_queryHeap;
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_readback;
+	UINT64 m_frequency;	// ticks per second
+	uint32_t m_frameCount;
+
+public:
+	D3D12GpuTimer();
+
+	HRESULT Init(ID3D12Device* device, ID3D12CommandQueue* queue, uint32_t frameCount);
+
+	void Begin(ID3D12GraphicsCommandList* commandList, uint32_t frameIndex);
+	// also copies both timestamps to the readback buffer
+	void End(ID3D12GraphicsCommandList* commandList, uint32_t frameIndex);
+
+	// 0 when the slot was never measured
+	float GetSeconds(uint32_t frameIndex) const;
+};
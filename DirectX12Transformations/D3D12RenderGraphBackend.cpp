@@ -0,0 +1,111 @@
+#include "stdafx.h"
+#include "D3D12RenderGraphBackend.h"
+
+D3D12RenderGraphBackend::D3D12RenderGraphBackend()
+	: m_commandList(nullptr)
+{
+}
+
+void D3D12RenderGraphBackend::Init(ID3D12Device* device)
+{
+	m_device = device;
+}
+
+void D3D12RenderGraphBackend::SetCommandList(ID3D12GraphicsCommandList* commandList)
+{
+	m_commandList = commandList;
+}
+
+void D3D12RenderGraphBackend::SetResource(RenderGraphResource resource, ID3D12Resource* d3dResource)
+{
+	if (resource >= m_resources.size())
+	{
+		m_resources.resize(resource + 1, nullptr);
+	}
+	m_resources[resource] = d3dResource;
+}
+
+ID3D12Resource* D3D12RenderGraphBackend::GetResource(RenderGraphResource resource) const
+{
+	return resource < m_resources.size() ? m_resources[resource] : nullptr;
+}
+
+D3D12_RESOURCE_DESC D3D12RenderGraphBackend::GetResourceDesc(const TransientResourceDesc& desc)
+{
+	if (desc.isTexture)
+	{
+		return CD3DX12_RESOURCE_DESC::Tex2D(static_cast<DXGI_FORMAT>(desc.format), desc.width, desc.height, 1, 1, 1, 0,
+			static_cast<D3D12_RESOURCE_FLAGS>(desc.flags));
+	}
+
+	return CD3DX12_RESOURCE_DESC::Buffer(desc.sizeInBytes, static_cast<D3D12_RESOURCE_FLAGS>(desc.flags));
+}
+
+void D3D12RenderGraphBackend::FillAllocationInfo(TransientResourceDesc& desc) const
+{
+	D3D12_RESOURCE_DESC resourceDesc = GetResourceDesc(desc);
+	D3D12_RESOURCE_ALLOCATION_INFO allocationInfo = m_device->GetResourceAllocationInfo(0, 1, &resourceDesc);
+	desc.sizeInBytes = allocationInfo.SizeInBytes;
+	desc.alignment = allocationInfo.Alignment;
+}
+
+void D3D12RenderGraphBackend::AllocateTransientHeap(uint64_t sizeInBytes)
+{
+	// tier 1 hardware cannot mix resource categories in one heap,
+	// graph transients there are limited to render and depth targets
+	D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+	m_device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options));
+
+	D3D12_HEAP_DESC heapDesc = {};
+	heapDesc.SizeInBytes = sizeInBytes;
+	heapDesc.Properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+	heapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+	heapDesc.Flags = options.ResourceHeapTier == D3D12_RESOURCE_HEAP_TIER_1 ?
+		D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES : D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES;
+
+	HRESULT hr = m_device->CreateHeap(&heapDesc, IID_PPV_ARGS(&m_heap));
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
+
+	m_heap->SetName(L"Render graph transient heap");
+}
+
+void D3D12RenderGraphBackend::CreateTransient(RenderGraphResource resource, const TransientResourceDesc& desc, uint64_t heapOffset, uint32_t initialState)
+{
+	D3D12_RESOURCE_DESC resourceDesc = GetResourceDesc(desc);
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> d3dResource;
+	HRESULT hr = m_device->CreatePlacedResource(m_heap.Get(), heapOffset, &resourceDesc,
+		static_cast<D3D12_RESOURCE_STATES>(initialState), nullptr, IID_PPV_ARGS(&d3dResource));
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
+
+	SetResource(resource, d3dResource.Get());
+	m_transients.push_back(d3dResource);
+}
+
+void D3D12RenderGraphBackend::ResourceBarriers(const RenderGraphBarrier* barriers, size_t count)
+{
+	m_barriers.clear();
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const RenderGraphBarrier& barrier = barriers[i];
+		if (barrier.type == RenderGraphBarrier::Aliasing)
+		{
+			m_barriers.push_back(CD3DX12_RESOURCE_BARRIER::Aliasing(GetResource(barrier.resourceBefore), GetResource(barrier.resource)));
+		}
+		else
+		{
+			m_barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(GetResource(barrier.resource),
+				static_cast<D3D12_RESOURCE_STATES>(barrier.stateBefore),
+				static_cast<D3D12_RESOURCE_STATES>(barrier.stateAfter)));
+		}
+	}
+
+	m_commandList->ResourceBarrier(static_cast<UINT>(m_barriers.size()), m_barriers.data());
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <d3d12.h>
+#include "d3dx12.h"
+#include <wrl.h>
+#include <vector>
+#include "RenderGraph.h"
+
+// Turns render graph barriers into a single ResourceBarrier call per batch and
+// places transient resources in one heap.
+class D3D12RenderGraphBackend : public RenderGraphBackend
+{
+private:
+
+	Microsoft::WRL::ComPtr<ID3D12Device> m_device;
+	ID3D12GraphicsCommandList* m_commandList;
+	Microsoft::WRL::ComPtr<ID3D12Heap> m_heap;
+	std::vector<ID3D12Resource*> m_resources;
+	std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> m_transients;
+	std::vector<D3D12_RESOURCE_BARRIER> m_barriers;
+
+	static D3D12_RESOURCE_DESC GetResourceDesc(const TransientResourceDesc& desc);
+
+public:
+	D3D12RenderGraphBackend();
+
+	void Init(ID3D12Device* device);
+	void SetCommandList(ID3D12GraphicsCommandList* commandList);
+
+	// imported resources, e.g. the current back buffer
+	void SetResource(RenderGraphResource resource, ID3D12Resource* d3dResource);
+	ID3D12Resource* GetResource(RenderGraphResource resource) const;
+
+	// fills sizeInBytes and alignment before the desc is handed to the graph
+	void FillAllocationInfo(TransientResourceDesc& desc) const;
+
+	void AllocateTransientHeap(uint64_t sizeInBytes) override;
+	void CreateTransient(RenderGraphResource resource, const TransientResourceDesc& desc, uint64_t heapOffset, uint32_t initialState) override;
+	void ResourceBarriers(const RenderGraphBarrier* barriers, size_t count) override;
+};
@@ -0,0 +1,153 @@
+#include "stdafx.h"
+#include "D3D12TargetPool.h"
+#include <cstring>
+
+D3D12TargetPool::D3D12TargetPool()
+	: m_maxFreeTargets(4), m_serial(0), m_allocationCount(0), m_reuseCount(0)
+{
+}
+
+void D3D12TargetPool::Init(ID3D12Device* device, uint32_t maxFreeTargets)
+{
+	m_device = device;
+	m_maxFreeTargets = maxFreeTargets;
+}
+
+UINT D3D12TargetPool::GetBucketSize(UINT size)
+{
+	const UINT minimumSize = 64;
+	if (size <= minimumSize)
+	{
+		return minimumSize;
+	}
+
+	// at most 1/8 of each dimension is wasted
+	UINT highestBit = 1;
+	while (highestBit <= size / 2)
+	{
+		highestBit <<= 1;
+	}
+	UINT step = highestBit / 8;
+	return (size + step - 1) / step * step;
+}
+
+bool D3D12TargetPool::Matches(const Entry& entry, UINT width, UINT height, DXGI_FORMAT format, D3D12_RESOURCE_FLAGS flags,
+	D3D12_RESOURCE_STATES state, const D3D12_CLEAR_VALUE* clearValue)
+{
+	if (entry.inUse || entry.width != width || entry.height != height || entry.format != format || entry.flags != flags || entry.state != state)
+	{
+		return false;
+	}
+
+	// a different optimized clear value would make clears slow
+	if (clearValue == nullptr)
+	{
+		return !entry.hasClearValue;
+	}
+	return entry.hasClearValue && memcmp(&entry.clearValue, clearValue, sizeof(D3D12_CLEAR_VALUE)) == 0;
+}
+
+ID3D12Resource* D3D12TargetPool::Acquire(UINT width, UINT height, DXGI_FORMAT format, D3D12_RESOURCE_FLAGS flags,
+	D3D12_RESOURCE_STATES state, const D3D12_CLEAR_VALUE* clearValue)
+{
+	UINT bucketWidth = GetBucketSize(width);
+	UINT bucketHeight = GetBucketSize(height);
+
+	for (Entry& entry : m_entries)
+	{
+		if (Matches(entry, bucketWidth, bucketHeight, format, flags, state, clearValue))
+		{
+			entry.inUse = true;
+			++m_reuseCount;
+			return entry.resource.Get();
+		}
+	}
+
+	Entry entry = {};
+	HRESULT hr = m_device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Tex2D(format, bucketWidth, bucketHeight, 1, 1, 1, 0, flags),
+		state,
+		clearValue,
+		IID_PPV_ARGS(&entry.resource));
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+
+	entry.resource->SetName(L"Pooled target");
+	entry.width = bucketWidth;
+	entry.height = bucketHeight;
+	entry.format = format;
+	entry.flags = flags;
+	entry.state = state;
+	entry.hasClearValue = clearValue != nullptr;
+	if (clearValue != nullptr)
+	{
+		entry.clearValue = *clearValue;
+	}
+	entry.inUse = true;
+
+	m_entries.push_back(entry);
+	++m_allocationCount;
+	return m_entries.back().resource.Get();
+}
+
+void D3D12TargetPool::Release(ID3D12Resource* resource)
+{
+	for (Entry& entry : m_entries)
+	{
+		if (entry.resource.Get() == resource)
+		{
+			entry.inUse = false;
+			entry.releaseSerial = ++m_serial;
+			break;
+		}
+	}
+
+	TrimFreeTargets();
+}
+
+void D3D12TargetPool::TrimFreeTargets()
+{
+	for (;;)
+	{
+		size_t freeCount = 0;
+		size_t oldest = m_entries.size();
+		for (size_t i = 0; i < m_entries.size(); ++i)
+		{
+			if (!m_entries[i].inUse)
+			{
+				++freeCount;
+				if (oldest == m_entries.size() || m_entries[i].releaseSerial < m_entries[oldest].releaseSerial)
+				{
+					oldest = i;
+				}
+			}
+		}
+
+		if (freeCount <= m_maxFreeTargets)
+		{
+			return;
+		}
+
+		m_entries[oldest] = m_entries.back();
+		m_entries.pop_back();
+	}
+}
+
+uint64_t D3D12TargetPool::GetAllocationCount() const
+{
+	return m_allocationCount;
+}
+
+uint64_t D3D12TargetPool::GetReuseCount() const
+{
+	return m_reuseCount;
+}
+
+size_t D3D12TargetPool::GetTargetCount() const
+{
+	return m_entries.size();
+}
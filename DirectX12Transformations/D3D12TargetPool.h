@@ -0,0 +1,57 @@
+#pragma once
+#include <d3d12.h>
+#include <wrl.h>
+#include <cstdint>
+#include <vector>
+
+// Render and depth targets recycled by size bucket. A requested size is rounded
+// up to a bucket, the caller draws into the top left corner and sets its viewport
+// to the requested size, so resizing a window within a bucket reuses the texture
+// and dragging back and forth between buckets finds the old textures again.
+class D3D12TargetPool
+{
+private:
+
+	struct Entry
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+		UINT width;	// bucket size
+		UINT height;
+		DXGI_FORMAT format;
+		D3D12_RESOURCE_FLAGS flags;
+		D3D12_RESOURCE_STATES state;	// targets are handed back in the state they were created in
+		D3D12_CLEAR_VALUE clearValue;
+		bool hasClearValue;
+		bool inUse;
+		uint64_t releaseSerial;	// free entries are trimmed oldest first
+	};
+
+	Microsoft::WRL::ComPtr<ID3D12Device> m_device;
+	std::vector<Entry> m_entries;
+	uint32_t m_maxFreeTargets;
+	uint64_t m_serial;
+	uint64_t m_allocationCount;
+	uint64_t m_reuseCount;
+
+	static bool Matches(const Entry& entry, UINT width, UINT height, DXGI_FORMAT format, D3D12_RESOURCE_FLAGS flags,
+		D3D12_RESOURCE_STATES state, const D3D12_CLEAR_VALUE* clearValue);
+	void TrimFreeTargets();
+
+public:
+	D3D12TargetPool();
+
+	void Init(ID3D12Device* device, uint32_t maxFreeTargets = 4);
+
+	// sizes are rounded up to 1/8 of their highest power of two, at least 64
+	static UINT GetBucketSize(UINT size);
+
+	// nullptr when the texture could not be created
+	ID3D12Resource* Acquire(UINT width, UINT height, DXGI_FORMAT format, D3D12_RESOURCE_FLAGS flags,
+		D3D12_RESOURCE_STATES state, const D3D12_CLEAR_VALUE* clearValue);
+	// the GPU must be done with the target, it has to be back in the state it was acquired in
+	void Release(ID3D12Resource* resource);
+
+	uint64_t GetAllocationCount() const;
+	uint64_t GetReuseCount() const;
+	size_t GetTargetCount() const;
+};
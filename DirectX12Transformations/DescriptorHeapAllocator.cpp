@@ -0,0 +1,106 @@
+#include "stdafx.h"
+#include "DescriptorHeapAllocator.h"
+
+DescriptorHeapAllocator::DescriptorHeapAllocator()
+	: m_cpuStart{}, m_gpuStart{}, m_descriptorSize(0),
+	m_persistentCapacity(0), m_persistentCount(0),
+	m_transientCapacity(0), m_transientCount(0), m_transientBase(0), m_capacity(0)
+{
+}
+
+HRESULT DescriptorHeapAllocator::Init(ID3D12Device* device, UINT persistentCapacity, UINT transientCapacity, UINT frameCount)
+{
+	D3D12_DESCRIPTOR_HEAP_DESC descriptorHeapDesc = {};
+	descriptorHeapDesc.NumDescriptors = persistentCapacity + transientCapacity * frameCount;
+	descriptorHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	descriptorHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+
+	HRESULT hr = device->CreateDescriptorHeap(&descriptorHeapDesc, IID_PPV_ARGS(&m_heap));
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	m_heap->SetName(L"Shader visible CBV/SRV/UAV heap");
+
+	m_cpuStart = m_heap->GetCPUDescriptorHandleForHeapStart();
+	m_gpuStart = m_heap->GetGPUDescriptorHandleForHeapStart();
+	m_descriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+	m_persistentCapacity = persistentCapacity;
+	m_persistentCount = 0;
+	m_freeList.clear();
+	m_freeList.reserve(persistentCapacity);
+
+	m_transientCapacity = transientCapacity;
+	m_transientCount = 0;
+	m_transientBase = persistentCapacity;
+	m_capacity = descriptorHeapDesc.NumDescriptors;
+
+	return S_OK;
+}
+
+UINT DescriptorHeapAllocator::AllocatePersistent()
+{
+	if (!m_freeList.empty())
+	{
+		UINT index = m_freeList.back();
+		m_freeList.pop_back();
+		return index;
+	}
+
+	if (m_persistentCount == m_persistentCapacity)
+	{
+		return INVALID_INDEX;
+	}
+
+	return m_persistentCount++;
+}
+
+void DescriptorHeapAllocator::FreePersistent(UINT index)
+{
+	m_freeList.push_back(index);
+}
+
+void DescriptorHeapAllocator::BeginFrame(UINT frameIndex)
+{
+	m_transientBase = m_persistentCapacity + frameIndex * m_transientCapacity;
+	m_transientCount = 0;
+}
+
+UINT DescriptorHeapAllocator::AllocateTransient(UINT count)
+{
+	if (m_transientCount + count > m_transientCapacity)
+	{
+		return INVALID_INDEX;
+	}
+
+	UINT index = m_transientBase + m_transientCount;
+	m_transientCount += count;
+	return index;
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DescriptorHeapAllocator::GetCpuHandle(UINT index) const
+{
+	return CD3DX12_CPU_DESCRIPTOR_HANDLE(m_cpuStart, index, m_descriptorSize);
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE DescriptorHeapAllocator::GetGpuHandle(UINT index) const
+{
+	return CD3DX12_GPU_DESCRIPTOR_HANDLE(m_gpuStart, index, m_descriptorSize);
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE DescriptorHeapAllocator::GetGpuStart() const
+{
+	return m_gpuStart;
+}
+
+ID3D12DescriptorHeap* DescriptorHeapAllocator::GetHeap() const
+{
+	return m_heap.Get();
+}
+
+UINT DescriptorHeapAllocator::GetCapacity() const
+{
+	return m_capacity;
+}
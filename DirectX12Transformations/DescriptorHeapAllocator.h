@@ -0,0 +1,48 @@
+#pragma once
+#include <d3d12.h>
+#include "d3dx12.h"
+#include <wrl.h>
+#include <vector>
+
+// One large shader-visible CBV/SRV/UAV heap shared by the whole frame.
+// The front of the heap holds persistent descriptors handed out from a free list,
+// the back is split into one linear region per frame slot for transient descriptors.
+// The heap is bound once per frame, so tables never force a heap switch.
+class DescriptorHeapAllocator
+{
+private:
+
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_heap;
+	D3D12_CPU_DESCRIPTOR_HANDLE m_cpuStart;
+	D3D12_GPU_DESCRIPTOR_HANDLE m_gpuStart;
+	UINT m_descriptorSize;
+
+	UINT m_persistentCapacity;
+	UINT m_persistentCount;	// high-water mark of the persistent region
+	std::vector<UINT> m_freeList;
+
+	UINT m_transientCapacity;	// per frame slot
+	UINT m_transientCount;
+	UINT m_transientBase;	// first descriptor of the current frame slot
+	UINT m_capacity;
+
+public:
+	static const UINT INVALID_INDEX = 0xffffffff;
+
+	DescriptorHeapAllocator();
+
+	HRESULT Init(ID3D12Device* device, UINT persistentCapacity, UINT transientCapacity, UINT frameCount);
+
+	UINT AllocatePersistent();
+	void FreePersistent(UINT index);
+
+	// resets the transient region of the given frame slot, call after its fence has passed
+	void BeginFrame(UINT frameIndex);
+	UINT AllocateTransient(UINT count);
+
+	D3D12_CPU_DESCRIPTOR_HANDLE GetCpuHandle(UINT index) const;
+	D3D12_GPU_DESCRIPTOR_HANDLE GetGpuHandle(UINT index) const;
+	D3D12_GPU_DESCRIPTOR_HANDLE GetGpuStart() const;
+	ID3D12DescriptorHeap* GetHeap() const;
+	UINT GetCapacity() const;	// persistent and every frame slot
+};
@@ -0,0 +1,67 @@
+#include "DirtyTracker.h"
+
+DirtyTracker::DirtyTracker()
+{
+}
+
+DirtyTracker::DirtyTracker(size_t objectCount, uint32_t frameCount)
+	: m_writtenVersions(frameCount)
+{
+	Resize(objectCount);
+}
+
+void DirtyTracker::Resize(size_t objectCount)
+{
+	// new objects start at version 1, which no slot has written yet
+	m_versions.resize(objectCount, 1);
+	for (std::vector<uint32_t>& written : m_writtenVersions)
+	{
+		written.resize(objectCount, 0);
+	}
+}
+
+void DirtyTracker::MarkDirty(uint32_t object)
+{
+	++m_versions[object];
+}
+
+void DirtyTracker::MarkAllDirty()
+{
+	for (uint32_t& version : m_versions)
+	{
+		++version;
+	}
+}
+
+void DirtyTracker::CollectDirtyRanges(uint32_t frameIndex, std::vector<DirtyRange>& ranges)
+{
+	ranges.clear();
+
+	std::vector<uint32_t>& written = m_writtenVersions[frameIndex];
+	const uint32_t objectCount = static_cast<uint32_t>(m_versions.size());
+
+	uint32_t object = 0;
+	while (object < objectCount)
+	{
+		if (written[object] == m_versions[object])
+		{
+			++object;
+			continue;
+		}
+
+		DirtyRange range;
+		range.first = object;
+		while (object < objectCount && written[object] != m_versions[object])
+		{
+			written[object] = m_versions[object];
+			++object;
+		}
+		range.count = object - range.first;
+		ranges.push_back(range);
+	}
+}
+
+size_t DirtyTracker::GetObjectCount() const
+{
+	return m_versions.size();
+}
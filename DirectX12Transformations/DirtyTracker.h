@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// contiguous run of objects that has to be uploaded for one frame slot
+struct DirtyRange
+{
+	uint32_t first;
+	uint32_t count;
+};
+
+// Per-object version counters plus, for every frame slot, the version that
+// slot last received. Only objects changed since a slot last used them are
+// uploaded, and neighbouring dirty objects are merged into one copy.
+class DirtyTracker
+{
+private:
+
+	std::vector<uint32_t> m_versions;
+	std::vector<std::vector<uint32_t>> m_writtenVersions;	// per frame slot
+
+public:
+	DirtyTracker();
+	DirtyTracker(size_t objectCount, uint32_t frameCount);
+
+	void Resize(size_t objectCount);
+	void MarkDirty(uint32_t object);
+	void MarkAllDirty();
+
+	// collects dirty runs for the slot and marks them as written
+	void CollectDirtyRanges(uint32_t frameIndex, std::vector<DirtyRange>& ranges);
+
+	size_t GetObjectCount() const;
+};
@@ -0,0 +1,154 @@
+#include <algorithm>
+#include "DrawSortKey.h"
+
+namespace DrawSortKey
+{
+	namespace
+	{
+		const uint32_t DEPTH_SHIFT = 0;
+		const uint32_t MESH_SHIFT = DEPTH_SHIFT + DEPTH_BITS;
+		const uint32_t MATERIAL_SHIFT = MESH_SHIFT + MESH_BITS;
+		const uint32_t PIPELINE_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+		const uint32_t LAYER_SHIFT = PIPELINE_SHIFT + PIPELINE_BITS;
+
+		uint64_t Field(uint32_t value, uint32_t bits, uint32_t shift)
+		{
+			return (static_cast<uint64_t>(value) & ((1ull << bits) - 1)) << shift;
+		}
+
+		uint32_t Extract(uint64_t key, uint32_t bits, uint32_t shift)
+		{
+			return static_cast<uint32_t>((key >> shift) & ((1ull << bits) - 1));
+		}
+	}
+
+	uint64_t Make(uint32_t layer, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth)
+	{
+		depth = std::min(std::max(depth, 0.0f), 1.0f);
+		uint32_t quantizedDepth = static_cast<uint32_t>(depth * ((1u << DEPTH_BITS) - 1));
+
+		return Field(layer, LAYER_BITS, LAYER_SHIFT) |
+			Field(pipeline, PIPELINE_BITS, PIPELINE_SHIFT) |
+			Field(material, MATERIAL_BITS, MATERIAL_SHIFT) |
+			Field(mesh, MESH_BITS, MESH_SHIFT) |
+			Field(quantizedDepth, DEPTH_BITS, DEPTH_SHIFT);
+	}
+
+	uint32_t GetLayer(uint64_t key)
+	{
+		return Extract(key, LAYER_BITS, LAYER_SHIFT);
+	}
+
+	uint32_t GetPipeline(uint64_t key)
+	{
+		return Extract(key, PIPELINE_BITS, PIPELINE_SHIFT);
+	}
+
+	uint32_t GetMaterial(uint64_t key)
+	{
+		return Extract(key, MATERIAL_BITS, MATERIAL_SHIFT);
+	}
+
+	uint32_t GetMesh(uint64_t key)
+	{
+		return Extract(key, MESH_BITS, MESH_SHIFT);
+	}
+}
+
+namespace
+{
+	const uint32_t RADIX_BITS = 8;
+	const uint32_t BUCKET_COUNT = 1 << RADIX_BITS;
+	const size_t MIN_BLOCK_SIZE = 16 * 1024;
+}
+
+RadixSorter::RadixSorter(ThreadPool* threadPool)
+	: m_threadPool(threadPool)
+{
+}
+
+void RadixSorter::Sort(std::vector<SortableDraw>& draws)
+{
+	const size_t count = draws.size();
+	if (count < 2)
+	{
+		return;
+	}
+
+	// one block per thread unless the blocks would get too small to pay off
+	size_t blockCount = std::min<size_t>(m_threadPool->GetThreadCount(), (count + MIN_BLOCK_SIZE - 1) / MIN_BLOCK_SIZE);
+	const size_t blockSize = (count + blockCount - 1) / blockCount;
+	blockCount = (count + blockSize - 1) / blockSize;
+
+	m_scratch.resize(count);
+	m_histograms.resize(blockCount * BUCKET_COUNT);
+
+	SortableDraw* source = draws.data();
+	SortableDraw* destination = m_scratch.data();
+
+	for (uint32_t shift = 0; shift < 64; shift += RADIX_BITS)
+	{
+		m_threadPool->ParallelFor(blockCount, [&](size_t block, uint32_t)
+		{
+			uint32_t* histogram = &m_histograms[block * BUCKET_COUNT];
+			std::fill(histogram, histogram + BUCKET_COUNT, 0);
+
+			size_t end = std::min(count, (block + 1) * blockSize);
+			for (size_t i = block * blockSize; i < end; ++i)
+			{
+				++histogram[(source[i].key >> shift) & (BUCKET_COUNT - 1)];
+			}
+		});
+
+		// all keys share this digit, the pass would only copy
+		bool singleBucket = false;
+		for (uint32_t bucket = 0; bucket < BUCKET_COUNT; ++bucket)
+		{
+			size_t total = 0;
+			for (size_t block = 0; block < blockCount; ++block)
+			{
+				total += m_histograms[block * BUCKET_COUNT + bucket];
+			}
+			if (total != 0)
+			{
+				singleBucket = total == count;
+				break;
+			}
+		}
+		if (singleBucket)
+		{
+			continue;
+		}
+
+		// exclusive prefix sum, bucket major then block, keeps the sort stable
+		uint32_t offset = 0;
+		for (uint32_t bucket = 0; bucket < BUCKET_COUNT; ++bucket)
+		{
+			for (size_t block = 0; block < blockCount; ++block)
+			{
+				uint32_t& entry = m_histograms[block * BUCKET_COUNT + bucket];
+				uint32_t blockCountInBucket = entry;
+				entry = offset;
+				offset += blockCountInBucket;
+			}
+		}
+
+		m_threadPool->ParallelFor(blockCount, [&](size_t block, uint32_t)
+		{
+			uint32_t* offsets = &m_histograms[block * BUCKET_COUNT];
+
+			size_t end = std::min(count, (block + 1) * blockSize);
+			for (size_t i = block * blockSize; i < end; ++i)
+			{
+				destination[offsets[(source[i].key >> shift) & (BUCKET_COUNT - 1)]++] = source[i];
+			}
+		});
+
+		std::swap(source, destination);
+	}
+
+	if (source != draws.data())
+	{
+		std::copy(source, source + count, draws.data());
+	}
+}
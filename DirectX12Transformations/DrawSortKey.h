@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ThreadPool.h"
+
+// 64-bit draw key, most significant field first so sorting groups draws by
+// the most expensive state change:
+// layer (4) | pipeline (12) | material (16) | mesh (16) | depth (16)
+namespace DrawSortKey
+{
+	const uint32_t LAYER_BITS = 4;
+	const uint32_t PIPELINE_BITS = 12;
+	const uint32_t MATERIAL_BITS = 16;
+	const uint32_t MESH_BITS = 16;
+	const uint32_t DEPTH_BITS = 16;
+
+	// depth is quantized in [0, 1], front to back for opaque layers
+	uint64_t Make(uint32_t layer, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth);
+
+	uint32_t GetLayer(uint64_t key);
+	uint32_t GetPipeline(uint64_t key);
+	uint32_t GetMaterial(uint64_t key);
+	uint32_t GetMesh(uint64_t key);
+}
+
+// key plus the index of the draw it belongs to
+struct SortableDraw
+{
+	uint64_t key;
+	uint32_t drawIndex;
+};
+
+// LSD radix sort with 8-bit digits. Histograms are built in parallel per
+// block, scattering keeps the block order so the sort stays stable.
+// Passes whose digit is identical for every key are skipped.
+class RadixSorter
+{
+private:
+
+	ThreadPool* m_threadPool;
+	std::vector<SortableDraw> m_scratch;
+	std::vector<uint32_t> m_histograms;	// block major, 256 buckets each
+
+public:
+	explicit RadixSorter(ThreadPool* threadPool);
+
+	void Sort(std::vector<SortableDraw>& draws);
+};
@@ -1,11 +1,25 @@
 #include "stdafx.h"
 #include <comdef.h>
+#include <cmath>
 #include <iostream>
 #include "Engine.h"
 
 
 Engine::Engine(UINT resolutionWidth, UINT resolutionHeight)
-	: m_resolutionWidth(resolutionWidth), m_resolutionHeight(resolutionHeight)
+	: m_resolutionWidth(resolutionWidth), m_resolutionHeight(resolutionHeight), m_bindless(true),
+	m_wvpSrvIndex(DescriptorHeapAllocator::INVALID_INDEX),
+	m_affineUpload(true), m_frameStats{},
+	m_objectTracker(1, 2), m_frameConstantsTracker(1, 2),
+	m_frameAllocationStart(0),
+	m_frameUploadToken(UploadService::COMPLETED_TOKEN), m_compactionUploadToken(UploadService::COMPLETED_TOKEN),
+	m_geometryPool(64 * 1024, 256 * 1024), m_cubeMesh(GeometryPool::INVALID_HANDLE),
+	m_commandRecorder(&m_threadPool, 256), m_drawSorter(&m_threadPool),
+	m_indirectDraws(true), m_indirectArgsBuilder(&m_threadPool),
+	m_clusterCulling(true), m_clusterCuller(&m_threadPool), m_occlusionCulling(true), m_occlusionBuffer(&m_threadPool), m_cubeRadius(0.0f),
+	m_lodProjectionScale(1.0f), m_lodBuildSec(0.0f),
+	m_dynamicResolution(true), m_resolutionController(14.0f, 0.5f, 1.0f), m_renderScale(1.0f),
+	m_sceneColorSrvIndex(DescriptorHeapAllocator::INVALID_INDEX), m_projectionIsDirty(false), m_resizeStats{},
+	m_reverseZ(false)
 {
 }
 
@@ -73,55 +87,43 @@ void Engine::WaitForPreviousFrame()
 
 void Engine::CreateRootSignature()
 {
-	D3D12_DESCRIPTOR_RANGE descriptorTableRanges[1];
-	descriptorTableRanges[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
-	descriptorTableRanges[0].NumDescriptors = 1;
-	descriptorTableRanges[0].BaseShaderRegister = 0;
-	descriptorTableRanges[0].RegisterSpace = 0;
-	descriptorTableRanges[0].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
-
-	// color multiplier
-	D3D12_ROOT_DESCRIPTOR_TABLE rootDescriptorTable;
-	rootDescriptorTable.NumDescriptorRanges = 1;
-	rootDescriptorTable.pDescriptorRanges = descriptorTableRanges;
-
-	// WVP matrix
-	D3D12_ROOT_DESCRIPTOR rootDescriptor;
-	rootDescriptor.ShaderRegister = 1;
-	rootDescriptor.RegisterSpace = 0;
-
-	D3D12_ROOT_PARAMETER rootParameters[2];
-	// color multiplier
-	rootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-	rootParameters[0].DescriptorTable = rootDescriptorTable;
-	rootParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
-
-	// WVP matrix
-	rootParameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
-	rootParameters[1].Descriptor = rootDescriptor;
-	rootParameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+	// per-draw data is pushed inline as root constants when it fits the budget,
+	// the rest is read from the per-frame upload heaps through root descriptors
+	m_colorMultiplierParameter = m_rootSignatureBuilder.AddConstantBuffer(0, sizeof(ColorMultiplier),
+		UpdateFrequency::PerDraw, D3D12_SHADER_VISIBILITY_VERTEX);
+	if (m_bindless)
+	{
+		m_drawConstantsParameter = m_rootSignatureBuilder.AddConstantBuffer(2, sizeof(DrawConstants),
+			UpdateFrequency::PerDraw, D3D12_SHADER_VISIBILITY_VERTEX);
+		m_objectTableParameter = m_rootSignatureBuilder.AddDescriptorTable(D3D12_DESCRIPTOR_RANGE_TYPE_SRV,
+			m_descriptorHeap.GetCapacity(), 0, D3D12_SHADER_VISIBILITY_VERTEX, 1);
 
-	CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc;
+		if (m_affineUpload)
+		{
+			m_frameConstantsParameter = m_rootSignatureBuilder.AddConstantBuffer(1, sizeof(FrameConstants),
+				UpdateFrequency::PerFrame, D3D12_SHADER_VISIBILITY_VERTEX);
+		}
+	}
+	else
+	{
+		m_wvpParameter = m_rootSignatureBuilder.AddConstantBuffer(1, sizeof(Wvp),
+			UpdateFrequency::PerFrame, D3D12_SHADER_VISIBILITY_VERTEX);
+	}
 
-	rootSignatureDesc.Init(_countof(rootParameters),
-		rootParameters,
-		0,
-		nullptr,
+	HRESULT hr = m_rootSignatureBuilder.Build(m_device.Get(),
 		D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT |
 		D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
 		D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS |
-		D3D12_ROOT_SIGNATURE_FLAG_DENY_PIXEL_SHADER_ROOT_ACCESS
-	);
-
-	ID3DBlob* signature;
-	HRESULT hr = D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signature, nullptr);
+		D3D12_ROOT_SIGNATURE_FLAG_DENY_PIXEL_SHADER_ROOT_ACCESS,
+		&m_rootSignature);
 	if (FAILED(hr))
 	{
 		exit(-1);
 	}
-	
-	hr = m_device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&m_rootSignature));
-	if (FAILED(hr))
+
+	// draw constants change per draw and have no upload heap behind them, so
+	// RecordDraws can only set them as root constants
+	if (m_bindless && m_rootSignatureBuilder.GetParameterType(m_drawConstantsParameter) != D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS)
 	{
 		exit(-1);
 	}
@@ -137,13 +139,22 @@ void Engine::LoadShaders()
 	UINT compileFlags = 0;
 #endif
 
-	HRESULT hr = D3DCompileFromFile(TEXT("Shaders.hlsl"), nullptr, nullptr, "vsMain", "vs_5_0", compileFlags, 0, &m_vertexShader, nullptr);
+	// resource arrays need shader model 5.1
+	const D3D_SHADER_MACRO bindlessDefines[] = { { "BINDLESS", "1" }, { nullptr, nullptr } };
+	const D3D_SHADER_MACRO affineDefines[] = { { "BINDLESS", "1" }, { "AFFINE_WORLD", "1" }, { nullptr, nullptr } };
+	const D3D_SHADER_MACRO* defines = nullptr;
+	if (m_bindless)
+	{
+		defines = m_affineUpload ? affineDefines : bindlessDefines;
+	}
+
+	HRESULT hr = D3DCompileFromFile(TEXT("Shaders.hlsl"), defines, nullptr, "vsMain", "vs_5_1", compileFlags, 0, &m_vertexShader, nullptr);
 	if (FAILED(hr))
 	{
 		exit(-1);
 	}
 
-	hr = D3DCompileFromFile(TEXT("Shaders.hlsl"), nullptr, nullptr, "psMain", "ps_5_0", compileFlags, 0, &m_pixelShader, nullptr);
+	hr = D3DCompileFromFile(TEXT("Shaders.hlsl"), defines, nullptr, "psMain", "ps_5_1", compileFlags, 0, &m_pixelShader, nullptr);
 	if (FAILED(hr))
 	{
 		exit(-1);
@@ -189,6 +200,10 @@ void Engine::CreatePipelineStateObject()
 	psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
 	psoDesc.NumRenderTargets = 1;
 	psoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+	if (m_reverseZ)
+	{
+		psoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_GREATER;
+	}
 	psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
 
 	HRESULT hr = m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_pipelineState));
@@ -214,52 +229,8 @@ void Engine::CreateVertexBuffer()
 
 	};
 
-	int vBufferSize = sizeof(vList);
-
-	// create default heap - memory on GPU. Only GPU has access to it.
-	HRESULT hr = m_device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(vBufferSize),
-		D3D12_RESOURCE_STATE_COPY_DEST,
-		nullptr,
-		IID_PPV_ARGS(&m_vertexBuffer)
-	);
-	if (FAILED(hr))
-	{
-		exit(-1);
-	}
-
-	m_vertexBuffer->SetName(L"Vertex Buffer Resource Type");
-	
-	// create upload heap - cpu can write to it, gpu can read from it
-	hr = m_device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(vBufferSize),
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(&m_vBufferUploadHeap)
-	);
-	if (FAILED(hr))
-	{
-		exit(-1);
-	}
-
-	m_vBufferUploadHeap->SetName(L"Vertex Buffer Upload Resource Heap");
-
-	// store vertex buffer in upload heap
-	D3D12_SUBRESOURCE_DATA vertexData = {};
-	vertexData.pData = reinterpret_cast<BYTE*>(vList);
-	vertexData.RowPitch = vBufferSize;
-	vertexData.SlicePitch = vBufferSize;
-
-	// copy from upload heap to default heap
-	UpdateSubresources(m_commandList.Get(), m_vertexBuffer.Get(), m_vBufferUploadHeap.Get(), 0, 0, 1, &vertexData);
-	m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_vertexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER));
-
 	// index buffer
-	DWORD iList[] = {
+	uint32_t iList[] = {
 		// front
 		0, 1, 2,
 		0, 2, 3,
@@ -285,58 +256,144 @@ void Engine::CreateVertexBuffer()
 		0, 5, 1
 	};
 
-	int iBufferSize = sizeof(iList);
-
-	// create deafult heap
-	hr = m_device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(iBufferSize),
-		D3D12_RESOURCE_STATE_COPY_DEST,
-		nullptr,
-		IID_PPV_ARGS(&m_indexBuffer)
-	);
-	if (FAILED(hr))
+	// split into clusters that are culled every frame, the pool gets the
+	// indices in cluster order so every cluster is one index range
+	MeshletBuilder::Build(iList, _countof(iList), &vList[0].pos.x, _countof(vList), sizeof(Vertex), m_cubeMeshlets);
+
+	// coarser levels follow the cluster ordered level 0 in the same index range
+	high_resolution_clock::time_point lodStart = high_resolution_clock::now();
+	MeshSimplifier::BuildLodChain(m_cubeMeshlets.indices.data(), m_cubeMeshlets.indices.size(), &vList[0].pos.x, _countof(vList), sizeof(Vertex),
+		4, 0.5f, 1.0f, m_cubeLods);
+	m_lodBuildSec = duration<float>(high_resolution_clock::now() - lodStart).count();
+
+	// the cube is one range of the shared geometry buffers, uploaded on the
+	// copy queue, the graphics queue waits for it on first use
+	m_cubeMesh = m_geometryPool.AddMesh(vList, _countof(vList), m_cubeLods.indices.data(), static_cast<uint32_t>(m_cubeLods.indices.size()));
+	if (m_cubeMesh == GeometryPool::INVALID_HANDLE)
 	{
 		exit(-1);
 	}
-	m_indexBuffer->SetName(L"Index buffer default heap");
+	m_uploadService.Flush();
+
+	// CPU copy for the occlusion buffer
+	m_cubePositions.clear();
+	XMVECTOR boundsMin = XMLoadFloat3(&vList[0].pos);
+	XMVECTOR boundsMax = boundsMin;
+	for (const Vertex& vertex : vList)
+	{
+		m_cubePositions.push_back(vertex.pos);
+		boundsMin = XMVectorMin(boundsMin, XMLoadFloat3(&vertex.pos));
+		boundsMax = XMVectorMax(boundsMax, XMLoadFloat3(&vertex.pos));
+	}
+	XMStoreFloat3(&m_cubeBoundsMin, boundsMin);
+	XMStoreFloat3(&m_cubeBoundsMax, boundsMax);
+	m_cubeRadius = XMVectorGetX(XMVector3Length(XMVectorMax(XMVectorAbs(boundsMin), XMVectorAbs(boundsMax))));
+
+	HRESULT hr;
 
-	// create upload heap
-	hr = m_device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(iBufferSize),
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(&m_iBufferUploadHeap)
-	);
+	// execute the initial command list, geometry is already on the copy queue
+	m_commandList->Close();
+
+	ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
+	m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+	m_fenceValue++;
+	hr = m_commandQueue->Signal(m_fence.Get(), m_fenceValue);
 	if (FAILED(hr))
 	{
 		exit(-1);
 	}
+}
 
-	// store index data in upload heap
-	D3D12_SUBRESOURCE_DATA indexData = {};
-	indexData.pData = reinterpret_cast<BYTE*>(iList);
-	indexData.RowPitch = iBufferSize;
-	indexData.SlicePitch = iBufferSize;
+void Engine::FillOutViewportAndScissorRect()
+{
+	m_outputViewport.TopLeftX = 0;
+	m_outputViewport.TopLeftY = 0;
+	m_outputViewport.Width = static_cast<float>(m_resolutionWidth);
+	m_outputViewport.Height = static_cast<float>(m_resolutionHeight);
+	m_outputViewport.MinDepth = 0.0f;
+	m_outputViewport.MaxDepth = 1.0f;
+
+	m_outputScissorRect.left = 0;
+	m_outputScissorRect.top = 0;
+	m_outputScissorRect.right = m_resolutionWidth;
+	m_outputScissorRect.bottom = m_resolutionHeight;
+
+	// the scene covers the top left corner of its target, nothing is reallocated
+	uint32_t renderWidth;
+	uint32_t renderHeight;
+	m_resolutionController.GetRenderSize(m_resolutionWidth, m_resolutionHeight, &renderWidth, &renderHeight);
+	if (!m_dynamicResolution)
+	{
+		renderWidth = m_resolutionWidth;
+		renderHeight = m_resolutionHeight;
+	}
 
-	UpdateSubresources(m_commandList.Get(), m_indexBuffer.Get(), m_iBufferUploadHeap.Get(), 0, 0, 1, &indexData);
+	m_viewport = m_outputViewport;
+	m_viewport.Width = static_cast<float>(renderWidth);
+	m_viewport.Height = static_cast<float>(renderHeight);
 
-	m_commandList->ResourceBarrier(
-		1,
-		&CD3DX12_RESOURCE_BARRIER::Transition(m_indexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER)
-	);
+	m_scissorRect = m_outputScissorRect;
+	m_scissorRect.right = renderWidth;
+	m_scissorRect.bottom = renderHeight;
 
-	// create depth/stencil descriptor heap
-	D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc = {};
-	dsvHeapDesc.NumDescriptors = 1;
-	dsvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
-	dsvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+	m_frameStats.renderWidth = renderWidth;
+	m_frameStats.renderHeight = renderHeight;
+	m_frameStats.renderScale = m_renderScale;
+}
 
-	hr = m_device->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(&m_dsDescriptorHeap));
-	if (FAILED(hr))
+void Engine::CreateBackBufferViews()
+{
+	CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart());
+
+	for (UINT i = 0; i < 2; ++i)
+	{
+		if (FAILED(m_swapChain->GetBuffer(i, IID_PPV_ARGS(&m_renderTarget[i]))))
+		{
+			exit(-1);
+		}
+
+		m_device->CreateRenderTargetView(m_renderTarget[i].Get(), nullptr, rtvHandle);
+		rtvHandle.Offset(1, m_rtvDescriptorSize);
+	}
+}
+
+void Engine::CreateRenderTargets()
+{
+	// the views keep their slots, only the resources behind them change on resize
+	HRESULT hr;
+	if (m_dsDescriptorHeap == nullptr)
+	{
+		D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc = {};
+		dsvHeapDesc.NumDescriptors = 1;
+		dsvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
+		dsvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+
+		hr = m_device->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(&m_dsDescriptorHeap));
+		if (FAILED(hr))
+		{
+			exit(-1);
+		}
+		m_dsDescriptorHeap->SetName(L"Depth Stencil Resource Heap");
+	}
+
+	if (m_sceneColorSrvIndex == DescriptorHeapAllocator::INVALID_INDEX)
+	{
+		m_sceneColorSrvIndex = m_descriptorHeap.AllocatePersistent();
+		if (m_sceneColorSrvIndex == DescriptorHeapAllocator::INVALID_INDEX)
+		{
+			exit(-1);
+		}
+	}
+
+	// depth buffer
+	D3D12_CLEAR_VALUE depthOptimizedClearValue = {};
+	depthOptimizedClearValue.Format = DXGI_FORMAT_D32_FLOAT;
+	depthOptimizedClearValue.DepthStencil.Depth = m_reverseZ ? 0.0f : 1.0f;
+	depthOptimizedClearValue.DepthStencil.Stencil = 0;
+
+	m_dsBuffer = m_targetPool.Acquire(m_resolutionWidth, m_resolutionHeight, DXGI_FORMAT_D32_FLOAT,
+		D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL, D3D12_RESOURCE_STATE_DEPTH_WRITE, &depthOptimizedClearValue);
+	if (m_dsBuffer == nullptr)
 	{
 		exit(-1);
 	}
@@ -345,89 +402,197 @@ void Engine::CreateVertexBuffer()
 	depthStencilDesc.Format = DXGI_FORMAT_D32_FLOAT;
 	depthStencilDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
 	depthStencilDesc.Flags = D3D12_DSV_FLAG_NONE;
+	m_device->CreateDepthStencilView(m_dsBuffer.Get(), &depthStencilDesc, m_dsDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
 
-	D3D12_CLEAR_VALUE depthOptimizedClearValue = {};
-	depthOptimizedClearValue.Format = DXGI_FORMAT_D32_FLOAT;
-	depthOptimizedClearValue.DepthStencil.Depth = 1.0f;
-	depthOptimizedClearValue.DepthStencil.Stencil = 0;
+	// scene color, drawn at the render resolution and stretched to the back buffer
+	D3D12_CLEAR_VALUE clearValue = {};
+	clearValue.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	clearValue.Color[0] = 0.5f;
+	clearValue.Color[1] = 0.5f;
+	clearValue.Color[2] = 0.5f;
+	clearValue.Color[3] = 1.0f;
+
+	m_sceneColor = m_targetPool.Acquire(m_resolutionWidth, m_resolutionHeight, DXGI_FORMAT_R8G8B8A8_UNORM,
+		D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, &clearValue);
+	if (m_sceneColor == nullptr)
+	{
+		exit(-1);
+	}
 
-	hr = m_device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_D32_FLOAT, m_resolutionWidth, m_resolutionHeight, 1, 0, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL),
-		D3D12_RESOURCE_STATE_DEPTH_WRITE,
-		&depthOptimizedClearValue,
-		IID_PPV_ARGS(&m_dsBuffer)
-	);
+	CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), SCENE_COLOR_RTV, m_rtvDescriptorSize);
+	m_device->CreateRenderTargetView(m_sceneColor.Get(), nullptr, rtvHandle);
+	m_device->CreateShaderResourceView(m_sceneColor.Get(), nullptr, m_descriptorHeap.GetCpuHandle(m_sceneColorSrvIndex));
+}
+
+void Engine::CreateUpscalePipeline()
+{
+	m_upscaleConstantsParameter = m_upscaleRootSignatureBuilder.AddConstantBuffer(3, sizeof(UpscaleConstants),
+		UpdateFrequency::PerDraw, D3D12_SHADER_VISIBILITY_ALL);
+	m_upscaleTextureParameter = m_upscaleRootSignatureBuilder.AddDescriptorTable(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0,
+		D3D12_SHADER_VISIBILITY_PIXEL);
+
+	CD3DX12_STATIC_SAMPLER_DESC linearClamp(0, D3D12_FILTER_MIN_MAG_MIP_LINEAR,
+		D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP, D3D12_TEXTURE_ADDRESS_MODE_CLAMP);
+	linearClamp.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+	m_upscaleRootSignatureBuilder.AddStaticSampler(linearClamp);
+
+	HRESULT hr = m_upscaleRootSignatureBuilder.Build(m_device.Get(),
+		D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
+		D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
+		D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS,
+		&m_upscaleRootSignature);
 	if (FAILED(hr))
 	{
 		exit(-1);
 	}
 
-	hr = m_device->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(&m_dsDescriptorHeap));
+#if defined(_DEBUG)
+	UINT compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#else
+	UINT compileFlags = 0;
+#endif
+
+	hr = D3DCompileFromFile(TEXT("Shaders.hlsl"), nullptr, nullptr, "vsUpscale", "vs_5_1", compileFlags, 0, &m_upscaleVertexShader, nullptr);
 	if (FAILED(hr))
 	{
 		exit(-1);
 	}
-	m_dsDescriptorHeap->SetName(L"Depth Stencil Resource Heap");
 
-	m_device->CreateDepthStencilView(m_dsBuffer.Get(), &depthStencilDesc, m_dsDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
+	hr = D3DCompileFromFile(TEXT("Shaders.hlsl"), nullptr, nullptr, "psUpscale", "ps_5_1", compileFlags, 0, &m_upscalePixelShader, nullptr);
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
 
-	// execute command list to upload initial assets
-	m_commandList->Close();
+	// no vertex buffer, the triangle comes from the vertex id
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
+	psoDesc.pRootSignature = m_upscaleRootSignature.Get();
+	psoDesc.VS = CD3DX12_SHADER_BYTECODE(m_upscaleVertexShader.Get());
+	psoDesc.PS = CD3DX12_SHADER_BYTECODE(m_upscalePixelShader.Get());
+	psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+	psoDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+	psoDesc.SampleDesc.Count = 1;
+	psoDesc.SampleMask = 0xffffffff;
+	psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+	psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+	psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+	psoDesc.NumRenderTargets = 1;
+	psoDesc.DepthStencilState.DepthEnable = FALSE;
+	psoDesc.DepthStencilState.StencilEnable = FALSE;
 
-	ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
-	m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
-	m_fenceValue++;
-	hr = m_commandQueue->Signal(m_fence.Get(), m_fenceValue);
+	hr = m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_upscalePipelineState));
 	if (FAILED(hr))
 	{
 		exit(-1);
 	}
+}
 
-	// create vertex buffer view
-	m_vertexBufferView.BufferLocation = m_vertexBuffer->GetGPUVirtualAddress();
-	m_vertexBufferView.StrideInBytes = sizeof(Vertex);
-	m_vertexBufferView.SizeInBytes = vBufferSize;
+void Engine::UpdateRenderScale(UINT measuredFrameIndex)
+{
+	// the slot's fence has passed, its timestamps are in the readback buffer
+	m_frameStats.gpuSec = m_gpuTimer.GetSeconds(measuredFrameIndex);
 
-	// create index buffer view
-	m_indexBufferView.BufferLocation = m_indexBuffer->GetGPUVirtualAddress();
-	m_indexBufferView.Format = DXGI_FORMAT_R32_UINT;
-	m_indexBufferView.SizeInBytes = iBufferSize;
+	if (m_dynamicResolution)
+	{
+		m_renderScale = m_resolutionController.Update(m_frameStats.gpuSec * 1000.0f, m_renderScale);
+	}
+	else
+	{
+		m_renderScale = 1.0f;
+	}
+	FillOutViewportAndScissorRect();
 }
 
-void Engine::FillOutViewportAndScissorRect()
+void Engine::RecordUpscale()
 {
-	m_viewport.TopLeftX = 0;
-	m_viewport.TopLeftY = 0;
-	m_viewport.Width = static_cast<float>(m_resolutionWidth);
-	m_viewport.Height = static_cast<float>(m_resolutionHeight);
-	m_viewport.MinDepth = 0.0f;
-	m_viewport.MaxDepth = 1.0f;
+	// the graph moved the scene color to shader resource and the back buffer to render target
+	ID3D12GraphicsCommandList* commandList = m_commandListTail.Get();
 
-	m_scissorRect.left = 0;
-	m_scissorRect.top = 0;
-	m_scissorRect.right = m_resolutionWidth;
-	m_scissorRect.bottom = m_resolutionHeight;
+	CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), m_frameIndex, m_rtvDescriptorSize);
+	commandList->OMSetRenderTargets(1, &rtvHandle, FALSE, nullptr);
+
+	commandList->SetGraphicsRootSignature(m_upscaleRootSignature.Get());
+	commandList->SetPipelineState(m_upscalePipelineState.Get());
+
+	ID3D12DescriptorHeap* descriptorHeaps[] = { m_descriptorHeap.GetHeap() };
+	commandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+	commandList->SetGraphicsRootDescriptorTable(m_upscaleRootSignatureBuilder.GetRootIndex(m_upscaleTextureParameter),
+		m_descriptorHeap.GetGpuHandle(m_sceneColorSrvIndex));
+
+	// the filter must not pull in texels outside the rendered corner
+	D3D12_RESOURCE_DESC sceneColorDesc = m_sceneColor->GetDesc();
+	float targetWidth = static_cast<float>(sceneColorDesc.Width);
+	float targetHeight = static_cast<float>(sceneColorDesc.Height);
+
+	UpscaleConstants constants;
+	constants.uvScale.x = m_viewport.Width / targetWidth;
+	constants.uvScale.y = m_viewport.Height / targetHeight;
+	constants.uvMax.x = (m_viewport.Width - 0.5f) / targetWidth;
+	constants.uvMax.y = (m_viewport.Height - 0.5f) / targetHeight;
+	commandList->SetGraphicsRoot32BitConstants(m_upscaleRootSignatureBuilder.GetRootIndex(m_upscaleConstantsParameter),
+		sizeof(UpscaleConstants) / 4, &constants, 0);
+
+	commandList->RSSetViewports(1, &m_outputViewport);
+	commandList->RSSetScissorRects(1, &m_outputScissorRect);
+	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	commandList->DrawInstanced(3, 1, 0, 0);
 }
 
-void Engine::CreateConstantBuffers()
+void Engine::CreateCommandSignature()
 {
-	HRESULT hr;
-	// descriptor heap
+	// the per-draw object index has to be a root constant the signature can set
+	if (!m_bindless || m_rootSignatureBuilder.GetParameterType(m_drawConstantsParameter) != D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS)
+	{
+		m_indirectDraws = false;
+		return;
+	}
+
+	D3D12_INDIRECT_ARGUMENT_DESC arguments[2] = {};
+	arguments[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+	arguments[0].Constant.RootParameterIndex = m_rootSignatureBuilder.GetRootIndex(m_drawConstantsParameter);
+	arguments[0].Constant.DestOffsetIn32BitValues = offsetof(DrawConstants, objectIndex) / sizeof(UINT);
+	arguments[0].Constant.Num32BitValuesToSet = 1;
+	arguments[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+	D3D12_COMMAND_SIGNATURE_DESC signatureDesc = {};
+	signatureDesc.ByteStride = sizeof(IndirectDrawCommand);
+	signatureDesc.NumArgumentDescs = _countof(arguments);
+	signatureDesc.pArgumentDescs = arguments;
+
+	// root signature is required because the signature changes root arguments
+	HRESULT hr = m_device->CreateCommandSignature(&signatureDesc, m_rootSignature.Get(), IID_PPV_ARGS(&m_commandSignature));
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
+
+	// argument buffers are written by the CPU every frame and read in place
 	for (int i = 0; i < 2; ++i)
 	{
-		D3D12_DESCRIPTOR_HEAP_DESC descriptorHeapDesc = {};
-		descriptorHeapDesc.NumDescriptors = 2;
-		descriptorHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-		descriptorHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+		hr = m_device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer(MAX_INDIRECT_DRAWS * sizeof(IndirectDrawCommand)),
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(&m_indirectArgsUploadHeap[i]));
+		if (FAILED(hr))
+		{
+			exit(-1);
+		}
+		m_indirectArgsUploadHeap[i]->SetName(L"Indirect Arguments Upload Resource Heap");
 
-		hr = m_device->CreateDescriptorHeap(&descriptorHeapDesc, IID_PPV_ARGS(&m_cbDescriptorHeap[i]));
+		CD3DX12_RANGE readRange(0, 0);
+		hr = m_indirectArgsUploadHeap[i]->Map(0, &readRange, reinterpret_cast<void**>(&m_indirectArgs[i]));
 		if (FAILED(hr))
 		{
 			exit(-1);
 		}
 	}
+}
+
+void Engine::CreateConstantBuffers()
+{
+	HRESULT hr;
 
 	// resource heap
 	for (int i = 0; i < 2; ++i)
@@ -448,20 +613,18 @@ void Engine::CreateConstantBuffers()
 
 		m_cbColorMultiplierUploadHeap[i]->SetName(L"Constant Buffer Color Multiplier Upload Heap");
 
-		D3D12_CONSTANT_BUFFER_VIEW_DESC cbvColorMultiplierDesc = {};
-		cbvColorMultiplierDesc.BufferLocation = m_cbColorMultiplierUploadHeap[i]->GetGPUVirtualAddress();
-		cbvColorMultiplierDesc.SizeInBytes = (sizeof(ColorMultiplier) + 255) & ~255;
-		m_device->CreateConstantBufferView(&cbvColorMultiplierDesc, m_cbDescriptorHeap[i]->GetCPUDescriptorHandleForHeapStart());
-
 		m_cbColorMultiplierData = {};
 
+		// mapped memory is write-combined, it is only ever written through an UploadWriter
 		CD3DX12_RANGE readRange(0, 0);
-		hr = m_cbColorMultiplierUploadHeap[i]->Map(0, &readRange, reinterpret_cast<void**>(&m_cbColorMultiplierGpuAddress[i]));
+		void* mapped;
+		hr = m_cbColorMultiplierUploadHeap[i]->Map(0, &readRange, &mapped);
 		if (FAILED(hr))
 		{
 			exit(-1);
 		}
-		memcpy(m_cbColorMultiplierGpuAddress[i], &m_cbColorMultiplierData, sizeof(m_cbColorMultiplierData));
+		m_cbColorMultiplierWriter[i] = UploadWriter(mapped, 1024 * 64);
+		m_cbColorMultiplierWriter[i].Write(0, &m_cbColorMultiplierData, sizeof(m_cbColorMultiplierData));
 
 		// WVP matrix
 
@@ -478,166 +641,313 @@ void Engine::CreateConstantBuffers()
 		}
 
 		m_cbWvpUploadHeap[i]->SetName(L"Constant buffer WVP matrix upload heap");
+		hr = m_cbWvpUploadHeap[i]->Map(0, &readRange, &mapped);
+		if (FAILED(hr))
+		{
+			exit(-1);
+		}
+		m_cbWvpWriter[i] = UploadWriter(mapped, 1024 * 64);
+		m_cbWvpWriter[i].Write(0, &m_wvpData, sizeof(Wvp));
 
-		D3D12_CONSTANT_BUFFER_VIEW_DESC cbWvpDesc;
-		cbWvpDesc.BufferLocation = m_cbWvpUploadHeap[i]->GetGPUVirtualAddress();
-		cbWvpDesc.SizeInBytes = (sizeof(Wvp) + 255) & ~255;
+		if (m_bindless && m_affineUpload)
+		{
+			hr = m_device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+				D3D12_HEAP_FLAG_NONE,
+				&CD3DX12_RESOURCE_DESC::Buffer(1024 * 64),
+				D3D12_RESOURCE_STATE_GENERIC_READ,
+				nullptr,
+				IID_PPV_ARGS(&m_cbFrameUploadHeap[i]));
+
+			if (FAILED(hr))
+			{
+				exit(-1);
+			}
 
-		UINT colorMultiplierDescriptorIncrementSize =
-			m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+			m_cbFrameUploadHeap[i]->SetName(L"Constant buffer frame constants upload heap");
+			hr = m_cbFrameUploadHeap[i]->Map(0, &readRange, &mapped);
+			if (FAILED(hr))
+			{
+				exit(-1);
+			}
+			m_cbFrameWriter[i] = UploadWriter(mapped, 1024 * 64);
+			m_cbFrameWriter[i].Write(0, &m_frameConstants, sizeof(FrameConstants));
+		}
+	}
+}
 
-		CD3DX12_CPU_DESCRIPTOR_HANDLE cbWvpCpuDescriptorHandle(m_cbDescriptorHeap[i]->GetCPUDescriptorHandleForHeapStart());
-		cbWvpCpuDescriptorHandle.Offset(1, colorMultiplierDescriptorIncrementSize);
+void Engine::UploadConstantBuffer(UINT parameter, const void* data, UINT size, UploadWriter& writer)
+{
+	// root constants are recorded straight into the command list
+	if (m_rootSignatureBuilder.GetParameterType(parameter) != D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS)
+	{
+		writer.Write(0, data, size);
+	}
+}
 
-		m_device->CreateConstantBufferView(&cbWvpDesc, cbWvpCpuDescriptorHandle);
-		m_cbWvpUploadHeap[i]->Map(0, &readRange, reinterpret_cast<void**>(&m_cbWvpGpuAddress[i]));
+void Engine::SetConstantBuffer(ID3D12GraphicsCommandList* commandList, UINT parameter, const void* data, ID3D12Resource* uploadHeap)
+{
+	UINT rootIndex = m_rootSignatureBuilder.GetRootIndex(parameter);
 
-		memcpy(m_cbWvpGpuAddress[i], &m_wvpData, sizeof(Wvp));
+	if (m_rootSignatureBuilder.GetParameterType(parameter) == D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS)
+	{
+		commandList->SetGraphicsRoot32BitConstants(rootIndex, m_rootSignatureBuilder.GetNum32BitValues(parameter), data, 0);
+	}
+	else
+	{
+		commandList->SetGraphicsRootConstantBufferView(rootIndex, uploadHeap->GetGPUVirtualAddress());
 	}
 }
 
 void Engine::InitWvp()
 {
-	// world
+	// view
 
-	m_scale = XMFLOAT4(1.0f, 1.0f, 1.0f, 0.0f);
-	m_position = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
-	m_rotation = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+	m_camera.SetPosition(0.0f, 0.0f, -3.0f);
+	m_camera.SetRotation(0.0f, 0.0f);
 
-	XMVECTOR scale = XMLoadFloat4(&m_scale);
-	XMVECTOR position = XMLoadFloat4(&m_position);
-	XMVECTOR rotation = XMLoadFloat4(&m_rotation);
+	XMMATRIX viewMat = m_camera.GetViewMatrix();
 
-	XMMATRIX scaleMat = XMMatrixScalingFromVector(scale);
-	XMMATRIX positionMat = XMMatrixTranslationFromVector(position);
-	XMMATRIX rotationMat = XMMatrixRotationRollPitchYawFromVector(rotation);
+	// projection
 
-	XMMATRIX worldMat = scaleMat * positionMat * rotationMat;
+	UpdateProjection();
+	XMMATRIX projectionMat = m_camera.GetProjectionMatrix();
 
-	XMStoreFloat4x4(&m_worldMat, worldMat);
+	// World-View-Projection matrix
 
-	// view
+	PackWvpTransforms(&m_objectWorlds[0], viewMat * projectionMat, &m_wvpData.wvp, 1);
+
+	UpdateViewProjection();
+}
 
-	m_cameraPosition = XMFLOAT4(0.0f, 0.0f, -3.0f, 0.0f);
-	m_cameraRotation = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+void Engine::UpdateProjection()
+{
+	const float fov = 60.0f * (XM_PI / 180.0f);
+	const float aspectRatio = static_cast<float>(m_resolutionWidth) / static_cast<float>(m_resolutionHeight);
 
-	m_viewMat._11 = 1.0f;	m_viewMat._12 = 0.0f;	m_viewMat._13 = 0.0f;	m_viewMat._14 = 0.0f;
-	m_viewMat._21 = 0.0f;	m_viewMat._22 = 1.0f;	m_viewMat._23 = 0.0f;	m_viewMat._24 = 0.0f;
-	m_viewMat._31 = 0.0f;	m_viewMat._32 = 0.0f;	m_viewMat._33 = 1.0f;	m_viewMat._34 = 0.0f;
+	// pixels covered by one unit at distance one, for LOD selection
+	m_lodProjectionScale = static_cast<float>(m_resolutionHeight) / (2.0f * tanf(0.5f * fov));
+	if (m_reverseZ)
+	{
+		m_camera.SetPerspectiveReverseZ(fov, aspectRatio, 0.01f);
+	}
+	else
+	{
+		m_camera.SetPerspective(fov, aspectRatio, 0.01f, 1000.0f);
+	}
+}
 
-	m_viewMat._41 = -m_cameraPosition.x;	
-	m_viewMat._42 = -m_cameraPosition.y;
-	m_viewMat._43 = -m_cameraPosition.z;
-	m_viewMat._44 = 1.0f;
+void Engine::CreateScene()
+{
+	m_worldComponent = m_scene.RegisterComponent<XMFLOAT4X4>();
+	m_objectIndexComponent = m_scene.RegisterComponent<UINT>();
+	m_animationComponent = m_scene.RegisterComponent<AnimationInstance>();
+	m_colorComponent = m_scene.RegisterComponent<XMFLOAT4>();
+
+	// the cube turns once around y and cycles its color every loop
+	const float sampleRate = 4.0f;
+	const float loopSec = 8.0f;
+	const uint32_t keyCount = static_cast<uint32_t>(loopSec * sampleRate) + 1;
+
+	std::vector<XMFLOAT4> rotationKeys(keyCount);
+	std::vector<XMFLOAT4> colorKeys(keyCount);
+	for (uint32_t key = 0; key < keyCount; ++key)
+	{
+		float phase = static_cast<float>(key) / (keyCount - 1);
+		XMStoreFloat4(&rotationKeys[key], XMQuaternionRotationRollPitchYaw(0.0f, XM_2PI * phase, 0.0f));
+
+		// triangle waves of one, two and three periods per loop
+		float red = fabsf(2.0f * (phase - floorf(phase + 0.5f)));
+		float green = fabsf(2.0f * (2.0f * phase - floorf(2.0f * phase + 0.5f)));
+		float blue = fabsf(2.0f * (3.0f * phase - floorf(3.0f * phase + 0.5f)));
+		colorKeys[key] = XMFLOAT4(red, green, blue, 1.0f);
+	}
 
-	XMMATRIX viewMat = XMLoadFloat4x4(&m_viewMat);
+	AnimationClip clip(sampleRate, true);
+	clip.SetTrack(AnimationChannel::Rotation, &rotationKeys[0].x, keyCount);
+	clip.SetTrack(AnimationChannel::Color, &colorKeys[0].x, keyCount);
+	m_animationClips.push_back(clip);
 
-	// projection
+	m_cubeEntity = m_scene.Create(EntityWorld::MaskOf(m_worldComponent) | EntityWorld::MaskOf(m_objectIndexComponent) |
+		EntityWorld::MaskOf(m_animationComponent) | EntityWorld::MaskOf(m_colorComponent));
 
-	const float fov = 60.0f * (XM_PI / 180.0f);
-	const float aspectRatio = static_cast<float>(m_resolutionWidth) / static_cast<float>(m_resolutionHeight);
-	XMMATRIX projectionMat = XMMatrixPerspectiveFovLH(fov, aspectRatio, 0.01f, 1000.0f);
+	XMMATRIX worldMat = ComposeWorldMatrix(XMVectorSet(1.0f, 1.0f, 1.0f, 0.0f), XMVectorZero(), XMVectorZero());
+	XMStoreFloat4x4(m_scene.Get<XMFLOAT4X4>(m_cubeEntity, m_worldComponent), worldMat);
+	*m_scene.Get<UINT>(m_cubeEntity, m_objectIndexComponent) = 0;
+	m_scene.Get<AnimationInstance>(m_cubeEntity, m_animationComponent)->clip = 0;
 
-	XMStoreFloat4x4(&m_projectionMat, projectionMat);
+	// the engine draws the one cube; the multi-object paths of FramePhases and
+	// the indirect recording run with generated scenes in the frame benchmark
+	m_objectWorlds.resize(1);
+	GatherObjectTransforms();
+}
 
-	// World-View-Projection matrix
+bool Engine::UpdateScene(float deltaSec)
+{
+	// animation system, chunks are sampled in parallel straight into their world and color arrays
+	const ComponentMask animated = EntityWorld::MaskOf(m_worldComponent) | EntityWorld::MaskOf(m_animationComponent) |
+		EntityWorld::MaskOf(m_colorComponent);
+
+	size_t animatedChunks = m_scene.ParallelForEachChunk(m_threadPool, animated, 0, [this, deltaSec](const EntityChunkView& chunk, uint32_t)
+	{
+		AnimationInstance* instances = chunk.Get<AnimationInstance>(m_animationComponent);
+		AnimationSampler::Advance(m_animationClips.data(), instances, chunk.count, deltaSec);
+		AnimationSampler::SampleRange(m_animationClips.data(), instances, 0, chunk.count,
+			chunk.Get<XMFLOAT4X4>(m_worldComponent), chunk.Get<XMFLOAT4>(m_colorComponent));
+	});
+
+	GatherObjectTransforms();
 
-	XMMATRIX wvpMat = worldMat * viewMat * projectionMat;
-	XMMATRIX wvpTransposedMat = XMMatrixTranspose(wvpMat);
+	// one color multiplier buffer, it follows the cube
+	m_cbColorMultiplierData.colorMultiplier = *m_scene.Get<XMFLOAT4>(m_cubeEntity, m_colorComponent);
 
-	XMStoreFloat4x4(&m_wvpData.wvp, wvpTransposedMat);
+	return animatedChunks > 0;
 }
 
-void Engine::UpdateWvp(float deltaSec)
+void Engine::GatherObjectTransforms()
 {
-	const float movementSpeed = 1.0f;
-	const float rotationSpeed = 0.005f;
-	bool viewHasChanged = false;
+	// transform system, world matrices in object buffer order for upload, culling and sorting
+	const ComponentMask objects = EntityWorld::MaskOf(m_worldComponent) | EntityWorld::MaskOf(m_objectIndexComponent);
+
+	m_scene.ForEachChunk(objects, 0, [this](const EntityChunkView& chunk)
+	{
+		const XMFLOAT4X4* worldMats = chunk.Get<XMFLOAT4X4>(m_worldComponent);
+		const UINT* objectIndices = chunk.Get<UINT>(m_objectIndexComponent);
+		for (uint32_t i = 0; i < chunk.count; ++i)
+		{
+			m_objectWorlds[objectIndices[i]] = worldMats[i];
+		}
+	});
+}
+
+void Engine::UpdateViewProjection()
+{
+	XMMATRIX viewProjectionMat = m_camera.GetViewMatrix() * m_camera.GetProjectionMatrix();
+	XMStoreFloat4x4(&m_frameConstants.viewProjection, XMMatrixTranspose(viewProjectionMat));
+}
 
-	XMVECTOR cameraRotationVec = XMLoadFloat4(&m_cameraRotation);
-	XMMATRIX cameraRotationMat = XMMatrixRotationRollPitchYawFromVector(cameraRotationVec);
+UINT Engine::GetObjectStride() const
+{
+	return m_affineUpload ? sizeof(AffineTransform) : sizeof(Wvp);
+}
+
+void Engine::CreateObjectBufferView()
+{
+	// the upload heap of this frame slot doubles as a structured buffer of per-object data
+	m_wvpSrvIndex = m_descriptorHeap.AllocateTransient(1);
+	if (m_wvpSrvIndex == DescriptorHeapAllocator::INVALID_INDEX)
+	{
+		exit(-1);
+	}
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Buffer.FirstElement = 0;
+	srvDesc.Buffer.NumElements = (1024 * 64) / GetObjectStride();
+	srvDesc.Buffer.StructureByteStride = GetObjectStride();
+	srvDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
 
-	XMFLOAT4 forwardVecFlt(0.0f, 0.0f, 1.0f, 0.0f);
-	XMVECTOR forwardVec = XMLoadFloat4(&forwardVecFlt);
-	forwardVec = XMVector4Transform(forwardVec, cameraRotationMat);
+	m_device->CreateShaderResourceView(m_cbWvpUploadHeap[m_frameIndex].Get(), &srvDesc, m_descriptorHeap.GetCpuHandle(m_wvpSrvIndex));
+}
 
-	XMFLOAT4 rightVecFlt(1.0f, 0.0f, 0.0f, 0.0f);
-	XMVECTOR rightVec = XMLoadFloat4(&rightVecFlt);
-	rightVec = XMVector4Transform(rightVec, cameraRotationMat);
+void Engine::UpdateWvp(float deltaSec, bool worldHasChanged)
+{
+	const float movementSpeed = 1.0f;
+	const float rotationSpeed = 0.005f;
+	bool viewHasChanged = false;
 
-	XMVECTOR cameraPositionVec = XMLoadFloat4(&m_cameraPosition);
+	float forward = 0.0f;
+	float right = 0.0f;
 
 	if (GetKeyState(((int) 'W')) & 0x800)
 	{
-		//m_cameraPosition.z += movementSpeed * deltaSec;
-		cameraPositionVec += forwardVec * movementSpeed * deltaSec;
+		forward += movementSpeed * deltaSec;
 		viewHasChanged = true;
 	}
 
 	if (GetKeyState(((int) 'S')) & 0x800)
 	{
-		//m_cameraPosition.z -= movementSpeed * deltaSec;
-		cameraPositionVec -= forwardVec * movementSpeed * deltaSec;
+		forward -= movementSpeed * deltaSec;
 		viewHasChanged = true;
 	}
 
 	if (GetKeyState(((int) 'A')) & 0x800)
 	{
-		//m_cameraPosition.x -= movementSpeed * deltaSec;
-		cameraPositionVec -= rightVec * movementSpeed * deltaSec;
+		right -= movementSpeed * deltaSec;
 		viewHasChanged = true;
 	}
 
 	if (GetKeyState(((int) 'D'))  & 0x800)
 	{
-		//m_cameraPosition.x += movementSpeed * deltaSec;
-		cameraPositionVec += rightVec * movementSpeed * deltaSec;
+		right += movementSpeed * deltaSec;
 		viewHasChanged = true;
 	}
 
+	// move along the basis from before this frame's rotation
 	if (viewHasChanged)
 	{
-		XMStoreFloat4(&m_cameraPosition, cameraPositionVec);
+		m_camera.Move(forward, right);
 	}
 
 	if (m_mouseDeltaX != 0.0f || m_mouseDeltaY != 0.0f)
 	{
-		m_cameraRotation.y += rotationSpeed * m_mouseDeltaX;
-		m_cameraRotation.x += rotationSpeed * m_mouseDeltaY;
-		if (m_cameraRotation.x < -XM_PIDIV2)
-		{
-			m_cameraRotation.x = -XM_PIDIV2;
-		}
-		else if (m_cameraRotation.x > XM_PIDIV2)
-		{
-			m_cameraRotation.x = XM_PIDIV2;
-		}
-
-		XMVECTOR cameraRotation = XMLoadFloat4(&m_cameraRotation);
-		cameraRotation = XMVectorModAngles(cameraRotation);
-		XMStoreFloat4(&m_cameraRotation, cameraRotation);
+		m_camera.Rotate(rotationSpeed * m_mouseDeltaY, rotationSpeed * m_mouseDeltaX);
+		viewHasChanged = true;
+	}
 
+	// the aspect ratio changed, however many resizes happened since the last frame
+	if (m_projectionIsDirty)
+	{
+		UpdateProjection();
+		m_projectionIsDirty = false;
 		viewHasChanged = true;
 	}
 
+	if (viewHasChanged || worldHasChanged)
+	{
+		PackWvpTransforms(&m_objectWorlds[0], m_camera.GetViewMatrix() * m_camera.GetProjectionMatrix(), &m_wvpData.wvp, 1);
+	}
+
 	if (viewHasChanged)
 	{
-		XMVECTOR rotationVec = XMLoadFloat4(&m_cameraRotation);
-		XMMATRIX rotationMat = XMMatrixRotationRollPitchYawFromVector(rotationVec);
-		
-		XMVECTOR cameraPosition = XMLoadFloat4(&m_cameraPosition);
-		XMMATRIX translationMat = XMMatrixTranslationFromVector(cameraPosition);
+		UpdateViewProjection();
+		m_frameConstantsTracker.MarkDirty(0);
+	}
 
-		XMMATRIX viewMat = rotationMat * translationMat;
-		viewMat = XMMatrixInverse(nullptr, viewMat);
-		XMStoreFloat4x4(&m_viewMat, viewMat);
+	// in affine mode objects do not depend on the view
+	if (worldHasChanged || (viewHasChanged && !(m_bindless && m_affineUpload)))
+	{
+		m_objectTracker.MarkDirty(0);
+	}
+}
 
-		XMMATRIX worldMat = XMLoadFloat4x4(&m_worldMat);
-		XMMATRIX projectionMat = XMLoadFloat4x4(&m_projectionMat);
+void Engine::UploadObjects(UploadWriter& writer)
+{
+	m_objectTracker.CollectDirtyRanges(m_frameIndex, m_dirtyRanges);
 
-		XMMATRIX wvpMat = worldMat * viewMat * projectionMat;
-		XMMATRIX wvpMatTransposed = XMMatrixTranspose(wvpMat);
-		XMStoreFloat4x4(&m_wvpData.wvp, wvpMatTransposed);
+	for (const DirtyRange& range : m_dirtyRanges)
+	{
+		if (m_bindless && m_affineUpload)
+		{
+			if (!FramePhases::UploadAffineTransforms(m_objectWorlds.data(), range.first, range.count, m_frameArenas.Get(0), writer))
+			{
+				exit(-1);
+			}
+		}
+		else if (m_bindless)
+		{
+			// packed per object, m_wvpData only holds object 0 for the root parameter path
+			if (!FramePhases::UploadWvpTransforms(m_objectWorlds.data(), range.first, range.count,
+				m_camera.GetViewMatrix() * m_camera.GetProjectionMatrix(), m_frameArenas.Get(0), writer))
+			{
+				exit(-1);
+			}
+		}
+		else
+		{
+			UploadConstantBuffer(m_wvpParameter, &m_wvpData, sizeof(Wvp), writer);
+		}
 	}
 }
 
@@ -687,6 +997,17 @@ void Engine::Init(HWND hwnd)
 		exit(-1);
 	}
 
+	// geometry and texture uploads go through their own copy queue
+	if (FAILED(m_uploadService.Init(m_device.Get())))
+	{
+		exit(-1);
+	}
+
+	if (FAILED(m_geometryPool.Init(m_device.Get(), &m_uploadService, sizeof(Vertex))))
+	{
+		exit(-1);
+	}
+
 	// create swap chain
 	DXGI_SWAP_CHAIN_DESC1 swapChainDesc = {};
 	swapChainDesc.Height = m_resolutionHeight;
@@ -715,7 +1036,7 @@ void Engine::Init(HWND hwnd)
 	// create descriptor heaps
 	{
 		D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc = {};
-		rtvHeapDesc.NumDescriptors = 2;
+		rtvHeapDesc.NumDescriptors = 3;	// back buffers and scene color
 		rtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
 		rtvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
 
@@ -728,20 +1049,8 @@ void Engine::Init(HWND hwnd)
 	}
 
 	// create frame resources
-	{
-		CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart());
-
-		for (UINT i = 0; i < 2; ++i)
-		{
-			if (FAILED(m_swapChain->GetBuffer(i, IID_PPV_ARGS(&m_renderTarget[i]))))
-			{
-				exit(-1);
-			}
-
-			m_device->CreateRenderTargetView(m_renderTarget[i].Get(), nullptr, rtvHandle);
-			rtvHandle.Offset(1, m_rtvDescriptorSize);
-		}
-	}
+	CreateBackBufferViews();
+	m_targetPool.Init(m_device.Get());
 
 	// create command allocator
 	HRESULT hr = m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&m_commandAllocator));
@@ -757,6 +1066,14 @@ void Engine::Init(HWND hwnd)
 		exit(-1);
 	}
 
+	// tail list, closed until the scene pass hands it to the render graph
+	hr = m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandAllocator.Get(), nullptr, IID_PPV_ARGS(&m_commandListTail));
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
+	m_commandListTail->Close();
+
 	// create fence
 	hr = m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence));
 	if (FAILED(hr))
@@ -771,13 +1088,43 @@ void Engine::Init(HWND hwnd)
 		exit(-1);
 	}
 
+	// GPU time of every frame drives the render resolution
+	hr = m_gpuTimer.Init(m_device.Get(), m_commandQueue.Get(), 2);
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
+
+	// one shader visible heap for the whole frame
+	hr = m_descriptorHeap.Init(m_device.Get(), 1024, 256, 2);
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
+
 	CreateRootSignature();
 	LoadShaders();
 	CreatePipelineStateObject();
+	CreateUpscalePipeline();
+	CreateRenderTargets();
+	CreateScene();
 	InitWvp();
 	CreateConstantBuffers();
+	CreateCommandSignature();
 	CreateVertexBuffer();
 	FillOutViewportAndScissorRect();
+	BuildRenderGraph();
+
+	// parallel draw recording
+	m_commandListBackend.Init(m_device.Get(), m_threadPool.GetThreadCount(), 2);
+	m_commandListBackend.SetCallbacks(m_pipelineState.Get(),
+		[this](ID3D12GraphicsCommandList* commandList, uint32_t threadIndex) { RecordSceneState(commandList, threadIndex); },
+		[this](ID3D12GraphicsCommandList* commandList, uint32_t threadIndex, const DrawItem* draws, size_t count) { RecordDraws(commandList, threadIndex, draws, count); });
+	m_stateFilters.resize(m_threadPool.GetThreadCount());
+
+	m_pipelines.push_back(m_pipelineState.Get());
+
+	m_frameArenas.Init(m_threadPool.GetThreadCount());
 
 	WaitForPreviousFrame();
 
@@ -798,37 +1145,369 @@ void Engine::Input(float mouseX, float mouseY, bool rightMouseBtnIsDown)
 
 void Engine::Update()
 {
+	// scratch of the previous frame is no longer referenced
+	m_frameAllocationStart = GetHeapAllocationCount();
+	m_frameArenas.Reset();
+
 	high_resolution_clock::time_point now = high_resolution_clock::now();
 	float deltaSec = duration<float>(now - m_prevTime).count();
 	m_prevTime = now;
 
-	// color multiplier
-	m_cbColorMultiplierData.colorMultiplier.x += 0.05f * deltaSec;
-	m_cbColorMultiplierData.colorMultiplier.y += 0.09f * deltaSec;
-	m_cbColorMultiplierData.colorMultiplier.z += 0.03f * deltaSec;
+	// animated world matrices and color multiplier
+	bool worldHasChanged = UpdateScene(deltaSec);
+
+	// WVP matrix
+	UpdateWvp(deltaSec, worldHasChanged);
+
+	high_resolution_clock::time_point uploadStart = high_resolution_clock::now();
+
+	UploadWriter& colorMultiplierWriter = m_cbColorMultiplierWriter[m_frameIndex];
+	UploadWriter& wvpWriter = m_cbWvpWriter[m_frameIndex];
+	UploadWriter& frameWriter = m_cbFrameWriter[m_frameIndex];
+	colorMultiplierWriter.ResetBytesWritten();
+	wvpWriter.ResetBytesWritten();
+	frameWriter.ResetBytesWritten();
+
+	UploadConstantBuffer(m_colorMultiplierParameter, &m_cbColorMultiplierData, sizeof(m_cbColorMultiplierData), colorMultiplierWriter);
+
+	UploadObjects(wvpWriter);
+
+	// view-projection is shared by every object and only written when the view moved
+	if (m_bindless && m_affineUpload)
+	{
+		m_frameConstantsTracker.CollectDirtyRanges(m_frameIndex, m_dirtyRanges);
+		if (!m_dirtyRanges.empty())
+		{
+			frameWriter.Write(0, &m_frameConstants, sizeof(FrameConstants));
+		}
+	}
+
+	wvpWriter.Flush();
+
+	m_frameStats.uploadedBytes = colorMultiplierWriter.GetBytesWritten() + wvpWriter.GetBytesWritten() + frameWriter.GetBytesWritten();
+	m_frameStats.uploadSec = duration<float>(high_resolution_clock::now() - uploadStart).count();
+
+	m_mouseDeltaX = 0.0f;
+	m_mouseDeltaY = 0.0f;
+}
+
+void Engine::BuildRenderGraph()
+{
+	m_renderGraphBackend.Init(m_device.Get());
+
+	m_backBufferResource = m_renderGraph.ImportResource("Back buffer", ResourceState::Present, ResourceState::Present);
+	m_depthResource = m_renderGraph.ImportResource("Depth buffer", ResourceState::DepthWrite, ResourceState::DepthWrite);
+	m_renderGraphBackend.SetResource(m_depthResource, m_dsBuffer.Get());
+	m_sceneColorResource = m_renderGraph.ImportResource("Scene color", ResourceState::PixelShaderResource, ResourceState::PixelShaderResource);
+	m_renderGraphBackend.SetResource(m_sceneColorResource, m_sceneColor.Get());
+
+	RenderGraphPass scenePass = m_renderGraph.AddPass("Scene", [this]() { RecordScene(); });
+	m_renderGraph.Write(scenePass, m_sceneColorResource, ResourceState::RenderTarget);
+	m_renderGraph.Write(scenePass, m_depthResource, ResourceState::DepthWrite);
+
+	RenderGraphPass upscalePass = m_renderGraph.AddPass("Upscale", [this]() { RecordUpscale(); });
+	m_renderGraph.Read(upscalePass, m_sceneColorResource, ResourceState::PixelShaderResource);
+	m_renderGraph.Write(upscalePass, m_backBufferResource, ResourceState::RenderTarget);
+
+	// the graph does not change between frames, only the back buffer it points to
+	m_renderGraph.Compile();
+	m_renderGraph.Realize(m_renderGraphBackend);
+}
+
+void Engine::RecordScene()
+{
+	// clears go on the main list, draws are recorded in parallel chunks
+	// or, in indirect mode, as a few ExecuteIndirect calls on the main list
+	CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), SCENE_COLOR_RTV, m_rtvDescriptorSize);
+	CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle(m_dsDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
 
-	if (m_cbColorMultiplierData.colorMultiplier.x > 1.0f)
+	// only the rendered corner is cleared
+	const float clearColor[] = { 0.5f, 0.5f, 0.5f, 1.0f };
+	m_commandList->ClearRenderTargetView(rtvHandle, clearColor, 1, &m_scissorRect);
+	m_commandList->ClearDepthStencilView(dsvHandle, D3D12_CLEAR_FLAG_DEPTH, m_reverseZ ? 0.0f : 1.0f, 0, 1, &m_scissorRect);
+
+	CullClusters();
+	SortDraws();
+
+	for (RedundantStateFilter& filter : m_stateFilters)
 	{
-		m_cbColorMultiplierData.colorMultiplier.x = 0.0f;
+		filter.ResetCounts();
 	}
-	if (m_cbColorMultiplierData.colorMultiplier.y > 1.0f)
+
+	m_frameStats.indirectOverflowDraws = 0;
+	if (m_indirectDraws)
 	{
-		m_cbColorMultiplierData.colorMultiplier.y = 0.0f;
+		RecordIndirectDraws(m_commandList.Get());
 	}
-	if (m_cbColorMultiplierData.colorMultiplier.z > 1.0f)
+
+	HRESULT hr = m_commandList->Close();
+	if (FAILED(hr))
 	{
-		m_cbColorMultiplierData.colorMultiplier.z = 0.0f;
+		exit(-1);
 	}
 
-	memcpy(m_cbColorMultiplierGpuAddress[m_frameIndex], &m_cbColorMultiplierData, sizeof(m_cbColorMultiplierData));
+	m_commandListBackend.BeginFrame(m_frameIndex);
+	if (m_indirectDraws)
+	{
+		m_commandListBackend.BeginRecording(0);
+	}
+	else
+	{
+		m_commandRecorder.Record(m_sortedDraws.data(), m_sortedDraws.size(), m_commandListBackend);
+	}
 
-	// WVP matrix
-	UpdateWvp(deltaSec);
+	m_frameStats.binds = BindCounts{};
+	for (const RedundantStateFilter& filter : m_stateFilters)
+	{
+		m_frameStats.binds.Add(filter.GetCounts());
+	}
+
+	// whatever the graph records after this pass goes behind the chunk lists
+	hr = m_commandListTail->Reset(m_commandAllocator.Get(), nullptr);
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
+	m_renderGraphBackend.SetCommandList(m_commandListTail.Get());
+}
 
-	memcpy(m_cbWvpGpuAddress[m_frameIndex], &m_wvpData, sizeof(Wvp));
+void Engine::RecordIndirectDraws(ID3D12GraphicsCommandList* commandList)
+{
+	// the main thread is thread 0 of the pool, its filter is free here
+	RecordSceneState(commandList, 0);
+	RedundantStateFilter& filter = m_stateFilters[0];
 
-	m_mouseDeltaX = 0.0f;
-	m_mouseDeltaY = 0.0f;
+	// the object buffer is shared, the object index comes from the argument buffer
+	commandList->SetGraphicsRoot32BitConstant(m_rootSignatureBuilder.GetRootIndex(m_drawConstantsParameter), m_wvpSrvIndex, 0);
+
+	IndirectDrawCommand* args = m_indirectArgs[m_frameIndex];
+	const size_t drawCount = m_sortedDraws.size() < MAX_INDIRECT_DRAWS ? m_sortedDraws.size() : MAX_INDIRECT_DRAWS;
+
+	// a command signature cannot change the pipeline, so every run of draws
+	// sharing one becomes its own ExecuteIndirect
+	size_t commandOffset = 0;
+	size_t first = 0;
+	while (first < drawCount)
+	{
+		const uint32_t pipeline = m_sortedDraws[first].pipeline;
+		size_t last = first + 1;
+		while (last < drawCount && m_sortedDraws[last].pipeline == pipeline)
+		{
+			++last;
+		}
+
+		uint32_t commandCount = m_indirectArgsBuilder.Build(&m_sortedDraws[first], last - first, nullptr, args + commandOffset);
+
+		if (filter.Bind(BindSlot::PipelineState, reinterpret_cast<uint64_t>(m_pipelines[pipeline])))
+		{
+			commandList->SetPipelineState(m_pipelines[pipeline]);
+		}
+
+		commandList->ExecuteIndirect(m_commandSignature.Get(), commandCount, m_indirectArgsUploadHeap[m_frameIndex].Get(),
+			commandOffset * sizeof(IndirectDrawCommand), nullptr, 0);
+
+		commandOffset += commandCount;
+		first = last;
+	}
+
+	// draws that do not fit the argument buffer are still drawn, one call each
+	if (drawCount < m_sortedDraws.size())
+	{
+		m_frameStats.indirectOverflowDraws = static_cast<UINT>(m_sortedDraws.size() - drawCount);
+		RecordDraws(commandList, 0, &m_sortedDraws[drawCount], m_sortedDraws.size() - drawCount);
+	}
+}
+
+bool Engine::CullOccluded()
+{
+	m_frameStats.occluderTriangles = 0;
+	m_frameStats.occluded = false;
+	if (!m_occlusionCulling || m_occluders.empty())
+	{
+		return false;
+	}
+
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection, m_camera.GetViewMatrix() * m_camera.GetProjectionMatrix());
+	m_occlusionBuffer.BeginFrame(&viewProjection.m[0][0]);
+
+	// level 0 of the chain, coarser levels may grow past the real surface
+	const MeshLod& lod = m_cubeLods.lods[0];
+	for (const XMFLOAT4X4& occluder : m_occluders)
+	{
+		m_occlusionBuffer.AddOccluder(&m_cubePositions[0].x, sizeof(XMFLOAT3), &m_cubeLods.indices[lod.firstIndex], lod.indexCount, &occluder.m[0][0]);
+	}
+	m_occlusionBuffer.Rasterize();
+	m_frameStats.occluderTriangles = static_cast<UINT>(m_occlusionBuffer.GetOccluderTriangleCount());
+
+	m_frameStats.occluded = !m_occlusionBuffer.IsVisible(&m_cubeBoundsMin.x, &m_cubeBoundsMax.x, &m_objectWorlds[0].m[0][0]);
+	return m_frameStats.occluded;
+}
+
+void Engine::CullClusters()
+{
+	// one draw per run of visible clusters, or one for a coarser level of detail
+	m_drawItems.clear();
+	m_clusterRanges.clear();
+
+	// off screen objects need neither occlusion nor cluster culling
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection, m_camera.GetViewMatrix() * m_camera.GetProjectionMatrix());
+	ClusterFrustum worldFrustum;
+	ClusterCuller::ExtractFrustum(&viewProjection.m[0][0], worldFrustum);
+	if (!FramePhases::IsObjectVisible(m_objectWorlds[0], m_cubeRadius, worldFrustum))
+	{
+		m_frameStats.occluderTriangles = 0;
+		m_frameStats.occluded = false;
+		m_frameStats.triangles = 0;
+		return;
+	}
+
+	if (CullOccluded())
+	{
+		m_frameStats.triangles = 0;
+		return;
+	}
+
+	// frustum and eye in object space, so cluster bounds and LOD errors are used as built
+	XMMATRIX worldMat = XMLoadFloat4x4(&m_objectWorlds[0]);
+	XMVECTOR eyeVec = XMVector3Transform(m_camera.GetPosition(), XMMatrixInverse(nullptr, worldMat));
+	XMFLOAT3 eye;
+	XMStoreFloat3(&eye, eyeVec);
+
+	const float maxPixelError = 1.0f;
+	float distance = XMVectorGetX(XMVector3Length(eyeVec));
+	m_frameStats.lod = MeshSimplifier::SelectLod(m_cubeLods.lods.data(), static_cast<uint32_t>(m_cubeLods.lods.size()),
+		distance, m_lodProjectionScale * m_renderScale, maxPixelError);
+
+	if (m_frameStats.lod > 0)
+	{
+		// coarse levels are too small on screen for clusters to pay off
+		const MeshLod& lod = m_cubeLods.lods[m_frameStats.lod];
+		ClusterRange range = { lod.firstIndex, lod.indexCount };
+		m_clusterRanges.push_back(range);
+	}
+	else if (m_clusterCulling)
+	{
+		XMFLOAT4X4 worldViewProjection;
+		XMStoreFloat4x4(&worldViewProjection, worldMat * m_camera.GetViewMatrix() * m_camera.GetProjectionMatrix());
+
+		ClusterFrustum frustum;
+		ClusterCuller::ExtractFrustum(&worldViewProjection.m[0][0], frustum);
+
+		m_clusterCuller.Cull(m_cubeMeshlets, frustum, &eye.x, m_clusterRanges);
+	}
+	else
+	{
+		ClusterRange range = { 0, static_cast<uint32_t>(m_cubeMeshlets.indices.size()) };
+		m_clusterRanges.push_back(range);
+	}
+
+	m_frameStats.triangles = 0;
+	for (const ClusterRange& range : m_clusterRanges)
+	{
+		DrawItem draw = { range.indexCount, range.firstIndex, 0, 0, 0, m_cubeMesh };
+		m_drawItems.push_back(draw);
+		m_frameStats.triangles += range.indexCount / 3;
+	}
+}
+
+void Engine::SortDraws()
+{
+	m_frameUploadToken = UploadService::COMPLETED_TOKEN;
+	for (const DrawItem& draw : m_drawItems)
+	{
+		UploadToken meshToken = m_geometryPool.GetUploadToken(draw.mesh);
+		m_frameUploadToken = meshToken > m_frameUploadToken ? meshToken : m_frameUploadToken;
+	}
+
+	m_sortedDraws.resize(m_drawItems.size());
+	FramePhases::SortDraws(m_drawItems.data(), m_drawItems.size(), m_objectWorlds.data(), m_camera.GetViewMatrix(), m_geometryPool.GetPool(),
+		m_drawSorter, m_drawKeys, m_sortedDraws.data());
+}
+
+void Engine::RecordSceneState(ID3D12GraphicsCommandList* commandList, uint32_t threadIndex)
+{
+	// a fresh list has nothing bound except the pipeline it was reset with
+	RedundantStateFilter& filter = m_stateFilters[threadIndex];
+	filter.Invalidate();
+	filter.Assume(BindSlot::PipelineState, reinterpret_cast<uint64_t>(m_pipelineState.Get()));
+
+	CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), SCENE_COLOR_RTV, m_rtvDescriptorSize);
+	CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle(m_dsDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
+	commandList->OMSetRenderTargets(1, &rtvHandle, FALSE, &dsvHandle);
+
+	if (filter.Bind(BindSlot::RootSignature, reinterpret_cast<uint64_t>(m_rootSignature.Get())))
+	{
+		commandList->SetGraphicsRootSignature(m_rootSignature.Get());
+	}
+
+	// shader visible heap, bound once per list
+	ID3D12DescriptorHeap* descriptorHeaps[] = { m_descriptorHeap.GetHeap() };
+	if (filter.Bind(BindSlot::DescriptorHeaps, reinterpret_cast<uint64_t>(descriptorHeaps[0])))
+	{
+		commandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+	}
+
+	// constant buffers
+	SetConstantBuffer(commandList, m_colorMultiplierParameter, &m_cbColorMultiplierData, m_cbColorMultiplierUploadHeap[m_frameIndex].Get());
+
+	if (m_bindless)
+	{
+		commandList->SetGraphicsRootDescriptorTable(m_rootSignatureBuilder.GetRootIndex(m_objectTableParameter), m_descriptorHeap.GetGpuStart());
+
+		if (m_affineUpload)
+		{
+			SetConstantBuffer(commandList, m_frameConstantsParameter, &m_frameConstants, m_cbFrameUploadHeap[m_frameIndex].Get());
+		}
+	}
+	else
+	{
+		SetConstantBuffer(commandList, m_wvpParameter, &m_wvpData, m_cbWvpUploadHeap[m_frameIndex].Get());
+	}
+
+	commandList->RSSetViewports(1, &m_viewport);
+	commandList->RSSetScissorRects(1, &m_scissorRect);
+	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	// every mesh lives in the geometry pool, its buffers are bound once per list
+	if (filter.Bind(BindSlot::VertexBuffer, m_vertexBufferView.BufferLocation))
+	{
+		commandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
+	}
+	if (filter.Bind(BindSlot::IndexBuffer, m_indexBufferView.BufferLocation))
+	{
+		commandList->IASetIndexBuffer(&m_indexBufferView);
+	}
+}
+
+void Engine::RecordDraws(ID3D12GraphicsCommandList* commandList, uint32_t threadIndex, const DrawItem* draws, size_t count)
+{
+	// runs on worker threads, only reads engine state
+	RedundantStateFilter& filter = m_stateFilters[threadIndex];
+
+	DrawConstants drawConstants;
+	drawConstants.objectBuffer = m_bindless ? m_wvpSrvIndex : 0;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const DrawItem& draw = draws[i];
+
+		// draws are sorted by pipeline, so most of these are skipped
+		ID3D12PipelineState* pipelineState = m_pipelines[draw.pipeline];
+		if (filter.Bind(BindSlot::PipelineState, reinterpret_cast<uint64_t>(pipelineState)))
+		{
+			commandList->SetPipelineState(pipelineState);
+		}
+
+		if (m_bindless)
+		{
+			drawConstants.objectIndex = draw.objectIndex;
+			SetConstantBuffer(commandList, m_drawConstantsParameter, &drawConstants, nullptr);
+		}
+
+		commandList->DrawIndexedInstanced(draw.indexCount, 1, draw.startIndex, draw.baseVertex, 0);
+	}
 }
 
 void Engine::Render()
@@ -846,48 +1525,44 @@ void Engine::Render()
 		exit(-1);
 	}
 
-	// indicate that the back buffer will be used as a render target
-	m_commandList->ResourceBarrier(1, 
-		&CD3DX12_RESOURCE_BARRIER::Transition(m_renderTarget[m_frameIndex].Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
+	m_descriptorHeap.BeginFrame(m_frameIndex);
+	if (m_bindless)
+	{
+		CreateObjectBufferView();
+	}
+	m_gpuTimer.Begin(m_commandList.Get(), m_frameIndex);
 
-	CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), m_frameIndex, m_rtvDescriptorSize);
-	CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle(m_dsDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
+	// defragment the geometry pool before anything draws from it this frame
+	const float maxGeometryFragmentation = 0.5f;
+	m_compactionUploadToken = UploadService::COMPLETED_TOKEN;
+	if (m_geometryPool.GetFragmentation() > maxGeometryFragmentation)
+	{
+		m_geometryPool.Compact(m_commandList.Get(), &m_compactionUploadToken);
+	}
+	m_vertexBufferView = m_geometryPool.GetVertexBufferView();
+	m_indexBufferView = m_geometryPool.GetIndexBufferView();
 
-	// record commands
-	m_commandList->OMSetRenderTargets(1, &rtvHandle, FALSE, &dsvHandle);
-	const float clearColor[] = { 0.5f, 0.5f, 0.5f, 1.0f };
-	m_commandList->ClearRenderTargetView(rtvHandle, clearColor, 0, nullptr);
-	m_commandList->ClearDepthStencilView(m_dsDescriptorHeap->GetCPUDescriptorHandleForHeapStart(), D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
-
-	// draw triangle
-	m_commandList->SetGraphicsRootSignature(m_rootSignature.Get());
-
-	// constant buffer descriptor heap
-	ID3D12DescriptorHeap* descriptorHeaps[] = { m_cbDescriptorHeap[m_frameIndex].Get() };
-	m_commandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
-	m_commandList->SetGraphicsRootDescriptorTable(0, m_cbDescriptorHeap[m_frameIndex]->GetGPUDescriptorHandleForHeapStart());
-	m_commandList->SetGraphicsRootConstantBufferView(1, m_cbWvpUploadHeap[m_frameIndex]->GetGPUVirtualAddress());
-
-	m_commandList->RSSetViewports(1, &m_viewport);
-	m_commandList->RSSetScissorRects(1, &m_scissorRect);
-	m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-	m_commandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
-	m_commandList->IASetIndexBuffer(&m_indexBufferView);
-	m_commandList->DrawIndexedInstanced(36, 1, 0, 0, 0);
-
-	// indicate that the back buffer will be used to present
-	m_commandList->ResourceBarrier(1, 
-		&CD3DX12_RESOURCE_BARRIER::Transition(m_renderTarget[m_frameIndex].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
-
-	hr = m_commandList->Close();
+	// the graph transitions the back buffer to render target and back to present
+	m_renderGraphBackend.SetCommandList(m_commandList.Get());
+	m_renderGraphBackend.SetResource(m_backBufferResource, m_renderTarget[m_frameIndex].Get());
+	m_renderGraph.Execute(m_renderGraphBackend);
+
+	m_gpuTimer.End(m_commandListTail.Get(), m_frameIndex);
+	hr = m_commandListTail->Close();
 	if (FAILED(hr))
 	{
 		exit(-1);
 	}
 
-	// execute command list
-	ID3D12CommandList* ppCommandLists[]{ m_commandList.Get() };
-	m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+	// meshes still streaming in hold back only this submission, not the CPU
+	m_uploadService.WaitOnGpu(m_commandQueue.Get(), m_frameUploadToken > m_compactionUploadToken ? m_frameUploadToken : m_compactionUploadToken);
+
+	// main list, chunk lists in draw order, tail list, all in one submission
+	m_submitLists.clear();
+	m_submitLists.push_back(m_commandList.Get());
+	m_commandListBackend.AppendCommandLists(m_submitLists);
+	m_submitLists.push_back(m_commandListTail.Get());
+	m_commandQueue->ExecuteCommandLists(static_cast<UINT>(m_submitLists.size()), m_submitLists.data());
 
 	// present the frame
 	hr = m_swapChain->Present(1, 0);
@@ -896,7 +1571,75 @@ void Engine::Render()
 		exit(-1);
 	}
 
+	UINT renderedFrameIndex = m_frameIndex;
 	WaitForPreviousFrame();
+
+	// resolution of the next frame
+	UpdateRenderScale(renderedFrameIndex);
+
+	// the frame completed, buffers replaced by a compaction are no longer read
+	m_geometryPool.ReleaseRetired();
+
+	m_frameStats.heapAllocations = GetHeapAllocationCount() - m_frameAllocationStart;
+}
+
+void Engine::Resize(UINT width, UINT height)
+{
+	// before Init the swap chain is simply created at this size
+	if (m_swapChain == nullptr)
+	{
+		m_resolutionWidth = width;
+		m_resolutionHeight = height;
+		return;
+	}
+
+	if (width == 0 || height == 0 || (width == m_resolutionWidth && height == m_resolutionHeight))
+	{
+		return;
+	}
+
+	// back buffers and targets may still be used by the frame in flight
+	high_resolution_clock::time_point start = high_resolution_clock::now();
+	WaitForPreviousFrame();
+	high_resolution_clock::time_point drained = high_resolution_clock::now();
+
+	// every reference to the back buffers has to be gone before ResizeBuffers
+	for (UINT i = 0; i < 2; ++i)
+	{
+		m_renderTarget[i].Reset();
+	}
+	m_renderGraphBackend.SetResource(m_backBufferResource, nullptr);
+
+	HRESULT hr = m_swapChain->ResizeBuffers(2, width, height, DXGI_FORMAT_UNKNOWN, 0);
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
+	m_resolutionWidth = width;
+	m_resolutionHeight = height;
+
+	CreateBackBufferViews();
+	m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
+	high_resolution_clock::time_point swapChainResized = high_resolution_clock::now();
+
+	// targets of the same size bucket come straight back from the pool
+	uint64_t allocationCount = m_targetPool.GetAllocationCount();
+	m_targetPool.Release(m_dsBuffer.Get());
+	m_targetPool.Release(m_sceneColor.Get());
+	m_dsBuffer.Reset();
+	m_sceneColor.Reset();
+	CreateRenderTargets();
+	m_renderGraphBackend.SetResource(m_depthResource, m_dsBuffer.Get());
+	m_renderGraphBackend.SetResource(m_sceneColorResource, m_sceneColor.Get());
+
+	FillOutViewportAndScissorRect();
+	m_projectionIsDirty = true;
+
+	high_resolution_clock::time_point end = high_resolution_clock::now();
+	m_resizeStats.drainSec = duration<float>(drained - start).count();
+	m_resizeStats.swapChainSec = duration<float>(swapChainResized - drained).count();
+	m_resizeStats.targetsSec = duration<float>(end - swapChainResized).count();
+	m_resizeStats.reallocated = m_targetPool.GetAllocationCount() != allocationCount;
 }
 
 void Engine::Destroy()
@@ -904,3 +1647,42 @@ void Engine::Destroy()
 	CloseHandle(m_fenceEvent);
 }
 
+void Engine::AddOccluder(FXMMATRIX worldMat)
+{
+	XMFLOAT4X4 occluder;
+	XMStoreFloat4x4(&occluder, worldMat);
+	m_occluders.push_back(occluder);
+}
+
+void Engine::ClearOccluders()
+{
+	m_occluders.clear();
+}
+
+void Engine::SetDynamicResolution(bool enabled, float targetGpuMs)
+{
+	m_dynamicResolution = enabled;
+	m_resolutionController.SetTarget(targetGpuMs);
+	m_resolutionController.Reset(1.0f);
+}
+
+const FrameStats& Engine::GetFrameStats() const
+{
+	return m_frameStats;
+}
+
+const ResizeStats& Engine::GetResizeStats() const
+{
+	return m_resizeStats;
+}
+
+const MeshLodChain& Engine::GetCubeLods() const
+{
+	return m_cubeLods;
+}
+
+float Engine::GetLodBuildSec() const
+{
+	return m_lodBuildSec;
+}
+
@@ -6,6 +6,32 @@
 #include <d3dcompiler.h>
 #include <DirectXMath.h>
 #include <chrono>
+#include "RootSignatureBuilder.h"
+#include "DescriptorHeapAllocator.h"
+#include "Camera.h"
+#include "TransformCore.h"
+#include "TransformPacking.h"
+#include "UploadWriter.h"
+#include "DirtyTracker.h"
+#include "D3D12RenderGraphBackend.h"
+#include "D3D12CommandListBackend.h"
+#include "DrawSortKey.h"
+#include "RedundantStateFilter.h"
+#include "UploadService.h"
+#include "D3D12GeometryPool.h"
+#include "IndirectArgsBuilder.h"
+#include "ClusterCuller.h"
+#include "OcclusionBuffer.h"
+#include "MeshSimplifier.h"
+#include "AnimationSampler.h"
+#include "EntityWorld.h"
+#include "FrameArena.h"
+#include "FramePhases.h"
+#include "AllocationCounter.h"
+#include "ResolutionController.h"
+#include "D3D12GpuTimer.h"
+#include "D3D12TargetPool.h"
+#include <vector>
 
 #pragma comment(lib, "d3d12.lib")
 #pragma comment(lib, "dxgi.lib")
@@ -37,6 +63,53 @@ struct Wvp
 	XMFLOAT4X4 wvp;
 };
 
+// shared by every object in affine upload mode
+struct FrameConstants
+{
+	XMFLOAT4X4 viewProjection;
+};
+
+struct FrameStats
+{
+	UINT64 uploadedBytes;
+	float uploadSec;
+	BindCounts binds;	// state changes issued and skipped over all chunk lists
+	UINT triangles;	// submitted after culling and LOD selection
+	UINT lod;
+	UINT occluderTriangles;	// rasterized into the occlusion buffer
+	bool occluded;	// the cube was hidden behind the occluders
+	UINT indirectOverflowDraws;	// past the indirect argument buffer, recorded as direct draws
+	float gpuSec;	// of the last completed frame, from timestamp queries
+	float renderScale;	// of the output resolution
+	UINT renderWidth;
+	UINT renderHeight;
+	UINT64 heapAllocations;	// made by Update and Render, zero in the steady state
+};
+
+
+// cost of the last window resize
+struct ResizeStats
+{
+	float drainSec;	// waiting for the frames in flight
+	float swapChainSec;	// ResizeBuffers and back buffer views
+	float targetsSec;	// depth and scene color from the target pool
+	bool reallocated;	// the pool had no target of the new size bucket
+};
+
+// root constants of the upscale pass
+struct UpscaleConstants
+{
+	XMFLOAT2 uvScale;	// rendered size over target size
+	XMFLOAT2 uvMax;
+};
+
+// root constants selecting per-object data in bindless mode
+struct DrawConstants
+{
+	UINT objectBuffer;	// descriptor index of the object structured buffer
+	UINT objectIndex;
+};
+
 class Engine
 {
 private:
@@ -54,6 +127,7 @@ private:
 
 	ComPtr<ID3D12CommandAllocator> m_commandAllocator;
 	ComPtr<ID3D12GraphicsCommandList> m_commandList;
+	ComPtr<ID3D12GraphicsCommandList> m_commandListTail;	// recorded after the parallel chunks
 	ComPtr<ID3D12PipelineState> m_pipelineState;
 	ComPtr<ID3D12Resource> m_renderTarget[2];
 	ComPtr<ID3D12DescriptorHeap> m_rtvHeap;
@@ -64,13 +138,45 @@ private:
 
 	// drawing triangles
 	ComPtr<ID3D12RootSignature> m_rootSignature;
+	RootSignatureBuilder m_rootSignatureBuilder;
+	UINT m_colorMultiplierParameter;	// root signature builder ids
+	UINT m_wvpParameter;
+	UINT m_drawConstantsParameter;
+	UINT m_objectTableParameter;
+	UINT m_frameConstantsParameter;
 
-	ComPtr<ID3D12Resource> m_vertexBuffer;
-	ComPtr<ID3D12Resource> m_vBufferUploadHeap;
-	D3D12_VERTEX_BUFFER_VIEW m_vertexBufferView;
+	// bindless mode: per-object data is fetched by index from one shader visible heap
+	bool m_bindless;
+	DescriptorHeapAllocator m_descriptorHeap;
+	UINT m_wvpSrvIndex;	// transient, recreated every frame for the current upload heap
 
-	ComPtr<ID3D12Resource> m_indexBuffer;
-	ComPtr<ID3D12Resource> m_iBufferUploadHeap;
+	// affine mode: objects ship a 3x4 world matrix, view-projection is uploaded once per frame
+	bool m_affineUpload;
+	ComPtr<ID3D12Resource> m_cbFrameUploadHeap[2];
+	FrameConstants m_frameConstants;
+	UploadWriter m_cbFrameWriter[2];
+	FrameStats m_frameStats;
+
+	// only data changed since a frame slot last used it is uploaded
+	DirtyTracker m_objectTracker;
+	DirtyTracker m_frameConstantsTracker;
+	std::vector<DirtyRange> m_dirtyRanges;
+
+	// per-frame scratch memory, one arena per worker thread, reset at the start of Update
+	FrameArenas m_frameArenas;
+	UINT64 m_frameAllocationStart;
+
+	// asynchronous uploads on the copy queue
+	UploadService m_uploadService;
+	UploadToken m_frameUploadToken;	// latest upload used by this frame's draws
+	UploadToken m_compactionUploadToken;
+
+	// all meshes share one vertex and one index buffer
+	D3D12GeometryPool m_geometryPool;
+	MeshHandle m_cubeMesh;
+	MeshletMesh m_cubeMeshlets;
+	MeshLodChain m_cubeLods;	// level 0 is the cluster ordered mesh
+	D3D12_VERTEX_BUFFER_VIEW m_vertexBufferView;	// pool views for the current frame
 	D3D12_INDEX_BUFFER_VIEW m_indexBufferView;
 
 	ComPtr<ID3DBlob> m_vertexShader;
@@ -78,30 +184,104 @@ private:
 	D3D12_VIEWPORT m_viewport;
 	D3D12_RECT m_scissorRect;
 
+	// draws are recorded in chunks on worker threads
+	ThreadPool m_threadPool;
+	ParallelCommandRecorder m_commandRecorder;
+	D3D12CommandListBackend m_commandListBackend;
+	std::vector<DrawItem> m_drawItems;	// scene order, index ranges relative to the mesh
+	std::vector<ID3D12CommandList*> m_submitLists;
+
+	// draws are sorted by state before recording, binds that change nothing are skipped
+	RadixSorter m_drawSorter;
+	std::vector<SortableDraw> m_drawKeys;
+	std::vector<DrawItem> m_sortedDraws;
+	std::vector<RedundantStateFilter> m_stateFilters;	// one per recording thread
+	std::vector<ID3D12PipelineState*> m_pipelines;
+
+	// indirect mode: sorted draws become an argument buffer for ExecuteIndirect
+	static const UINT MAX_INDIRECT_DRAWS = 64 * 1024;
+	bool m_indirectDraws;
+	IndirectArgsBuilder m_indirectArgsBuilder;
+	ComPtr<ID3D12CommandSignature> m_commandSignature;
+	ComPtr<ID3D12Resource> m_indirectArgsUploadHeap[2];
+	IndirectDrawCommand* m_indirectArgs[2];	// persistently mapped
+
+	// clusters outside the frustum or facing away are not drawn
+	bool m_clusterCulling;
+	ClusterCuller m_clusterCuller;
+	std::vector<ClusterRange> m_clusterRanges;
+
+	// objects behind the occluders in the software depth buffer are not drawn
+	bool m_occlusionCulling;
+	OcclusionBuffer m_occlusionBuffer;
+	std::vector<XMFLOAT3> m_cubePositions;	// occluders are drawn with the cube mesh
+	XMFLOAT3 m_cubeBoundsMin;
+	XMFLOAT3 m_cubeBoundsMax;
+	float m_cubeRadius;	// of the bounding sphere around the cube's origin
+	std::vector<XMFLOAT4X4> m_occluders;	// world transforms
+
+	// coarser levels are picked by their projected error
+	float m_lodProjectionScale;
+	float m_lodBuildSec;
+
+	// frame graph
+	RenderGraph m_renderGraph;
+	D3D12RenderGraphBackend m_renderGraphBackend;
+	RenderGraphResource m_backBufferResource;
+	RenderGraphResource m_depthResource;
+
+	// dynamic resolution: the scene is drawn at a fraction of the output size into a
+	// full size target that is created once, then stretched over the back buffer
+	static const UINT SCENE_COLOR_RTV = 2;	// after the back buffers
+	bool m_dynamicResolution;
+	ResolutionController m_resolutionController;
+	float m_renderScale;	// used by the frame being recorded
+	D3D12GpuTimer m_gpuTimer;
+	ComPtr<ID3D12Resource> m_sceneColor;	// pooled, may be larger than the output
+	UINT m_sceneColorSrvIndex;
+	RenderGraphResource m_sceneColorResource;
+	ComPtr<ID3D12RootSignature> m_upscaleRootSignature;
+	RootSignatureBuilder m_upscaleRootSignatureBuilder;
+	UINT m_upscaleConstantsParameter;
+	UINT m_upscaleTextureParameter;
+	ComPtr<ID3DBlob> m_upscaleVertexShader;
+	ComPtr<ID3DBlob> m_upscalePixelShader;
+	ComPtr<ID3D12PipelineState> m_upscalePipelineState;
+	D3D12_VIEWPORT m_outputViewport;
+	D3D12_RECT m_outputScissorRect;
+
 	// depth/stencil buffer
 	ComPtr<ID3D12DescriptorHeap> m_dsDescriptorHeap;
-	ComPtr<ID3D12Resource> m_dsBuffer;
+	ComPtr<ID3D12Resource> m_dsBuffer;	// pooled, may be larger than the output
+
+	// window resizes reuse size dependent targets and recompute the projection once before the next frame
+	D3D12TargetPool m_targetPool;
+	bool m_projectionIsDirty;
+	ResizeStats m_resizeStats;
 
 	// constant buffers
-	ComPtr<ID3D12DescriptorHeap> m_cbDescriptorHeap[2];
 	ComPtr<ID3D12Resource> m_cbColorMultiplierUploadHeap[2];
 	ColorMultiplier m_cbColorMultiplierData;
-	UINT8* m_cbColorMultiplierGpuAddress[2];
+	UploadWriter m_cbColorMultiplierWriter[2];
 
-	ComPtr<ID3D12Resource> m_cbWvpUploadHeap[2];
+	ComPtr<ID3D12Resource> m_cbWvpUploadHeap[2];	// per-object data in bindless mode
 	Wvp m_wvpData;
-	UINT8* m_cbWvpGpuAddress[2];
+	UploadWriter m_cbWvpWriter[2];
 
-	XMFLOAT4X4 m_worldMat;
-	XMFLOAT4X4 m_viewMat;
-	XMFLOAT4X4 m_projectionMat;
+	// scene objects, components are stored per archetype in chunked arrays
+	EntityWorld m_scene;
+	ComponentType m_worldComponent;	// XMFLOAT4X4
+	ComponentType m_objectIndexComponent;	// UINT, slot in the object buffer
+	ComponentType m_animationComponent;	// AnimationInstance
+	ComponentType m_colorComponent;	// XMFLOAT4
+	Entity m_cubeEntity;
+	std::vector<XMFLOAT4X4> m_objectWorlds;	// by object index, gathered every frame
 
-	XMFLOAT4 m_scale;
-	XMFLOAT4 m_position;
-	XMFLOAT4 m_rotation;
+	// keyframed cube spin and color
+	std::vector<AnimationClip> m_animationClips;
 
-	XMFLOAT4 m_cameraPosition;
-	XMFLOAT4 m_cameraRotation;
+	Camera m_camera;
+	bool m_reverseZ;	// reverse-Z infinite projection instead of [0.01, 1000] range
 
 	int m_frameIndex;	// render target index
 	UINT m_rtvDescriptorSize;	// Render Target View descriptor heap size
@@ -116,9 +296,33 @@ private:
 	void CreatePipelineStateObject();
 	void CreateVertexBuffer();
 	void FillOutViewportAndScissorRect();
+	void CreateBackBufferViews();
+	void CreateRenderTargets();
+	void UpdateProjection();
+	void CreateUpscalePipeline();
+	void UpdateRenderScale(UINT measuredFrameIndex);
+	void RecordUpscale();
 	void InitWvp();
-	void UpdateWvp(float deltaSec);
+	void CreateScene();
+	bool UpdateScene(float deltaSec);
+	void GatherObjectTransforms();
+	void UpdateWvp(float deltaSec, bool worldHasChanged);
+	void UploadObjects(UploadWriter& writer);
+	void UpdateViewProjection();
+	UINT GetObjectStride() const;
+	void CreateObjectBufferView();
 	void CreateConstantBuffers();
+	void CreateCommandSignature();
+	void BuildRenderGraph();
+	void RecordScene();
+	void RecordIndirectDraws(ID3D12GraphicsCommandList* commandList);
+	bool CullOccluded();
+	void CullClusters();
+	void SortDraws();
+	void RecordSceneState(ID3D12GraphicsCommandList* commandList, uint32_t threadIndex);
+	void RecordDraws(ID3D12GraphicsCommandList* commandList, uint32_t threadIndex, const DrawItem* draws, size_t count);
+	void UploadConstantBuffer(UINT parameter, const void* data, UINT size, UploadWriter& writer);
+	void SetConstantBuffer(ID3D12GraphicsCommandList* commandList, UINT parameter, const void* data, ID3D12Resource* uploadHeap);
 
 public:
 	Engine(UINT resolutionWidth, UINT resolutionHeight);
@@ -130,5 +334,18 @@ public:
 	void InputRightBtnReleased();
 	void Update();
 	void Render();
+	void Resize(UINT width, UINT height);	// client area size, ignores minimized windows
 	void Destroy();
+
+	// cube shaped occluder for the software occlusion test
+	void AddOccluder(FXMMATRIX worldMat);
+	void ClearOccluders();
+
+	// frame time budget of the GPU, the render resolution is scaled down to stay within it
+	void SetDynamicResolution(bool enabled, float targetGpuMs);
+
+	const FrameStats& GetFrameStats() const;
+	const ResizeStats& GetResizeStats() const;
+	const MeshLodChain& GetCubeLods() const;	// triangle count and error per level
+	float GetLodBuildSec() const;
 };
\ No newline at end of file
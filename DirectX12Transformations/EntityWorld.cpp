@@ -0,0 +1,352 @@
+#include <algorithm>
+#include <cstring>
+#include "EntityWorld.h"
+
+namespace
+{
+	const size_t CHUNK_ALIGNMENT = 64;
+	const uint32_t INVALID_INDEX = 0xffffffff;
+
+	size_t AlignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}
+
+EntityWorld::EntityWorld()
+	: m_entityCount(0)
+{
+}
+
+ComponentType EntityWorld::RegisterComponent(size_t size, size_t alignment)
+{
+	// every component has to fit a chunk next to one entity handle
+	if (m_components.size() == 64 || alignment > CHUNK_ALIGNMENT || AlignUp(sizeof(Entity), std::max<size_t>(alignment, 16)) + size > CHUNK_SIZE)
+	{
+		return INVALID_COMPONENT;
+	}
+
+	ComponentInfo info = { static_cast<uint32_t>(size), static_cast<uint32_t>(std::max<size_t>(alignment, 16)) };
+	m_components.push_back(info);
+	return static_cast<ComponentType>(m_components.size() - 1);
+}
+
+ComponentMask EntityWorld::MaskOf(ComponentType type)
+{
+	return ComponentMask(1) << type;
+}
+
+uint32_t EntityWorld::GetArchetype(ComponentMask mask)
+{
+	auto found = m_archetypeIndices.find(mask);
+	if (found != m_archetypeIndices.end())
+	{
+		return found->second;
+	}
+
+	// entity handles first, then one array per component, as many entities as fit
+	size_t bytesPerEntity = sizeof(Entity);
+	for (ComponentType type = 0; type < m_components.size(); ++type)
+	{
+		if (mask & MaskOf(type))
+		{
+			bytesPerEntity += m_components[type].size;
+		}
+	}
+
+	uint32_t capacity = static_cast<uint32_t>(CHUNK_SIZE / bytesPerEntity);
+	while (capacity > 0 && GetChunkBytes(mask, capacity) > CHUNK_SIZE)
+	{
+		--capacity;
+	}
+
+	// the components together are too large for one chunk, a row would overrun it
+	if (capacity == 0)
+	{
+		return INVALID_INDEX;
+	}
+
+	Archetype archetype;
+	archetype.mask = mask;
+	archetype.capacity = capacity;
+	std::fill_n(archetype.offsets, 64, 0u);
+
+	size_t offset = capacity * sizeof(Entity);
+	for (ComponentType type = 0; type < m_components.size(); ++type)
+	{
+		if (mask & MaskOf(type))
+		{
+			offset = AlignUp(offset, m_components[type].alignment);
+			archetype.offsets[type] = static_cast<uint32_t>(offset);
+			offset += capacity * m_components[type].size;
+		}
+	}
+
+	m_archetypes.push_back(std::move(archetype));
+	uint32_t index = static_cast<uint32_t>(m_archetypes.size() - 1);
+	m_archetypeIndices[mask] = index;
+	return index;
+}
+
+size_t EntityWorld::GetChunkBytes(ComponentMask mask, uint32_t capacity) const
+{
+	size_t offset = capacity * sizeof(Entity);
+	for (ComponentType type = 0; type < m_components.size(); ++type)
+	{
+		if (mask & MaskOf(type))
+		{
+			offset = AlignUp(offset, m_components[type].alignment) + capacity * m_components[type].size;
+		}
+	}
+	return offset;
+}
+
+Entity* EntityWorld::GetEntities(const Chunk& chunk) const
+{
+	return reinterpret_cast<Entity*>(chunk.data);
+}
+
+void EntityWorld::AddRow(uint32_t archetypeIndex, uint32_t entityIndex)
+{
+	Archetype& archetype = m_archetypes[archetypeIndex];
+
+	// only the last chunk can have room
+	if (archetype.chunks.empty() || archetype.chunks.back().count == archetype.capacity)
+	{
+		Chunk chunk;
+		chunk.memory.reset(new uint8_t[CHUNK_SIZE + CHUNK_ALIGNMENT]);
+		chunk.data = reinterpret_cast<uint8_t*>(AlignUp(reinterpret_cast<uintptr_t>(chunk.memory.get()), CHUNK_ALIGNMENT));
+		chunk.count = 0;
+		archetype.chunks.push_back(std::move(chunk));
+	}
+
+	Chunk& chunk = archetype.chunks.back();
+	uint32_t row = chunk.count++;
+
+	EntityRecord& record = m_records[entityIndex];
+	record.archetype = archetypeIndex;
+	record.chunk = static_cast<uint32_t>(archetype.chunks.size() - 1);
+	record.row = row;
+
+	Entity entity = { entityIndex, record.generation };
+	GetEntities(chunk)[row] = entity;
+
+	for (ComponentType type = 0; type < m_components.size(); ++type)
+	{
+		if (archetype.mask & MaskOf(type))
+		{
+			memset(chunk.data + archetype.offsets[type] + row * m_components[type].size, 0, m_components[type].size);
+		}
+	}
+}
+
+void EntityWorld::RemoveRow(uint32_t archetypeIndex, uint32_t chunkIndex, uint32_t row)
+{
+	Archetype& archetype = m_archetypes[archetypeIndex];
+	Chunk& chunk = archetype.chunks[chunkIndex];
+	Chunk& last = archetype.chunks.back();
+	uint32_t lastRow = last.count - 1;
+
+	// the archetype's last entity fills the hole
+	if (&chunk != &last || row != lastRow)
+	{
+		Entity moved = GetEntities(last)[lastRow];
+		GetEntities(chunk)[row] = moved;
+		for (ComponentType type = 0; type < m_components.size(); ++type)
+		{
+			if (archetype.mask & MaskOf(type))
+			{
+				uint32_t size = m_components[type].size;
+				memcpy(chunk.data + archetype.offsets[type] + row * size, last.data + archetype.offsets[type] + lastRow * size, size);
+			}
+		}
+
+		m_records[moved.index].chunk = chunkIndex;
+		m_records[moved.index].row = row;
+	}
+
+	if (--last.count == 0)
+	{
+		archetype.chunks.pop_back();
+	}
+}
+
+Entity EntityWorld::Create(ComponentMask components)
+{
+	uint32_t archetype = GetArchetype(components);
+	if (archetype == INVALID_INDEX)
+	{
+		Entity invalid = { INVALID_ENTITY_INDEX, 0 };
+		return invalid;
+	}
+
+	uint32_t index;
+	if (!m_freeIndices.empty())
+	{
+		index = m_freeIndices.back();
+		m_freeIndices.pop_back();
+	}
+	else
+	{
+		index = static_cast<uint32_t>(m_records.size());
+		EntityRecord record = { 0, INVALID_INDEX, 0, 0 };
+		m_records.push_back(record);
+	}
+
+	AddRow(archetype, index);
+	++m_entityCount;
+
+	Entity entity = { index, m_records[index].generation };
+	return entity;
+}
+
+void EntityWorld::Destroy(Entity entity)
+{
+	if (!IsAlive(entity))
+	{
+		return;
+	}
+
+	EntityRecord& record = m_records[entity.index];
+	RemoveRow(record.archetype, record.chunk, record.row);
+
+	record.archetype = INVALID_INDEX;
+	++record.generation;
+	m_freeIndices.push_back(entity.index);
+	--m_entityCount;
+}
+
+bool EntityWorld::IsAlive(Entity entity) const
+{
+	return entity.index < m_records.size() && m_records[entity.index].generation == entity.generation &&
+		m_records[entity.index].archetype != INVALID_INDEX;
+}
+
+bool EntityWorld::SetComponents(Entity entity, ComponentMask components)
+{
+	if (!IsAlive(entity))
+	{
+		return false;
+	}
+
+	const EntityRecord before = m_records[entity.index];
+	if (m_archetypes[before.archetype].mask == components)
+	{
+		return true;
+	}
+
+	uint32_t target = GetArchetype(components);
+	if (target == INVALID_INDEX)
+	{
+		return false;
+	}
+	AddRow(target, entity.index);
+
+	// GetArchetype may have grown the archetype array, look both up afterwards
+	const Archetype& from = m_archetypes[before.archetype];
+	const Archetype& to = m_archetypes[target];
+	const Chunk& fromChunk = from.chunks[before.chunk];
+	const EntityRecord& after = m_records[entity.index];
+	const Chunk& toChunk = to.chunks[after.chunk];
+
+	ComponentMask shared = from.mask & to.mask;
+	for (ComponentType type = 0; type < m_components.size(); ++type)
+	{
+		if (shared & MaskOf(type))
+		{
+			uint32_t size = m_components[type].size;
+			memcpy(toChunk.data + to.offsets[type] + after.row * size, fromChunk.data + from.offsets[type] + before.row * size, size);
+		}
+	}
+
+	RemoveRow(before.archetype, before.chunk, before.row);
+	return true;
+}
+
+bool EntityWorld::AddComponents(Entity entity, ComponentMask components)
+{
+	return SetComponents(entity, GetComponents(entity) | components);
+}
+
+bool EntityWorld::RemoveComponents(Entity entity, ComponentMask components)
+{
+	return SetComponents(entity, GetComponents(entity) & ~components);
+}
+
+ComponentMask EntityWorld::GetComponents(Entity entity) const
+{
+	return IsAlive(entity) ? m_archetypes[m_records[entity.index].archetype].mask : 0;
+}
+
+void* EntityWorld::Get(Entity entity, ComponentType type) const
+{
+	if (!IsAlive(entity))
+	{
+		return nullptr;
+	}
+
+	const EntityRecord& record = m_records[entity.index];
+	const Archetype& archetype = m_archetypes[record.archetype];
+	if (!(archetype.mask & MaskOf(type)))
+	{
+		return nullptr;
+	}
+
+	return archetype.chunks[record.chunk].data + archetype.offsets[type] + record.row * m_components[type].size;
+}
+
+size_t EntityWorld::ForEachChunk(ComponentMask required, ComponentMask excluded, const std::function<void(const EntityChunkView&)>& function)
+{
+	size_t visited = 0;
+	for (Archetype& archetype : m_archetypes)
+	{
+		if ((archetype.mask & required) != required || (archetype.mask & excluded) != 0)
+		{
+			continue;
+		}
+
+		for (Chunk& chunk : archetype.chunks)
+		{
+			EntityChunkView view = { chunk.count, GetEntities(chunk), chunk.data, archetype.offsets };
+			function(view);
+			++visited;
+		}
+	}
+
+	return visited;
+}
+
+size_t EntityWorld::ParallelForEachChunk(ThreadPool& threadPool, ComponentMask required, ComponentMask excluded,
+	const std::function<void(const EntityChunkView&, uint32_t)>& function)
+{
+	m_chunkViews.clear();
+	ForEachChunk(required, excluded, [this](const EntityChunkView& view) { m_chunkViews.push_back(view); });
+
+	const EntityChunkView* views = m_chunkViews.data();
+	threadPool.ParallelFor(m_chunkViews.size(), [views, &function](size_t index, uint32_t threadIndex)
+	{
+		function(views[index], threadIndex);
+	});
+
+	return m_chunkViews.size();
+}
+
+size_t EntityWorld::GetEntityCount() const
+{
+	return m_entityCount;
+}
+
+size_t EntityWorld::GetArchetypeCount() const
+{
+	return m_archetypes.size();
+}
+
+size_t EntityWorld::GetChunkCount() const
+{
+	size_t count = 0;
+	for (const Archetype& archetype : m_archetypes)
+	{
+		count += archetype.chunks.size();
+	}
+	return count;
+}
@@ -0,0 +1,148 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "ThreadPool.h"
+
+typedef uint32_t ComponentType;
+typedef uint64_t ComponentMask;	// one bit per registered component type
+
+// generational handle, stale handles of destroyed entities are detected
+struct Entity
+{
+	uint32_t index;
+	uint32_t generation;
+};
+
+// Component arrays of one chunk, valid until the next structural change.
+struct EntityChunkView
+{
+	uint32_t count;
+	const Entity* entities;
+	uint8_t* data;
+	const uint32_t* offsets;	// per component type, into data
+
+	void* Get(ComponentType type) const
+	{
+		return data + offsets[type];
+	}
+
+	template<typename T>
+	T* Get(ComponentType type) const
+	{
+		return static_cast<T*>(Get(type));
+	}
+};
+
+// Archetype entity storage. Entities with the same component set share an
+// archetype whose 16 KB chunks store every component as its own array
+// (structure of arrays), so systems stream linearly through the components
+// they use. Chunks stay dense: destroying an entity moves the archetype's
+// last entity into the hole.
+//
+// Components are plain data, they are moved with memcpy and start zeroed.
+// Creating, destroying or changing the components of entities invalidates
+// pointers and chunk views, so structural changes wait until iteration ends.
+class EntityWorld
+{
+private:
+
+	struct Chunk
+	{
+		std::unique_ptr<uint8_t[]> memory;
+		uint8_t* data;	// memory aligned to 64 bytes
+		uint32_t count;
+	};
+
+	struct Archetype
+	{
+		ComponentMask mask;
+		uint32_t capacity;	// entities per chunk
+		uint32_t offsets[64];	// array offset of each component type in a chunk
+		std::vector<Chunk> chunks;
+	};
+
+	struct EntityRecord
+	{
+		uint32_t generation;
+		uint32_t archetype;
+		uint32_t chunk;
+		uint32_t row;
+	};
+
+	struct ComponentInfo
+	{
+		uint32_t size;
+		uint32_t alignment;
+	};
+
+	std::vector<ComponentInfo> m_components;
+	std::vector<Archetype> m_archetypes;
+	std::unordered_map<ComponentMask, uint32_t> m_archetypeIndices;
+	std::vector<EntityRecord> m_records;
+	std::vector<uint32_t> m_freeIndices;
+	size_t m_entityCount;
+	std::vector<EntityChunkView> m_chunkViews;	// reused by every parallel walk
+
+	// INVALID_INDEX if not even one entity with these components fits a chunk
+	uint32_t GetArchetype(ComponentMask mask);
+	size_t GetChunkBytes(ComponentMask mask, uint32_t capacity) const;
+	void AddRow(uint32_t archetypeIndex, uint32_t entityIndex);
+	void RemoveRow(uint32_t archetypeIndex, uint32_t chunkIndex, uint32_t row);
+	Entity* GetEntities(const Chunk& chunk) const;
+
+public:
+	static const ComponentType INVALID_COMPONENT = 0xffffffff;
+	static const uint32_t INVALID_ENTITY_INDEX = 0xffffffff;
+	static const size_t CHUNK_SIZE = 16 * 1024;
+
+	EntityWorld();
+
+	// INVALID_COMPONENT once 64 types are registered, or if the component does
+	// not fit a chunk or needs more than 64 byte alignment
+	ComponentType RegisterComponent(size_t size, size_t alignment);
+
+	template<typename T>
+	ComponentType RegisterComponent()
+	{
+		return RegisterComponent(sizeof(T), alignof(T));
+	}
+
+	static ComponentMask MaskOf(ComponentType type);
+
+	// an entity with index INVALID_ENTITY_INDEX, which is never alive, if the
+	// components together do not fit a chunk
+	Entity Create(ComponentMask components);
+	void Destroy(Entity entity);
+	bool IsAlive(Entity entity) const;
+
+	// moves the entity to the archetype of the new component set, components it keeps are copied;
+	// false and the entity unchanged if it is dead or the new set does not fit a chunk
+	bool SetComponents(Entity entity, ComponentMask components);
+	bool AddComponents(Entity entity, ComponentMask components);
+	bool RemoveComponents(Entity entity, ComponentMask components);
+	ComponentMask GetComponents(Entity entity) const;
+
+	// nullptr if the entity is dead or lacks the component
+	void* Get(Entity entity, ComponentType type) const;
+
+	template<typename T>
+	T* Get(Entity entity, ComponentType type) const
+	{
+		return static_cast<T*>(Get(entity, type));
+	}
+
+	// every non-empty chunk whose archetype has all required and none of the excluded components,
+	// returns the number of chunks visited
+	size_t ForEachChunk(ComponentMask required, ComponentMask excluded, const std::function<void(const EntityChunkView&)>& function);
+	// not reentrant, the chunk list is kept between calls so walks do not allocate
+	size_t ParallelForEachChunk(ThreadPool& threadPool, ComponentMask required, ComponentMask excluded,
+		const std::function<void(const EntityChunkView&, uint32_t)>& function);
+
+	size_t GetEntityCount() const;
+	size_t GetArchetypeCount() const;
+	size_t GetChunkCount() const;
+};
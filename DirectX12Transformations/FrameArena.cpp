@@ -0,0 +1,192 @@
+#include "FrameArena.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace
+{
+	const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+	size_t AlignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	// pages come straight from the OS so arena growth never shows up as a heap allocation
+	uint8_t* MapPages(size_t size, bool hugePages)
+	{
+#if defined(_WIN32)
+		(void)hugePages;	// large pages need a privilege the process usually lacks
+		return static_cast<uint8_t*>(VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+#else
+		void* memory = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+		// explicit huge pages only exist when the admin reserved a pool of them
+		if (hugePages)
+		{
+			memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		}
+#endif
+		if (memory == MAP_FAILED)
+		{
+			memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (memory == MAP_FAILED)
+			{
+				return nullptr;
+			}
+#if defined(MADV_HUGEPAGE)
+			// otherwise ask for transparent huge pages
+			if (hugePages)
+			{
+				madvise(memory, size, MADV_HUGEPAGE);
+			}
+#endif
+		}
+		return static_cast<uint8_t*>(memory);
+#endif
+	}
+
+	void UnmapPages(uint8_t* memory, size_t size)
+	{
+#if defined(_WIN32)
+		(void)size;
+		VirtualFree(memory, 0, MEM_RELEASE);
+#else
+		munmap(memory, size);
+#endif
+	}
+}
+
+FrameArena::FrameArena(size_t blockSize, bool hugePages)
+	: m_used(0), m_blockSize(blockSize), m_highWater(0), m_frameBytes(0), m_blockAllocations(0), m_hugePages(hugePages)
+{
+}
+
+FrameArena::~FrameArena()
+{
+	FreeBlocks();
+}
+
+bool FrameArena::AddBlock(size_t minimumSize)
+{
+	size_t size = minimumSize > m_blockSize ? minimumSize : m_blockSize;
+	size = AlignUp(size, m_hugePages ? HUGE_PAGE_SIZE : 64 * 1024);
+
+	uint8_t* memory = MapPages(size, m_hugePages);
+	if (memory == nullptr)
+	{
+		return false;
+	}
+
+	Block block = { memory, size };
+	m_blocks.push_back(block);
+	m_used = 0;
+	++m_blockAllocations;
+	return true;
+}
+
+void FrameArena::FreeBlocks()
+{
+	for (const Block& block : m_blocks)
+	{
+		UnmapPages(block.memory, block.size);
+	}
+	m_blocks.clear();
+	m_used = 0;
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+	if (!m_blocks.empty())
+	{
+		const Block& block = m_blocks.back();
+		size_t offset = AlignUp(m_used, alignment);
+		if (offset + size <= block.size)
+		{
+			m_used = offset + size;
+			m_frameBytes += size;
+			return block.memory + offset;
+		}
+	}
+
+	// blocks are page aligned, so a fresh one satisfies any smaller alignment
+	if (!AddBlock(size + alignment))
+	{
+		return nullptr;
+	}
+
+	m_used = size;
+	m_frameBytes += size;
+	return m_blocks.back().memory;
+}
+
+void FrameArena::Reset()
+{
+	m_highWater = m_frameBytes > m_highWater ? m_frameBytes : m_highWater;
+	m_frameBytes = 0;
+
+	// the frame overflowed, keep one block that holds all of it next time
+	if (m_blocks.size() > 1)
+	{
+		size_t capacity = GetCapacity();
+		FreeBlocks();
+		AddBlock(capacity);
+	}
+	m_used = 0;
+}
+
+size_t FrameArena::GetCapacity() const
+{
+	size_t capacity = 0;
+	for (const Block& block : m_blocks)
+	{
+		capacity += block.size;
+	}
+	return capacity;
+}
+
+size_t FrameArena::GetHighWater() const
+{
+	return m_highWater > m_frameBytes ? m_highWater : m_frameBytes;
+}
+
+uint64_t FrameArena::GetBlockAllocationCount() const
+{
+	return m_blockAllocations;
+}
+
+void FrameArenas::Init(uint32_t threadCount, size_t blockSize, bool hugePages)
+{
+	m_arenas.clear();
+	for (uint32_t i = 0; i < threadCount; ++i)
+	{
+		m_arenas.emplace_back(new FrameArena(blockSize, hugePages));
+	}
+}
+
+void FrameArenas::Reset()
+{
+	for (std::unique_ptr<FrameArena>& arena : m_arenas)
+	{
+		arena->Reset();
+	}
+}
+
+FrameArena& FrameArenas::Get(uint32_t threadIndex)
+{
+	return *m_arenas[threadIndex];
+}
+
+uint64_t FrameArenas::GetBlockAllocationCount() const
+{
+	uint64_t count = 0;
+	for (const std::unique_ptr<FrameArena>& arena : m_arenas)
+	{
+		count += arena->GetBlockAllocationCount();
+	}
+	return count;
+}
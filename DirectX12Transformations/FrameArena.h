@@ -0,0 +1,69 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Bump allocator for scratch memory that lives until the end of the frame.
+// Allocations are never freed one by one, Reset releases all of them at once.
+// When a frame overflows the current block a new one is chained, and the next
+// Reset replaces the chain with a single block of the combined size, so after
+// a few frames the arena stops mapping memory. Not thread safe, use one per thread.
+class FrameArena
+{
+private:
+
+	struct Block
+	{
+		uint8_t* memory;
+		size_t size;
+	};
+
+	std::vector<Block> m_blocks;	// the last one is bumped into
+	size_t m_used;	// in the last block
+	size_t m_blockSize;
+	size_t m_highWater;	// bytes allocated in the largest frame so far
+	size_t m_frameBytes;
+	uint64_t m_blockAllocations;
+	bool m_hugePages;
+
+	bool AddBlock(size_t minimumSize);
+	void FreeBlocks();
+
+public:
+	// huge pages are requested from the OS on Linux and ignored elsewhere
+	explicit FrameArena(size_t blockSize = 1024 * 1024, bool hugePages = false);
+	~FrameArena();
+
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	// nullptr only when the OS is out of memory, alignment must be a power of two
+	void* Allocate(size_t size, size_t alignment = 16);
+	void Reset();
+
+	template<typename T>
+	T* Allocate(size_t count)
+	{
+		return static_cast<T*>(Allocate(count * sizeof(T), alignof(T) > 16 ? alignof(T) : 16));
+	}
+
+	size_t GetCapacity() const;
+	size_t GetHighWater() const;
+	uint64_t GetBlockAllocationCount() const;	// blocks mapped since construction
+};
+
+// one arena per worker thread, reset together at the frame boundary
+class FrameArenas
+{
+private:
+
+	std::vector<std::unique_ptr<FrameArena>> m_arenas;
+
+public:
+	void Init(uint32_t threadCount, size_t blockSize = 1024 * 1024, bool hugePages = false);
+	void Reset();
+
+	FrameArena& Get(uint32_t threadIndex);
+	uint64_t GetBlockAllocationCount() const;
+};
@@ -0,0 +1,88 @@
+#include <cmath>
+#include "FramePhases.h"
+#include "TransformPacking.h"
+
+using namespace DirectX;
+
+bool FramePhases::IsObjectVisible(const XMFLOAT4X4& worldMat, float radius, const ClusterFrustum& frustum)
+{
+	float scaleSquared = worldMat._11 * worldMat._11 + worldMat._12 * worldMat._12 + worldMat._13 * worldMat._13;
+	scaleSquared = fmaxf(scaleSquared, worldMat._21 * worldMat._21 + worldMat._22 * worldMat._22 + worldMat._23 * worldMat._23);
+	scaleSquared = fmaxf(scaleSquared, worldMat._31 * worldMat._31 + worldMat._32 * worldMat._32 + worldMat._33 * worldMat._33);
+
+	return ClusterCuller::IsSphereVisible(&worldMat._41, radius * sqrtf(scaleSquared), frustum);
+}
+
+void FramePhases::CullObjects(const XMFLOAT4X4* worldMats, const float* radii, size_t count, const ClusterFrustum& frustum,
+	uint8_t* visibility, ThreadPool& threadPool)
+{
+	const size_t objectsPerBlock = 4096;
+	const size_t blockCount = (count + objectsPerBlock - 1) / objectsPerBlock;
+	threadPool.ParallelFor(blockCount, [&](size_t block, uint32_t)
+	{
+		size_t end = (block + 1) * objectsPerBlock < count ? (block + 1) * objectsPerBlock : count;
+		for (size_t i = block * objectsPerBlock; i < end; ++i)
+		{
+			visibility[i] = IsObjectVisible(worldMats[i], radii[i], frustum) ? 1 : 0;
+		}
+	});
+}
+
+void XM_CALLCONV FramePhases::SortDraws(const DrawItem* draws, size_t count, const XMFLOAT4X4* worldMats, FXMMATRIX viewMat,
+	const GeometryPool& geometryPool, RadixSorter& sorter, std::vector<SortableDraw>& keys, DrawItem* sortedDraws)
+{
+	const float sortDepthRange = 1000.0f;
+
+	keys.resize(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		const DrawItem& draw = draws[i];
+		const XMFLOAT4X4& worldMat = worldMats[draw.objectIndex];
+
+		XMVECTOR position = XMVector3Transform(XMVectorSet(worldMat._41, worldMat._42, worldMat._43, 1.0f), viewMat);
+		float depth = XMVectorGetZ(position) / sortDepthRange;
+
+		keys[i].key = DrawSortKey::Make(0, draw.pipeline, 0, draw.mesh, depth);
+		keys[i].drawIndex = static_cast<uint32_t>(i);
+	}
+
+	sorter.Sort(keys);
+
+	// the mesh ranges move when the geometry pool is compacted
+	for (size_t i = 0; i < count; ++i)
+	{
+		DrawItem& draw = sortedDraws[i];
+		draw = draws[keys[i].drawIndex];
+
+		const MeshRange& range = geometryPool.GetMesh(draw.mesh);
+		draw.startIndex += range.firstIndex;
+		draw.baseVertex = static_cast<int32_t>(range.baseVertex);
+	}
+}
+
+bool FramePhases::UploadAffineTransforms(const XMFLOAT4X4* worldMats, size_t first, size_t count, FrameArena& arena, UploadWriter& writer)
+{
+	AffineTransform* staging = arena.Allocate<AffineTransform>(count);
+	if (staging == nullptr)
+	{
+		return false;
+	}
+
+	PackAffineTransforms(&worldMats[first], staging, count);
+	writer.Write(first * sizeof(AffineTransform), staging, count * sizeof(AffineTransform));
+	return true;
+}
+
+bool XM_CALLCONV FramePhases::UploadWvpTransforms(const XMFLOAT4X4* worldMats, size_t first, size_t count, FXMMATRIX viewProjection,
+	FrameArena& arena, UploadWriter& writer)
+{
+	XMFLOAT4X4* staging = arena.Allocate<XMFLOAT4X4>(count);
+	if (staging == nullptr)
+	{
+		return false;
+	}
+
+	PackWvpTransforms(&worldMats[first], viewProjection, staging, count);
+	writer.Write(first * sizeof(XMFLOAT4X4), staging, count * sizeof(XMFLOAT4X4));
+	return true;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ClusterCuller.h"
+#include "DrawSortKey.h"
+#include "FrameArena.h"
+#include "GeometryPool.h"
+#include "ParallelCommandRecorder.h"
+#include "ThreadPool.h"
+#include "UploadWriter.h"
+
+// The CPU phases of a frame between the update and the recording, shared by
+// Engine and the headless frame of the benchmarks. World matrices are indexed
+// by DrawItem::objectIndex.
+namespace FramePhases
+{
+	// frustum test of the bounding sphere around the object's origin, radius
+	// in object space, scaled by the largest axis of the world matrix
+	bool IsObjectVisible(const DirectX::XMFLOAT4X4& worldMat, float radius, const ClusterFrustum& frustum);
+
+	// visibility[i] is 1 for objects inside the world space frustum, in blocks of objects on the pool
+	void CullObjects(const DirectX::XMFLOAT4X4* worldMats, const float* radii, size_t count, const ClusterFrustum& frustum,
+		uint8_t* visibility, ThreadPool& threadPool);
+
+	// Opaque front to back, depth normalized over the standard projection
+	// range. keys is resized to the draw count, sortedDraws must hold as many
+	// draws and receives them with their ranges resolved against the pool,
+	// since draw ranges are relative to their mesh.
+	void XM_CALLCONV SortDraws(const DrawItem* draws, size_t count, const DirectX::XMFLOAT4X4* worldMats, DirectX::FXMMATRIX viewMat,
+		const GeometryPool& geometryPool, RadixSorter& sorter, std::vector<SortableDraw>& keys, DrawItem* sortedDraws);
+
+	// Pack objects [first, first + count) through the arena and write them at
+	// their index, as AffineTransform or transposed world * viewProjection.
+	// Return false if the arena is out of memory.
+	bool UploadAffineTransforms(const DirectX::XMFLOAT4X4* worldMats, size_t first, size_t count, FrameArena& arena, UploadWriter& writer);
+	bool XM_CALLCONV UploadWvpTransforms(const DirectX::XMFLOAT4X4* worldMats, size_t first, size_t count, DirectX::FXMMATRIX viewProjection,
+		FrameArena& arena, UploadWriter& writer);
+}
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include "GeometryPool.h"
+
+GeometryPool::GeometryPool(uint32_t vertexCapacity, uint32_t indexCapacity)
+	: m_vertexAllocator(vertexCapacity), m_indexAllocator(indexCapacity)
+{
+}
+
+MeshHandle GeometryPool::AddMesh(uint32_t vertexCount, uint32_t indexCount)
+{
+	uint32_t baseVertex = m_vertexAllocator.Allocate(vertexCount);
+	if (baseVertex == RangeAllocator::INVALID_OFFSET)
+	{
+		return INVALID_HANDLE;
+	}
+
+	uint32_t firstIndex = m_indexAllocator.Allocate(indexCount);
+	if (firstIndex == RangeAllocator::INVALID_OFFSET)
+	{
+		m_vertexAllocator.Free(baseVertex, vertexCount);
+		return INVALID_HANDLE;
+	}
+
+	MeshRange range = { baseVertex, vertexCount, firstIndex, indexCount };
+
+	MeshHandle mesh;
+	if (!m_freeHandles.empty())
+	{
+		mesh = m_freeHandles.back();
+		m_freeHandles.pop_back();
+		m_meshes[mesh] = range;
+		m_alive[mesh] = true;
+	}
+	else
+	{
+		mesh = static_cast<MeshHandle>(m_meshes.size());
+		m_meshes.push_back(range);
+		m_alive.push_back(true);
+	}
+
+	return mesh;
+}
+
+void GeometryPool::RemoveMesh(MeshHandle mesh)
+{
+	if (!IsValid(mesh))
+	{
+		return;
+	}
+
+	const MeshRange& range = m_meshes[mesh];
+	m_vertexAllocator.Free(range.baseVertex, range.vertexCount);
+	m_indexAllocator.Free(range.firstIndex, range.indexCount);
+
+	m_alive[mesh] = false;
+	m_freeHandles.push_back(mesh);
+}
+
+bool GeometryPool::IsValid(MeshHandle mesh) const
+{
+	return mesh < m_meshes.size() && m_alive[mesh];
+}
+
+const MeshRange& GeometryPool::GetMesh(MeshHandle mesh) const
+{
+	return m_meshes[mesh];
+}
+
+float GeometryPool::GetFragmentation() const
+{
+	float fragmentation = 0.0f;
+
+	const RangeAllocator* allocators[] = { &m_vertexAllocator, &m_indexAllocator };
+	for (const RangeAllocator* allocator : allocators)
+	{
+		if (allocator->GetFreeCount() > 0)
+		{
+			float arena = 1.0f - static_cast<float>(allocator->GetLargestFreeRange()) / allocator->GetFreeCount();
+			fragmentation = std::max(fragmentation, arena);
+		}
+	}
+
+	return fragmentation;
+}
+
+void GeometryPool::AppendMove(std::vector<GeometryMove>& moves, uint32_t source, uint32_t destination, uint32_t count)
+{
+	if (source == destination || count == 0)
+	{
+		return;
+	}
+
+	// neighbouring meshes that shift by the same amount become one copy
+	if (!moves.empty())
+	{
+		GeometryMove& last = moves.back();
+		if (last.source + last.count == source && last.destination + last.count == destination)
+		{
+			last.count += count;
+			return;
+		}
+	}
+
+	GeometryMove move = { source, destination, count };
+	moves.push_back(move);
+}
+
+bool GeometryPool::Compact(CompactionPlan& plan)
+{
+	plan.vertexMoves.clear();
+	plan.indexMoves.clear();
+
+	std::vector<MeshHandle> live;
+	for (MeshHandle mesh = 0; mesh < m_meshes.size(); ++mesh)
+	{
+		if (m_alive[mesh])
+		{
+			live.push_back(mesh);
+		}
+	}
+
+	// in source order every destination is at or below its source,
+	// so applying the moves front to back never overwrites live data
+	std::sort(live.begin(), live.end(), [this](MeshHandle a, MeshHandle b) { return m_meshes[a].baseVertex < m_meshes[b].baseVertex; });
+
+	uint32_t vertexCount = 0;
+	for (MeshHandle mesh : live)
+	{
+		MeshRange& range = m_meshes[mesh];
+		AppendMove(plan.vertexMoves, range.baseVertex, vertexCount, range.vertexCount);
+		range.baseVertex = vertexCount;
+		vertexCount += range.vertexCount;
+	}
+
+	std::sort(live.begin(), live.end(), [this](MeshHandle a, MeshHandle b) { return m_meshes[a].firstIndex < m_meshes[b].firstIndex; });
+
+	uint32_t indexCount = 0;
+	for (MeshHandle mesh : live)
+	{
+		MeshRange& range = m_meshes[mesh];
+		AppendMove(plan.indexMoves, range.firstIndex, indexCount, range.indexCount);
+		range.firstIndex = indexCount;
+		indexCount += range.indexCount;
+	}
+
+	m_vertexAllocator.ResetPacked(vertexCount);
+	m_indexAllocator.ResetPacked(indexCount);
+
+	return !plan.vertexMoves.empty() || !plan.indexMoves.empty();
+}
+
+uint32_t GeometryPool::GetVertexCapacity() const
+{
+	return m_vertexAllocator.GetCapacity();
+}
+
+uint32_t GeometryPool::GetIndexCapacity() const
+{
+	return m_indexAllocator.GetCapacity();
+}
+
+uint32_t GeometryPool::GetUsedVertexCount() const
+{
+	return m_vertexAllocator.GetCapacity() - m_vertexAllocator.GetFreeCount();
+}
+
+uint32_t GeometryPool::GetUsedIndexCount() const
+{
+	return m_indexAllocator.GetCapacity() - m_indexAllocator.GetFreeCount();
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "RangeAllocator.h"
+
+typedef uint32_t MeshHandle;
+
+// where a mesh lives in the shared vertex and index arenas, indices are
+// relative to baseVertex so moving vertices does not touch the index data
+struct MeshRange
+{
+	uint32_t baseVertex;
+	uint32_t vertexCount;
+	uint32_t firstIndex;
+	uint32_t indexCount;
+};
+
+// element copy from source to destination, destination <= source
+struct GeometryMove
+{
+	uint32_t source;
+	uint32_t destination;
+	uint32_t count;
+};
+
+struct CompactionPlan
+{
+	std::vector<GeometryMove> vertexMoves;	// ascending source order
+	std::vector<GeometryMove> indexMoves;
+};
+
+// Sub-allocates meshes from one vertex and one index arena, so the buffers are
+// bound once and draws select meshes with base vertex and first index.
+// Only bookkeeping lives here, the GPU buffers belong to D3D12GeometryPool.
+class GeometryPool
+{
+private:
+
+	RangeAllocator m_vertexAllocator;
+	RangeAllocator m_indexAllocator;
+	std::vector<MeshRange> m_meshes;
+	std::vector<bool> m_alive;
+	std::vector<MeshHandle> m_freeHandles;
+
+	static void AppendMove(std::vector<GeometryMove>& moves, uint32_t source, uint32_t destination, uint32_t count);
+
+public:
+	static const MeshHandle INVALID_HANDLE = 0xffffffff;
+
+	GeometryPool(uint32_t vertexCapacity, uint32_t indexCapacity);
+
+	// INVALID_HANDLE if either arena has no free range large enough
+	MeshHandle AddMesh(uint32_t vertexCount, uint32_t indexCount);
+	void RemoveMesh(MeshHandle mesh);
+
+	bool IsValid(MeshHandle mesh) const;
+	const MeshRange& GetMesh(MeshHandle mesh) const;
+
+	// 0 when the free space of both arenas is one range, close to 1 when it is scattered
+	float GetFragmentation() const;
+
+	// packs live meshes to the start of the arenas and updates their ranges,
+	// the moves in plan have to be applied to the buffers. False if already packed.
+	bool Compact(CompactionPlan& plan);
+
+	uint32_t GetVertexCapacity() const;
+	uint32_t GetIndexCapacity() const;
+	uint32_t GetUsedVertexCount() const;
+	uint32_t GetUsedIndexCount() const;
+};
@@ -0,0 +1,109 @@
+#include <emmintrin.h>
+#include "IndirectArgsBuilder.h"
+
+namespace
+{
+	// DrawItem starts with indexCount, startIndex, baseVertex, objectIndex
+	static_assert(offsetof(DrawItem, indexCount) == 0 && offsetof(DrawItem, objectIndex) == 12, "DrawItem layout");
+
+	inline void WriteCommand(const DrawItem* draw, IndirectDrawCommand* out)
+	{
+		__m128i item = _mm_loadu_si128(reinterpret_cast<const __m128i*>(draw));
+
+		// objectIndex, indexCount, startIndex -> lanes 0, 1, 3, instance count 1 in lane 2
+		__m128i head = _mm_shuffle_epi32(item, _MM_SHUFFLE(1, 0, 0, 3));
+		head = _mm_or_si128(_mm_and_si128(head, _mm_setr_epi32(-1, -1, 0, -1)), _mm_setr_epi32(0, 0, 1, 0));
+
+		// baseVertex, start instance 0
+		__m128i tail = _mm_and_si128(_mm_srli_si128(item, 8), _mm_setr_epi32(-1, 0, 0, 0));
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out), head);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(reinterpret_cast<uint8_t*>(out) + 16), tail);
+	}
+
+	size_t CountVisible(const uint8_t* visibility, size_t count)
+	{
+		size_t visible = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			visible += visibility[i] != 0;
+		}
+		return visible;
+	}
+}
+
+IndirectArgsBuilder::IndirectArgsBuilder(ThreadPool* threadPool, size_t drawsPerBlock)
+	: m_threadPool(threadPool), m_drawsPerBlock(drawsPerBlock > 0 ? drawsPerBlock : 1)
+{
+}
+
+uint32_t IndirectArgsBuilder::BuildRange(const DrawItem* draws, size_t count, const uint8_t* visibility, IndirectDrawCommand* out)
+{
+	if (visibility == nullptr)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			WriteCommand(draws + i, out + i);
+		}
+		return static_cast<uint32_t>(count);
+	}
+
+	// only visible draws are written, a speculative write past the last one
+	// would land in the next block's output
+	IndirectDrawCommand* next = out;
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (visibility[i] != 0)
+		{
+			WriteCommand(draws + i, next);
+			++next;
+		}
+	}
+	return static_cast<uint32_t>(next - out);
+}
+
+uint32_t IndirectArgsBuilder::Build(const DrawItem* draws, size_t count, const uint8_t* visibility, IndirectDrawCommand* out)
+{
+	const size_t drawsPerBlock = m_drawsPerBlock;
+	const size_t blockCount = (count + drawsPerBlock - 1) / drawsPerBlock;
+	if (blockCount <= 1)
+	{
+		return BuildRange(draws, count, visibility, out);
+	}
+
+	// output offset of every block
+	m_blockOffsets.resize(blockCount + 1);
+	if (visibility != nullptr)
+	{
+		m_threadPool->ParallelFor(blockCount, [&](size_t block, uint32_t)
+		{
+			size_t first = block * drawsPerBlock;
+			size_t blockSize = count - first < drawsPerBlock ? count - first : drawsPerBlock;
+			m_blockOffsets[block + 1] = static_cast<uint32_t>(CountVisible(visibility + first, blockSize));
+		});
+
+		m_blockOffsets[0] = 0;
+		for (size_t block = 0; block < blockCount; ++block)
+		{
+			m_blockOffsets[block + 1] += m_blockOffsets[block];
+		}
+	}
+	else
+	{
+		for (size_t block = 0; block <= blockCount; ++block)
+		{
+			size_t offset = block * drawsPerBlock;
+			m_blockOffsets[block] = static_cast<uint32_t>(offset < count ? offset : count);
+		}
+	}
+
+	m_threadPool->ParallelFor(blockCount, [&](size_t block, uint32_t)
+	{
+		size_t first = block * drawsPerBlock;
+		size_t blockSize = count - first < drawsPerBlock ? count - first : drawsPerBlock;
+		const uint8_t* blockVisibility = visibility != nullptr ? visibility + first : nullptr;
+		BuildRange(draws + first, blockSize, blockVisibility, out + m_blockOffsets[block]);
+	});
+
+	return m_blockOffsets[blockCount];
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ParallelCommandRecorder.h"
+#include "ThreadPool.h"
+
+// same layout as D3D12_DRAW_INDEXED_ARGUMENTS
+struct DrawIndexedArgs
+{
+	uint32_t indexCountPerInstance;
+	uint32_t instanceCount;
+	uint32_t startIndexLocation;
+	int32_t baseVertexLocation;
+	uint32_t startInstanceLocation;
+};
+
+// one command signature record: the object index root constant, then the draw
+struct IndirectDrawCommand
+{
+	uint32_t objectIndex;
+	DrawIndexedArgs draw;
+};
+
+static_assert(sizeof(DrawIndexedArgs) == 20, "must match D3D12_DRAW_INDEXED_ARGUMENTS");
+static_assert(sizeof(IndirectDrawCommand) == 24, "command signature stride");
+
+// Turns visible draws into an argument buffer for ExecuteIndirect, so the
+// per-draw CPU cost is one 24 byte write. Blocks of draws are converted in
+// parallel; with a visibility mask the blocks first count their survivors
+// and a prefix sum gives every block its output offset, keeping draw order.
+class IndirectArgsBuilder
+{
+private:
+
+	ThreadPool* m_threadPool;
+	size_t m_drawsPerBlock;
+	std::vector<uint32_t> m_blockOffsets;
+
+public:
+	IndirectArgsBuilder(ThreadPool* threadPool, size_t drawsPerBlock = 16 * 1024);
+
+	// visibility is one byte per draw, nonzero if visible, or nullptr to keep all.
+	// out needs room for count commands, returns the number written.
+	uint32_t Build(const DrawItem* draws, size_t count, const uint8_t* visibility, IndirectDrawCommand* out);
+
+	// converts a single block, the sequential kernel behind Build
+	static uint32_t BuildRange(const DrawItem* draws, size_t count, const uint8_t* visibility, IndirectDrawCommand* out);
+};
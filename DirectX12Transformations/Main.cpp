@@ -77,6 +77,10 @@ LRESULT CALLBACK wndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 		g_engine.Update();
 		g_engine.Render();
 		return 0;
+	case WM_SIZE:
+		// minimized windows report 0x0, the engine keeps its buffers then
+		g_engine.Resize(LOWORD(lParam), HIWORD(lParam));
+		return 0;
 	case WM_MOUSEMOVE:
 		{
 			bool rightMouseBtnIsDown = (wParam & 0x0002);
@@ -0,0 +1,560 @@
+#include <algorithm>
+#include <cmath>
+#include "MeshSimplifier.h"
+
+namespace
+{
+	// borders move only if that is very cheap compared to interior collapses
+	const double BORDER_WEIGHT = 10.0;
+
+	struct Vector3
+	{
+		double x, y, z;
+	};
+
+	Vector3 LoadPosition(const float* positions, size_t positionStride, uint32_t vertex)
+	{
+		const float* p = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + vertex * positionStride);
+		Vector3 result = { p[0], p[1], p[2] };
+		return result;
+	}
+
+	Vector3 Sub(const Vector3& a, const Vector3& b)
+	{
+		Vector3 result = { a.x - b.x, a.y - b.y, a.z - b.z };
+		return result;
+	}
+
+	Vector3 Cross(const Vector3& a, const Vector3& b)
+	{
+		Vector3 result = { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+		return result;
+	}
+
+	double Dot(const Vector3& a, const Vector3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	Vector3 MultiplyAdd(const Vector3& a, double s, const Vector3& b)
+	{
+		Vector3 result = { a.x * s + b.x, a.y * s + b.y, a.z * s + b.z };
+		return result;
+	}
+
+	// squared distance from p to the closest point of triangle abc (Ericson, Real-Time Collision Detection 5.1.5)
+	double TriangleDistanceSquared(const Vector3& p, const Vector3& a, const Vector3& b, const Vector3& c)
+	{
+		Vector3 ab = Sub(b, a), ac = Sub(c, a), ap = Sub(p, a);
+		double d1 = Dot(ab, ap), d2 = Dot(ac, ap);
+		Vector3 closest = a;
+		if (d1 > 0.0 || d2 > 0.0)
+		{
+			Vector3 bp = Sub(p, b);
+			double d3 = Dot(ab, bp), d4 = Dot(ac, bp);
+			Vector3 cp = Sub(p, c);
+			double d5 = Dot(ab, cp), d6 = Dot(ac, cp);
+			double vc = d1 * d4 - d3 * d2, vb = d5 * d2 - d1 * d6, va = d3 * d6 - d5 * d4;
+
+			if (d3 >= 0.0 && d4 <= d3)
+			{
+				closest = b;
+			}
+			else if (d6 >= 0.0 && d5 <= d6)
+			{
+				closest = c;
+			}
+			else if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+			{
+				closest = MultiplyAdd(ab, d1 / (d1 - d3), a);
+			}
+			else if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+			{
+				closest = MultiplyAdd(ac, d2 / (d2 - d6), a);
+			}
+			else if (va <= 0.0 && d4 - d3 >= 0.0 && d5 - d6 >= 0.0)
+			{
+				closest = MultiplyAdd(Sub(c, b), (d4 - d3) / ((d4 - d3) + (d5 - d6)), b);
+			}
+			else
+			{
+				double denominator = 1.0 / (va + vb + vc);
+				closest = MultiplyAdd(ac, vc * denominator, MultiplyAdd(ab, vb * denominator, a));
+			}
+		}
+
+		Vector3 offset = Sub(p, closest);
+		return Dot(offset, offset);
+	}
+
+	// symmetric 4x4 matrix of the plane equations, weight is the summed area
+	struct Quadric
+	{
+		double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+		double weight;
+
+		void AddPlane(const Vector3& normal, double d, double planeWeight)
+		{
+			a2 += planeWeight * normal.x * normal.x;
+			ab += planeWeight * normal.x * normal.y;
+			ac += planeWeight * normal.x * normal.z;
+			ad += planeWeight * normal.x * d;
+			b2 += planeWeight * normal.y * normal.y;
+			bc += planeWeight * normal.y * normal.z;
+			bd += planeWeight * normal.y * d;
+			c2 += planeWeight * normal.z * normal.z;
+			cd += planeWeight * normal.z * d;
+			d2 += planeWeight * d * d;
+			weight += planeWeight;
+		}
+
+		void Add(const Quadric& q)
+		{
+			a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+			b2 += q.b2; bc += q.bc; bd += q.bd;
+			c2 += q.c2; cd += q.cd;
+			d2 += q.d2;
+			weight += q.weight;
+		}
+
+		// weighted sum of squared distances to the planes
+		double Evaluate(const Vector3& p) const
+		{
+			double result = a2 * p.x * p.x + 2.0 * ab * p.x * p.y + 2.0 * ac * p.x * p.z + 2.0 * ad * p.x +
+				b2 * p.y * p.y + 2.0 * bc * p.y * p.z + 2.0 * bd * p.y +
+				c2 * p.z * p.z + 2.0 * cd * p.z +
+				d2;
+			return result > 0.0 ? result : 0.0;
+		}
+	};
+
+	const uint32_t INVALID_CORNER = 0xffffffff;
+
+	// one direction of an edge. Versions only grow, so the entry is current while
+	// the sum of its vertices' versions still matches.
+	struct Collapse
+	{
+		uint32_t from;
+		uint32_t to;
+		float cost;	// squared distance
+		uint32_t version;
+	};
+
+	// 4-ary min heap on cost: half the depth of a binary heap and the children of
+	// a node share a cache line
+	void SiftUp(std::vector<Collapse>& heap, size_t index)
+	{
+		Collapse collapse = heap[index];
+		while (index > 0)
+		{
+			size_t parent = (index - 1) / 4;
+			if (heap[parent].cost <= collapse.cost)
+			{
+				break;
+			}
+			heap[index] = heap[parent];
+			index = parent;
+		}
+		heap[index] = collapse;
+	}
+
+	void SiftDown(std::vector<Collapse>& heap, size_t index)
+	{
+		Collapse collapse = heap[index];
+		const size_t size = heap.size();
+		for (;;)
+		{
+			size_t first = index * 4 + 1;
+			if (first >= size)
+			{
+				break;
+			}
+			size_t last = std::min(first + 4, size);
+			size_t smallest = first;
+			for (size_t child = first + 1; child < last; ++child)
+			{
+				smallest = heap[child].cost < heap[smallest].cost ? child : smallest;
+			}
+			if (collapse.cost <= heap[smallest].cost)
+			{
+				break;
+			}
+			heap[index] = heap[smallest];
+			index = smallest;
+		}
+		heap[index] = collapse;
+	}
+
+	void PushCollapse(std::vector<Collapse>& heap, const Collapse& collapse)
+	{
+		heap.push_back(collapse);
+		SiftUp(heap, heap.size() - 1);
+	}
+
+	void MakeHeap(std::vector<Collapse>& heap)
+	{
+		for (size_t index = heap.size() / 4 + 1; index-- > 0;)
+		{
+			if (index < heap.size())
+			{
+				SiftDown(heap, index);
+			}
+		}
+	}
+
+	Collapse PopCollapse(std::vector<Collapse>& heap)
+	{
+		Collapse top = heap.front();
+		heap.front() = heap.back();
+		heap.pop_back();
+		if (!heap.empty())
+		{
+			SiftDown(heap, 0);
+		}
+		return top;
+	}
+
+	bool FlipsTriangle(const Vector3& a, const Vector3& b, const Vector3& c, const Vector3& moved, int movedCorner)
+	{
+		Vector3 before = Cross(Sub(b, a), Sub(c, a));
+
+		Vector3 corners[3] = { a, b, c };
+		corners[movedCorner] = moved;
+		Vector3 after = Cross(Sub(corners[1], corners[0]), Sub(corners[2], corners[0]));
+
+		return Dot(before, after) <= 0.0;
+	}
+
+	uint32_t NextCorner(uint32_t corner)
+	{
+		return corner - corner % 3 + (corner + 1) % 3;
+	}
+
+	uint32_t PreviousCorner(uint32_t corner)
+	{
+		return corner - corner % 3 + (corner + 2) % 3;
+	}
+
+	// the cheaper direction of edge ab under the merged quadric
+	Collapse GetCollapse(const std::vector<Quadric>& quadrics, const std::vector<uint32_t>& versions,
+		const float* positions, size_t positionStride, uint32_t a, uint32_t b)
+	{
+		Quadric q = quadrics[a];
+		q.Add(quadrics[b]);
+		double normalization = q.weight > 0.0 ? 1.0 / q.weight : 0.0;
+
+		double costAB = q.Evaluate(LoadPosition(positions, positionStride, b)) * normalization;
+		double costBA = q.Evaluate(LoadPosition(positions, positionStride, a)) * normalization;
+
+		uint32_t version = versions[a] + versions[b];
+		return costAB <= costBA ? Collapse{ a, b, static_cast<float>(costAB), version } : Collapse{ b, a, static_cast<float>(costBA), version };
+	}
+}
+
+float MeshSimplifier::Simplify(const uint32_t* indices, size_t indexCount,
+	const float* positions, size_t vertexCount, size_t positionStride,
+	size_t targetIndexCount, float maxError, std::vector<uint32_t>& out)
+{
+	out.assign(indices, indices + indexCount - indexCount % 3);
+	const uint32_t cornerCount = static_cast<uint32_t>(out.size());
+
+	// every vertex keeps a list of the triangle corners that reference it; a
+	// collapse rewrites the corners of one list and splices it into the other
+	std::vector<uint32_t> firstCorner(vertexCount, INVALID_CORNER);
+	std::vector<uint32_t> nextCorner(cornerCount);
+	std::vector<bool> removed(cornerCount / 3);
+	for (uint32_t corner = 0; corner < cornerCount; ++corner)
+	{
+		uint32_t vertex = out[corner];
+		nextCorner[corner] = firstCorner[vertex];
+		firstCorner[vertex] = corner;
+	}
+
+	// plane quadrics of the triangles around every vertex, weighted by area
+	std::vector<Quadric> quadrics(vertexCount, Quadric());
+	size_t remainingIndices = cornerCount;
+	for (uint32_t i = 0; i < cornerCount; i += 3)
+	{
+		if (out[i] == out[i + 1] || out[i + 1] == out[i + 2] || out[i] == out[i + 2])
+		{
+			removed[i / 3] = true;
+			remainingIndices -= 3;
+			continue;
+		}
+
+		Vector3 p0 = LoadPosition(positions, positionStride, out[i]);
+		Vector3 normal = Cross(Sub(LoadPosition(positions, positionStride, out[i + 1]), p0), Sub(LoadPosition(positions, positionStride, out[i + 2]), p0));
+		double length = sqrt(Dot(normal, normal));
+		if (length == 0.0)
+		{
+			continue;
+		}
+
+		normal = { normal.x / length, normal.y / length, normal.z / length };
+		double d = -Dot(normal, p0);
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			quadrics[out[i + corner]].AddPlane(normal, d, 0.5 * length);
+		}
+	}
+
+	// an edge without its opposite half is a border, it gets a plane through the
+	// edge perpendicular to its triangle. Every edge is queued once, from the
+	// half with a < b or from its only half.
+	std::vector<uint32_t> versions(vertexCount, 0);
+	std::vector<Collapse> heap;
+	heap.reserve(cornerCount / 2);
+	for (uint32_t corner = 0; corner < cornerCount; ++corner)
+	{
+		if (removed[corner / 3])
+		{
+			continue;
+		}
+
+		uint32_t a = out[corner];
+		uint32_t b = out[NextCorner(corner)];
+		bool isBorder = true;
+		for (uint32_t other = firstCorner[b]; other != INVALID_CORNER && isBorder; other = nextCorner[other])
+		{
+			isBorder = removed[other / 3] || out[NextCorner(other)] != a;
+		}
+
+		if (isBorder)
+		{
+			Vector3 pa = LoadPosition(positions, positionStride, a);
+			Vector3 pb = LoadPosition(positions, positionStride, b);
+			Vector3 pc = LoadPosition(positions, positionStride, out[PreviousCorner(corner)]);
+			Vector3 edge = Sub(pb, pa);
+			Vector3 normal = Cross(edge, Cross(edge, Sub(pc, pa)));
+			double length = sqrt(Dot(normal, normal));
+			if (length != 0.0)
+			{
+				normal = { normal.x / length, normal.y / length, normal.z / length };
+				double d = -Dot(normal, pa);
+				double weight = BORDER_WEIGHT * Dot(edge, edge);
+				quadrics[a].AddPlane(normal, d, weight);
+				quadrics[b].AddPlane(normal, d, weight);
+			}
+		}
+
+		if (isBorder || a < b)
+		{
+			heap.push_back(Collapse{ a, b, 0.0f, 0 });
+		}
+	}
+
+	// costs need the border quadrics, so they are filled in once all are added
+	for (Collapse& collapse : heap)
+	{
+		collapse = GetCollapse(quadrics, versions, positions, positionStride, collapse.from, collapse.to);
+	}
+	MakeHeap(heap);
+
+	const double maxCost = static_cast<double>(maxError) * maxError;
+	double resultCost = 0.0;
+
+	std::vector<bool> collapsed(vertexCount);
+	// the quadric cost is an area weighted mean over many planes and can be well
+	// below the real deviation, so every vertex also carries the distance of the
+	// vertices collapsed into it to the surface that replaced them
+	std::vector<double> deviations(vertexCount, 0.0);
+	double resultDeviation = 0.0;
+	std::vector<uint32_t> neighbours;
+	// collapses that would have flipped a triangle, retried once others changed their surroundings
+	std::vector<Collapse> rejected;
+	bool collapsedSinceRejected = false;
+
+	while (remainingIndices > targetIndexCount)
+	{
+		if (heap.empty() || heap.front().cost > maxCost)
+		{
+			if (rejected.empty() || !collapsedSinceRejected)
+			{
+				break;
+			}
+
+			for (const Collapse& collapse : rejected)
+			{
+				PushCollapse(heap, collapse);
+			}
+			rejected.clear();
+			collapsedSinceRejected = false;
+			continue;
+		}
+
+		const Collapse collapse = PopCollapse(heap);
+
+		// a later entry replaced this one once either vertex changed
+		if (collapsed[collapse.from] || collapsed[collapse.to] ||
+			versions[collapse.from] + versions[collapse.to] != collapse.version)
+		{
+			continue;
+		}
+
+		Vector3 target = LoadPosition(positions, positionStride, collapse.to);
+		bool flips = false;
+		for (uint32_t corner = firstCorner[collapse.from]; corner != INVALID_CORNER && !flips; corner = nextCorner[corner])
+		{
+			if (removed[corner / 3])
+			{
+				continue;
+			}
+
+			uint32_t next = out[NextCorner(corner)];
+			uint32_t previous = out[PreviousCorner(corner)];
+			if (next == collapse.to || previous == collapse.to)
+			{
+				continue;
+			}
+
+			const uint32_t* triangle = &out[corner - corner % 3];
+			flips = FlipsTriangle(LoadPosition(positions, positionStride, triangle[0]),
+				LoadPosition(positions, positionStride, triangle[1]),
+				LoadPosition(positions, positionStride, triangle[2]), target, corner % 3);
+		}
+		if (flips)
+		{
+			rejected.push_back(collapse);
+			continue;
+		}
+
+		// triangles on the edge become lines, the others move to the target
+		Vector3 source = LoadPosition(positions, positionStride, collapse.from);
+		double distance = -1.0;
+		for (uint32_t corner = firstCorner[collapse.from]; corner != INVALID_CORNER; corner = nextCorner[corner])
+		{
+			if (removed[corner / 3])
+			{
+				continue;
+			}
+
+			if (out[NextCorner(corner)] == collapse.to || out[PreviousCorner(corner)] == collapse.to)
+			{
+				removed[corner / 3] = true;
+				remainingIndices -= 3;
+				continue;
+			}
+
+			out[corner] = collapse.to;
+			const uint32_t* triangle = &out[corner - corner % 3];
+			double triangleDistance = TriangleDistanceSquared(source, LoadPosition(positions, positionStride, triangle[0]),
+				LoadPosition(positions, positionStride, triangle[1]), LoadPosition(positions, positionStride, triangle[2]));
+			distance = distance < 0.0 ? triangleDistance : std::min(distance, triangleDistance);
+		}
+
+		double deviation = deviations[collapse.from] + (distance > 0.0 ? sqrt(distance) : 0.0);
+		deviations[collapse.to] = std::max(deviations[collapse.to], deviation);
+		resultDeviation = std::max(resultDeviation, deviation);
+
+		// append the moved corners to the target's list, dropping removed
+		// triangles from both and collecting the target's neighbours
+		neighbours.clear();
+		uint32_t* link = &firstCorner[collapse.to];
+		bool spliced = false;
+		for (;;)
+		{
+			if (*link == INVALID_CORNER)
+			{
+				if (spliced)
+				{
+					break;
+				}
+				*link = firstCorner[collapse.from];
+				firstCorner[collapse.from] = INVALID_CORNER;
+				spliced = true;
+				continue;
+			}
+
+			uint32_t corner = *link;
+			if (removed[corner / 3])
+			{
+				*link = nextCorner[corner];
+				continue;
+			}
+
+			neighbours.push_back(out[NextCorner(corner)]);
+			neighbours.push_back(out[PreviousCorner(corner)]);
+			link = &nextCorner[corner];
+		}
+
+		quadrics[collapse.to].Add(quadrics[collapse.from]);
+		collapsed[collapse.from] = true;
+		++versions[collapse.to];
+		resultCost = std::max(resultCost, static_cast<double>(collapse.cost));
+		collapsedSinceRejected = true;
+
+		// only the edges around the target changed cost
+		std::sort(neighbours.begin(), neighbours.end());
+		neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+		for (uint32_t neighbour : neighbours)
+		{
+			PushCollapse(heap, GetCollapse(quadrics, versions, positions, positionStride, collapse.to, neighbour));
+		}
+	}
+
+	// keep the remaining triangles in their input order
+	size_t write = 0;
+	for (uint32_t i = 0; i < cornerCount; i += 3)
+	{
+		if (!removed[i / 3])
+		{
+			out[write++] = out[i];
+			out[write++] = out[i + 1];
+			out[write++] = out[i + 2];
+		}
+	}
+	out.resize(write);
+
+	return static_cast<float>(std::max(sqrt(resultCost), resultDeviation));
+}
+
+void MeshSimplifier::BuildLodChain(const uint32_t* indices, size_t indexCount,
+	const float* positions, size_t vertexCount, size_t positionStride,
+	uint32_t maxLods, float reduction, float maxError, MeshLodChain& out)
+{
+	out.indices.assign(indices, indices + indexCount);
+	out.lods.clear();
+
+	MeshLod lod = { 0, static_cast<uint32_t>(indexCount), 0.0f };
+	out.lods.push_back(lod);
+
+	std::vector<uint32_t> simplified;
+	while (out.lods.size() < maxLods)
+	{
+		const MeshLod previous = out.lods.back();
+		size_t target = static_cast<size_t>(previous.indexCount / 3 * reduction) * 3;
+
+		// every level starts from the previous one, which is faster on large
+		// meshes; the errors add up so the stored error stays conservative
+		float error = Simplify(&out.indices[previous.firstIndex], previous.indexCount,
+			positions, vertexCount, positionStride, target, maxError - previous.error, simplified);
+
+		if (simplified.empty() || simplified.size() > previous.indexCount * 9 / 10)
+		{
+			break;
+		}
+
+		lod.firstIndex = static_cast<uint32_t>(out.indices.size());
+		lod.indexCount = static_cast<uint32_t>(simplified.size());
+		lod.error = previous.error + error;
+		out.lods.push_back(lod);
+		out.indices.insert(out.indices.end(), simplified.begin(), simplified.end());
+	}
+}
+
+uint32_t MeshSimplifier::SelectLod(const MeshLod* lods, uint32_t lodCount, float distance, float projectionScale, float maxPixelError)
+{
+	if (distance <= 0.0f)
+	{
+		return 0;
+	}
+
+	// errors grow with the level, stop at the first one that would be visible
+	const float pixelsPerUnit = projectionScale / distance;
+	uint32_t lod = 0;
+	while (lod + 1 < lodCount && lods[lod + 1].error * pixelsPerUnit <= maxPixelError)
+	{
+		++lod;
+	}
+	return lod;
+}
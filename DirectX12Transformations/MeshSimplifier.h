@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// one level of detail, a range of MeshLodChain::indices
+struct MeshLod
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	float error;	// geometric deviation from the full mesh, in mesh units
+};
+
+struct MeshLodChain
+{
+	std::vector<uint32_t> indices;	// all levels back to back, finest first
+	std::vector<MeshLod> lods;
+};
+
+// Quadric error metric simplification by edge collapse (Garland and Heckbert).
+// Vertices are only collapsed onto existing vertices, so every level is an
+// index buffer over the original vertex buffer. Open borders, including
+// attribute seams with split vertices, get extra quadrics that keep them in
+// place. Collapses that would flip a triangle are rejected. Edges wait in a
+// priority queue and only the ones around a collapse are costed again.
+class MeshSimplifier
+{
+public:
+	// simplifies towards targetIndexCount without exceeding maxError, returns
+	// the error of the result, the indices are written to out
+	static float Simplify(const uint32_t* indices, size_t indexCount,
+		const float* positions, size_t vertexCount, size_t positionStride,
+		size_t targetIndexCount, float maxError, std::vector<uint32_t>& out);
+
+	// level 0 is the input, every further level keeps about reduction of the
+	// previous one's triangles; stops early once a level barely shrinks
+	static void BuildLodChain(const uint32_t* indices, size_t indexCount,
+		const float* positions, size_t vertexCount, size_t positionStride,
+		uint32_t maxLods, float reduction, float maxError, MeshLodChain& out);
+
+	// coarsest level whose error projects to at most maxPixelError pixels.
+	// projectionScale is viewport height / (2 * tan(fov / 2)), distance is in
+	// mesh units, i.e. divided by the object's scale.
+	static uint32_t SelectLod(const MeshLod* lods, uint32_t lodCount, float distance, float projectionScale, float maxPixelError);
+};
@@ -0,0 +1,333 @@
+#include <cmath>
+#include "MeshletBuilder.h"
+
+namespace
+{
+	const uint8_t NOT_IN_MESHLET = 0xff;
+
+	struct Float3
+	{
+		float x, y, z;
+	};
+
+	Float3 LoadPosition(const float* positions, size_t positionStride, uint32_t vertex)
+	{
+		const float* p = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + vertex * positionStride);
+		Float3 result = { p[0], p[1], p[2] };
+		return result;
+	}
+
+	Float3 Sub(const Float3& a, const Float3& b)
+	{
+		Float3 result = { a.x - b.x, a.y - b.y, a.z - b.z };
+		return result;
+	}
+
+	Float3 MulAdd(const Float3& a, float s, const Float3& b)
+	{
+		Float3 result = { a.x * s + b.x, a.y * s + b.y, a.z * s + b.z };
+		return result;
+	}
+
+	float Dot(const Float3& a, const Float3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	Float3 Cross(const Float3& a, const Float3& b)
+	{
+		Float3 result = { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+		return result;
+	}
+
+	float Length(const Float3& a)
+	{
+		return sqrtf(Dot(a, a));
+	}
+
+	// finishes the open meshlet and resets the local vertex slots it used
+	void CloseMeshlet(MeshletMesh& out, Meshlet& meshlet, std::vector<uint8_t>& localIndex)
+	{
+		if (meshlet.triangleCount == 0)
+		{
+			return;
+		}
+
+		for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+		{
+			localIndex[out.vertices[meshlet.vertexOffset + i]] = NOT_IN_MESHLET;
+		}
+
+		out.meshlets.push_back(meshlet);
+
+		meshlet.vertexOffset = static_cast<uint32_t>(out.vertices.size());
+		meshlet.vertexCount = 0;
+		meshlet.triangleOffset = static_cast<uint32_t>(out.triangles.size() / 3);
+		meshlet.triangleCount = 0;
+	}
+}
+
+void MeshletBuilder::Build(const uint32_t* indices, size_t indexCount,
+	const float* positions, size_t vertexCount, size_t positionStride,
+	MeshletMesh& out, uint32_t maxVertices, uint32_t maxTriangles)
+{
+	out = MeshletMesh();
+
+	// local indices are bytes and 0xff marks a vertex outside the meshlet
+	maxVertices = maxVertices < NOT_IN_MESHLET ? maxVertices : NOT_IN_MESHLET;
+	maxVertices = maxVertices >= 3 ? maxVertices : 3;
+	maxTriangles = maxTriangles > 0 ? maxTriangles : 1;
+
+	const size_t triangleCount = indexCount / 3;
+
+	// triangles around every vertex
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t i = 0; i < triangleCount * 3; ++i)
+	{
+		++adjacencyOffsets[indices[i] + 1];
+	}
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+	}
+
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (size_t i = 0; i < triangleCount * 3; ++i)
+	{
+		adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint8_t> localIndex(vertexCount, NOT_IN_MESHLET);
+	std::vector<uint32_t> candidates;
+	size_t nextSeed = 0;
+
+	Meshlet meshlet = {};
+
+	for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+	{
+		// neighbour needing the fewest new vertices, 0 is as good as it gets
+		size_t best = candidates.size();
+		uint32_t bestNewVertices = 4;
+		for (size_t c = 0; c < candidates.size() && bestNewVertices > 0; )
+		{
+			uint32_t triangle = candidates[c];
+			if (emitted[triangle])
+			{
+				candidates[c] = candidates.back();
+				candidates.pop_back();
+				continue;
+			}
+
+			const uint32_t* corners = indices + triangle * 3;
+			uint32_t newVertices = (localIndex[corners[0]] == NOT_IN_MESHLET) +
+				(localIndex[corners[1]] == NOT_IN_MESHLET && corners[1] != corners[0]) +
+				(localIndex[corners[2]] == NOT_IN_MESHLET && corners[2] != corners[0] && corners[2] != corners[1]);
+
+			if (newVertices < bestNewVertices && meshlet.vertexCount + newVertices <= maxVertices)
+			{
+				best = c;
+				bestNewVertices = newVertices;
+			}
+			++c;
+		}
+
+		uint32_t triangle;
+		if (best < candidates.size())
+		{
+			triangle = candidates[best];
+			candidates[best] = candidates.back();
+			candidates.pop_back();
+		}
+		else
+		{
+			// no neighbour fits: continue with the next triangle in index order,
+			// in a fresh meshlet if the open one is out of vertices
+			while (emitted[nextSeed])
+			{
+				++nextSeed;
+			}
+			triangle = static_cast<uint32_t>(nextSeed);
+
+			if (meshlet.vertexCount + 3 > maxVertices)
+			{
+				CloseMeshlet(out, meshlet, localIndex);
+				candidates.clear();
+			}
+		}
+
+		const uint32_t* corners = indices + triangle * 3;
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			uint32_t vertex = corners[corner];
+			if (localIndex[vertex] == NOT_IN_MESHLET)
+			{
+				localIndex[vertex] = static_cast<uint8_t>(meshlet.vertexCount++);
+				out.vertices.push_back(vertex);
+			}
+
+			out.triangles.push_back(localIndex[vertex]);
+			out.indices.push_back(vertex);
+
+			for (uint32_t a = adjacencyOffsets[vertex]; a < adjacencyOffsets[vertex + 1]; ++a)
+			{
+				if (!emitted[adjacency[a]] && adjacency[a] != triangle)
+				{
+					candidates.push_back(adjacency[a]);
+				}
+			}
+		}
+
+		emitted[triangle] = true;
+		++meshlet.triangleCount;
+
+		if (meshlet.triangleCount == maxTriangles || meshlet.vertexCount == maxVertices)
+		{
+			CloseMeshlet(out, meshlet, localIndex);
+			candidates.clear();
+		}
+	}
+
+	CloseMeshlet(out, meshlet, localIndex);
+
+	out.bounds.reserve(out.meshlets.size());
+	for (const Meshlet& m : out.meshlets)
+	{
+		out.bounds.push_back(ComputeBounds(out, m, positions, positionStride));
+	}
+}
+
+MeshletBounds MeshletBuilder::ComputeBounds(const MeshletMesh& mesh, const Meshlet& meshlet,
+	const float* positions, size_t positionStride)
+{
+	MeshletBounds bounds = {};
+	if (meshlet.vertexCount == 0)
+	{
+		bounds.coneCutoff = 1.0f;
+		return bounds;
+	}
+
+	const uint32_t* vertices = &mesh.vertices[meshlet.vertexOffset];
+
+	// Ritter's sphere: start from two far apart points, grow to cover the rest
+	Float3 x = LoadPosition(positions, positionStride, vertices[0]);
+	Float3 y = x;
+	float maxDistance = 0.0f;
+	for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+	{
+		Float3 p = LoadPosition(positions, positionStride, vertices[i]);
+		Float3 d = Sub(p, x);
+		if (Dot(d, d) > maxDistance)
+		{
+			maxDistance = Dot(d, d);
+			y = p;
+		}
+	}
+
+	Float3 z = y;
+	maxDistance = 0.0f;
+	for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+	{
+		Float3 p = LoadPosition(positions, positionStride, vertices[i]);
+		Float3 d = Sub(p, y);
+		if (Dot(d, d) > maxDistance)
+		{
+			maxDistance = Dot(d, d);
+			z = p;
+		}
+	}
+
+	Float3 center = MulAdd(Sub(z, y), 0.5f, y);
+	float radius = 0.5f * sqrtf(maxDistance);
+
+	for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+	{
+		Float3 p = LoadPosition(positions, positionStride, vertices[i]);
+		float distance = Length(Sub(p, center));
+		if (distance > radius)
+		{
+			// move the center towards p just enough to cover it
+			float newRadius = 0.5f * (radius + distance);
+			center = MulAdd(Sub(p, center), (newRadius - radius) / distance, center);
+			radius = newRadius;
+		}
+	}
+
+	bounds.center[0] = center.x;
+	bounds.center[1] = center.y;
+	bounds.center[2] = center.z;
+	bounds.radius = radius;
+
+	// normal cone: average of the triangle normals, opened to contain all of them
+	std::vector<Float3> normals;
+	std::vector<Float3> corners;
+	normals.reserve(meshlet.triangleCount);
+	corners.reserve(meshlet.triangleCount);
+
+	Float3 axis = { 0.0f, 0.0f, 0.0f };
+	for (uint32_t t = 0; t < meshlet.triangleCount; ++t)
+	{
+		const uint8_t* local = &mesh.triangles[(meshlet.triangleOffset + t) * 3];
+		Float3 p0 = LoadPosition(positions, positionStride, vertices[local[0]]);
+		Float3 p1 = LoadPosition(positions, positionStride, vertices[local[1]]);
+		Float3 p2 = LoadPosition(positions, positionStride, vertices[local[2]]);
+
+		Float3 normal = Cross(Sub(p1, p0), Sub(p2, p0));
+		float area = Length(normal);
+		if (area == 0.0f)
+		{
+			continue;
+		}
+
+		normal = MulAdd(normal, 1.0f / area, Float3());
+		normals.push_back(normal);
+		corners.push_back(p0);
+		axis = MulAdd(normal, 1.0f, axis);
+	}
+
+	bounds.coneApex[0] = center.x;
+	bounds.coneApex[1] = center.y;
+	bounds.coneApex[2] = center.z;
+	bounds.coneCutoff = 1.0f;
+
+	float axisLength = Length(axis);
+	if (axisLength == 0.0f)
+	{
+		return bounds;
+	}
+	axis = MulAdd(axis, 1.0f / axisLength, Float3());
+
+	float minDot = 1.0f;
+	for (const Float3& normal : normals)
+	{
+		float d = Dot(axis, normal);
+		minDot = d < minDot ? d : minDot;
+	}
+
+	bounds.coneAxis[0] = axis.x;
+	bounds.coneAxis[1] = axis.y;
+	bounds.coneAxis[2] = axis.z;
+
+	// cones wider than about 84 degrees almost never cull, leave the test off
+	if (minDot <= 0.1f)
+	{
+		return bounds;
+	}
+
+	// apex behind every triangle plane along the axis
+	float maxT = 0.0f;
+	for (size_t t = 0; t < normals.size(); ++t)
+	{
+		float distance = Dot(Sub(center, corners[t]), normals[t]) / Dot(axis, normals[t]);
+		maxT = distance > maxT ? distance : maxT;
+	}
+
+	Float3 apex = MulAdd(axis, -maxT, center);
+	bounds.coneApex[0] = apex.x;
+	bounds.coneApex[1] = apex.y;
+	bounds.coneApex[2] = apex.z;
+	bounds.coneCutoff = sqrtf(1.0f - minDot * minDot);
+
+	return bounds;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A cluster of at most MAX_VERTICES vertices and MAX_TRIANGLES triangles.
+// Its triangles form one contiguous range of MeshletMesh::indices.
+struct Meshlet
+{
+	uint32_t vertexOffset;	// into MeshletMesh::vertices
+	uint32_t vertexCount;
+	uint32_t triangleOffset;	// into MeshletMesh::triangles, in triangles
+	uint32_t triangleCount;
+};
+
+// Bounding sphere and normal cone in the mesh's space. A cluster is back
+// facing when dot(normalize(coneApex - eye), coneAxis) >= coneCutoff;
+// a cutoff of 1 or more disables the test for clusters facing every way.
+struct MeshletBounds
+{
+	float center[3];
+	float radius;
+	float coneApex[3];
+	float coneCutoff;
+	float coneAxis[3];
+};
+
+struct MeshletMesh
+{
+	std::vector<Meshlet> meshlets;
+	std::vector<MeshletBounds> bounds;
+	std::vector<uint32_t> vertices;	// mesh vertex index per meshlet vertex
+	std::vector<uint8_t> triangles;	// meshlet local vertex indices, three per triangle
+	std::vector<uint32_t> indices;	// the mesh re-indexed in meshlet order, three per triangle
+};
+
+// Offline splitting of an indexed triangle mesh into meshlets. Triangles are
+// added greedily to the current meshlet, preferring the neighbour that needs
+// the fewest new vertices, so meshlets stay compact and share few vertices.
+class MeshletBuilder
+{
+public:
+	static const uint32_t MAX_VERTICES = 64;
+	static const uint32_t MAX_TRIANGLES = 124;
+
+	// positions are three floats every positionStride bytes
+	static void Build(const uint32_t* indices, size_t indexCount,
+		const float* positions, size_t vertexCount, size_t positionStride,
+		MeshletMesh& out,
+		uint32_t maxVertices = MAX_VERTICES, uint32_t maxTriangles = MAX_TRIANGLES);
+
+	static MeshletBounds ComputeBounds(const MeshletMesh& mesh, const Meshlet& meshlet,
+		const float* positions, size_t positionStride);
+};
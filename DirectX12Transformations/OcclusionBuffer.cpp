@@ -0,0 +1,356 @@
+#include <algorithm>
+#include <cmath>
+#include <xmmintrin.h>
+#include "OcclusionBuffer.h"
+
+namespace
+{
+	// points closer than this to the eye plane are not projected
+	const float MIN_W = 1e-4f;
+
+	void Multiply(const float a[16], const float b[16], float result[16])
+	{
+		for (int row = 0; row < 4; ++row)
+		{
+			for (int column = 0; column < 4; ++column)
+			{
+				result[row * 4 + column] = a[row * 4 + 0] * b[0 * 4 + column] + a[row * 4 + 1] * b[1 * 4 + column] +
+					a[row * 4 + 2] * b[2 * 4 + column] + a[row * 4 + 3] * b[3 * 4 + column];
+			}
+		}
+	}
+
+	void Transform(const float p[3], const float m[16], float clip[4])
+	{
+		for (int column = 0; column < 4; ++column)
+		{
+			clip[column] = p[0] * m[column] + p[1] * m[4 + column] + p[2] * m[8 + column] + m[12 + column];
+		}
+	}
+}
+
+OcclusionBuffer::OcclusionBuffer(ThreadPool* threadPool, uint32_t width, uint32_t height)
+	: m_threadPool(threadPool), m_width(0), m_height(0), m_tilesX(0), m_tilesY(0)
+{
+	for (int i = 0; i < 16; ++i)
+	{
+		m_viewProjection[i] = i % 5 == 0 ? 1.0f : 0.0f;
+	}
+	Resize(width, height);
+}
+
+void OcclusionBuffer::Resize(uint32_t width, uint32_t height)
+{
+	m_tilesX = (std::max(width, 1u) + TILE_WIDTH - 1) / TILE_WIDTH;
+	m_tilesY = (std::max(height, 1u) + TILE_HEIGHT - 1) / TILE_HEIGHT;
+	m_width = m_tilesX * TILE_WIDTH;
+	m_height = m_tilesY * TILE_HEIGHT;
+
+	m_depth.assign(static_cast<size_t>(m_width) * m_height, 0.0f);
+	m_hiZ.assign(static_cast<size_t>(m_width / HIZ_BLOCK) * (m_height / HIZ_BLOCK), 0.0f);
+	m_tileBins.resize(static_cast<size_t>(m_tilesX) * m_tilesY);
+}
+
+void OcclusionBuffer::BeginFrame(const float viewProjection[16])
+{
+	std::copy(viewProjection, viewProjection + 16, m_viewProjection);
+	m_triangles.clear();
+}
+
+void OcclusionBuffer::AddOccluder(const float* positions, size_t positionStride, const uint32_t* indices, size_t indexCount, const float world[16])
+{
+	float worldViewProjection[16];
+	Multiply(world, m_viewProjection, worldViewProjection);
+
+	for (size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		ScreenTriangle triangle;
+		bool crossesNearPlane = false;
+
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			const float* p = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + indices[i + corner] * positionStride);
+			float clip[4];
+			Transform(p, worldViewProjection, clip);
+
+			if (clip[3] < MIN_W)
+			{
+				crossesNearPlane = true;
+				break;
+			}
+
+			float invW = 1.0f / clip[3];
+			triangle.x[corner] = (clip[0] * invW * 0.5f + 0.5f) * m_width;
+			triangle.y[corner] = (0.5f - clip[1] * invW * 0.5f) * m_height;
+			triangle.invW[corner] = invW;
+		}
+
+		if (!crossesNearPlane)
+		{
+			m_triangles.push_back(triangle);
+		}
+	}
+}
+
+void OcclusionBuffer::Rasterize()
+{
+	for (std::vector<uint32_t>& bin : m_tileBins)
+	{
+		bin.clear();
+	}
+
+	for (uint32_t t = 0; t < m_triangles.size(); ++t)
+	{
+		const ScreenTriangle& triangle = m_triangles[t];
+		float minX = std::min(std::min(triangle.x[0], triangle.x[1]), triangle.x[2]);
+		float maxX = std::max(std::max(triangle.x[0], triangle.x[1]), triangle.x[2]);
+		float minY = std::min(std::min(triangle.y[0], triangle.y[1]), triangle.y[2]);
+		float maxY = std::max(std::max(triangle.y[0], triangle.y[1]), triangle.y[2]);
+
+		if (maxX < 0.0f || maxY < 0.0f || minX >= m_width || minY >= m_height)
+		{
+			continue;
+		}
+
+		uint32_t firstTileX = static_cast<uint32_t>(std::max(minX, 0.0f)) / TILE_WIDTH;
+		uint32_t lastTileX = std::min(static_cast<uint32_t>(std::min(maxX, static_cast<float>(m_width - 1))) / TILE_WIDTH, m_tilesX - 1);
+		uint32_t firstTileY = static_cast<uint32_t>(std::max(minY, 0.0f)) / TILE_HEIGHT;
+		uint32_t lastTileY = std::min(static_cast<uint32_t>(std::min(maxY, static_cast<float>(m_height - 1))) / TILE_HEIGHT, m_tilesY - 1);
+
+		for (uint32_t tileY = firstTileY; tileY <= lastTileY; ++tileY)
+		{
+			for (uint32_t tileX = firstTileX; tileX <= lastTileX; ++tileX)
+			{
+				m_tileBins[tileY * m_tilesX + tileX].push_back(t);
+			}
+		}
+	}
+
+	// tiles own disjoint pixels and hierarchy blocks, no synchronization needed
+	m_threadPool->ParallelFor(m_tileBins.size(), [this](size_t tile, uint32_t)
+	{
+		RasterizeTile(static_cast<uint32_t>(tile));
+	});
+}
+
+void OcclusionBuffer::RasterizeTile(uint32_t tile)
+{
+	const uint32_t tileX = (tile % m_tilesX) * TILE_WIDTH;
+	const uint32_t tileY = (tile / m_tilesX) * TILE_HEIGHT;
+
+	for (uint32_t y = 0; y < TILE_HEIGHT; ++y)
+	{
+		std::fill_n(&m_depth[(tileY + y) * m_width + tileX], TILE_WIDTH, 0.0f);
+	}
+
+	const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 zero = _mm_setzero_ps();
+
+	for (uint32_t t : m_tileBins[tile])
+	{
+		const ScreenTriangle& triangle = m_triangles[t];
+
+		float area = (triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) - (triangle.x[2] - triangle.x[0]) * (triangle.y[1] - triangle.y[0]);
+		if (area == 0.0f)
+		{
+			continue;
+		}
+
+		// edge functions E(x, y) = a * x + b * y + c, positive inside for either winding;
+		// pixel centers exactly on an edge are covered so shared edges leave no cracks
+		const float sign = area > 0.0f ? 1.0f : -1.0f;
+		float edgeA[3], edgeB[3], edgeC[3];
+		for (int edge = 0; edge < 3; ++edge)
+		{
+			int from = (edge + 1) % 3;
+			int to = (edge + 2) % 3;
+			edgeA[edge] = sign * (triangle.y[from] - triangle.y[to]);
+			edgeB[edge] = sign * (triangle.x[to] - triangle.x[from]);
+			edgeC[edge] = sign * (triangle.x[from] * triangle.y[to] - triangle.x[to] * triangle.y[from]);
+		}
+
+		// 1/w as a plane over the screen, from the barycentrics E / (2 * area)
+		const float invArea = 1.0f / (sign * area);
+		float depthA = 0.0f, depthB = 0.0f, depthC = 0.0f;
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			depthA += edgeA[corner] * triangle.invW[corner] * invArea;
+			depthB += edgeB[corner] * triangle.invW[corner] * invArea;
+			depthC += edgeC[corner] * triangle.invW[corner] * invArea;
+		}
+
+		// triangle bounds clipped to the tile, x aligned down to 4 pixels
+		float minX = std::min(std::min(triangle.x[0], triangle.x[1]), triangle.x[2]);
+		float maxX = std::max(std::max(triangle.x[0], triangle.x[1]), triangle.x[2]);
+		float minY = std::min(std::min(triangle.y[0], triangle.y[1]), triangle.y[2]);
+		float maxY = std::max(std::max(triangle.y[0], triangle.y[1]), triangle.y[2]);
+
+		int x0 = std::max(static_cast<int>(minX), static_cast<int>(tileX)) & ~3;
+		int x1 = std::min(static_cast<int>(ceilf(maxX)), static_cast<int>(tileX + TILE_WIDTH));
+		int y0 = std::max(static_cast<int>(minY), static_cast<int>(tileY));
+		int y1 = std::min(static_cast<int>(ceilf(maxY)), static_cast<int>(tileY + TILE_HEIGHT));
+
+		for (int y = y0; y < y1; ++y)
+		{
+			const __m128 py = _mm_set1_ps(y + 0.5f);
+			__m128 rowE[3];
+			for (int edge = 0; edge < 3; ++edge)
+			{
+				rowE[edge] = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeB[edge]), py), _mm_set1_ps(edgeC[edge]));
+			}
+			__m128 rowDepth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(depthB), py), _mm_set1_ps(depthC));
+
+			float* row = &m_depth[y * m_width];
+			for (int x = x0; x < x1; x += 4)
+			{
+				const __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneOffsets);
+
+				__m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[0]), px), rowE[0]);
+				__m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[1]), px), rowE[1]);
+				__m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[2]), px), rowE[2]);
+				__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+
+				if (_mm_movemask_ps(inside) == 0)
+				{
+					continue;
+				}
+
+				__m128 depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(depthA), px), rowDepth);
+				__m128 current = _mm_loadu_ps(row + x);
+				__m128 nearest = _mm_max_ps(current, depth);
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, current)));
+			}
+		}
+	}
+
+	// farthest depth of every block in the tile
+	const uint32_t hiZWidth = m_width / HIZ_BLOCK;
+	for (uint32_t blockY = tileY / HIZ_BLOCK; blockY < (tileY + TILE_HEIGHT) / HIZ_BLOCK; ++blockY)
+	{
+		for (uint32_t blockX = tileX / HIZ_BLOCK; blockX < (tileX + TILE_WIDTH) / HIZ_BLOCK; ++blockX)
+		{
+			__m128 farthest = _mm_set1_ps(INFINITY);
+			for (uint32_t y = 0; y < HIZ_BLOCK; ++y)
+			{
+				const float* row = &m_depth[(blockY * HIZ_BLOCK + y) * m_width + blockX * HIZ_BLOCK];
+				farthest = _mm_min_ps(farthest, _mm_min_ps(_mm_loadu_ps(row), _mm_loadu_ps(row + 4)));
+			}
+
+			farthest = _mm_min_ps(farthest, _mm_shuffle_ps(farthest, farthest, _MM_SHUFFLE(1, 0, 3, 2)));
+			farthest = _mm_min_ps(farthest, _mm_shuffle_ps(farthest, farthest, _MM_SHUFFLE(2, 3, 0, 1)));
+			m_hiZ[blockY * hiZWidth + blockX] = _mm_cvtss_f32(farthest);
+		}
+	}
+}
+
+bool OcclusionBuffer::IsVisibleClip(const float (*clip)[4], size_t count) const
+{
+	float minX = INFINITY, maxX = -INFINITY, minY = INFINITY, maxY = -INFINITY;
+	float nearest = 0.0f;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		// w is linear over the box, so the nearest point is a corner
+		if (clip[i][3] < MIN_W)
+		{
+			return true;
+		}
+
+		float invW = 1.0f / clip[i][3];
+		float x = (clip[i][0] * invW * 0.5f + 0.5f) * m_width;
+		float y = (0.5f - clip[i][1] * invW * 0.5f) * m_height;
+
+		minX = std::min(minX, x);
+		maxX = std::max(maxX, x);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
+		nearest = std::max(nearest, invW);
+	}
+
+	if (maxX < 0.0f || maxY < 0.0f || minX >= m_width || minY >= m_height)
+	{
+		return false;
+	}
+
+	const uint32_t hiZWidth = m_width / HIZ_BLOCK;
+	uint32_t blockX0 = static_cast<uint32_t>(std::max(minX, 0.0f)) / HIZ_BLOCK;
+	uint32_t blockX1 = static_cast<uint32_t>(std::min(maxX, static_cast<float>(m_width - 1))) / HIZ_BLOCK;
+	uint32_t blockY0 = static_cast<uint32_t>(std::max(minY, 0.0f)) / HIZ_BLOCK;
+	uint32_t blockY1 = static_cast<uint32_t>(std::min(maxY, static_cast<float>(m_height - 1))) / HIZ_BLOCK;
+
+	// visible as soon as one block has an occluder gap at or behind the box
+	for (uint32_t blockY = blockY0; blockY <= blockY1; ++blockY)
+	{
+		for (uint32_t blockX = blockX0; blockX <= blockX1; ++blockX)
+		{
+			if (m_hiZ[blockY * hiZWidth + blockX] <= nearest)
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+bool OcclusionBuffer::IsVisible(const float boundsMin[3], const float boundsMax[3], const float* world) const
+{
+	float transform[16];
+	if (world != nullptr)
+	{
+		Multiply(world, m_viewProjection, transform);
+	}
+	else
+	{
+		std::copy(m_viewProjection, m_viewProjection + 16, transform);
+	}
+
+	float clip[8][4];
+	for (int corner = 0; corner < 8; ++corner)
+	{
+		float p[3] =
+		{
+			(corner & 1) ? boundsMax[0] : boundsMin[0],
+			(corner & 2) ? boundsMax[1] : boundsMin[1],
+			(corner & 4) ? boundsMax[2] : boundsMin[2]
+		};
+		Transform(p, transform, clip[corner]);
+	}
+
+	return IsVisibleClip(clip, 8);
+}
+
+void OcclusionBuffer::TestVisibility(const float* bounds, size_t count, uint8_t* visibility)
+{
+	const size_t boxesPerBlock = 256;
+	const size_t blockCount = (count + boxesPerBlock - 1) / boxesPerBlock;
+
+	m_threadPool->ParallelFor(blockCount, [&](size_t block, uint32_t)
+	{
+		size_t end = std::min(count, (block + 1) * boxesPerBlock);
+		for (size_t i = block * boxesPerBlock; i < end; ++i)
+		{
+			visibility[i] = IsVisible(bounds + i * 6, bounds + i * 6 + 3) ? 1 : 0;
+		}
+	});
+}
+
+uint32_t OcclusionBuffer::GetWidth() const
+{
+	return m_width;
+}
+
+uint32_t OcclusionBuffer::GetHeight() const
+{
+	return m_height;
+}
+
+size_t OcclusionBuffer::GetOccluderTriangleCount() const
+{
+	return m_triangles.size();
+}
+
+const float* OcclusionBuffer::GetDepth() const
+{
+	return m_depth.data();
+}
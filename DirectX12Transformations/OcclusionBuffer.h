@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ThreadPool.h"
+
+// Low resolution software depth buffer for CPU occlusion culling. Large
+// occluders are rasterized into it on the thread pool, one screen tile per
+// task, and every HIZ_BLOCK x HIZ_BLOCK block keeps its farthest depth.
+// Bounds are then rejected when they are behind the occluders in every
+// block they cover.
+//
+// Depth is stored as 1/w, which is linear in screen space and independent
+// of the projection's depth mapping, so standard and reverse-Z work alike.
+// Larger is nearer and 0 is empty. Matrices are row-vector, row-major, as
+// stored by DirectXMath.
+class OcclusionBuffer
+{
+private:
+
+	struct ScreenTriangle
+	{
+		float x[3];
+		float y[3];
+		float invW[3];
+	};
+
+	ThreadPool* m_threadPool;
+	uint32_t m_width;
+	uint32_t m_height;
+	uint32_t m_tilesX;
+	uint32_t m_tilesY;
+	float m_viewProjection[16];
+
+	std::vector<float> m_depth;
+	std::vector<float> m_hiZ;	// per block, farthest depth
+	std::vector<ScreenTriangle> m_triangles;
+	std::vector<std::vector<uint32_t>> m_tileBins;
+
+	void RasterizeTile(uint32_t tile);
+	bool IsVisibleClip(const float (*clip)[4], size_t count) const;
+
+public:
+	static const uint32_t TILE_WIDTH = 64;
+	static const uint32_t TILE_HEIGHT = 32;
+	static const uint32_t HIZ_BLOCK = 8;
+
+	// the size is rounded up to whole tiles
+	OcclusionBuffer(ThreadPool* threadPool, uint32_t width = 256, uint32_t height = 128);
+
+	void Resize(uint32_t width, uint32_t height);
+
+	// drops last frame's occluders
+	void BeginFrame(const float viewProjection[16]);
+
+	// triangles crossing the near plane are skipped, which only makes the buffer more conservative
+	void AddOccluder(const float* positions, size_t positionStride, const uint32_t* indices, size_t indexCount, const float world[16]);
+
+	// bins the occluder triangles to tiles, rasterizes them and builds the hierarchy
+	void Rasterize();
+
+	// box in the space of world, or in world space if world is nullptr
+	bool IsVisible(const float boundsMin[3], const float boundsMax[3], const float* world = nullptr) const;
+
+	// world space boxes as min xyz, max xyz; one byte per box, nonzero if visible
+	void TestVisibility(const float* bounds, size_t count, uint8_t* visibility);
+
+	uint32_t GetWidth() const;
+	uint32_t GetHeight() const;
+	size_t GetOccluderTriangleCount() const;
+	const float* GetDepth() const;
+};
@@ -0,0 +1,90 @@
+#include "ParallelCommandRecorder.h"
+
+ParallelCommandRecorder::ParallelCommandRecorder(ThreadPool* threadPool, size_t drawsPerChunk)
+	: m_threadPool(threadPool), m_drawsPerChunk(1)
+{
+	SetDrawsPerChunk(drawsPerChunk);
+}
+
+uint32_t ParallelCommandRecorder::Record(const DrawItem* draws, size_t count, CommandListBackend& backend)
+{
+	const uint32_t chunkCount = static_cast<uint32_t>((count + m_drawsPerChunk - 1) / m_drawsPerChunk);
+	backend.BeginRecording(chunkCount);
+
+	const size_t drawsPerChunk = m_drawsPerChunk;
+	m_threadPool->ParallelFor(chunkCount, [&](size_t chunk, uint32_t threadIndex)
+	{
+		size_t first = chunk * drawsPerChunk;
+		size_t chunkSize = count - first < drawsPerChunk ? count - first : drawsPerChunk;
+		backend.RecordChunk(static_cast<uint32_t>(chunk), threadIndex, draws + first, chunkSize);
+	});
+
+	return chunkCount;
+}
+
+void ParallelCommandRecorder::SetDrawsPerChunk(size_t drawsPerChunk)
+{
+	m_drawsPerChunk = drawsPerChunk > 0 ? drawsPerChunk : 1;
+}
+
+namespace
+{
+	// packet headers of the recorded stream
+	const uint32_t SET_ROOT_CONSTANTS = 1;
+	const uint32_t DRAW_INDEXED_INSTANCED = 2;
+}
+
+RecordingCommandListBackend::RecordingCommandListBackend()
+	: m_chunkCount(0)
+{
+}
+
+void RecordingCommandListBackend::BeginRecording(uint32_t chunkCount)
+{
+	if (m_chunks.size() < chunkCount)
+	{
+		m_chunks.resize(chunkCount);
+	}
+	m_chunkCount = chunkCount;
+}
+
+void RecordingCommandListBackend::RecordChunk(uint32_t chunkIndex, uint32_t, const DrawItem* draws, size_t count)
+{
+	std::vector<uint32_t>& stream = m_chunks[chunkIndex];
+	stream.clear();
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const DrawItem& draw = draws[i];
+
+		stream.push_back(SET_ROOT_CONSTANTS);
+		stream.push_back(draw.objectIndex);
+
+		stream.push_back(DRAW_INDEXED_INSTANCED);
+		stream.push_back(draw.indexCount);
+		stream.push_back(1);
+		stream.push_back(draw.startIndex);
+		stream.push_back(static_cast<uint32_t>(draw.baseVertex));
+		stream.push_back(0);
+	}
+}
+
+size_t RecordingCommandListBackend::GetRecordedWords() const
+{
+	size_t words = 0;
+	for (uint32_t i = 0; i < m_chunkCount; ++i)
+	{
+		words += m_chunks[i].size();
+	}
+	return words;
+}
+
+const std::vector<uint32_t>& RecordingCommandListBackend::GetChunk(uint32_t chunkIndex) const
+{
+	return m_chunks[chunkIndex];
+}
+
+uint32_t RecordingCommandListBackend::GetChunkCount() const
+{
+	return m_chunkCount;
+}
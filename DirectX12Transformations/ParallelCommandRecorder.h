@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ThreadPool.h"
+
+struct DrawItem
+{
+	uint32_t indexCount;
+	uint32_t startIndex;
+	int32_t baseVertex;
+	uint32_t objectIndex;
+	uint32_t pipeline;	// indices into the renderer's pipeline and mesh tables
+	uint32_t mesh;
+};
+
+// Records one chunk of draws into its own command list. Called concurrently
+// from worker threads, chunkIndex decides the submission order.
+class CommandListBackend
+{
+public:
+	virtual ~CommandListBackend() {}
+
+	virtual void BeginRecording(uint32_t chunkCount) = 0;
+	virtual void RecordChunk(uint32_t chunkIndex, uint32_t threadIndex, const DrawItem* draws, size_t count) = 0;
+};
+
+// Splits the draw list into fixed size chunks and records them on the thread pool.
+class ParallelCommandRecorder
+{
+private:
+
+	ThreadPool* m_threadPool;
+	size_t m_drawsPerChunk;
+
+public:
+	ParallelCommandRecorder(ThreadPool* threadPool, size_t drawsPerChunk);
+
+	// returns the number of chunks, i.e. command lists to submit
+	uint32_t Record(const DrawItem* draws, size_t count, CommandListBackend& backend);
+
+	void SetDrawsPerChunk(size_t drawsPerChunk);
+};
+
+// Encodes draws into plain memory instead of a GPU command list, so recording
+// throughput can be measured without a device.
+class RecordingCommandListBackend : public CommandListBackend
+{
+private:
+
+	// one reusable command stream per chunk
+	std::vector<std::vector<uint32_t>> m_chunks;
+	uint32_t m_chunkCount;
+
+public:
+	RecordingCommandListBackend();
+
+	void BeginRecording(uint32_t chunkCount) override;
+	void RecordChunk(uint32_t chunkIndex, uint32_t threadIndex, const DrawItem* draws, size_t count) override;
+
+	// concatenated streams in submission order, as ExecuteCommandLists would see them
+	size_t GetRecordedWords() const;
+	const std::vector<uint32_t>& GetChunk(uint32_t chunkIndex) const;
+	uint32_t GetChunkCount() const;
+};
@@ -0,0 +1,126 @@
+#include <iterator>
+#include "RangeAllocator.h"
+
+RangeAllocator::RangeAllocator(uint32_t capacity)
+	: m_capacity(0), m_freeCount(0)
+{
+	Reset(capacity);
+}
+
+void RangeAllocator::Reset(uint32_t capacity)
+{
+	m_capacity = capacity;
+	ResetPacked(0);
+}
+
+void RangeAllocator::ResetPacked(uint32_t usedCount)
+{
+	m_freeByOffset.clear();
+	m_freeBySize.clear();
+	m_freeCount = 0;
+
+	if (usedCount < m_capacity)
+	{
+		InsertFree(usedCount, m_capacity - usedCount);
+	}
+}
+
+void RangeAllocator::InsertFree(uint32_t offset, uint32_t size)
+{
+	m_freeByOffset[offset] = size;
+	m_freeBySize.insert(std::make_pair(size, offset));
+	m_freeCount += size;
+}
+
+void RangeAllocator::EraseFree(std::map<uint32_t, uint32_t>::iterator it)
+{
+	auto range = m_freeBySize.equal_range(it->second);
+	for (auto sizeIt = range.first; sizeIt != range.second; ++sizeIt)
+	{
+		if (sizeIt->second == it->first)
+		{
+			m_freeBySize.erase(sizeIt);
+			break;
+		}
+	}
+
+	m_freeCount -= it->second;
+	m_freeByOffset.erase(it);
+}
+
+uint32_t RangeAllocator::Allocate(uint32_t size)
+{
+	if (size == 0)
+	{
+		return INVALID_OFFSET;
+	}
+
+	// smallest free range that fits keeps large ranges intact
+	auto sizeIt = m_freeBySize.lower_bound(size);
+	if (sizeIt == m_freeBySize.end())
+	{
+		return INVALID_OFFSET;
+	}
+
+	uint32_t offset = sizeIt->second;
+	uint32_t freeSize = sizeIt->first;
+	EraseFree(m_freeByOffset.find(offset));
+
+	if (freeSize > size)
+	{
+		InsertFree(offset + size, freeSize - size);
+	}
+
+	return offset;
+}
+
+void RangeAllocator::Free(uint32_t offset, uint32_t size)
+{
+	if (size == 0)
+	{
+		return;
+	}
+
+	auto next = m_freeByOffset.lower_bound(offset);
+
+	// merge with the free range that ends where this one starts
+	if (next != m_freeByOffset.begin())
+	{
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == offset)
+		{
+			offset = previous->first;
+			size += previous->second;
+			EraseFree(previous);
+		}
+	}
+
+	// and with the one that starts where it ends
+	if (next != m_freeByOffset.end() && offset + size == next->first)
+	{
+		size += next->second;
+		EraseFree(next);
+	}
+
+	InsertFree(offset, size);
+}
+
+uint32_t RangeAllocator::GetCapacity() const
+{
+	return m_capacity;
+}
+
+uint32_t RangeAllocator::GetFreeCount() const
+{
+	return m_freeCount;
+}
+
+uint32_t RangeAllocator::GetLargestFreeRange() const
+{
+	return m_freeBySize.empty() ? 0 : m_freeBySize.rbegin()->first;
+}
+
+size_t RangeAllocator::GetFreeRangeCount() const
+{
+	return m_freeByOffset.size();
+}
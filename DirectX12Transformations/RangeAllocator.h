@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+
+// Best-fit allocator over a linear range of elements, e.g. vertices in a
+// shared buffer. Freed ranges are merged with their neighbours. The caller
+// remembers the size of every allocation and passes it back to Free.
+class RangeAllocator
+{
+private:
+
+	std::map<uint32_t, uint32_t> m_freeByOffset;	// offset -> size
+	std::multimap<uint32_t, uint32_t> m_freeBySize;	// size -> offset
+	uint32_t m_capacity;
+	uint32_t m_freeCount;
+
+	void InsertFree(uint32_t offset, uint32_t size);
+	void EraseFree(std::map<uint32_t, uint32_t>::iterator it);
+
+public:
+	static const uint32_t INVALID_OFFSET = 0xffffffff;
+
+	explicit RangeAllocator(uint32_t capacity = 0);
+
+	// drops all allocations
+	void Reset(uint32_t capacity);
+	// everything below usedCount is allocated, the rest is one free range
+	void ResetPacked(uint32_t usedCount);
+
+	uint32_t Allocate(uint32_t size);
+	void Free(uint32_t offset, uint32_t size);
+
+	uint32_t GetCapacity() const;
+	uint32_t GetFreeCount() const;
+	uint32_t GetLargestFreeRange() const;
+	size_t GetFreeRangeCount() const;
+};
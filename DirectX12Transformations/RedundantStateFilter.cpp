@@ -0,0 +1,85 @@
+#include "RedundantStateFilter.h"
+
+namespace
+{
+	const int SLOT_COUNT = static_cast<int>(BindSlot::Count);
+}
+
+void BindCounts::Add(const BindCounts& other)
+{
+	for (int i = 0; i < SLOT_COUNT; ++i)
+	{
+		issued[i] += other.issued[i];
+		skipped[i] += other.skipped[i];
+	}
+}
+
+uint32_t BindCounts::GetIssued(BindSlot slot) const
+{
+	return issued[static_cast<int>(slot)];
+}
+
+uint32_t BindCounts::GetSkipped(BindSlot slot) const
+{
+	return skipped[static_cast<int>(slot)];
+}
+
+uint32_t BindCounts::GetTotalIssued() const
+{
+	uint32_t total = 0;
+	for (int i = 0; i < SLOT_COUNT; ++i)
+	{
+		total += issued[i];
+	}
+	return total;
+}
+
+RedundantStateFilter::RedundantStateFilter()
+{
+	Invalidate();
+	ResetCounts();
+}
+
+void RedundantStateFilter::Invalidate()
+{
+	for (int i = 0; i < SLOT_COUNT; ++i)
+	{
+		m_bound[i] = 0;
+		m_valid[i] = false;
+	}
+}
+
+void RedundantStateFilter::Assume(BindSlot slot, uint64_t value)
+{
+	m_bound[static_cast<int>(slot)] = value;
+	m_valid[static_cast<int>(slot)] = true;
+}
+
+bool RedundantStateFilter::Bind(BindSlot slot, uint64_t value)
+{
+	const int index = static_cast<int>(slot);
+	if (m_valid[index] && m_bound[index] == value)
+	{
+		++m_counts.skipped[index];
+		return false;
+	}
+
+	m_bound[index] = value;
+	m_valid[index] = true;
+	++m_counts.issued[index];
+	return true;
+}
+
+void RedundantStateFilter::ResetCounts()
+{
+	for (int i = 0; i < SLOT_COUNT; ++i)
+	{
+		m_counts.issued[i] = 0;
+		m_counts.skipped[i] = 0;
+	}
+}
+
+const BindCounts& RedundantStateFilter::GetCounts() const
+{
+	return m_counts;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+
+// state that a command list keeps until it is set again
+enum class BindSlot
+{
+	RootSignature,
+	PipelineState,
+	DescriptorHeaps,
+	VertexBuffer,
+	IndexBuffer,
+	Count
+};
+
+struct BindCounts
+{
+	uint32_t issued[static_cast<int>(BindSlot::Count)];
+	uint32_t skipped[static_cast<int>(BindSlot::Count)];
+
+	void Add(const BindCounts& other);
+	uint32_t GetIssued(BindSlot slot) const;
+	uint32_t GetSkipped(BindSlot slot) const;
+	uint32_t GetTotalIssued() const;
+};
+
+// Remembers the last value bound to every slot of one command list and tells
+// the caller whether a bind call changes anything. Values are opaque, usually
+// a pointer or a GPU address. One filter per recording thread.
+class RedundantStateFilter
+{
+private:
+
+	uint64_t m_bound[static_cast<int>(BindSlot::Count)];
+	bool m_valid[static_cast<int>(BindSlot::Count)];
+	BindCounts m_counts;
+
+public:
+	RedundantStateFilter();
+
+	// call for every new command list, nothing is bound yet
+	void Invalidate();
+	// state set by ID3D12GraphicsCommandList::Reset, e.g. the initial pipeline state
+	void Assume(BindSlot slot, uint64_t value);
+
+	// true if the bind call has to be issued
+	bool Bind(BindSlot slot, uint64_t value);
+
+	void ResetCounts();
+	const BindCounts& GetCounts() const;
+};
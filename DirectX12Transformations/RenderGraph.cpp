@@ -0,0 +1,499 @@
+#include <algorithm>
+#include "RenderGraph.h"
+
+namespace ResourceState
+{
+	bool IsReadOnly(uint32_t state)
+	{
+		const uint32_t writeStates = RenderTarget | UnorderedAccess | DepthWrite | CopyDest;
+		return state != Common && (state & writeStates) == 0;
+	}
+}
+
+void RecordingRenderGraphBackend::AllocateTransientHeap(uint64_t sizeInBytes)
+{
+	Event event = {};
+	event.type = Event::AllocateHeap;
+	event.value = sizeInBytes;
+	events.push_back(event);
+}
+
+void RecordingRenderGraphBackend::CreateTransient(RenderGraphResource resource, const TransientResourceDesc&, uint64_t heapOffset, uint32_t initialState)
+{
+	Event event = {};
+	event.type = Event::CreateTransient;
+	event.value = heapOffset;
+
+	RenderGraphBarrier state = {};
+	state.resource = resource;
+	state.stateAfter = initialState;
+	event.barriers.push_back(state);
+
+	events.push_back(event);
+}
+
+void RecordingRenderGraphBackend::ResourceBarriers(const RenderGraphBarrier* barriers, size_t count)
+{
+	Event event = {};
+	event.type = Event::Barriers;
+	event.barriers.assign(barriers, barriers + count);
+	events.push_back(event);
+}
+
+void RecordingRenderGraphBackend::BeginPass(const char* name)
+{
+	Event event = {};
+	event.type = Event::BeginPass;
+	event.name = name;
+	events.push_back(event);
+}
+
+size_t RecordingRenderGraphBackend::CountEvents(Event::Type type) const
+{
+	size_t count = 0;
+	for (const Event& event : events)
+	{
+		if (event.type == type)
+		{
+			++count;
+		}
+	}
+	return count;
+}
+
+RenderGraph::RenderGraph()
+	: m_finalBarrierBegin(0), m_transientHeapSize(0), m_compiled(false)
+{
+}
+
+void RenderGraph::Reset()
+{
+	m_resources.clear();
+	m_passes.clear();
+	m_barriers.clear();
+	m_finalBarrierBegin = 0;
+	m_transientHeapSize = 0;
+	m_compiled = false;
+}
+
+RenderGraphResource RenderGraph::ImportResource(const char* name, uint32_t initialState, uint32_t finalState)
+{
+	Resource resource = {};
+	resource.name = name;
+	resource.imported = true;
+	resource.initialState = initialState;
+	resource.finalState = finalState;
+
+	m_resources.push_back(resource);
+	return static_cast<RenderGraphResource>(m_resources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::CreateTransient(const char* name, const TransientResourceDesc& desc)
+{
+	Resource resource = {};
+	resource.name = name;
+	resource.imported = false;
+	resource.desc = desc;
+	if (resource.desc.alignment == 0)
+	{
+		resource.desc.alignment = 64 * 1024;
+	}
+
+	m_resources.push_back(resource);
+	return static_cast<RenderGraphResource>(m_resources.size() - 1);
+}
+
+RenderGraphPass RenderGraph::AddPass(const char* name, std::function<void()> execute, bool hasSideEffects)
+{
+	Pass pass = {};
+	pass.name = name;
+	pass.execute = execute;
+	pass.hasSideEffects = hasSideEffects;
+
+	m_passes.push_back(pass);
+	return static_cast<RenderGraphPass>(m_passes.size() - 1);
+}
+
+void RenderGraph::Read(RenderGraphPass pass, RenderGraphResource resource, uint32_t state)
+{
+	Access access = { resource, state, false };
+	m_passes[pass].accesses.push_back(access);
+}
+
+void RenderGraph::Write(RenderGraphPass pass, RenderGraphResource resource, uint32_t state)
+{
+	Access access = { resource, state, true };
+	m_passes[pass].accesses.push_back(access);
+}
+
+void RenderGraph::CullPasses()
+{
+	// walk backwards, a pass survives if it has side effects or writes something
+	// imported or used by a later surviving pass
+	std::vector<bool> needed(m_resources.size(), false);
+
+	for (size_t i = m_passes.size(); i-- > 0;)
+	{
+		Pass& pass = m_passes[i];
+		pass.alive = pass.hasSideEffects;
+
+		for (const Access& access : pass.accesses)
+		{
+			if (access.isWrite && (m_resources[access.resource].imported || needed[access.resource]))
+			{
+				pass.alive = true;
+			}
+		}
+
+		if (pass.alive)
+		{
+			// writes may be partial, so earlier contents are needed as well
+			for (const Access& access : pass.accesses)
+			{
+				needed[access.resource] = true;
+			}
+		}
+	}
+}
+
+void RenderGraph::ComputeLifetimes()
+{
+	for (Resource& resource : m_resources)
+	{
+		resource.firstPass = INVALID_INDEX;
+		resource.lastPass = INVALID_INDEX;
+	}
+
+	for (RenderGraphPass i = 0; i < m_passes.size(); ++i)
+	{
+		if (!m_passes[i].alive)
+		{
+			continue;
+		}
+
+		for (const Access& access : m_passes[i].accesses)
+		{
+			Resource& resource = m_resources[access.resource];
+			if (resource.firstPass == INVALID_INDEX)
+			{
+				resource.firstPass = i;
+			}
+			resource.lastPass = i;
+		}
+	}
+}
+
+void RenderGraph::AliasTransients()
+{
+	std::vector<RenderGraphResource> transients;
+	for (RenderGraphResource i = 0; i < m_resources.size(); ++i)
+	{
+		if (!m_resources[i].imported && m_resources[i].firstPass != INVALID_INDEX)
+		{
+			transients.push_back(i);
+		}
+	}
+
+	// biggest first keeps the first-fit placement tight
+	std::stable_sort(transients.begin(), transients.end(), [this](RenderGraphResource a, RenderGraphResource b)
+	{
+		return m_resources[a].desc.sizeInBytes > m_resources[b].desc.sizeInBytes;
+	});
+
+	std::vector<RenderGraphResource> placed;
+	m_transientHeapSize = 0;
+
+	for (RenderGraphResource index : transients)
+	{
+		Resource& resource = m_resources[index];
+		const uint64_t alignment = resource.desc.alignment;
+		const uint64_t size = resource.desc.sizeInBytes;
+
+		// candidate offsets are the heap start and the end of every live neighbour
+		std::vector<uint64_t> candidates(1, 0);
+		for (RenderGraphResource other : placed)
+		{
+			const Resource& placedResource = m_resources[other];
+			uint64_t end = placedResource.heapOffset + placedResource.desc.sizeInBytes;
+			candidates.push_back((end + alignment - 1) / alignment * alignment);
+		}
+		std::sort(candidates.begin(), candidates.end());
+
+		for (uint64_t offset : candidates)
+		{
+			bool fits = true;
+			for (RenderGraphResource other : placed)
+			{
+				const Resource& placedResource = m_resources[other];
+				bool livesOverlap = resource.firstPass <= placedResource.lastPass && placedResource.firstPass <= resource.lastPass;
+				bool memoryOverlaps = offset < placedResource.heapOffset + placedResource.desc.sizeInBytes && placedResource.heapOffset < offset + size;
+				if (livesOverlap && memoryOverlaps)
+				{
+					fits = false;
+					break;
+				}
+			}
+
+			if (fits)
+			{
+				resource.heapOffset = offset;
+				break;
+			}
+		}
+
+		placed.push_back(index);
+		m_transientHeapSize = std::max(m_transientHeapSize, resource.heapOffset + size);
+	}
+}
+
+uint32_t RenderGraph::GetRequiredState(const Pass& pass, RenderGraphResource resource) const
+{
+	uint32_t state = 0;
+	bool hasWrite = false;
+	for (const Access& access : pass.accesses)
+	{
+		if (access.resource != resource)
+		{
+			continue;
+		}
+
+		if (access.isWrite)
+		{
+			state = access.state;
+			hasWrite = true;
+		}
+		else if (!hasWrite)
+		{
+			state |= access.state;
+		}
+	}
+	return state;
+}
+
+void RenderGraph::ComputeBarriers()
+{
+	m_barriers.clear();
+
+	// Transients are created in the state of their last use, which is also the
+	// state every execution leaves them in, so each frame starts from the same
+	// states and the compiled barriers stay valid when Execute runs again.
+	std::vector<uint32_t> currentState(m_resources.size());
+	for (RenderGraphResource i = 0; i < m_resources.size(); ++i)
+	{
+		Resource& resource = m_resources[i];
+		if (!resource.imported && resource.lastPass != INVALID_INDEX)
+		{
+			resource.initialState = GetRequiredState(m_passes[resource.lastPass], i);
+		}
+		currentState[i] = resource.initialState;
+	}
+
+	std::vector<uint32_t> requiredState(m_resources.size());
+	std::vector<bool> hasWrite(m_resources.size());
+
+	for (RenderGraphPass i = 0; i < m_passes.size(); ++i)
+	{
+		Pass& pass = m_passes[i];
+		pass.barrierBegin = m_barriers.size();
+		pass.barrierCount = 0;
+
+		if (!pass.alive)
+		{
+			continue;
+		}
+
+		// reads in several states are combined, a write state wins
+		for (const Access& access : pass.accesses)
+		{
+			requiredState[access.resource] = 0;
+			hasWrite[access.resource] = false;
+		}
+		for (const Access& access : pass.accesses)
+		{
+			if (access.isWrite)
+			{
+				requiredState[access.resource] = access.state;
+				hasWrite[access.resource] = true;
+			}
+			else if (!hasWrite[access.resource])
+			{
+				requiredState[access.resource] |= access.state;
+			}
+		}
+
+		for (const Access& access : pass.accesses)
+		{
+			RenderGraphResource index = access.resource;
+			Resource& resource = m_resources[index];
+
+			// memory previously used by another transient, earlier in this frame
+			// or, for the first user of the memory, at the end of the previous one
+			if (!resource.imported && resource.firstPass == i && requiredState[index] != INVALID_INDEX)
+			{
+				const RenderGraphPass passCount = static_cast<RenderGraphPass>(m_passes.size());
+				RenderGraphResource previous = INVALID_INDEX;
+				RenderGraphPass previousDistance = 0;
+				for (RenderGraphResource other = 0; other < m_resources.size(); ++other)
+				{
+					const Resource& otherResource = m_resources[other];
+					if (other == index || otherResource.imported || otherResource.firstPass == INVALID_INDEX)
+					{
+						continue;
+					}
+
+					bool memoryOverlaps = resource.heapOffset < otherResource.heapOffset + otherResource.desc.sizeInBytes &&
+						otherResource.heapOffset < resource.heapOffset + resource.desc.sizeInBytes;
+					if (!memoryOverlaps)
+					{
+						continue;
+					}
+
+					// overlapping memory means disjoint lifetimes, so lastPass != i
+					RenderGraphPass distance = otherResource.lastPass < i ? i - otherResource.lastPass : i + passCount - otherResource.lastPass;
+					if (previous == INVALID_INDEX || distance < previousDistance)
+					{
+						previous = other;
+						previousDistance = distance;
+					}
+				}
+
+				if (previous != INVALID_INDEX)
+				{
+					RenderGraphBarrier barrier = {};
+					barrier.type = RenderGraphBarrier::Aliasing;
+					barrier.resource = index;
+					barrier.resourceBefore = previous;
+					m_barriers.push_back(barrier);
+				}
+			}
+
+			uint32_t required = requiredState[index];
+			// mark handled so duplicate accesses in the same pass are skipped
+			requiredState[index] = INVALID_INDEX;
+
+			if (required == INVALID_INDEX)
+			{
+				continue;
+			}
+
+			uint32_t current = currentState[index];
+			if (required == current)
+			{
+				continue;
+			}
+
+			if (ResourceState::IsReadOnly(required) && ResourceState::IsReadOnly(current) && (current & required) == required)
+			{
+				continue;
+			}
+
+			RenderGraphBarrier barrier = {};
+			barrier.type = RenderGraphBarrier::Transition;
+			barrier.resource = index;
+			barrier.resourceBefore = INVALID_INDEX;
+			barrier.stateBefore = current;
+			barrier.stateAfter = required;
+			m_barriers.push_back(barrier);
+
+			currentState[index] = required;
+		}
+
+		pass.barrierCount = m_barriers.size() - pass.barrierBegin;
+	}
+
+	// hand imported resources back in the state the caller expects,
+	// transients already are in the state they were created in
+	m_finalBarrierBegin = m_barriers.size();
+	for (RenderGraphResource i = 0; i < m_resources.size(); ++i)
+	{
+		const Resource& resource = m_resources[i];
+		if (resource.imported && currentState[i] != resource.finalState)
+		{
+			RenderGraphBarrier barrier = {};
+			barrier.type = RenderGraphBarrier::Transition;
+			barrier.resource = i;
+			barrier.resourceBefore = INVALID_INDEX;
+			barrier.stateBefore = currentState[i];
+			barrier.stateAfter = resource.finalState;
+			m_barriers.push_back(barrier);
+		}
+	}
+}
+
+void RenderGraph::Compile()
+{
+	CullPasses();
+	ComputeLifetimes();
+	AliasTransients();
+	ComputeBarriers();
+	m_compiled = true;
+}
+
+void RenderGraph::Realize(RenderGraphBackend& backend)
+{
+	if (m_transientHeapSize > 0)
+	{
+		backend.AllocateTransientHeap(m_transientHeapSize);
+	}
+
+	for (RenderGraphResource i = 0; i < m_resources.size(); ++i)
+	{
+		const Resource& resource = m_resources[i];
+		if (!resource.imported && resource.firstPass != INVALID_INDEX)
+		{
+			backend.CreateTransient(i, resource.desc, resource.heapOffset, resource.initialState);
+		}
+	}
+}
+
+void RenderGraph::Execute(RenderGraphBackend& backend)
+{
+	if (!m_compiled)
+	{
+		Compile();
+	}
+
+	for (Pass& pass : m_passes)
+	{
+		if (!pass.alive)
+		{
+			continue;
+		}
+
+		backend.BeginPass(pass.name.c_str());
+		if (pass.barrierCount > 0)
+		{
+			backend.ResourceBarriers(&m_barriers[pass.barrierBegin], pass.barrierCount);
+		}
+
+		if (pass.execute)
+		{
+			pass.execute();
+		}
+	}
+
+	if (m_barriers.size() > m_finalBarrierBegin)
+	{
+		backend.ResourceBarriers(&m_barriers[m_finalBarrierBegin], m_barriers.size() - m_finalBarrierBegin);
+	}
+}
+
+bool RenderGraph::IsPassAlive(RenderGraphPass pass) const
+{
+	return m_passes[pass].alive;
+}
+
+uint64_t RenderGraph::GetTransientHeapSize() const
+{
+	return m_transientHeapSize;
+}
+
+uint64_t RenderGraph::GetTransientOffset(RenderGraphResource resource) const
+{
+	return m_resources[resource].heapOffset;
+}
+
+size_t RenderGraph::GetBarrierCount() const
+{
+	return m_barriers.size();
+}
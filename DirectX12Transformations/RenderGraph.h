@@ -0,0 +1,173 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Frame graph: passes declare which resources they read and write, Compile
+// culls passes whose results are never used, computes the minimal state
+// transitions batched into one barrier call per pass and aliases transient
+// resources with non-overlapping lifetimes in one heap. Compilation is pure
+// CPU code, the API calls are made by a RenderGraphBackend.
+
+typedef uint32_t RenderGraphResource;
+typedef uint32_t RenderGraphPass;
+
+// same bit values as D3D12_RESOURCE_STATES, so backends can cast directly
+namespace ResourceState
+{
+	const uint32_t Common = 0;
+	const uint32_t Present = 0;
+	const uint32_t VertexAndConstantBuffer = 0x1;
+	const uint32_t IndexBuffer = 0x2;
+	const uint32_t RenderTarget = 0x4;
+	const uint32_t UnorderedAccess = 0x8;
+	const uint32_t DepthWrite = 0x10;
+	const uint32_t DepthRead = 0x20;
+	const uint32_t NonPixelShaderResource = 0x40;
+	const uint32_t PixelShaderResource = 0x80;
+	const uint32_t CopyDest = 0x400;
+	const uint32_t CopySource = 0x800;
+
+	bool IsReadOnly(uint32_t state);
+}
+
+struct TransientResourceDesc
+{
+	uint64_t sizeInBytes;	// filled in by the backend for textures, see D3D12RenderGraphBackend
+	uint64_t alignment;
+	uint32_t width;
+	uint32_t height;
+	uint32_t format;	// DXGI_FORMAT
+	uint32_t flags;	// D3D12_RESOURCE_FLAGS
+	bool isTexture;
+};
+
+struct RenderGraphBarrier
+{
+	enum Type
+	{
+		Transition,
+		Aliasing
+	};
+
+	Type type;
+	RenderGraphResource resource;
+	RenderGraphResource resourceBefore;	// aliasing only, previous user of the memory
+	uint32_t stateBefore;
+	uint32_t stateAfter;
+};
+
+class RenderGraphBackend
+{
+public:
+	virtual ~RenderGraphBackend() {}
+
+	virtual void AllocateTransientHeap(uint64_t sizeInBytes) = 0;
+	virtual void CreateTransient(RenderGraphResource resource, const TransientResourceDesc& desc, uint64_t heapOffset, uint32_t initialState) = 0;
+	virtual void ResourceBarriers(const RenderGraphBarrier* barriers, size_t count) = 0;
+	virtual void BeginPass(const char*) {}
+};
+
+// Backend that only records what it was asked to do, for testing graph compilation.
+class RecordingRenderGraphBackend : public RenderGraphBackend
+{
+public:
+	struct Event
+	{
+		enum Type
+		{
+			AllocateHeap,
+			CreateTransient,
+			Barriers,
+			BeginPass
+		};
+
+		Type type;
+		std::string name;
+		uint64_t value;	// heap size or offset
+		std::vector<RenderGraphBarrier> barriers;
+	};
+
+	std::vector<Event> events;
+
+	void AllocateTransientHeap(uint64_t sizeInBytes) override;
+	void CreateTransient(RenderGraphResource resource, const TransientResourceDesc& desc, uint64_t heapOffset, uint32_t initialState) override;
+	void ResourceBarriers(const RenderGraphBarrier* barriers, size_t count) override;
+	void BeginPass(const char* name) override;
+
+	size_t CountEvents(Event::Type type) const;
+};
+
+class RenderGraph
+{
+private:
+
+	struct Resource
+	{
+		std::string name;
+		bool imported;
+		uint32_t initialState;	// for transients the state of their last use
+		uint32_t finalState;	// imported only
+		TransientResourceDesc desc;	// transient only
+		uint64_t heapOffset;
+		RenderGraphPass firstPass;
+		RenderGraphPass lastPass;
+	};
+
+	struct Access
+	{
+		RenderGraphResource resource;
+		uint32_t state;
+		bool isWrite;
+	};
+
+	struct Pass
+	{
+		std::string name;
+		std::function<void()> execute;
+		bool hasSideEffects;
+		std::vector<Access> accesses;
+		bool alive;
+		size_t barrierBegin;
+		size_t barrierCount;
+	};
+
+	std::vector<Resource> m_resources;
+	std::vector<Pass> m_passes;
+	std::vector<RenderGraphBarrier> m_barriers;
+	size_t m_finalBarrierBegin;
+	uint64_t m_transientHeapSize;
+	bool m_compiled;
+
+	void CullPasses();
+	void ComputeLifetimes();
+	void AliasTransients();
+	uint32_t GetRequiredState(const Pass& pass, RenderGraphResource resource) const;
+	void ComputeBarriers();
+
+public:
+	static const uint32_t INVALID_INDEX = 0xffffffff;
+
+	RenderGraph();
+
+	void Reset();
+
+	RenderGraphResource ImportResource(const char* name, uint32_t initialState, uint32_t finalState);
+	RenderGraphResource CreateTransient(const char* name, const TransientResourceDesc& desc);
+
+	RenderGraphPass AddPass(const char* name, std::function<void()> execute, bool hasSideEffects = false);
+	void Read(RenderGraphPass pass, RenderGraphResource resource, uint32_t state);
+	void Write(RenderGraphPass pass, RenderGraphResource resource, uint32_t state);
+
+	void Compile();
+	// creates the transient heap and placed resources, once after Compile
+	void Realize(RenderGraphBackend& backend);
+	void Execute(RenderGraphBackend& backend);
+
+	bool IsPassAlive(RenderGraphPass pass) const;
+	uint64_t GetTransientHeapSize() const;
+	uint64_t GetTransientOffset(RenderGraphResource resource) const;
+	size_t GetBarrierCount() const;
+};
@@ -0,0 +1,109 @@
+#include "ResolutionController.h"
+#include <cmath>
+
+namespace
+{
+	const float FILTER_WEIGHT = 0.3f;	// of a new measurement, more recovers faster from a load drop but follows noise
+	const float SPIKE_RATIO = 1.2f;	// over budget by this much skips the filter
+	const float HEADROOM = 0.95f;	// aims a little below the budget
+	const float RAISE_THRESHOLD = 1.03f;	// smaller increases are not worth a change
+	const float LOWER_THRESHOLD = 0.99f;
+	const float MAX_RAISE = 1.1f;	// per update
+
+	float Clamp(float value, float minimum, float maximum)
+	{
+		return value < minimum ? minimum : (value > maximum ? maximum : value);
+	}
+}
+
+ResolutionController::ResolutionController(float targetMs, float minScale, float maxScale, size_t traceCapacity)
+	: m_targetMs(targetMs), m_minScale(minScale), m_maxScale(maxScale), m_scale(maxScale),
+	m_costPerArea(0.0f), m_hasMeasurement(false),
+	m_trace(traceCapacity > 0 ? traceCapacity : 1), m_traceNext(0), m_traceCount(0)
+{
+}
+
+void ResolutionController::SetTarget(float targetMs)
+{
+	m_targetMs = targetMs;
+}
+
+float ResolutionController::GetTarget() const
+{
+	return m_targetMs;
+}
+
+float ResolutionController::Update(float gpuMs, float renderedScale)
+{
+	if (gpuMs <= 0.0f || renderedScale <= 0.0f)
+	{
+		return m_scale;
+	}
+
+	// pixel shading and fill rate cost scale with the area
+	float area = renderedScale * renderedScale;
+	float costPerArea = gpuMs / area;
+	if (!m_hasMeasurement || gpuMs > m_targetMs * SPIKE_RATIO)
+	{
+		m_costPerArea = m_hasMeasurement && costPerArea < m_costPerArea ? m_costPerArea : costPerArea;
+		m_hasMeasurement = true;
+	}
+	else
+	{
+		m_costPerArea += (costPerArea - m_costPerArea) * FILTER_WEIGHT;
+	}
+
+	float desired = sqrtf(m_targetMs * HEADROOM / m_costPerArea);
+	desired = Clamp(desired, m_minScale, m_maxScale);
+
+	if (desired < m_scale * LOWER_THRESHOLD)
+	{
+		m_scale = desired;
+	}
+	else if (desired > m_scale * RAISE_THRESHOLD || (desired > m_scale && desired == m_maxScale))
+	{
+		m_scale = desired < m_scale * MAX_RAISE ? desired : m_scale * MAX_RAISE;
+	}
+
+	ResolutionSample& sample = m_trace[m_traceNext];
+	sample.gpuMs = gpuMs;
+	sample.predictedMs = m_costPerArea * m_scale * m_scale;
+	sample.scale = m_scale;
+	m_traceNext = (m_traceNext + 1) % m_trace.size();
+	m_traceCount = m_traceCount < m_trace.size() ? m_traceCount + 1 : m_traceCount;
+
+	return m_scale;
+}
+
+float ResolutionController::GetScale() const
+{
+	return m_scale;
+}
+
+void ResolutionController::Reset(float scale)
+{
+	m_scale = Clamp(scale, m_minScale, m_maxScale);
+	m_hasMeasurement = false;
+	m_traceNext = 0;
+	m_traceCount = 0;
+}
+
+void ResolutionController::GetRenderSize(uint32_t maxWidth, uint32_t maxHeight, uint32_t* width, uint32_t* height) const
+{
+	uint32_t scaledWidth = static_cast<uint32_t>(maxWidth * m_scale + 0.5f) & ~1u;
+	uint32_t scaledHeight = static_cast<uint32_t>(maxHeight * m_scale + 0.5f) & ~1u;
+
+	*width = scaledWidth < 8 ? (maxWidth < 8 ? maxWidth : 8) : scaledWidth;
+	*height = scaledHeight < 8 ? (maxHeight < 8 ? maxHeight : 8) : scaledHeight;
+}
+
+size_t ResolutionController::GetTraceCount() const
+{
+	return m_traceCount;
+}
+
+const ResolutionSample& ResolutionController::GetTraceSample(size_t index) const
+{
+	size_t first = m_traceCount < m_trace.size() ? 0 : m_traceNext;
+	return m_trace[(first + index) % m_trace.size()];
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct ResolutionSample
+{
+	float gpuMs;	// as measured
+	float predictedMs;	// filtered cost at full resolution times scale squared
+	float scale;	// chosen for the next frame
+};
+
+// Picks the render resolution scale that keeps the GPU frame time within a budget.
+// Measurements are normalized by the pixel count they were taken at, so the filter
+// does not have to relearn the cost after every change; the remaining error from
+// fixed costs shrinks on every step. Decreases are applied at once, increases only
+// when the headroom is clear, so noise does not make the resolution oscillate.
+class ResolutionController
+{
+private:
+
+	float m_targetMs;
+	float m_minScale;
+	float m_maxScale;
+	float m_scale;
+	float m_costPerArea;	// filtered ms at scale 1
+	bool m_hasMeasurement;
+
+	std::vector<ResolutionSample> m_trace;	// ring buffer, allocated once
+	size_t m_traceNext;
+	size_t m_traceCount;
+
+public:
+	explicit ResolutionController(float targetMs = 14.0f, float minScale = 0.5f, float maxScale = 1.0f, size_t traceCapacity = 512);
+
+	void SetTarget(float targetMs);
+	float GetTarget() const;
+
+	// gpuMs was measured on a frame drawn at renderedScale, which need not be the
+	// current scale when frames are pipelined, returns the scale for the next frame
+	float Update(float gpuMs, float renderedScale);
+	float GetScale() const;
+	void Reset(float scale);
+
+	// scaled size, even and at least 8 pixels in each direction
+	void GetRenderSize(uint32_t maxWidth, uint32_t maxHeight, uint32_t* width, uint32_t* height) const;
+
+	// oldest first
+	size_t GetTraceCount() const;
+	const ResolutionSample& GetTraceSample(size_t index) const;
+};
@@ -0,0 +1,201 @@
+#include "stdafx.h"
+#include <algorithm>
+#include <wrl.h>
+#include "RootSignatureBuilder.h"
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	// root signature cost of each parameter type, in DWORDs
+	const UINT DESCRIPTOR_TABLE_COST = 1;
+	const UINT ROOT_DESCRIPTOR_COST = 2;
+}
+
+RootSignatureBuilder::RootSignatureBuilder(UINT budget)
+	: m_budget(budget < MAX_ROOT_SIGNATURE_DWORDS ? budget : MAX_ROOT_SIGNATURE_DWORDS)
+{
+}
+
+UINT RootSignatureBuilder::AddConstantBuffer(UINT shaderRegister, UINT sizeInBytes, UpdateFrequency frequency,
+	D3D12_SHADER_VISIBILITY visibility, UINT registerSpace)
+{
+	Parameter parameter = {};
+	parameter.shaderRegister = shaderRegister;
+	parameter.registerSpace = registerSpace;
+	parameter.num32BitValues = (sizeInBytes + 3) / 4;
+	parameter.frequency = frequency;
+	parameter.visibility = visibility;
+	parameter.rangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
+	parameter.numDescriptors = 1;
+
+	m_parameters.push_back(parameter);
+	return static_cast<UINT>(m_parameters.size() - 1);
+}
+
+UINT RootSignatureBuilder::AddDescriptorTable(D3D12_DESCRIPTOR_RANGE_TYPE rangeType, UINT numDescriptors, UINT baseShaderRegister,
+	D3D12_SHADER_VISIBILITY visibility, UINT registerSpace)
+{
+	Parameter parameter = {};
+	parameter.shaderRegister = baseShaderRegister;
+	parameter.registerSpace = registerSpace;
+	parameter.frequency = UpdateFrequency::Static;
+	parameter.visibility = visibility;
+	parameter.rangeType = rangeType;
+	parameter.numDescriptors = numDescriptors;
+
+	m_parameters.push_back(parameter);
+	return static_cast<UINT>(m_parameters.size() - 1);
+}
+
+void RootSignatureBuilder::AddStaticSampler(const D3D12_STATIC_SAMPLER_DESC& desc)
+{
+	m_staticSamplers.push_back(desc);
+}
+
+void RootSignatureBuilder::AssignParameterTypes()
+{
+	// start from the cheapest binding every parameter can always use
+	UINT size = 0;
+	for (Parameter& parameter : m_parameters)
+	{
+		if (parameter.frequency == UpdateFrequency::Static)
+		{
+			parameter.type = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+			size += DESCRIPTOR_TABLE_COST;
+		}
+		else
+		{
+			parameter.type = D3D12_ROOT_PARAMETER_TYPE_CBV;
+			size += ROOT_DESCRIPTOR_COST;
+		}
+	}
+
+	// promote per-draw data to root constants, smallest first, while the budget allows
+	std::vector<Parameter*> perDraw;
+	for (Parameter& parameter : m_parameters)
+	{
+		if (parameter.frequency == UpdateFrequency::PerDraw)
+		{
+			perDraw.push_back(&parameter);
+		}
+	}
+
+	std::stable_sort(perDraw.begin(), perDraw.end(), [](const Parameter* a, const Parameter* b)
+	{
+		return a->num32BitValues < b->num32BitValues;
+	});
+
+	for (Parameter* parameter : perDraw)
+	{
+		UINT inlinedSize = size - ROOT_DESCRIPTOR_COST + parameter->num32BitValues;
+		if (inlinedSize > m_budget)
+		{
+			break;
+		}
+
+		parameter->type = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+		size = inlinedSize;
+	}
+}
+
+void RootSignatureBuilder::AssignRootIndices()
+{
+	// frequently changing parameters go first
+	const D3D12_ROOT_PARAMETER_TYPE order[] =
+	{
+		D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS,
+		D3D12_ROOT_PARAMETER_TYPE_CBV,
+		D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE
+	};
+
+	UINT rootIndex = 0;
+	for (D3D12_ROOT_PARAMETER_TYPE type : order)
+	{
+		for (Parameter& parameter : m_parameters)
+		{
+			if (parameter.type == type)
+			{
+				parameter.rootIndex = rootIndex++;
+			}
+		}
+	}
+}
+
+HRESULT RootSignatureBuilder::Build(ID3D12Device* device, D3D12_ROOT_SIGNATURE_FLAGS flags, ID3D12RootSignature** ppRootSignature)
+{
+	AssignParameterTypes();
+	AssignRootIndices();
+
+	std::vector<CD3DX12_ROOT_PARAMETER> rootParameters(m_parameters.size());
+	m_ranges.clear();
+	m_ranges.reserve(m_parameters.size());
+
+	for (const Parameter& parameter : m_parameters)
+	{
+		CD3DX12_ROOT_PARAMETER& rootParameter = rootParameters[parameter.rootIndex];
+
+		switch (parameter.type)
+		{
+		case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+			rootParameter.InitAsConstants(parameter.num32BitValues, parameter.shaderRegister, parameter.registerSpace, parameter.visibility);
+			break;
+		case D3D12_ROOT_PARAMETER_TYPE_CBV:
+			rootParameter.InitAsConstantBufferView(parameter.shaderRegister, parameter.registerSpace, parameter.visibility);
+			break;
+		default:
+			m_ranges.push_back(CD3DX12_DESCRIPTOR_RANGE(parameter.rangeType, parameter.numDescriptors, parameter.shaderRegister, parameter.registerSpace));
+			rootParameter.InitAsDescriptorTable(1, &m_ranges.back(), parameter.visibility);
+			break;
+		}
+	}
+
+	CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc;
+	rootSignatureDesc.Init(static_cast<UINT>(rootParameters.size()), rootParameters.data(),
+		static_cast<UINT>(m_staticSamplers.size()), m_staticSamplers.data(), flags);
+
+	ComPtr<ID3DBlob> signature;
+	HRESULT hr = D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signature, nullptr);
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	return device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(ppRootSignature));
+}
+
+UINT RootSignatureBuilder::GetRootIndex(UINT id) const
+{
+	return m_parameters[id].rootIndex;
+}
+
+D3D12_ROOT_PARAMETER_TYPE RootSignatureBuilder::GetParameterType(UINT id) const
+{
+	return m_parameters[id].type;
+}
+
+UINT RootSignatureBuilder::GetNum32BitValues(UINT id) const
+{
+	return m_parameters[id].num32BitValues;
+}
+
+UINT RootSignatureBuilder::GetSizeInDwords() const
+{
+	UINT size = 0;
+	for (const Parameter& parameter : m_parameters)
+	{
+		switch (parameter.type)
+		{
+		case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+			size += parameter.num32BitValues;
+			break;
+		case D3D12_ROOT_PARAMETER_TYPE_CBV:
+			size += ROOT_DESCRIPTOR_COST;
+			break;
+		default:
+			size += DESCRIPTOR_TABLE_COST;
+			break;
+		}
+	}
+	return size;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <d3d12.h>
+#include "d3dx12.h"
+#include <vector>
+
+// how often the data behind a root parameter changes
+enum class UpdateFrequency
+{
+	PerDraw,	// different for every draw call
+	PerFrame,	// written once per frame, lives in an upload heap
+	Static		// written once, referenced through a descriptor table
+};
+
+// Collects constant buffer parameters and decides for each one whether it is
+// bound as root constants, as a root descriptor or through a descriptor table.
+// Per-draw data is pushed inline with SetGraphicsRoot32BitConstants as long as
+// the whole signature stays within the root signature budget.
+class RootSignatureBuilder
+{
+private:
+
+	struct Parameter
+	{
+		UINT shaderRegister;
+		UINT registerSpace;
+		UINT num32BitValues;
+		UpdateFrequency frequency;
+		D3D12_SHADER_VISIBILITY visibility;
+		D3D12_DESCRIPTOR_RANGE_TYPE rangeType;
+		UINT numDescriptors;
+		D3D12_ROOT_PARAMETER_TYPE type;
+		UINT rootIndex;
+	};
+
+	UINT m_budget;	// in DWORDs, 64 is the hardware limit
+	std::vector<Parameter> m_parameters;
+	std::vector<D3D12_DESCRIPTOR_RANGE> m_ranges;
+	std::vector<D3D12_STATIC_SAMPLER_DESC> m_staticSamplers;
+
+	void AssignParameterTypes();
+	void AssignRootIndices();
+
+public:
+	static const UINT MAX_ROOT_SIGNATURE_DWORDS = 64;
+
+	explicit RootSignatureBuilder(UINT budget = MAX_ROOT_SIGNATURE_DWORDS);
+
+	// returns id used to query root index and parameter type after Build
+	UINT AddConstantBuffer(UINT shaderRegister, UINT sizeInBytes, UpdateFrequency frequency,
+		D3D12_SHADER_VISIBILITY visibility, UINT registerSpace = 0);
+
+	// always bound as a descriptor table, e.g. a bindless range over the whole heap
+	UINT AddDescriptorTable(D3D12_DESCRIPTOR_RANGE_TYPE rangeType, UINT numDescriptors, UINT baseShaderRegister,
+		D3D12_SHADER_VISIBILITY visibility, UINT registerSpace = 0);
+
+	// baked into the signature, costs no root space
+	void AddStaticSampler(const D3D12_STATIC_SAMPLER_DESC& desc);
+
+	HRESULT Build(ID3D12Device* device, D3D12_ROOT_SIGNATURE_FLAGS flags, ID3D12RootSignature** ppRootSignature);
+
+	UINT GetRootIndex(UINT id) const;
+	D3D12_ROOT_PARAMETER_TYPE GetParameterType(UINT id) const;
+	UINT GetNum32BitValues(UINT id) const;
+	UINT GetSizeInDwords() const;
+};
@@ -0,0 +1,389 @@
+#include <cmath>
+#include <utility>
+#include "SceneGenerator.h"
+#include "TransformCore.h"
+
+using namespace DirectX;
+
+namespace
+{
+	uint32_t NextRandom(uint32_t& state)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+	float RandomRange(uint32_t& state, float minimum, float maximum)
+	{
+		return minimum + (NextRandom(state) >> 8) * ((maximum - minimum) / 16777216.0f);
+	}
+
+	void AddVertex(ProceduralMesh& mesh, float x, float y, float z, const float color[4])
+	{
+		SceneVertex vertex = { { x, y, z }, { color[0], color[1], color[2], color[3] } };
+		mesh.vertices.push_back(vertex);
+	}
+
+	void AddTriangle(ProceduralMesh& mesh, uint32_t a, uint32_t b, uint32_t c)
+	{
+		mesh.indices.push_back(a);
+		mesh.indices.push_back(b);
+		mesh.indices.push_back(c);
+	}
+
+	// The primitives are convex around the origin, so a triangle faces out
+	// when its centroid and normal agree. Every triangle is turned to the
+	// cube's winding, whose normal cross(b - a, c - a) points inwards.
+	void MatchCubeWinding(ProceduralMesh& mesh)
+	{
+		for (size_t i = 0; i < mesh.indices.size(); i += 3)
+		{
+			const float* a = mesh.vertices[mesh.indices[i]].pos;
+			const float* b = mesh.vertices[mesh.indices[i + 1]].pos;
+			const float* c = mesh.vertices[mesh.indices[i + 2]].pos;
+			XMVECTOR va = XMVectorSet(a[0], a[1], a[2], 0.0f);
+			XMVECTOR vb = XMVectorSet(b[0], b[1], b[2], 0.0f);
+			XMVECTOR vc = XMVectorSet(c[0], c[1], c[2], 0.0f);
+
+			XMVECTOR normal = XMVector3Cross(vb - va, vc - va);
+			if (XMVectorGetX(XMVector3Dot(normal, va + vb + vc)) > 0.0f)
+			{
+				std::swap(mesh.indices[i + 1], mesh.indices[i + 2]);
+			}
+		}
+	}
+
+	void BuildCube(ProceduralMesh& mesh, const float color[4])
+	{
+		// the cube of CreateVertexBuffer
+		AddVertex(mesh, -0.5f, -0.5f, -0.5f, color);
+		AddVertex(mesh, 0.5f, -0.5f, -0.5f, color);
+		AddVertex(mesh, 0.5f, 0.5f, -0.5f, color);
+		AddVertex(mesh, -0.5f, 0.5f, -0.5f, color);
+		AddVertex(mesh, -0.5f, -0.5f, 0.5f, color);
+		AddVertex(mesh, 0.5f, -0.5f, 0.5f, color);
+		AddVertex(mesh, 0.5f, 0.5f, 0.5f, color);
+		AddVertex(mesh, -0.5f, 0.5f, 0.5f, color);
+
+		const uint32_t indices[] = {
+			0, 1, 2, 0, 2, 3,
+			4, 7, 6, 4, 6, 5,
+			0, 3, 7, 0, 7, 4,
+			1, 6, 2, 1, 5, 6,
+			3, 6, 7, 3, 2, 6,
+			0, 4, 5, 0, 5, 1
+		};
+		mesh.indices.assign(indices, indices + sizeof(indices) / sizeof(indices[0]));
+	}
+
+	void BuildSphere(ProceduralMesh& mesh, const float color[4])
+	{
+		const uint32_t rings = 8;
+		const uint32_t segments = 16;
+
+		for (uint32_t ring = 0; ring <= rings; ++ring)
+		{
+			float theta = XM_PI * ring / rings;
+			for (uint32_t segment = 0; segment <= segments; ++segment)
+			{
+				float phi = XM_2PI * segment / segments;
+				AddVertex(mesh, 0.5f * sinf(theta) * cosf(phi), 0.5f * cosf(theta), 0.5f * sinf(theta) * sinf(phi), color);
+			}
+		}
+
+		// the pole rows need one triangle per segment
+		for (uint32_t ring = 0; ring < rings; ++ring)
+		{
+			for (uint32_t segment = 0; segment < segments; ++segment)
+			{
+				uint32_t corner = ring * (segments + 1) + segment;
+				uint32_t below = corner + segments + 1;
+				if (ring > 0)
+				{
+					AddTriangle(mesh, corner, corner + 1, below + 1);
+				}
+				if (ring < rings - 1)
+				{
+					AddTriangle(mesh, corner, below + 1, below);
+				}
+			}
+		}
+	}
+
+	void BuildCylinder(ProceduralMesh& mesh, const float color[4])
+	{
+		const uint32_t segments = 16;
+
+		// the side and the caps have their own rims, bottom and top alternating
+		for (uint32_t rim = 0; rim < 4; ++rim)
+		{
+			float y = (rim & 1) ? 0.5f : -0.5f;
+			for (uint32_t segment = 0; segment < segments; ++segment)
+			{
+				float phi = XM_2PI * segment / segments;
+				AddVertex(mesh, 0.5f * cosf(phi), y, 0.5f * sinf(phi), color);
+			}
+		}
+		uint32_t bottomCenter = static_cast<uint32_t>(mesh.vertices.size());
+		AddVertex(mesh, 0.0f, -0.5f, 0.0f, color);
+		AddVertex(mesh, 0.0f, 0.5f, 0.0f, color);
+
+		for (uint32_t segment = 0; segment < segments; ++segment)
+		{
+			uint32_t next = (segment + 1) % segments;
+			AddTriangle(mesh, segment, next, segments + next);
+			AddTriangle(mesh, segment, segments + next, segments + segment);
+			AddTriangle(mesh, bottomCenter, 2 * segments + segment, 2 * segments + next);
+			AddTriangle(mesh, bottomCenter + 1, 3 * segments + segment, 3 * segments + next);
+		}
+	}
+
+	void BuildPyramid(ProceduralMesh& mesh, const float color[4])
+	{
+		AddVertex(mesh, -0.5f, -0.5f, -0.5f, color);
+		AddVertex(mesh, 0.5f, -0.5f, -0.5f, color);
+		AddVertex(mesh, 0.5f, -0.5f, 0.5f, color);
+		AddVertex(mesh, -0.5f, -0.5f, 0.5f, color);
+		AddVertex(mesh, 0.0f, 0.5f, 0.0f, color);
+
+		AddTriangle(mesh, 0, 1, 2);
+		AddTriangle(mesh, 0, 2, 3);
+		for (uint32_t corner = 0; corner < 4; ++corner)
+		{
+			AddTriangle(mesh, corner, (corner + 1) % 4, 4);
+		}
+	}
+
+	// spins once around a seeded axis per loop, bobs, and cycles its color in triangle waves
+	AnimationClip BuildClip(uint32_t& random)
+	{
+		const float sampleRate = 4.0f;
+		float loopSec = floorf(RandomRange(random, 4.0f, 12.0f));
+		const uint32_t keyCount = static_cast<uint32_t>(loopSec * sampleRate) + 1;
+
+		XMVECTOR axis = XMVector3Normalize(XMVectorSet(RandomRange(random, -0.3f, 0.3f), 1.0f, RandomRange(random, -0.3f, 0.3f), 0.0f));
+		float bob = RandomRange(random, 0.0f, 0.25f);
+		float periods[3];
+		for (float& period : periods)
+		{
+			period = floorf(RandomRange(random, 1.0f, 4.0f));
+		}
+
+		std::vector<XMFLOAT4> rotationKeys(keyCount);
+		std::vector<XMFLOAT3> positionKeys(keyCount);
+		std::vector<XMFLOAT4> colorKeys(keyCount);
+		for (uint32_t key = 0; key < keyCount; ++key)
+		{
+			float phase = static_cast<float>(key) / (keyCount - 1);
+			XMStoreFloat4(&rotationKeys[key], XMQuaternionRotationAxis(axis, XM_2PI * phase));
+			positionKeys[key] = XMFLOAT3(0.0f, bob * sinf(XM_2PI * phase), 0.0f);
+
+			float color[3];
+			for (int channel = 0; channel < 3; ++channel)
+			{
+				float wave = periods[channel] * phase;
+				color[channel] = fabsf(2.0f * (wave - floorf(wave + 0.5f)));
+			}
+			colorKeys[key] = XMFLOAT4(color[0], color[1], color[2], 1.0f);
+		}
+
+		AnimationClip clip(sampleRate, true);
+		clip.SetTrack(AnimationChannel::Rotation, &rotationKeys[0].x, keyCount);
+		clip.SetTrack(AnimationChannel::Position, &positionKeys[0].x, keyCount);
+		clip.SetTrack(AnimationChannel::Color, &colorKeys[0].x, keyCount);
+		return clip;
+	}
+
+	uint32_t PickPrimitive(uint32_t& random, float cubeFraction)
+	{
+		if (RandomRange(random, 0.0f, 1.0f) < cubeFraction)
+		{
+			return static_cast<uint32_t>(PrimitiveType::Cube);
+		}
+		const uint32_t others = static_cast<uint32_t>(PrimitiveType::Count) - 1;
+		return 1 + NextRandom(random) % others;
+	}
+}
+
+SceneDesc::SceneDesc(uint32_t objectCount)
+	: objectCount(objectCount), seed(0x2545f491), cubeFraction(0.7f), childFraction(0.3f), maxDepth(3), clipCount(8), spacing(2.0f)
+{
+}
+
+void SceneGenerator::BuildPrimitive(PrimitiveType type, ProceduralMesh& mesh)
+{
+	// the cube keeps the engine's blue, the others are told apart by color
+	const float colors[][4] = {
+		{ 0.0f, 0.0f, 1.0f, 1.0f },
+		{ 1.0f, 1.0f, 1.0f, 1.0f },
+		{ 1.0f, 0.6f, 0.2f, 1.0f },
+		{ 0.3f, 1.0f, 0.4f, 1.0f }
+	};
+	const float* color = colors[static_cast<size_t>(type)];
+
+	mesh.vertices.clear();
+	mesh.indices.clear();
+	switch (type)
+	{
+	case PrimitiveType::Cube:
+		BuildCube(mesh, color);
+		break;
+	case PrimitiveType::Sphere:
+		BuildSphere(mesh, color);
+		break;
+	case PrimitiveType::Cylinder:
+		BuildCylinder(mesh, color);
+		break;
+	case PrimitiveType::Pyramid:
+		BuildPyramid(mesh, color);
+		break;
+	default:
+		break;
+	}
+	MatchCubeWinding(mesh);
+
+	float radiusSquared = 0.0f;
+	for (const SceneVertex& vertex : mesh.vertices)
+	{
+		float lengthSquared = vertex.pos[0] * vertex.pos[0] + vertex.pos[1] * vertex.pos[1] + vertex.pos[2] * vertex.pos[2];
+		radiusSquared = lengthSquared > radiusSquared ? lengthSquared : radiusSquared;
+	}
+	mesh.radius = sqrtf(radiusSquared);
+}
+
+void SceneGenerator::Generate(const SceneDesc& desc, GeneratedScene& scene)
+{
+	uint32_t random = desc.seed != 0 ? desc.seed : 1;
+	const uint32_t count = desc.objectCount;
+
+	scene.meshes.resize(static_cast<size_t>(PrimitiveType::Count));
+	for (size_t type = 0; type < scene.meshes.size(); ++type)
+	{
+		BuildPrimitive(static_cast<PrimitiveType>(type), scene.meshes[type]);
+	}
+
+	scene.clips.clear();
+	uint32_t clipCount = desc.clipCount > 0 ? desc.clipCount : 1;
+	for (uint32_t clip = 0; clip < clipCount; ++clip)
+	{
+		scene.clips.push_back(BuildClip(random));
+	}
+
+	// build the forest in creation order, parents always have a lower index
+	std::vector<uint32_t> parents(count);
+	std::vector<uint32_t> depths(count);
+	uint32_t rootCount = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		parents[i] = NO_PARENT;
+		depths[i] = 0;
+		if (i > 0 && desc.maxDepth > 0 && RandomRange(random, 0.0f, 1.0f) < desc.childFraction)
+		{
+			uint32_t parent = NextRandom(random) % i;
+			if (depths[parent] < desc.maxDepth)
+			{
+				parents[i] = parent;
+				depths[i] = depths[parent] + 1;
+			}
+		}
+		rootCount += parents[i] == NO_PARENT ? 1 : 0;
+	}
+
+	// counting sort by depth, stable so siblings keep their creation order
+	uint32_t levelCount = desc.maxDepth + 1;
+	scene.levelOffsets.assign(levelCount + 1, 0);
+	for (uint32_t depth : depths)
+	{
+		++scene.levelOffsets[depth + 1];
+	}
+	for (uint32_t level = 0; level < levelCount; ++level)
+	{
+		scene.levelOffsets[level + 1] += scene.levelOffsets[level];
+	}
+	std::vector<uint32_t> remap(count);
+	std::vector<uint32_t> next(scene.levelOffsets.begin(), scene.levelOffsets.end() - 1);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		remap[i] = next[depths[i]]++;
+	}
+	while (scene.levelOffsets.size() > 2 && scene.levelOffsets[scene.levelOffsets.size() - 2] == count)
+	{
+		scene.levelOffsets.pop_back();
+	}
+
+	// roots on a jittered square grid, children around their parent at a fraction of its size
+	uint32_t side = static_cast<uint32_t>(ceil(sqrt(static_cast<double>(rootCount > 0 ? rootCount : 1))));
+	float fieldOrigin = -0.5f * desc.spacing * (side - 1);
+	uint32_t rootIndex = 0;
+
+	scene.primitives.resize(count);
+	scene.parents.resize(count);
+	scene.localMats.resize(count);
+	scene.animations.resize(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		uint32_t object = remap[i];
+		scene.primitives[object] = PickPrimitive(random, desc.cubeFraction);
+		scene.parents[object] = parents[i] == NO_PARENT ? NO_PARENT : remap[parents[i]];
+
+		XMVECTOR position;
+		float scale;
+		if (parents[i] == NO_PARENT)
+		{
+			float jitter = 0.25f * desc.spacing;
+			position = XMVectorSet(fieldOrigin + desc.spacing * (rootIndex % side) + RandomRange(random, -jitter, jitter),
+				RandomRange(random, -1.0f, 1.0f),
+				fieldOrigin + desc.spacing * (rootIndex / side) + RandomRange(random, -jitter, jitter), 0.0f);
+			scale = RandomRange(random, 0.5f, 1.0f);
+			++rootIndex;
+		}
+		else
+		{
+			XMVECTOR direction = XMVector3Normalize(XMVectorSet(RandomRange(random, -1.0f, 1.0f), RandomRange(random, -0.5f, 1.0f),
+				RandomRange(random, -1.0f, 1.0f), 0.0f));
+			position = direction * RandomRange(random, 0.8f, 1.2f);
+			scale = RandomRange(random, 0.3f, 0.6f);
+		}
+		XMVECTOR angles = XMVectorSet(RandomRange(random, -XM_PI, XM_PI), RandomRange(random, -XM_PI, XM_PI),
+			RandomRange(random, -XM_PI, XM_PI), 0.0f);
+		XMStoreFloat4x4(&scene.localMats[object], ComposeWorldMatrix(XMVectorReplicate(scale), position, angles));
+
+		AnimationInstance& animation = scene.animations[object];
+		animation.clip = NextRandom(random) % clipCount;
+		animation.time = RandomRange(random, 0.0f, scene.clips[animation.clip].GetDuration());
+	}
+}
+
+void SceneGenerator::ComposeHierarchy(const GeneratedScene& scene, const XMFLOAT4X4* animatedMats, XMFLOAT4X4* worldMats,
+	ThreadPool& threadPool)
+{
+	const size_t objectsPerBlock = 4096;
+
+	for (size_t level = 0; level + 1 < scene.levelOffsets.size(); ++level)
+	{
+		const size_t first = scene.levelOffsets[level];
+		const size_t end = scene.levelOffsets[level + 1];
+		const size_t blockCount = (end - first + objectsPerBlock - 1) / objectsPerBlock;
+
+		threadPool.ParallelFor(blockCount, [&](size_t block, uint32_t)
+		{
+			size_t blockFirst = first + block * objectsPerBlock;
+			size_t blockEnd = blockFirst + objectsPerBlock < end ? blockFirst + objectsPerBlock : end;
+			for (size_t i = blockFirst; i < blockEnd; ++i)
+			{
+				XMMATRIX worldMat = XMLoadFloat4x4(&scene.localMats[i]);
+				if (animatedMats != nullptr)
+				{
+					worldMat = XMLoadFloat4x4(&animatedMats[i]) * worldMat;
+				}
+				if (scene.parents[i] != NO_PARENT)
+				{
+					worldMat = worldMat * XMLoadFloat4x4(&worldMats[scene.parents[i]]);
+				}
+				XMStoreFloat4x4(&worldMats[i], worldMat);
+			}
+		});
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "AnimationClip.h"
+#include "AnimationSampler.h"
+#include "ThreadPool.h"
+
+enum class PrimitiveType
+{
+	Cube,
+	Sphere,
+	Cylinder,
+	Pyramid,
+	Count
+};
+
+// same layout as the engine's Vertex
+struct SceneVertex
+{
+	float pos[3];
+	float color[4];
+};
+
+// Centered on the origin and about one unit across. Triangles wind like the
+// cube of Engine::CreateVertexBuffer.
+struct ProceduralMesh
+{
+	std::vector<SceneVertex> vertices;
+	std::vector<uint32_t> indices;
+	float radius;	// of the bounding sphere around the origin
+};
+
+struct SceneDesc
+{
+	uint32_t objectCount;
+	uint32_t seed;
+	float cubeFraction;	// the other objects are spread over the remaining primitives
+	float childFraction;	// objects attached to an earlier object instead of the field
+	uint32_t maxDepth;	// of the hierarchies, roots are depth 0
+	uint32_t clipCount;	// animations with their own spin and color cycle
+	float spacing;	// between neighbouring roots of the field
+
+	explicit SceneDesc(uint32_t objectCount);
+};
+
+// Objects are stored level by level, roots first, so every parent comes
+// before its children and each level can be transformed in parallel.
+struct GeneratedScene
+{
+	std::vector<ProceduralMesh> meshes;	// indexed by PrimitiveType
+	std::vector<AnimationClip> clips;
+
+	// per object
+	std::vector<uint32_t> primitives;
+	std::vector<uint32_t> parents;	// NO_PARENT for roots
+	std::vector<DirectX::XMFLOAT4X4> localMats;	// relative to the parent, applied after the animation
+	std::vector<AnimationInstance> animations;
+
+	std::vector<uint32_t> levelOffsets;	// first object of every depth, then the object count
+};
+
+// Seeded stress scenes: a field of cubes and other procedural primitives,
+// some of them carrying children, every object spinning and cycling its
+// color. The same desc always gives the same scene.
+class SceneGenerator
+{
+public:
+	static const uint32_t NO_PARENT = 0xffffffff;
+
+	static void BuildPrimitive(PrimitiveType type, ProceduralMesh& mesh);
+	static void Generate(const SceneDesc& desc, GeneratedScene& scene);
+
+	// worldMats[i] = animatedMats[i] * localMats[i] * worldMats[parents[i]], one level at a time
+	// on the pool. animatedMats may be null for a scene at rest.
+	static void ComposeHierarchy(const GeneratedScene& scene, const DirectX::XMFLOAT4X4* animatedMats,
+		DirectX::XMFLOAT4X4* worldMats, ThreadPool& threadPool);
+};
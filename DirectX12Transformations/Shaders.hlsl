@@ -15,10 +15,41 @@ cbuffer ConstantBuffer : register(b0)
 	float4 colorMultiplier;
 };
 
+#ifdef BINDLESS
+#ifdef AFFINE_WORLD
+// transposed 3x4 world matrix
+struct ObjectConstants
+{
+	float4 world0;
+	float4 world1;
+	float4 world2;
+};
+
+cbuffer FrameConstants : register(b1)
+{
+	float4x4 viewProjection;
+};
+#else
+struct ObjectConstants
+{
+	float4x4 wvp;
+};
+#endif
+
+// every structured buffer in the shader visible heap, selected per draw
+StructuredBuffer<ObjectConstants> objectBuffers[] : register(t0, space1);
+
+cbuffer DrawConstants : register(b2)
+{
+	uint objectBuffer;
+	uint objectIndex;
+};
+#else
 cbuffer WvpConstantBuffer : register(b1)
 {
 	float4x4 wvp;
 };
+#endif
 
 // simple vertex shader
 VS_OUTPUT vsMain(VS_INPUT input)
@@ -26,7 +57,15 @@ VS_OUTPUT vsMain(VS_INPUT input)
 	VS_OUTPUT output;
 	output.pos = float4(input.pos, 1.0f);
 	output.color = input.color * colorMultiplier;
+#if defined(AFFINE_WORLD)
+	ObjectConstants object = objectBuffers[objectBuffer][objectIndex];
+	float3 worldPos = float3(dot(object.world0, output.pos), dot(object.world1, output.pos), dot(object.world2, output.pos));
+	output.pos = mul(float4(worldPos, 1.0f), viewProjection);
+#elif defined(BINDLESS)
+	output.pos = mul(output.pos, objectBuffers[objectBuffer][objectIndex].wvp);
+#else
 	output.pos = mul(output.pos, wvp);
+#endif
 
 	return output;
 }
@@ -35,4 +74,36 @@ VS_OUTPUT vsMain(VS_INPUT input)
 float4 psMain(VS_OUTPUT input) : SV_TARGET
 {
 	return input.color;
-}
\ No newline at end of file
+}
+
+// dynamic resolution: the scene is drawn into the top left corner of a
+// full size target and stretched over the back buffer
+Texture2D sceneColor : register(t0);
+SamplerState linearClamp : register(s0);
+
+cbuffer UpscaleConstants : register(b3)
+{
+	float2 uvScale;	// rendered size over target size
+	float2 uvMax;	// last texel center the filter may reach
+};
+
+struct UPSCALE_OUTPUT
+{
+	float4 pos : SV_POSITION;
+	float2 uv : TEXCOORD;
+};
+
+// one triangle covering the screen
+UPSCALE_OUTPUT vsUpscale(uint vertexId : SV_VertexID)
+{
+	UPSCALE_OUTPUT output;
+	float2 uv = float2((vertexId << 1) & 2, vertexId & 2);
+	output.pos = float4(uv * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f), 0.0f, 1.0f);
+	output.uv = uv * uvScale;
+	return output;
+}
+
+float4 psUpscale(UPSCALE_OUTPUT input) : SV_TARGET
+{
+	return sceneColor.SampleLevel(linearClamp, min(input.uv, uvMax), 0);
+}
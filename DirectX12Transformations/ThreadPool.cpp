@@ -0,0 +1,108 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+	: m_taskFunction(nullptr), m_task(nullptr), m_count(0), m_next(0), m_busy(0), m_generation(0), m_stop(false)
+{
+	if (threadCount == 0)
+	{
+		threadCount = std::thread::hardware_concurrency();
+	}
+	if (threadCount == 0)
+	{
+		threadCount = 1;
+	}
+
+	for (uint32_t i = 1; i < threadCount; ++i)
+	{
+		m_threads.push_back(std::thread(&ThreadPool::WorkerMain, this, i));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+
+	for (std::thread& thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+uint32_t ThreadPool::GetThreadCount() const
+{
+	return static_cast<uint32_t>(m_threads.size() + 1);
+}
+
+void ThreadPool::RunTasks(uint32_t threadIndex)
+{
+	for (size_t index = m_next++; index < m_count; index = m_next++)
+	{
+		m_taskFunction(m_task, index, threadIndex);
+	}
+}
+
+void ThreadPool::WorkerMain(uint32_t threadIndex)
+{
+	uint64_t generation = 0;
+
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [&]() { return m_stop || m_generation != generation; });
+			if (m_stop)
+			{
+				return;
+			}
+			generation = m_generation;
+		}
+
+		RunTasks(threadIndex);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (--m_busy == 0)
+		{
+			m_done.notify_one();
+		}
+	}
+}
+
+void ThreadPool::Run(size_t count, TaskFunction function, const void* task)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	// not worth waking anybody up for a single task
+	if (count == 1 || m_threads.empty())
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			function(task, i, 0);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_taskFunction = function;
+		m_task = task;
+		m_count = count;
+		m_next = 0;
+		m_busy = static_cast<uint32_t>(m_threads.size());
+		++m_generation;
+	}
+	m_wake.notify_all();
+
+	RunTasks(0);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done.wait(lock, [this]() { return m_busy == 0; });
+	m_taskFunction = nullptr;
+	m_task = nullptr;
+}
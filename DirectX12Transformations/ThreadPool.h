@@ -0,0 +1,59 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running one parallel loop at a time.
+// The calling thread takes part as thread 0, so GetThreadCount() includes it.
+class ThreadPool
+{
+private:
+
+	std::vector<std::thread> m_threads;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+
+	typedef void (*TaskFunction)(const void* task, size_t index, uint32_t threadIndex);
+
+	TaskFunction m_taskFunction;
+	const void* m_task;
+	size_t m_count;
+	std::atomic<size_t> m_next;
+	uint32_t m_busy;
+	uint64_t m_generation;
+	bool m_stop;
+
+	void WorkerMain(uint32_t threadIndex);
+	void RunTasks(uint32_t threadIndex);
+	void Run(size_t count, TaskFunction function, const void* task);
+
+	template<typename Task>
+	static void InvokeTask(const void* task, size_t index, uint32_t threadIndex)
+	{
+		(*static_cast<const Task*>(task))(index, threadIndex);
+	}
+
+public:
+	// 0 uses one thread per hardware thread
+	explicit ThreadPool(uint32_t threadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	uint32_t GetThreadCount() const;
+
+	// runs task(index, threadIndex) for every index in [0, count) and waits for all of them,
+	// tasks must not call ParallelFor themselves. The task is called through a
+	// pointer, not copied into a std::function, so lambdas of any size do not allocate.
+	template<typename Task>
+	void ParallelFor(size_t count, const Task& task)
+	{
+		Run(count, &InvokeTask<Task>, &task);
+	}
+};
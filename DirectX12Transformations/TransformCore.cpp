@@ -0,0 +1,647 @@
+#include <cmath>
+#include <vector>
+#include <emmintrin.h>
+#include <immintrin.h>
+#include "TransformCore.h"
+
+using namespace DirectX;
+
+namespace
+{
+	void MultiplyTransposeScalar(const XMFLOAT4X4* matrices, const XMFLOAT4X4& right, XMFLOAT4X4* result, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			const XMFLOAT4X4& left = matrices[i];
+			for (int row = 0; row < 4; ++row)
+			{
+				for (int column = 0; column < 4; ++column)
+				{
+					float sum = left.m[row][0] * right.m[0][column];
+					sum += left.m[row][1] * right.m[1][column];
+					sum += left.m[row][2] * right.m[2][column];
+					sum += left.m[row][3] * right.m[3][column];
+					result[i].m[column][row] = sum;
+				}
+			}
+		}
+	}
+
+	// the same operation order as scalar, so results are bit exact
+	void MultiplyTransposeSse2(const XMFLOAT4X4* matrices, const XMFLOAT4X4& right, XMFLOAT4X4* result, size_t count)
+	{
+		const __m128 right0 = _mm_loadu_ps(right.m[0]);
+		const __m128 right1 = _mm_loadu_ps(right.m[1]);
+		const __m128 right2 = _mm_loadu_ps(right.m[2]);
+		const __m128 right3 = _mm_loadu_ps(right.m[3]);
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			__m128 rows[4];
+			for (int row = 0; row < 4; ++row)
+			{
+				__m128 left = _mm_loadu_ps(matrices[i].m[row]);
+				__m128 sum = _mm_mul_ps(_mm_shuffle_ps(left, left, _MM_SHUFFLE(0, 0, 0, 0)), right0);
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(left, left, _MM_SHUFFLE(1, 1, 1, 1)), right1));
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(left, left, _MM_SHUFFLE(2, 2, 2, 2)), right2));
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(left, left, _MM_SHUFFLE(3, 3, 3, 3)), right3));
+				rows[row] = sum;
+			}
+
+			_MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
+			for (int row = 0; row < 4; ++row)
+			{
+				_mm_storeu_ps(result[i].m[row], rows[row]);
+			}
+		}
+	}
+
+	// two matrices per iteration, one in each 128 bit lane
+	SIMD_TARGET_AVX2 void MultiplyTransposeAvx2(const XMFLOAT4X4* matrices, const XMFLOAT4X4& right, XMFLOAT4X4* result, size_t count)
+	{
+		const __m256 right0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(right.m[0]));
+		const __m256 right1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(right.m[1]));
+		const __m256 right2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(right.m[2]));
+		const __m256 right3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(right.m[3]));
+
+		size_t i = 0;
+		for (; i + 2 <= count; i += 2)
+		{
+			__m256 rows[4];
+			for (int row = 0; row < 4; ++row)
+			{
+				__m256 left = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(matrices[i].m[row])), _mm_loadu_ps(matrices[i + 1].m[row]), 1);
+				__m256 sum = _mm256_mul_ps(_mm256_permute_ps(left, _MM_SHUFFLE(0, 0, 0, 0)), right0);
+				sum = _mm256_fmadd_ps(_mm256_permute_ps(left, _MM_SHUFFLE(1, 1, 1, 1)), right1, sum);
+				sum = _mm256_fmadd_ps(_mm256_permute_ps(left, _MM_SHUFFLE(2, 2, 2, 2)), right2, sum);
+				sum = _mm256_fmadd_ps(_mm256_permute_ps(left, _MM_SHUFFLE(3, 3, 3, 3)), right3, sum);
+				rows[row] = sum;
+			}
+
+			// 4x4 transpose within each lane
+			__m256 t0 = _mm256_unpacklo_ps(rows[0], rows[1]);
+			__m256 t1 = _mm256_unpacklo_ps(rows[2], rows[3]);
+			__m256 t2 = _mm256_unpackhi_ps(rows[0], rows[1]);
+			__m256 t3 = _mm256_unpackhi_ps(rows[2], rows[3]);
+			rows[0] = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+			rows[1] = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+			rows[2] = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+			rows[3] = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+
+			for (int row = 0; row < 4; ++row)
+			{
+				_mm_storeu_ps(result[i].m[row], _mm256_castps256_ps128(rows[row]));
+				_mm_storeu_ps(result[i + 1].m[row], _mm256_extractf128_ps(rows[row], 1));
+			}
+		}
+
+		if (i < count)
+		{
+			// the tail runs legacy SSE code, which stalls on the dirty upper halves
+			// of the ymm registers unless they are cleared first
+			_mm256_zeroupper();
+			MultiplyTransposeSse2(matrices + i, right, result + i, count - i);
+		}
+	}
+
+	const float INV_TWO_PI = 0.159154943f;
+	const float TWO_PI_HI = 6.28125f;	// 8 significant bits, q * TWO_PI_HI is exact
+	const float TWO_PI_LO = 1.9353071795864769e-3f;
+	const float PI = 3.141592654f;
+	const float HALF_PI = 1.570796327f;
+
+	// minimax coefficients, sin(y) = y * S(y^2), cos(y) = C(y^2) on [-pi/2, pi/2]
+	const float PRECISE_SIN[5] = { -0.16666667f, 0.0083333310f, -1.9840874e-4f, 2.7525562e-6f, -2.3889859e-8f };
+	const float PRECISE_COS[5] = { -0.5f, 0.041666638f, -1.3888378e-3f, 2.4760495e-5f, -2.6051615e-7f };
+	const float FAST_SIN[3] = { -0.16665852f, 0.0083139502f, -1.8524670e-4f };
+	const float FAST_COS[3] = { -0.49992746f, 0.041493919f, -1.2712436e-3f };
+
+	void SinCosScalarOne(float angle, TrigAccuracy accuracy, float& sine, float& cosine)
+	{
+		// angle - q * 2pi in two steps keeps the reduction accurate for large angles
+		float quotient = nearbyintf(angle * INV_TWO_PI);
+		float y = (angle - quotient * TWO_PI_HI) - quotient * TWO_PI_LO;
+
+		// reflect into [-pi/2, pi/2], sin keeps its sign and cos flips
+		float cosineSign = 1.0f;
+		if (y > HALF_PI)
+		{
+			y = PI - y;
+			cosineSign = -1.0f;
+		}
+		else if (y < -HALF_PI)
+		{
+			y = -PI - y;
+			cosineSign = -1.0f;
+		}
+
+		float y2 = y * y;
+		float s, c;
+		if (accuracy == TrigAccuracy::Precise)
+		{
+			s = PRECISE_SIN[4];
+			c = PRECISE_COS[4];
+			for (int i = 3; i >= 0; --i)
+			{
+				s = s * y2 + PRECISE_SIN[i];
+				c = c * y2 + PRECISE_COS[i];
+			}
+		}
+		else
+		{
+			s = FAST_SIN[2];
+			c = FAST_COS[2];
+			for (int i = 1; i >= 0; --i)
+			{
+				s = s * y2 + FAST_SIN[i];
+				c = c * y2 + FAST_COS[i];
+			}
+		}
+
+		sine = (s * y2 + 1.0f) * y;
+		cosine = (c * y2 + 1.0f) * cosineSign;
+	}
+
+	void SinCosScalar(const float* angles, float* sines, float* cosines, size_t count, TrigAccuracy accuracy)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			SinCosScalarOne(angles[i], accuracy, sines[i], cosines[i]);
+		}
+	}
+
+	void ComposeSrtScalar(const SrtStreams& streams, XMFLOAT4X4* result, size_t count, TrigAccuracy accuracy)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			float sp, cp, sy, cy, sr, cr;
+			SinCosScalarOne(streams.pitch[i], accuracy, sp, cp);
+			SinCosScalarOne(streams.yaw[i], accuracy, sy, cy);
+			SinCosScalarOne(streams.roll[i], accuracy, sr, cr);
+
+			float scaleX = streams.scaleX ? streams.scaleX[i] : 1.0f;
+			float scaleY = streams.scaleY ? streams.scaleY[i] : 1.0f;
+			float scaleZ = streams.scaleZ ? streams.scaleZ[i] : 1.0f;
+
+			// roll, then pitch, then yaw, as XMMatrixRotationRollPitchYaw
+			float srsp = sr * sp;
+			float crsp = cr * sp;
+			XMFLOAT4X4& m = result[i];
+			m._11 = (cr * cy + srsp * sy) * scaleX;
+			m._12 = sr * cp * scaleX;
+			m._13 = (srsp * cy - cr * sy) * scaleX;
+			m._14 = 0.0f;
+			m._21 = (crsp * sy - sr * cy) * scaleY;
+			m._22 = cr * cp * scaleY;
+			m._23 = (sr * sy + crsp * cy) * scaleY;
+			m._24 = 0.0f;
+			m._31 = cp * sy * scaleZ;
+			m._32 = -sp * scaleZ;
+			m._33 = cp * cy * scaleZ;
+			m._34 = 0.0f;
+			m._41 = streams.positionX ? streams.positionX[i] : 0.0f;
+			m._42 = streams.positionY ? streams.positionY[i] : 0.0f;
+			m._43 = streams.positionZ ? streams.positionZ[i] : 0.0f;
+			m._44 = 1.0f;
+		}
+	}
+
+	const float* Offset(const float* stream, size_t offset)
+	{
+		return stream ? stream + offset : nullptr;
+	}
+
+	SrtStreams OffsetStreams(const SrtStreams& streams, size_t offset)
+	{
+		SrtStreams result =
+		{
+			Offset(streams.pitch, offset), Offset(streams.yaw, offset), Offset(streams.roll, offset),
+			Offset(streams.scaleX, offset), Offset(streams.scaleY, offset), Offset(streams.scaleZ, offset),
+			Offset(streams.positionX, offset), Offset(streams.positionY, offset), Offset(streams.positionZ, offset)
+		};
+		return result;
+	}
+
+	// angles within +-2^31 * 2pi, the quotient is rounded through int32
+	void SinCosSse2(__m128 angle, TrigAccuracy accuracy, __m128& sine, __m128& cosine)
+	{
+		const __m128 signMask = _mm_set1_ps(-0.0f);
+
+		__m128 quotient = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(angle, _mm_set1_ps(INV_TWO_PI))));
+		__m128 y = _mm_sub_ps(_mm_sub_ps(angle, _mm_mul_ps(quotient, _mm_set1_ps(TWO_PI_HI))), _mm_mul_ps(quotient, _mm_set1_ps(TWO_PI_LO)));
+
+		__m128 ySign = _mm_and_ps(y, signMask);
+		__m128 reflect = _mm_cmpgt_ps(_mm_andnot_ps(signMask, y), _mm_set1_ps(HALF_PI));
+		__m128 reflected = _mm_sub_ps(_mm_or_ps(_mm_set1_ps(PI), ySign), y);
+		y = _mm_or_ps(_mm_and_ps(reflect, reflected), _mm_andnot_ps(reflect, y));
+		__m128 cosineSign = _mm_and_ps(reflect, signMask);
+
+		__m128 y2 = _mm_mul_ps(y, y);
+		__m128 s, c;
+		if (accuracy == TrigAccuracy::Precise)
+		{
+			s = _mm_set1_ps(PRECISE_SIN[4]);
+			c = _mm_set1_ps(PRECISE_COS[4]);
+			for (int i = 3; i >= 0; --i)
+			{
+				s = _mm_add_ps(_mm_mul_ps(s, y2), _mm_set1_ps(PRECISE_SIN[i]));
+				c = _mm_add_ps(_mm_mul_ps(c, y2), _mm_set1_ps(PRECISE_COS[i]));
+			}
+		}
+		else
+		{
+			s = _mm_set1_ps(FAST_SIN[2]);
+			c = _mm_set1_ps(FAST_COS[2]);
+			for (int i = 1; i >= 0; --i)
+			{
+				s = _mm_add_ps(_mm_mul_ps(s, y2), _mm_set1_ps(FAST_SIN[i]));
+				c = _mm_add_ps(_mm_mul_ps(c, y2), _mm_set1_ps(FAST_COS[i]));
+			}
+		}
+
+		const __m128 one = _mm_set1_ps(1.0f);
+		sine = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(s, y2), one), y);
+		cosine = _mm_xor_ps(_mm_add_ps(_mm_mul_ps(c, y2), one), cosineSign);
+	}
+
+	void SinCosSse2(const float* angles, float* sines, float* cosines, size_t count, TrigAccuracy accuracy)
+	{
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 sine, cosine;
+			SinCosSse2(_mm_loadu_ps(angles + i), accuracy, sine, cosine);
+			_mm_storeu_ps(sines + i, sine);
+			_mm_storeu_ps(cosines + i, cosine);
+		}
+
+		SinCosScalar(angles + i, sines + i, cosines + i, count - i, accuracy);
+	}
+
+	__m128 LoadOr(const float* stream, size_t i, __m128 fallback)
+	{
+		return stream ? _mm_loadu_ps(stream + i) : fallback;
+	}
+
+	void ComposeSrtSse2(const SrtStreams& streams, XMFLOAT4X4* result, size_t count, TrigAccuracy accuracy)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 sp, cp, sy, cy, sr, cr;
+			SinCosSse2(_mm_loadu_ps(streams.pitch + i), accuracy, sp, cp);
+			SinCosSse2(_mm_loadu_ps(streams.yaw + i), accuracy, sy, cy);
+			SinCosSse2(_mm_loadu_ps(streams.roll + i), accuracy, sr, cr);
+
+			__m128 scaleX = LoadOr(streams.scaleX, i, one);
+			__m128 scaleY = LoadOr(streams.scaleY, i, one);
+			__m128 scaleZ = LoadOr(streams.scaleZ, i, one);
+
+			__m128 srsp = _mm_mul_ps(sr, sp);
+			__m128 crsp = _mm_mul_ps(cr, sp);
+
+			// one register per matrix element, one lane per object
+			__m128 rows[4][4];
+			rows[0][0] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(cr, cy), _mm_mul_ps(srsp, sy)), scaleX);
+			rows[0][1] = _mm_mul_ps(_mm_mul_ps(sr, cp), scaleX);
+			rows[0][2] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(srsp, cy), _mm_mul_ps(cr, sy)), scaleX);
+			rows[0][3] = zero;
+			rows[1][0] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(crsp, sy), _mm_mul_ps(sr, cy)), scaleY);
+			rows[1][1] = _mm_mul_ps(_mm_mul_ps(cr, cp), scaleY);
+			rows[1][2] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(sr, sy), _mm_mul_ps(crsp, cy)), scaleY);
+			rows[1][3] = zero;
+			rows[2][0] = _mm_mul_ps(_mm_mul_ps(cp, sy), scaleZ);
+			rows[2][1] = _mm_mul_ps(_mm_xor_ps(sp, _mm_set1_ps(-0.0f)), scaleZ);
+			rows[2][2] = _mm_mul_ps(_mm_mul_ps(cp, cy), scaleZ);
+			rows[2][3] = zero;
+			rows[3][0] = LoadOr(streams.positionX, i, zero);
+			rows[3][1] = LoadOr(streams.positionY, i, zero);
+			rows[3][2] = LoadOr(streams.positionZ, i, zero);
+			rows[3][3] = one;
+
+			// transposing the four elements of a row gives that row for each object
+			for (int row = 0; row < 4; ++row)
+			{
+				_MM_TRANSPOSE4_PS(rows[row][0], rows[row][1], rows[row][2], rows[row][3]);
+				for (int lane = 0; lane < 4; ++lane)
+				{
+					_mm_storeu_ps(result[i + lane].m[row], rows[row][lane]);
+				}
+			}
+		}
+
+		ComposeSrtScalar(OffsetStreams(streams, i), result + i, count - i, accuracy);
+	}
+
+	SIMD_TARGET_AVX2 void SinCosAvx2(__m256 angle, TrigAccuracy accuracy, __m256& sine, __m256& cosine)
+	{
+		const __m256 signMask = _mm256_set1_ps(-0.0f);
+
+		__m256 quotient = _mm256_round_ps(_mm256_mul_ps(angle, _mm256_set1_ps(INV_TWO_PI)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+		__m256 y = _mm256_fnmadd_ps(quotient, _mm256_set1_ps(TWO_PI_HI), angle);
+		y = _mm256_fnmadd_ps(quotient, _mm256_set1_ps(TWO_PI_LO), y);
+
+		__m256 ySign = _mm256_and_ps(y, signMask);
+		__m256 reflect = _mm256_cmp_ps(_mm256_andnot_ps(signMask, y), _mm256_set1_ps(HALF_PI), _CMP_GT_OQ);
+		y = _mm256_blendv_ps(y, _mm256_sub_ps(_mm256_or_ps(_mm256_set1_ps(PI), ySign), y), reflect);
+		__m256 cosineSign = _mm256_and_ps(reflect, signMask);
+
+		__m256 y2 = _mm256_mul_ps(y, y);
+		__m256 s, c;
+		if (accuracy == TrigAccuracy::Precise)
+		{
+			s = _mm256_set1_ps(PRECISE_SIN[4]);
+			c = _mm256_set1_ps(PRECISE_COS[4]);
+			for (int i = 3; i >= 0; --i)
+			{
+				s = _mm256_fmadd_ps(s, y2, _mm256_set1_ps(PRECISE_SIN[i]));
+				c = _mm256_fmadd_ps(c, y2, _mm256_set1_ps(PRECISE_COS[i]));
+			}
+		}
+		else
+		{
+			s = _mm256_set1_ps(FAST_SIN[2]);
+			c = _mm256_set1_ps(FAST_COS[2]);
+			for (int i = 1; i >= 0; --i)
+			{
+				s = _mm256_fmadd_ps(s, y2, _mm256_set1_ps(FAST_SIN[i]));
+				c = _mm256_fmadd_ps(c, y2, _mm256_set1_ps(FAST_COS[i]));
+			}
+		}
+
+		const __m256 one = _mm256_set1_ps(1.0f);
+		sine = _mm256_mul_ps(_mm256_fmadd_ps(s, y2, one), y);
+		cosine = _mm256_xor_ps(_mm256_fmadd_ps(c, y2, one), cosineSign);
+	}
+
+	SIMD_TARGET_AVX2 void SinCosAvx2(const float* angles, float* sines, float* cosines, size_t count, TrigAccuracy accuracy)
+	{
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 sine, cosine;
+			SinCosAvx2(_mm256_loadu_ps(angles + i), accuracy, sine, cosine);
+			_mm256_storeu_ps(sines + i, sine);
+			_mm256_storeu_ps(cosines + i, cosine);
+		}
+
+		// the scalar tail is legacy SSE code, see MultiplyTransposeAvx2
+		_mm256_zeroupper();
+		SinCosScalar(angles + i, sines + i, cosines + i, count - i, accuracy);
+	}
+
+	SIMD_TARGET_AVX2 __m256 LoadOr(const float* stream, size_t i, __m256 fallback)
+	{
+		return stream ? _mm256_loadu_ps(stream + i) : fallback;
+	}
+
+	SIMD_TARGET_AVX2 void ComposeSrtAvx2(const SrtStreams& streams, XMFLOAT4X4* result, size_t count, TrigAccuracy accuracy)
+	{
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 one = _mm256_set1_ps(1.0f);
+
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 sp, cp, sy, cy, sr, cr;
+			SinCosAvx2(_mm256_loadu_ps(streams.pitch + i), accuracy, sp, cp);
+			SinCosAvx2(_mm256_loadu_ps(streams.yaw + i), accuracy, sy, cy);
+			SinCosAvx2(_mm256_loadu_ps(streams.roll + i), accuracy, sr, cr);
+
+			__m256 scaleX = LoadOr(streams.scaleX, i, one);
+			__m256 scaleY = LoadOr(streams.scaleY, i, one);
+			__m256 scaleZ = LoadOr(streams.scaleZ, i, one);
+
+			__m256 srsp = _mm256_mul_ps(sr, sp);
+			__m256 crsp = _mm256_mul_ps(cr, sp);
+
+			__m256 rows[4][4];
+			rows[0][0] = _mm256_mul_ps(_mm256_fmadd_ps(srsp, sy, _mm256_mul_ps(cr, cy)), scaleX);
+			rows[0][1] = _mm256_mul_ps(_mm256_mul_ps(sr, cp), scaleX);
+			rows[0][2] = _mm256_mul_ps(_mm256_fmsub_ps(srsp, cy, _mm256_mul_ps(cr, sy)), scaleX);
+			rows[0][3] = zero;
+			rows[1][0] = _mm256_mul_ps(_mm256_fmsub_ps(crsp, sy, _mm256_mul_ps(sr, cy)), scaleY);
+			rows[1][1] = _mm256_mul_ps(_mm256_mul_ps(cr, cp), scaleY);
+			rows[1][2] = _mm256_mul_ps(_mm256_fmadd_ps(crsp, cy, _mm256_mul_ps(sr, sy)), scaleY);
+			rows[1][3] = zero;
+			rows[2][0] = _mm256_mul_ps(_mm256_mul_ps(cp, sy), scaleZ);
+			rows[2][1] = _mm256_mul_ps(_mm256_xor_ps(sp, _mm256_set1_ps(-0.0f)), scaleZ);
+			rows[2][2] = _mm256_mul_ps(_mm256_mul_ps(cp, cy), scaleZ);
+			rows[2][3] = zero;
+			rows[3][0] = LoadOr(streams.positionX, i, zero);
+			rows[3][1] = LoadOr(streams.positionY, i, zero);
+			rows[3][2] = LoadOr(streams.positionZ, i, zero);
+			rows[3][3] = one;
+
+			// 4x4 transpose within each 128 bit lane, the low lane holds objects 0-3, the high lane 4-7
+			for (int row = 0; row < 4; ++row)
+			{
+				__m256 t0 = _mm256_unpacklo_ps(rows[row][0], rows[row][1]);
+				__m256 t1 = _mm256_unpacklo_ps(rows[row][2], rows[row][3]);
+				__m256 t2 = _mm256_unpackhi_ps(rows[row][0], rows[row][1]);
+				__m256 t3 = _mm256_unpackhi_ps(rows[row][2], rows[row][3]);
+				__m256 objects[4] =
+				{
+					_mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0)),
+					_mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2)),
+					_mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0)),
+					_mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2))
+				};
+
+				for (int lane = 0; lane < 4; ++lane)
+				{
+					_mm_storeu_ps(result[i + lane].m[row], _mm256_castps256_ps128(objects[lane]));
+					_mm_storeu_ps(result[i + 4 + lane].m[row], _mm256_extractf128_ps(objects[lane], 1));
+				}
+			}
+		}
+
+		_mm256_zeroupper();
+		ComposeSrtScalar(OffsetStreams(streams, i), result + i, count - i, accuracy);
+	}
+
+	const TransformKernels SCALAR_KERNELS = { SimdLevel::Scalar, MultiplyTransposeScalar, SinCosScalar, ComposeSrtScalar };
+	const TransformKernels SSE2_KERNELS = { SimdLevel::Sse2, MultiplyTransposeSse2, SinCosSse2, ComposeSrtSse2 };
+	const TransformKernels AVX2_KERNELS = { SimdLevel::Avx2, MultiplyTransposeAvx2, SinCosAvx2, ComposeSrtAvx2 };
+
+	uint32_t NextRandom(uint32_t& state)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+	float RandomFloat(uint32_t& state)
+	{
+		// [-4, 4), covers rotations, scales and camera translations
+		return (NextRandom(state) >> 8) * (8.0f / 16777216.0f) - 4.0f;
+	}
+
+	float UlpOf(float value)
+	{
+		int exponent;
+		frexpf(value, &exponent);
+		return ldexpf(1.0f, exponent - 24);
+	}
+}
+
+XMMATRIX XM_CALLCONV ComposeWorldMatrix(FXMVECTOR scale, FXMVECTOR position, FXMVECTOR rollPitchYaw)
+{
+	return XMMatrixScalingFromVector(scale) * XMMatrixTranslationFromVector(position) * XMMatrixRotationRollPitchYawFromVector(rollPitchYaw);
+}
+
+const TransformKernels& GetTransformKernels()
+{
+	static const TransformKernels& kernels = GetTransformKernels(GetCpuSimdLevel());
+	return kernels;
+}
+
+const TransformKernels& GetTransformKernels(SimdLevel level)
+{
+	SimdLevel cpuLevel = GetCpuSimdLevel();
+	if (level > cpuLevel)
+	{
+		level = cpuLevel;
+	}
+
+	// nothing in the kernels needs more than SSE2 below AVX2
+	switch (level)
+	{
+	case SimdLevel::Avx2:
+		return AVX2_KERNELS;
+	case SimdLevel::Sse41:
+	case SimdLevel::Sse2:
+		return SSE2_KERNELS;
+	default:
+		return SCALAR_KERNELS;
+	}
+}
+
+float MeasureTransformUlp(SimdLevel level, size_t matrixCount, uint32_t seed)
+{
+	std::vector<XMFLOAT4X4> matrices(matrixCount);
+	std::vector<XMFLOAT4X4> expected(matrixCount);
+	std::vector<XMFLOAT4X4> actual(matrixCount);
+	XMFLOAT4X4 right;
+
+	uint32_t state = seed != 0 ? seed : 1;
+	for (XMFLOAT4X4& matrix : matrices)
+	{
+		for (int i = 0; i < 16; ++i)
+		{
+			(&matrix._11)[i] = RandomFloat(state);
+		}
+	}
+	for (int i = 0; i < 16; ++i)
+	{
+		(&right._11)[i] = RandomFloat(state);
+	}
+
+	SCALAR_KERNELS.multiplyTranspose(matrices.data(), right, expected.data(), matrixCount);
+	GetTransformKernels(level).multiplyTranspose(matrices.data(), right, actual.data(), matrixCount);
+
+	float maxUlp = 0.0f;
+	for (size_t i = 0; i < matrixCount; ++i)
+	{
+		for (int row = 0; row < 4; ++row)
+		{
+			for (int column = 0; column < 4; ++column)
+			{
+				float magnitude = 0.0f;
+				for (int k = 0; k < 4; ++k)
+				{
+					magnitude += fabsf(matrices[i].m[row][k] * right.m[k][column]);
+				}
+
+				float error = fabsf(actual[i].m[column][row] - expected[i].m[column][row]);
+				if (error != error)
+				{
+					return INFINITY;
+				}
+
+				float ulp = error / UlpOf(magnitude > 0.0f ? magnitude : 1.0f);
+				maxUlp = ulp > maxUlp ? ulp : maxUlp;
+			}
+		}
+	}
+
+	return maxUlp;
+}
+
+bool CheckTransformConformance(SimdLevel level, float maxUlp)
+{
+	return MeasureTransformUlp(level, 4097, 0x9e3779b9u) <= maxUlp;
+}
+
+float MeasureSinCosError(SimdLevel level, TrigAccuracy accuracy, size_t angleCount, float range, uint32_t seed)
+{
+	std::vector<float> angles(angleCount);
+	std::vector<float> sines(angleCount);
+	std::vector<float> cosines(angleCount);
+
+	uint32_t state = seed != 0 ? seed : 1;
+	for (float& angle : angles)
+	{
+		angle = RandomFloat(state) * (range / 4.0f);
+	}
+
+	GetTransformKernels(level).sinCos(angles.data(), sines.data(), cosines.data(), angleCount, accuracy);
+
+	double maxError = 0.0;
+	for (size_t i = 0; i < angleCount; ++i)
+	{
+		double sineError = fabs(sines[i] - sin(static_cast<double>(angles[i])));
+		double cosineError = fabs(cosines[i] - cos(static_cast<double>(angles[i])));
+		maxError = sineError > maxError ? sineError : maxError;
+		maxError = cosineError > maxError ? cosineError : maxError;
+	}
+
+	return static_cast<float>(maxError);
+}
+
+float MeasureSrtError(SimdLevel level, TrigAccuracy accuracy, size_t matrixCount, uint32_t seed)
+{
+	// pitch, yaw, roll, scale xyz, position xyz
+	std::vector<float> values[9];
+	uint32_t state = seed != 0 ? seed : 1;
+	for (std::vector<float>& stream : values)
+	{
+		stream.resize(matrixCount);
+		for (float& value : stream)
+		{
+			value = RandomFloat(state);
+		}
+	}
+
+	SrtStreams streams =
+	{
+		values[0].data(), values[1].data(), values[2].data(),
+		values[3].data(), values[4].data(), values[5].data(),
+		values[6].data(), values[7].data(), values[8].data()
+	};
+
+	std::vector<XMFLOAT4X4> result(matrixCount);
+	GetTransformKernels(level).composeSrt(streams, result.data(), matrixCount, accuracy);
+
+	float maxError = 0.0f;
+	for (size_t i = 0; i < matrixCount; ++i)
+	{
+		XMMATRIX expected = XMMatrixScaling(values[3][i], values[4][i], values[5][i]) *
+			XMMatrixRotationRollPitchYaw(values[0][i], values[1][i], values[2][i]) *
+			XMMatrixTranslation(values[6][i], values[7][i], values[8][i]);
+
+		XMFLOAT4X4 expectedMat;
+		XMStoreFloat4x4(&expectedMat, expected);
+		for (int element = 0; element < 16; ++element)
+		{
+			float error = fabsf((&result[i]._11)[element] - (&expectedMat._11)[element]);
+			maxError = error > maxError ? error : maxError;
+		}
+	}
+
+	return maxError;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+#include "CpuFeatures.h"
+
+// Transform math shared by the engine, camera and upload packing. Only
+// depends on DirectXMath and CpuFeatures, so it also builds with GCC and
+// Clang against the header-only DirectXMath.
+
+// the engine's world matrix, scale * translation * rotation
+DirectX::XMMATRIX XM_CALLCONV ComposeWorldMatrix(DirectX::FXMVECTOR scale, DirectX::FXMVECTOR position, DirectX::FXMVECTOR rollPitchYaw);
+
+// result[i] = transpose(matrices[i] * right), the layout the shaders read
+typedef void (*MultiplyTransposeKernel)(const DirectX::XMFLOAT4X4* matrices, const DirectX::XMFLOAT4X4& right,
+	DirectX::XMFLOAT4X4* result, size_t count);
+
+// Polynomial sin/cos after reduction to [-pi/2, pi/2]. Fast is a degree
+// 7/6 fit with about 1e-5 absolute error, Precise degree 11/10 with about
+// 3e-7, the same polynomials as XMScalarSinCosEst and XMScalarSinCos.
+enum class TrigAccuracy
+{
+	Fast,
+	Precise
+};
+
+typedef void (*SinCosKernel)(const float* angles, float* sines, float* cosines, size_t count, TrigAccuracy accuracy);
+
+// Structure of arrays input, one element per object. Null scale streams
+// mean 1 and null position streams 0, so rotation only matrices need just
+// the angles.
+struct SrtStreams
+{
+	const float* pitch;
+	const float* yaw;
+	const float* roll;
+	const float* scaleX;
+	const float* scaleY;
+	const float* scaleZ;
+	const float* positionX;
+	const float* positionY;
+	const float* positionZ;
+};
+
+// result[i] = scale * XMMatrixRotationRollPitchYaw(pitch, yaw, roll) * translation
+typedef void (*ComposeSrtKernel)(const SrtStreams& streams, DirectX::XMFLOAT4X4* result, size_t count, TrigAccuracy accuracy);
+
+struct TransformKernels
+{
+	SimdLevel level;
+	MultiplyTransposeKernel multiplyTranspose;
+	SinCosKernel sinCos;	// 4 lanes with SSE2, 8 with AVX2
+	ComposeSrtKernel composeSrt;
+};
+
+// kernels for the detected CPU, selected once
+const TransformKernels& GetTransformKernels();
+// kernels for one level, levels the CPU lacks fall back to the detected one
+const TransformKernels& GetTransformKernels(SimdLevel level);
+
+// Largest difference between a level's kernels and the scalar ones over
+// random matrices, in units in the last place of the sum of the absolute
+// products, which bounds the rounding error of a 4 term dot product.
+float MeasureTransformUlp(SimdLevel level, size_t matrixCount, uint32_t seed);
+// true if every kernel of the level stays within maxUlp of scalar
+bool CheckTransformConformance(SimdLevel level, float maxUlp);
+
+// largest absolute error of a level's sin/cos against double precision, for angles in [-range, range]
+float MeasureSinCosError(SimdLevel level, TrigAccuracy accuracy, size_t angleCount, float range, uint32_t seed);
+// largest element difference of composeSrt against XMMatrixRotationRollPitchYaw with scale and translation
+float MeasureSrtError(SimdLevel level, TrigAccuracy accuracy, size_t matrixCount, uint32_t seed);
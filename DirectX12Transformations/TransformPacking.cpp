@@ -0,0 +1,32 @@
+#include <xmmintrin.h>
+#include "TransformCore.h"
+#include "TransformPacking.h"
+
+using namespace DirectX;
+
+void PackAffineTransforms(const XMFLOAT4X4* worldMats, AffineTransform* packed, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		const float* src = &worldMats[i]._11;
+		float* dst = &packed[i].rows[0].x;
+
+		__m128 row0 = _mm_loadu_ps(src);
+		__m128 row1 = _mm_loadu_ps(src + 4);
+		__m128 row2 = _mm_loadu_ps(src + 8);
+		__m128 row3 = _mm_loadu_ps(src + 12);
+		_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+
+		// the fourth column of an affine matrix is always (0, 0, 0, 1) and is dropped
+		_mm_storeu_ps(dst, row0);
+		_mm_storeu_ps(dst + 4, row1);
+		_mm_storeu_ps(dst + 8, row2);
+	}
+}
+
+void XM_CALLCONV PackWvpTransforms(const XMFLOAT4X4* worldMats, FXMMATRIX viewProjection, XMFLOAT4X4* packed, size_t count)
+{
+	XMFLOAT4X4 viewProjectionMat;
+	XMStoreFloat4x4(&viewProjectionMat, viewProjection);
+	GetTransformKernels().multiplyTranspose(worldMats, viewProjectionMat, packed, count);
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstddef>
+
+// World matrix as uploaded in affine mode: the transposed upper 3x4 of a
+// row-vector affine matrix. Each row is dotted with float4(pos, 1) in the shader.
+struct AffineTransform
+{
+	DirectX::XMFLOAT4 rows[3];
+};
+
+// bulk conversion of affine world matrices to the 48 byte upload format
+void PackAffineTransforms(const DirectX::XMFLOAT4X4* worldMats, AffineTransform* packed, size_t count);
+
+// the 64 byte format: transposed world * viewProjection per object
+void XM_CALLCONV PackWvpTransforms(const DirectX::XMFLOAT4X4* worldMats, DirectX::FXMMATRIX viewProjection,
+	DirectX::XMFLOAT4X4* packed, size_t count);
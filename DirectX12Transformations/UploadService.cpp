@@ -0,0 +1,306 @@
+#include "stdafx.h"
+#include "d3dx12.h"
+#include "UploadService.h"
+
+UploadService::UploadService()
+	: m_pageSize(0), m_batchIsOpen(false), m_footprintArena(64 * 1024),
+	m_nextToken(COMPLETED_TOKEN + 1), m_gpuWaitedToken(COMPLETED_TOKEN)
+{
+}
+
+UploadService::~UploadService()
+{
+	// staging memory may still be read by the copy queue
+	if (m_fence)
+	{
+		WaitOnCpu(m_nextToken - 1);
+	}
+}
+
+HRESULT UploadService::Init(ID3D12Device* device, UINT64 pageSize)
+{
+	m_device = device;
+	m_pageSize = pageSize;
+
+	D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+	queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+	queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+
+	HRESULT hr = m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_copyQueue));
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+	m_copyQueue->SetName(L"Upload Copy Queue");
+
+	hr = m_device->CreateFence(COMPLETED_TOKEN, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence));
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	return S_OK;
+}
+
+void UploadService::OpenBatch()
+{
+	if (m_batchIsOpen)
+	{
+		return;
+	}
+
+	RetireCompleted();
+
+	HRESULT hr;
+	if (!m_freeBatches.empty())
+	{
+		m_openBatch = m_freeBatches.back();
+		m_freeBatches.pop_back();
+
+		hr = m_openBatch.allocator->Reset();
+		if (FAILED(hr))
+		{
+			exit(-1);
+		}
+
+		hr = m_openBatch.commandList->Reset(m_openBatch.allocator.Get(), nullptr);
+		if (FAILED(hr))
+		{
+			exit(-1);
+		}
+	}
+	else
+	{
+		m_openBatch = Batch();
+
+		hr = m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&m_openBatch.allocator));
+		if (FAILED(hr))
+		{
+			exit(-1);
+		}
+
+		hr = m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, m_openBatch.allocator.Get(), nullptr, IID_PPV_ARGS(&m_openBatch.commandList));
+		if (FAILED(hr))
+		{
+			exit(-1);
+		}
+	}
+
+	m_openBatch.token = m_nextToken;
+	m_batchIsOpen = true;
+}
+
+void UploadService::AllocateStaging(UINT64 size, UINT64 alignment, StagingPage** ppPage, UINT64* pOffset)
+{
+	std::vector<StagingPage>& pages = m_openBatch.pages;
+
+	if (!pages.empty())
+	{
+		StagingPage& page = pages.back();
+		UINT64 offset = (page.used + alignment - 1) & ~(alignment - 1);
+		if (offset + size <= page.size)
+		{
+			page.used = offset + size;
+			*ppPage = &page;
+			*pOffset = offset;
+			return;
+		}
+	}
+
+	// requests larger than a page get a dedicated one, which is not recycled
+	StagingPage page = {};
+	if (size <= m_pageSize && !m_freePages.empty())
+	{
+		page = m_freePages.back();
+		m_freePages.pop_back();
+	}
+	else
+	{
+		page.size = size > m_pageSize ? size : m_pageSize;
+
+		HRESULT hr = m_device->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer(page.size),
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(&page.resource));
+		if (FAILED(hr))
+		{
+			exit(-1);
+		}
+		page.resource->SetName(L"Upload Staging Page");
+
+		// persistently mapped, the CPU never reads it
+		CD3DX12_RANGE readRange(0, 0);
+		hr = page.resource->Map(0, &readRange, reinterpret_cast<void**>(&page.cpuAddress));
+		if (FAILED(hr))
+		{
+			exit(-1);
+		}
+	}
+
+	page.used = size;
+	pages.push_back(page);
+
+	*ppPage = &pages.back();
+	*pOffset = 0;
+}
+
+void UploadService::RetireCompleted()
+{
+	const UINT64 completed = m_fence->GetCompletedValue();
+
+	while (!m_inFlight.empty() && m_inFlight.front().token <= completed)
+	{
+		Batch& batch = m_inFlight.front();
+		for (StagingPage& page : batch.pages)
+		{
+			if (page.size == m_pageSize)
+			{
+				m_freePages.push_back(page);
+			}
+		}
+		batch.pages.clear();
+
+		m_freeBatches.push_back(batch);
+		m_inFlight.pop_front();
+	}
+}
+
+UploadToken UploadService::UploadBuffer(ID3D12Resource* destination, UINT64 destinationOffset, const void* data, UINT64 size)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	OpenBatch();
+
+	StagingPage* page;
+	UINT64 offset;
+	AllocateStaging(size, 16, &page, &offset);
+
+	memcpy(page->cpuAddress + offset, data, size);
+	m_openBatch.commandList->CopyBufferRegion(destination, destinationOffset, page->resource.Get(), offset, size);
+
+	return m_openBatch.token;
+}
+
+UploadToken UploadService::UploadTexture(ID3D12Resource* destination, UINT firstSubresource, UINT numSubresources, const D3D12_SUBRESOURCE_DATA* data)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	OpenBatch();
+
+	// the footprints go in the arena, the d3dx12 overload that queries them itself heap allocates per call
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT* layouts = m_footprintArena.Allocate<D3D12_PLACED_SUBRESOURCE_FOOTPRINT>(numSubresources);
+	UINT* numRows = m_footprintArena.Allocate<UINT>(numSubresources);
+	UINT64* rowSizes = m_footprintArena.Allocate<UINT64>(numSubresources);
+	if (layouts == nullptr || numRows == nullptr || rowSizes == nullptr)
+	{
+		exit(-1);
+	}
+
+	D3D12_RESOURCE_DESC desc = destination->GetDesc();
+	UINT64 size;
+	m_device->GetCopyableFootprints(&desc, firstSubresource, numSubresources, 0, layouts, numRows, rowSizes, &size);
+
+	StagingPage* page;
+	UINT64 offset;
+	AllocateStaging(size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, &page, &offset);
+
+	for (UINT i = 0; i < numSubresources; ++i)
+	{
+		layouts[i].Offset += offset;
+	}
+
+	// lays out the rows with the copyable footprint and records the copies
+	if (UpdateSubresources(m_openBatch.commandList.Get(), destination, page->resource.Get(), firstSubresource, numSubresources, size, layouts, numRows, rowSizes, data) == 0)
+	{
+		exit(-1);
+	}
+
+	m_footprintArena.Reset();
+	return m_openBatch.token;
+}
+
+UploadToken UploadService::FlushLocked()
+{
+	if (!m_batchIsOpen)
+	{
+		return m_nextToken - 1;
+	}
+
+	HRESULT hr = m_openBatch.commandList->Close();
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
+
+	ID3D12CommandList* ppCommandLists[] = { m_openBatch.commandList.Get() };
+	m_copyQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+
+	hr = m_copyQueue->Signal(m_fence.Get(), m_openBatch.token);
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
+
+	m_inFlight.push_back(m_openBatch);
+	m_openBatch = Batch();
+	m_batchIsOpen = false;
+
+	return m_nextToken++;
+}
+
+UploadToken UploadService::Flush()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return FlushLocked();
+}
+
+bool UploadService::IsComplete(UploadToken token) const
+{
+	return m_fence->GetCompletedValue() >= token;
+}
+
+void UploadService::WaitOnGpu(ID3D12CommandQueue* queue, UploadToken token)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (token <= m_gpuWaitedToken || m_fence->GetCompletedValue() >= token)
+	{
+		return;
+	}
+
+	// the upload is still being recorded
+	if (m_batchIsOpen && token == m_openBatch.token)
+	{
+		FlushLocked();
+	}
+
+	HRESULT hr = queue->Wait(m_fence.Get(), token);
+	if (FAILED(hr))
+	{
+		exit(-1);
+	}
+	m_gpuWaitedToken = token;
+}
+
+void UploadService::WaitOnCpu(UploadToken token)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_batchIsOpen && token == m_openBatch.token)
+		{
+			FlushLocked();
+		}
+	}
+
+	// without an event the call blocks this thread only, so concurrent waits on
+	// different tokens cannot take each other's wake-up
+	if (m_fence->GetCompletedValue() < token)
+	{
+		HRESULT hr = m_fence->SetEventOnCompletion(token, nullptr);
+		if (FAILED(hr))
+		{
+			exit(-1);
+		}
+	}
+}
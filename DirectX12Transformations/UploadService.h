@@ -0,0 +1,81 @@
+#pragma once
+#include <d3d12.h>
+#include <wrl.h>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include "FrameArena.h"
+
+// fence value of the copy queue submission that carries an upload
+typedef uint64_t UploadToken;
+
+// Uploads geometry and textures on a copy queue with its own fence, so
+// streaming does not serialize with rendering. Requests may come from any
+// thread; they are recorded into the open batch, which Flush submits.
+// Destination resources are created in the common state: buffers and
+// textures are promoted to copy dest on the copy queue and decay back when
+// the submission completes, so no barriers are needed on either queue.
+class UploadService
+{
+private:
+
+	struct StagingPage
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+		UINT8* cpuAddress;
+		UINT64 size;
+		UINT64 used;
+	};
+
+	struct Batch
+	{
+		Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator;
+		Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList;
+		std::vector<StagingPage> pages;
+		UploadToken token;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D12Device> m_device;
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_copyQueue;
+	Microsoft::WRL::ComPtr<ID3D12Fence> m_fence;
+	UINT64 m_pageSize;
+
+	std::mutex m_mutex;
+	Batch m_openBatch;
+	bool m_batchIsOpen;
+	std::deque<Batch> m_inFlight;	// submission order
+	std::vector<Batch> m_freeBatches;
+	std::vector<StagingPage> m_freePages;
+	FrameArena m_footprintArena;	// texture copy layouts, reset after every upload
+
+	UploadToken m_nextToken;
+	UploadToken m_gpuWaitedToken;	// highest token a graphics queue already waits for
+
+	void OpenBatch();
+	void AllocateStaging(UINT64 size, UINT64 alignment, StagingPage** ppPage, UINT64* pOffset);
+	void RetireCompleted();
+	UploadToken FlushLocked();
+
+public:
+	// token of data that is already on the GPU
+	static const UploadToken COMPLETED_TOKEN = 0;
+
+	UploadService();
+	~UploadService();
+
+	HRESULT Init(ID3D12Device* device, UINT64 pageSize = 4 * 1024 * 1024);
+
+	UploadToken UploadBuffer(ID3D12Resource* destination, UINT64 destinationOffset, const void* data, UINT64 size);
+	UploadToken UploadTexture(ID3D12Resource* destination, UINT firstSubresource, UINT numSubresources, const D3D12_SUBRESOURCE_DATA* data);
+
+	// submits the open batch, returns its token
+	UploadToken Flush();
+
+	bool IsComplete(UploadToken token) const;
+	// makes queue wait for the upload before its next submission, a no-op once the
+	// token completed or an earlier wait already covers it. Waits are tracked for
+	// one consuming queue, the graphics queue.
+	void WaitOnGpu(ID3D12CommandQueue* queue, UploadToken token);
+	void WaitOnCpu(UploadToken token);
+};
@@ -0,0 +1,135 @@
+#include <cassert>
+#include <cstring>
+#include <emmintrin.h>
+#include <immintrin.h>
+#include "CpuFeatures.h"
+#include "UploadWriter.h"
+
+namespace
+{
+	const size_t CACHE_LINE_SIZE = 64;
+
+	// below this the head/tail split and the store ordering cost more than
+	// the cache lines they save, so small copies use regular stores
+	const size_t STREAMING_COPY_MIN_SIZE = 4 * CACHE_LINE_SIZE;
+
+	typedef void(*StreamingCopyKernel)(uint8_t* dst, const uint8_t* src, size_t lines);
+
+	void StreamLinesScalar(uint8_t* dst, const uint8_t* src, size_t lines)
+	{
+		memcpy(dst, src, lines * CACHE_LINE_SIZE);
+	}
+
+	void StreamLinesSse2(uint8_t* dst, const uint8_t* src, size_t lines)
+	{
+		for (size_t i = 0; i < lines; ++i)
+		{
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+			__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32));
+			__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 48));
+			_mm_stream_si128(reinterpret_cast<__m128i*>(dst), a);
+			_mm_stream_si128(reinterpret_cast<__m128i*>(dst + 16), b);
+			_mm_stream_si128(reinterpret_cast<__m128i*>(dst + 32), c);
+			_mm_stream_si128(reinterpret_cast<__m128i*>(dst + 48), d);
+			src += CACHE_LINE_SIZE;
+			dst += CACHE_LINE_SIZE;
+		}
+	}
+
+	SIMD_TARGET_AVX2 void StreamLinesAvx2(uint8_t* dst, const uint8_t* src, size_t lines)
+	{
+		for (size_t i = 0; i < lines; ++i)
+		{
+			__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+			__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 32));
+			_mm256_stream_si256(reinterpret_cast<__m256i*>(dst), a);
+			_mm256_stream_si256(reinterpret_cast<__m256i*>(dst + 32), b);
+			src += CACHE_LINE_SIZE;
+			dst += CACHE_LINE_SIZE;
+		}
+	}
+
+	StreamingCopyKernel SelectKernel()
+	{
+		switch (GetCpuSimdLevel())
+		{
+		case SimdLevel::Avx2:
+			return StreamLinesAvx2;
+		case SimdLevel::Sse41:
+		case SimdLevel::Sse2:
+			return StreamLinesSse2;
+		default:
+			return StreamLinesScalar;
+		}
+	}
+}
+
+void StreamingCopy(void* dst, const void* src, size_t size)
+{
+	static const StreamingCopyKernel kernel = SelectKernel();
+
+	if (size < STREAMING_COPY_MIN_SIZE)
+	{
+		memcpy(dst, src, size);
+		return;
+	}
+
+	uint8_t* dstBytes = static_cast<uint8_t*>(dst);
+	const uint8_t* srcBytes = static_cast<const uint8_t*>(src);
+
+	// regular stores up to the first cache line boundary
+	size_t head = (CACHE_LINE_SIZE - (reinterpret_cast<uintptr_t>(dstBytes) & (CACHE_LINE_SIZE - 1))) & (CACHE_LINE_SIZE - 1);
+	if (head > size)
+	{
+		head = size;
+	}
+	memcpy(dstBytes, srcBytes, head);
+	dstBytes += head;
+	srcBytes += head;
+	size -= head;
+
+	size_t lines = size / CACHE_LINE_SIZE;
+	kernel(dstBytes, srcBytes, lines);
+	dstBytes += lines * CACHE_LINE_SIZE;
+	srcBytes += lines * CACHE_LINE_SIZE;
+
+	memcpy(dstBytes, srcBytes, size - lines * CACHE_LINE_SIZE);
+}
+
+UploadWriter::UploadWriter()
+	: m_mapped(nullptr), m_size(0), m_bytesWritten(0)
+{
+}
+
+UploadWriter::UploadWriter(void* mapped, size_t size)
+	: m_mapped(static_cast<uint8_t*>(mapped)), m_size(size), m_bytesWritten(0)
+{
+}
+
+void UploadWriter::Write(size_t offset, const void* src, size_t size)
+{
+	assert(offset <= m_size && size <= m_size - offset);
+	StreamingCopy(m_mapped + offset, src, size);
+	m_bytesWritten += size;
+}
+
+void UploadWriter::Flush()
+{
+	_mm_sfence();
+}
+
+size_t UploadWriter::GetSize() const
+{
+	return m_size;
+}
+
+size_t UploadWriter::GetBytesWritten() const
+{
+	return m_bytesWritten;
+}
+
+void UploadWriter::ResetBytesWritten()
+{
+	m_bytesWritten = 0;
+}
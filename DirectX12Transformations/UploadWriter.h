@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Copies into write-combined memory with aligned non-temporal stores.
+// Bulk data is written in full 64 byte cache lines, only the unaligned head
+// and tail fall back to regular stores. Copies of a few cache lines or less
+// are plain memcpy. The destination is never read.
+void StreamingCopy(void* dst, const void* src, size_t size);
+
+// Write-only view of a mapped upload heap. There is deliberately no accessor
+// returning the mapped pointer, so callers cannot read back from it.
+class UploadWriter
+{
+private:
+
+	uint8_t* m_mapped;
+	size_t m_size;
+	size_t m_bytesWritten;
+
+public:
+	UploadWriter();
+	UploadWriter(void* mapped, size_t size);
+
+	// offset + size must not exceed the mapped size
+	void Write(size_t offset, const void* src, size_t size);
+
+	// orders the streaming stores before the command list is submitted
+	void Flush();
+
+	size_t GetSize() const;
+	size_t GetBytesWritten() const;
+	void ResetBytesWritten();
+};
@@ -0,0 +1,160 @@
+#include "Test.h"
+#include "EntityWorld.h"
+#include <vector>
+
+namespace
+{
+	struct Position
+	{
+		float x, y, z;
+	};
+
+	struct Velocity
+	{
+		float x, y, z;
+	};
+
+	struct alignas(16) Color
+	{
+		float rgba[4];
+	};
+}
+
+TEST(EntityWorld_HandleGenerations)
+{
+	EntityWorld world;
+	ComponentType position = world.RegisterComponent<Position>();
+	ComponentMask mask = EntityWorld::MaskOf(position);
+
+	Entity first = world.Create(mask);
+	Entity second = world.Create(mask);
+	CHECK(world.IsAlive(first));
+	CHECK(world.IsAlive(second));
+	CHECK(first.index != second.index);
+	CHECK_EQUAL(static_cast<size_t>(2), world.GetEntityCount());
+
+	world.Destroy(first);
+	CHECK(!world.IsAlive(first));
+	CHECK(world.IsAlive(second));
+	CHECK(world.Get<Position>(first, position) == nullptr);
+	CHECK_EQUAL(static_cast<size_t>(1), world.GetEntityCount());
+
+	// the index is reused with a new generation, the old handle stays dead
+	Entity reused = world.Create(mask);
+	CHECK_EQUAL(first.index, reused.index);
+	CHECK(reused.generation != first.generation);
+	CHECK(world.IsAlive(reused));
+	CHECK(!world.IsAlive(first));
+	CHECK(world.Get<Position>(reused, position) != nullptr);
+
+	// destroying through a stale handle does not touch the new entity
+	world.Destroy(first);
+	CHECK(world.IsAlive(reused));
+	CHECK_EQUAL(static_cast<size_t>(2), world.GetEntityCount());
+	CHECK(!world.SetComponents(first, 0));
+
+	// every reuse moves the generation on
+	world.Destroy(reused);
+	Entity again = world.Create(mask);
+	CHECK_EQUAL(first.index, again.index);
+	CHECK(again.generation != reused.generation);
+	CHECK(again.generation != first.generation);
+	CHECK(!world.IsAlive(reused));
+}
+
+TEST(EntityWorld_ComponentsStartZeroed)
+{
+	EntityWorld world;
+	ComponentType position = world.RegisterComponent<Position>();
+
+	Entity entity = world.Create(EntityWorld::MaskOf(position));
+	world.Get<Position>(entity, position)->x = 5.0f;
+	world.Destroy(entity);
+
+	// the recycled row is cleared for the next entity
+	Entity reused = world.Create(EntityWorld::MaskOf(position));
+	const Position* data = world.Get<Position>(reused, position);
+	CHECK_EQUAL(0.0f, data->x);
+	CHECK_EQUAL(0.0f, data->y);
+	CHECK_EQUAL(0.0f, data->z);
+}
+
+TEST(EntityWorld_ArchetypeMoveKeepsData)
+{
+	EntityWorld world;
+	ComponentType position = world.RegisterComponent<Position>();
+	ComponentType velocity = world.RegisterComponent<Velocity>();
+	ComponentType color = world.RegisterComponent<Color>();
+
+	// enough entities for several chunks, so moves fill the holes they leave
+	const uint32_t count = 2000;
+	std::vector<Entity> entities;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		Entity entity = world.Create(EntityWorld::MaskOf(position) | EntityWorld::MaskOf(velocity));
+		Position* p = world.Get<Position>(entity, position);
+		p->x = static_cast<float>(i);
+		p->y = 2.0f * i;
+		p->z = 3.0f * i;
+		world.Get<Velocity>(entity, velocity)->x = -static_cast<float>(i);
+		entities.push_back(entity);
+	}
+
+	// every third entity gains a color, every third after that loses its velocity
+	for (uint32_t i = 0; i < count; i += 3)
+	{
+		CHECK(world.AddComponents(entities[i], EntityWorld::MaskOf(color)));
+		Color* c = world.Get<Color>(entities[i], color);
+		CHECK(c != nullptr);
+		CHECK_EQUAL(0.0f, c->rgba[0]);
+		c->rgba[3] = static_cast<float>(i);
+	}
+	for (uint32_t i = 1; i < count; i += 3)
+	{
+		CHECK(world.RemoveComponents(entities[i], EntityWorld::MaskOf(velocity)));
+	}
+
+	CHECK_EQUAL(static_cast<size_t>(count), world.GetEntityCount());
+	CHECK_EQUAL(static_cast<size_t>(3), world.GetArchetypeCount());
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const Entity entity = entities[i];
+		CHECK(world.IsAlive(entity));
+
+		const Position* p = world.Get<Position>(entity, position);
+		CHECK(p != nullptr && p->x == static_cast<float>(i) && p->y == 2.0f * i && p->z == 3.0f * i);
+
+		const Velocity* v = world.Get<Velocity>(entity, velocity);
+		if (i % 3 == 1)
+		{
+			CHECK(v == nullptr);
+			CHECK_EQUAL(EntityWorld::MaskOf(position), world.GetComponents(entity));
+		}
+		else
+		{
+			CHECK(v != nullptr && v->x == -static_cast<float>(i));
+		}
+
+		const Color* c = world.Get<Color>(entity, color);
+		CHECK((c != nullptr) == (i % 3 == 0));
+		if (c != nullptr)
+		{
+			CHECK_EQUAL(static_cast<float>(i), c->rgba[3]);
+			CHECK(reinterpret_cast<uintptr_t>(c) % alignof(Color) == 0);
+		}
+	}
+
+	// the chunk walk sees every entity exactly once
+	size_t visited = 0;
+	world.ForEachChunk(EntityWorld::MaskOf(position), 0, [&](const EntityChunkView& chunk)
+	{
+		const Position* positions = chunk.Get<Position>(position);
+		for (uint32_t row = 0; row < chunk.count; ++row)
+		{
+			CHECK_EQUAL(static_cast<float>(chunk.entities[row].index), positions[row].x);
+		}
+		visited += chunk.count;
+	});
+	CHECK_EQUAL(static_cast<size_t>(count), visited);
+}
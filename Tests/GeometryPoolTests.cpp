@@ -0,0 +1,260 @@
+#include "Test.h"
+#include "GeometryPool.h"
+#include <vector>
+
+namespace
+{
+	const uint32_t SEED = 0x9e3779b9;
+
+	uint32_t NextRandom(uint32_t& state)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+	// the contents every element of a mesh is filled with, unique per mesh and element
+	uint32_t GetTag(uint32_t meshTag, uint32_t element)
+	{
+		return meshTag * 65536 + element;
+	}
+
+	// copies a plan from the old buffer into a new one the way D3D12GeometryPool does:
+	// the prefix in front of the first move stays where it is, then every move
+	void ApplyPlan(const std::vector<GeometryMove>& moves, uint32_t usedCount, const std::vector<uint32_t>& source, std::vector<uint32_t>& destination)
+	{
+		uint32_t prefix = moves.empty() ? usedCount : moves.front().destination;
+		for (uint32_t i = 0; i < prefix; ++i)
+		{
+			destination[i] = source[i];
+		}
+		for (const GeometryMove& move : moves)
+		{
+			for (uint32_t i = 0; i < move.count; ++i)
+			{
+				destination[move.destination + i] = source[move.source + i];
+			}
+		}
+	}
+
+	// moves go down, in ascending source order, never start or end at the same
+	// place as their neighbour and cover everything behind the prefix
+	void CheckMoves(TestContext& context, const std::vector<GeometryMove>& moves, uint32_t usedCount)
+	{
+		uint32_t covered = moves.empty() ? usedCount : moves.front().destination;
+		for (size_t i = 0; i < moves.size(); ++i)
+		{
+			const GeometryMove& move = moves[i];
+			CHECK(move.destination < move.source);
+			CHECK(move.count > 0);
+			CHECK_EQUAL(covered, move.destination);
+			covered += move.count;
+			if (i > 0)
+			{
+				const GeometryMove& previous = moves[i - 1];
+				CHECK(previous.source + previous.count <= move.source);
+				// neighbours shifting by the same amount are one move
+				CHECK(previous.source + previous.count != move.source || previous.destination + previous.count != move.destination);
+			}
+		}
+		CHECK_EQUAL(usedCount, covered);
+	}
+}
+
+TEST(RangeAllocator_AllocateAndFree)
+{
+	RangeAllocator allocator(100);
+	CHECK_EQUAL(0u, allocator.Allocate(10));
+	CHECK_EQUAL(10u, allocator.Allocate(20));
+	CHECK_EQUAL(30u, allocator.Allocate(30));
+	CHECK_EQUAL(40u, allocator.GetFreeCount());
+
+	CHECK(allocator.Allocate(0) == RangeAllocator::INVALID_OFFSET);
+	CHECK(allocator.Allocate(41) == RangeAllocator::INVALID_OFFSET);
+
+	// best fit picks the 20 element hole over the 40 element tail
+	allocator.Free(10, 20);
+	CHECK_EQUAL(2u, allocator.GetFreeRangeCount());
+	CHECK_EQUAL(10u, allocator.Allocate(15));
+	CHECK_EQUAL(60u, allocator.Allocate(40));
+	CHECK_EQUAL(5u, allocator.GetFreeCount());
+	CHECK_EQUAL(5u, allocator.GetLargestFreeRange());
+}
+
+TEST(RangeAllocator_CoalescesNeighbours)
+{
+	RangeAllocator allocator(30);
+	uint32_t a = allocator.Allocate(10);
+	uint32_t b = allocator.Allocate(10);
+	uint32_t c = allocator.Allocate(10);
+	CHECK_EQUAL(0u, allocator.GetFreeRangeCount());
+
+	allocator.Free(b, 10);
+	CHECK_EQUAL(1u, allocator.GetFreeRangeCount());
+
+	// with the range after it
+	allocator.Free(a, 10);
+	CHECK_EQUAL(1u, allocator.GetFreeRangeCount());
+	CHECK_EQUAL(20u, allocator.GetLargestFreeRange());
+
+	// with the range before it
+	allocator.Free(c, 10);
+	CHECK_EQUAL(1u, allocator.GetFreeRangeCount());
+	CHECK_EQUAL(30u, allocator.GetLargestFreeRange());
+	CHECK_EQUAL(0u, allocator.Allocate(30));
+
+	allocator.ResetPacked(12);
+	CHECK_EQUAL(18u, allocator.GetFreeCount());
+	CHECK_EQUAL(12u, allocator.Allocate(18));
+}
+
+TEST(GeometryPool_CompactMergesNeighbours)
+{
+	GeometryPool pool(1000, 3000);
+	MeshHandle a = pool.AddMesh(10, 30);
+	MeshHandle b = pool.AddMesh(20, 60);
+	MeshHandle c = pool.AddMesh(30, 90);
+	MeshHandle d = pool.AddMesh(5, 15);
+	CHECK_EQUAL(0.0f, pool.GetFragmentation());
+
+	pool.RemoveMesh(a);
+	CHECK(!pool.IsValid(a));
+	CHECK(pool.GetFragmentation() > 0.0f);
+
+	// b, c and d shift down by the same amount, so they are copied as one range
+	CompactionPlan plan;
+	CHECK(pool.Compact(plan));
+	CHECK_EQUAL(1u, plan.vertexMoves.size());
+	CHECK_EQUAL(1u, plan.indexMoves.size());
+	if (plan.vertexMoves.size() == 1 && plan.indexMoves.size() == 1)
+	{
+		CHECK_EQUAL(10u, plan.vertexMoves[0].source);
+		CHECK_EQUAL(0u, plan.vertexMoves[0].destination);
+		CHECK_EQUAL(55u, plan.vertexMoves[0].count);
+		CHECK_EQUAL(30u, plan.indexMoves[0].source);
+		CHECK_EQUAL(165u, plan.indexMoves[0].count);
+	}
+
+	CHECK_EQUAL(0u, pool.GetMesh(b).baseVertex);
+	CHECK_EQUAL(20u, pool.GetMesh(c).baseVertex);
+	CHECK_EQUAL(50u, pool.GetMesh(d).baseVertex);
+	CHECK_EQUAL(150u, pool.GetMesh(d).firstIndex);
+	CHECK_EQUAL(0.0f, pool.GetFragmentation());
+
+	// already packed
+	CHECK(!pool.Compact(plan));
+	CHECK(plan.vertexMoves.empty() && plan.indexMoves.empty());
+}
+
+TEST(GeometryPool_CompactKeepsPrefix)
+{
+	GeometryPool pool(1000, 3000);
+	MeshHandle a = pool.AddMesh(10, 30);
+	MeshHandle b = pool.AddMesh(20, 60);
+	MeshHandle c = pool.AddMesh(30, 90);
+	MeshHandle d = pool.AddMesh(5, 15);
+
+	// a hole at the end leaves nothing to move
+	pool.RemoveMesh(d);
+	CompactionPlan plan;
+	CHECK(!pool.Compact(plan));
+
+	// a and the hole behind it: a stays, c moves down on its own
+	pool.RemoveMesh(b);
+	CHECK(pool.Compact(plan));
+	CheckMoves(context, plan.vertexMoves, pool.GetUsedVertexCount());
+	CheckMoves(context, plan.indexMoves, pool.GetUsedIndexCount());
+	CHECK_EQUAL(0u, pool.GetMesh(a).baseVertex);
+	CHECK_EQUAL(10u, pool.GetMesh(c).baseVertex);
+	CHECK_EQUAL(30u, pool.GetMesh(c).firstIndex);
+	if (!plan.vertexMoves.empty())
+	{
+		CHECK_EQUAL(10u, plan.vertexMoves.front().destination);
+		CHECK_EQUAL(30u, plan.vertexMoves.front().source);
+	}
+
+	// handles are reused and new meshes go behind the packed data
+	MeshHandle e = pool.AddMesh(7, 21);
+	CHECK(e == b || e == d);
+	CHECK_EQUAL(40u, pool.GetMesh(e).baseVertex);
+	CHECK_EQUAL(120u, pool.GetMesh(e).firstIndex);
+}
+
+// random adds and removes, compacting whenever an add fails; after every
+// compaction the copied buffers hold exactly the data of the live meshes
+TEST(GeometryPool_CompactPreservesContents)
+{
+	const uint32_t vertexCapacity = 20000;
+	const uint32_t indexCapacity = 60000;
+	GeometryPool pool(vertexCapacity, indexCapacity);
+	std::vector<uint32_t> vertices(vertexCapacity);
+	std::vector<uint32_t> indices(indexCapacity);
+	std::vector<uint32_t> packedVertices(vertexCapacity);
+	std::vector<uint32_t> packedIndices(indexCapacity);
+	std::vector<MeshHandle> meshes;
+	std::vector<uint32_t> tags;
+
+	uint32_t random = SEED;
+	uint32_t compactions = 0;
+	for (uint32_t step = 0; step < 5000; ++step)
+	{
+		if (!meshes.empty() && NextRandom(random) % 3 == 0)
+		{
+			size_t k = NextRandom(random) % meshes.size();
+			pool.RemoveMesh(meshes[k]);
+			meshes[k] = meshes.back();
+			meshes.pop_back();
+			tags[k] = tags.back();
+			tags.pop_back();
+			continue;
+		}
+
+		uint32_t vertexCount = 1 + NextRandom(random) % 300;
+		uint32_t indexCount = 3 * (1 + NextRandom(random) % 200);
+		MeshHandle mesh = pool.AddMesh(vertexCount, indexCount);
+		if (mesh == GeometryPool::INVALID_HANDLE)
+		{
+			CompactionPlan plan;
+			pool.Compact(plan);
+			++compactions;
+			CheckMoves(context, plan.vertexMoves, pool.GetUsedVertexCount());
+			CheckMoves(context, plan.indexMoves, pool.GetUsedIndexCount());
+			ApplyPlan(plan.vertexMoves, pool.GetUsedVertexCount(), vertices, packedVertices);
+			ApplyPlan(plan.indexMoves, pool.GetUsedIndexCount(), indices, packedIndices);
+			vertices.swap(packedVertices);
+			indices.swap(packedIndices);
+
+			uint32_t mismatches = 0;
+			for (size_t k = 0; k < meshes.size(); ++k)
+			{
+				const MeshRange& range = pool.GetMesh(meshes[k]);
+				for (uint32_t i = 0; i < range.vertexCount; ++i)
+				{
+					mismatches += vertices[range.baseVertex + i] != GetTag(tags[k], i);
+				}
+				for (uint32_t i = 0; i < range.indexCount; ++i)
+				{
+					mismatches += indices[range.firstIndex + i] != GetTag(tags[k], i);
+				}
+			}
+			CHECK_EQUAL(0u, mismatches);
+			CHECK_EQUAL(0.0f, pool.GetFragmentation());
+			continue;
+		}
+
+		const MeshRange& range = pool.GetMesh(mesh);
+		for (uint32_t i = 0; i < vertexCount; ++i)
+		{
+			vertices[range.baseVertex + i] = GetTag(step, i);
+		}
+		for (uint32_t i = 0; i < indexCount; ++i)
+		{
+			indices[range.firstIndex + i] = GetTag(step, i);
+		}
+		meshes.push_back(mesh);
+		tags.push_back(step);
+	}
+
+	CHECK(compactions > 0);
+}
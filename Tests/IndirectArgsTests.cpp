@@ -0,0 +1,162 @@
+#include "Test.h"
+#include "IndirectArgsBuilder.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	const uint32_t SEED = 0x3c6ef372;
+	const size_t DRAWS_PER_BLOCK = 64;
+	const uint8_t UNWRITTEN = 0xcd;
+
+	uint32_t NextRandom(uint32_t& state)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+	std::vector<DrawItem> BuildDraws(size_t count)
+	{
+		uint32_t random = SEED;
+		std::vector<DrawItem> draws(count);
+		for (DrawItem& draw : draws)
+		{
+			draw.indexCount = NextRandom(random);
+			draw.startIndex = NextRandom(random);
+			draw.baseVertex = static_cast<int32_t>(NextRandom(random));
+			draw.objectIndex = NextRandom(random);
+			draw.pipeline = NextRandom(random);
+			draw.mesh = NextRandom(random);
+		}
+		return draws;
+	}
+
+	// one more command than needed, so writes past the end show up
+	std::vector<IndirectDrawCommand> BuildOutput(size_t count)
+	{
+		std::vector<IndirectDrawCommand> out(count + 1);
+		memset(out.data(), UNWRITTEN, out.size() * sizeof(IndirectDrawCommand));
+		return out;
+	}
+
+	bool IsUnwritten(const IndirectDrawCommand* commands, size_t count)
+	{
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(commands);
+		for (size_t i = 0; i < count * sizeof(IndirectDrawCommand); ++i)
+		{
+			if (bytes[i] != UNWRITTEN)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Build against the single threaded BuildRange over the whole array
+	void CheckBuildMatchesRange(TestContext& context, IndirectArgsBuilder& builder, const std::vector<DrawItem>& draws, const uint8_t* visibility)
+	{
+		std::vector<IndirectDrawCommand> expected = BuildOutput(draws.size());
+		uint32_t expectedCount = IndirectArgsBuilder::BuildRange(draws.data(), draws.size(), visibility, expected.data());
+
+		std::vector<IndirectDrawCommand> built = BuildOutput(draws.size());
+		uint32_t count = builder.Build(draws.data(), draws.size(), visibility, built.data());
+
+		CHECK_EQUAL(expectedCount, count);
+		CHECK(memcmp(expected.data(), built.data(), expectedCount * sizeof(IndirectDrawCommand)) == 0);
+		CHECK(IsUnwritten(built.data() + count, built.size() - count));
+	}
+}
+
+TEST(IndirectArgs_WriteCommandLayout)
+{
+	DrawItem draw = { 36, 120, -24, 7, 3, 5 };
+	std::vector<IndirectDrawCommand> out = BuildOutput(1);
+
+	CHECK_EQUAL(1u, IndirectArgsBuilder::BuildRange(&draw, 1, nullptr, out.data()));
+
+	// the shuffle puts objectIndex first, then the D3D12_DRAW_INDEXED_ARGUMENTS fields
+	CHECK_EQUAL(7u, out[0].objectIndex);
+	CHECK_EQUAL(36u, out[0].draw.indexCountPerInstance);
+	CHECK_EQUAL(1u, out[0].draw.instanceCount);
+	CHECK_EQUAL(120u, out[0].draw.startIndexLocation);
+	CHECK_EQUAL(-24, out[0].draw.baseVertexLocation);
+	CHECK_EQUAL(0u, out[0].draw.startInstanceLocation);
+
+	// exactly 24 bytes are stored
+	CHECK(IsUnwritten(&out[1], 1));
+}
+
+TEST(IndirectArgs_BuildRangeSkipsHidden)
+{
+	std::vector<DrawItem> draws = BuildDraws(5);
+	const uint8_t visibility[] = { 0, 1, 0, 0, 1 };
+	std::vector<IndirectDrawCommand> out = BuildOutput(draws.size());
+
+	CHECK_EQUAL(2u, IndirectArgsBuilder::BuildRange(draws.data(), draws.size(), visibility, out.data()));
+	CHECK_EQUAL(draws[1].objectIndex, out[0].objectIndex);
+	CHECK_EQUAL(draws[4].objectIndex, out[1].objectIndex);
+	CHECK_EQUAL(draws[4].baseVertex, out[1].draw.baseVertexLocation);
+	CHECK(IsUnwritten(&out[2], out.size() - 2));
+}
+
+TEST(IndirectArgs_BuildMatchesBuildRange)
+{
+	ThreadPool threadPool(4);
+	IndirectArgsBuilder builder(&threadPool, DRAWS_PER_BLOCK);
+
+	// a partial last block
+	const size_t count = 20 * DRAWS_PER_BLOCK + 17;
+	std::vector<DrawItem> draws = BuildDraws(count);
+
+	CheckBuildMatchesRange(context, builder, draws, nullptr);
+
+	// random, about a third hidden
+	std::vector<uint8_t> visibility(count);
+	uint32_t random = SEED;
+	for (uint8_t& visible : visibility)
+	{
+		visible = NextRandom(random) % 3 != 0 ? 1 : 0;
+	}
+	CheckBuildMatchesRange(context, builder, draws, visibility.data());
+
+	// visible runs that start and end right around block boundaries
+	for (size_t i = 0; i < count; ++i)
+	{
+		size_t inBlock = i % DRAWS_PER_BLOCK;
+		visibility[i] = inBlock < 2 || inBlock >= DRAWS_PER_BLOCK - 3 ? 1 : 0;
+	}
+	CheckBuildMatchesRange(context, builder, draws, visibility.data());
+
+	// whole blocks hidden, others fully visible
+	for (size_t i = 0; i < count; ++i)
+	{
+		visibility[i] = (i / DRAWS_PER_BLOCK) % 3 == 1 ? 1 : 0;
+	}
+	CheckBuildMatchesRange(context, builder, draws, visibility.data());
+
+	// nothing visible writes nothing
+	std::fill(visibility.begin(), visibility.end(), 0);
+	CheckBuildMatchesRange(context, builder, draws, visibility.data());
+}
+
+TEST(IndirectArgs_BuildSmallCounts)
+{
+	ThreadPool threadPool(2);
+	IndirectArgsBuilder builder(&threadPool, DRAWS_PER_BLOCK);
+
+	const size_t counts[] = { 0, 1, DRAWS_PER_BLOCK - 1, DRAWS_PER_BLOCK, DRAWS_PER_BLOCK + 1 };
+	for (size_t count : counts)
+	{
+		std::vector<DrawItem> draws = BuildDraws(count);
+		std::vector<uint8_t> visibility(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			visibility[i] = i % 2 == 0 ? 1 : 0;
+		}
+		CheckBuildMatchesRange(context, builder, draws, nullptr);
+		CheckBuildMatchesRange(context, builder, draws, visibility.data());
+	}
+}
@@ -0,0 +1,7 @@
+#include "Test.h"
+
+// tests register themselves from their translation units
+int main(int argc, char** argv)
+{
+	return RunTests(argc, argv);
+}
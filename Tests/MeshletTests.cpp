@@ -0,0 +1,160 @@
+#include "Test.h"
+#include "ClusterCuller.h"
+#include "MeshletBuilder.h"
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+	struct Grid
+	{
+		std::vector<float> positions;	// three floats per vertex
+		std::vector<uint32_t> indices;
+	};
+
+	// quads in the z = 0 plane, wound so cross(p1 - p0, p2 - p0) points to +z
+	Grid BuildGrid(uint32_t quadsX, uint32_t quadsY)
+	{
+		Grid grid;
+		for (uint32_t y = 0; y <= quadsY; ++y)
+		{
+			for (uint32_t x = 0; x <= quadsX; ++x)
+			{
+				grid.positions.push_back(static_cast<float>(x));
+				grid.positions.push_back(static_cast<float>(y));
+				grid.positions.push_back(0.0f);
+			}
+		}
+
+		const uint32_t rowLength = quadsX + 1;
+		for (uint32_t y = 0; y < quadsY; ++y)
+		{
+			for (uint32_t x = 0; x < quadsX; ++x)
+			{
+				uint32_t corner = y * rowLength + x;
+				uint32_t quad[6] = { corner, corner + 1, corner + rowLength + 1, corner, corner + rowLength + 1, corner + rowLength };
+				grid.indices.insert(grid.indices.end(), quad, quad + 6);
+			}
+		}
+		return grid;
+	}
+
+	// a frustum whose planes every point passes, so only the cone decides
+	ClusterFrustum BuildOpenFrustum()
+	{
+		ClusterFrustum frustum = {};
+		for (uint32_t plane = 0; plane < 6; ++plane)
+		{
+			frustum.planes[plane][3] = 1.0f;
+		}
+		return frustum;
+	}
+
+	// sorted vertex triples, so triangles compare independent of their rotation
+	std::vector<uint64_t> GetTriangleKeys(const std::vector<uint32_t>& indices)
+	{
+		std::vector<uint64_t> keys;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			uint64_t corners[3] = { indices[i], indices[i + 1], indices[i + 2] };
+			std::sort(corners, corners + 3);
+			keys.push_back((corners[0] << 42) | (corners[1] << 21) | corners[2]);
+		}
+		std::sort(keys.begin(), keys.end());
+		return keys;
+	}
+
+	void CheckLimits(TestContext& context, const Grid& grid, uint32_t maxVertices, uint32_t maxTriangles)
+	{
+		MeshletMesh mesh;
+		MeshletBuilder::Build(grid.indices.data(), grid.indices.size(), grid.positions.data(), grid.positions.size() / 3, 3 * sizeof(float),
+			mesh, maxVertices, maxTriangles);
+
+		CHECK_EQUAL(mesh.meshlets.size(), mesh.bounds.size());
+		CHECK_EQUAL(grid.indices.size(), mesh.indices.size());
+
+		uint32_t triangleOffset = 0;
+		for (const Meshlet& meshlet : mesh.meshlets)
+		{
+			CHECK(meshlet.vertexCount > 0 && meshlet.vertexCount <= maxVertices);
+			CHECK(meshlet.triangleCount > 0 && meshlet.triangleCount <= maxTriangles);
+			// the triangles of consecutive meshlets are one contiguous range
+			CHECK_EQUAL(triangleOffset, meshlet.triangleOffset);
+			triangleOffset += meshlet.triangleCount;
+
+			for (uint32_t i = 0; i < meshlet.triangleCount * 3; ++i)
+			{
+				uint8_t local = mesh.triangles[meshlet.triangleOffset * 3 + i];
+				CHECK(local < meshlet.vertexCount);
+				CHECK_EQUAL(mesh.vertices[meshlet.vertexOffset + local], mesh.indices[meshlet.triangleOffset * 3 + i]);
+			}
+		}
+
+		// every triangle ends up in exactly one meshlet
+		CHECK(GetTriangleKeys(grid.indices) == GetTriangleKeys(mesh.indices));
+	}
+}
+
+TEST(Meshlet_DefaultLimits)
+{
+	CheckLimits(context, BuildGrid(40, 30), MeshletBuilder::MAX_VERTICES, MeshletBuilder::MAX_TRIANGLES);
+}
+
+TEST(Meshlet_SmallLimits)
+{
+	// a vertex limit that binds before the triangle limit, and the other way round
+	Grid grid = BuildGrid(16, 16);
+	CheckLimits(context, grid, 8, 64);
+	CheckLimits(context, grid, 64, 5);
+	CheckLimits(context, grid, 3, 1);
+}
+
+TEST(Meshlet_ConeRejectsBackFacingClusters)
+{
+	Grid grid = BuildGrid(8, 8);
+	MeshletMesh mesh;
+	MeshletBuilder::Build(grid.indices.data(), grid.indices.size(), grid.positions.data(), grid.positions.size() / 3, 3 * sizeof(float), mesh);
+
+	const ClusterFrustum frustum = BuildOpenFrustum();
+	const float front[3] = { 4.0f, 4.0f, 10.0f };
+	const float back[3] = { 4.0f, 4.0f, -10.0f };
+
+	CHECK(!mesh.bounds.empty());
+	for (const MeshletBounds& bounds : mesh.bounds)
+	{
+		// a flat cluster has a closed cone around +z
+		CHECK(bounds.coneCutoff < 1.0f);
+		CHECK(bounds.coneAxis[2] > 0.99f);
+		CHECK(ClusterCuller::IsVisible(bounds, frustum, front));
+		CHECK(!ClusterCuller::IsVisible(bounds, frustum, back));
+	}
+
+	ThreadPool threadPool(2);
+	ClusterCuller culler(&threadPool);
+	std::vector<ClusterRange> ranges;
+	CHECK_EQUAL(static_cast<uint32_t>(mesh.meshlets.size()), culler.Cull(mesh, frustum, front, ranges));
+	// neighbouring survivors merge into one range over the whole mesh
+	CHECK_EQUAL(static_cast<size_t>(1), ranges.size());
+
+	ranges.clear();
+	CHECK_EQUAL(0u, culler.Cull(mesh, frustum, back, ranges));
+	CHECK(ranges.empty());
+}
+
+TEST(Meshlet_FrustumRejectsOutsideClusters)
+{
+	Grid grid = BuildGrid(8, 8);
+	MeshletMesh mesh;
+	MeshletBuilder::Build(grid.indices.data(), grid.indices.size(), grid.positions.data(), grid.positions.size() / 3, 3 * sizeof(float), mesh);
+
+	// only x <= -20 is inside, the grid spans [0, 8]
+	ClusterFrustum frustum = BuildOpenFrustum();
+	frustum.planes[0][0] = -1.0f;
+	frustum.planes[0][3] = -20.0f;
+
+	const float front[3] = { 4.0f, 4.0f, 10.0f };
+	for (const MeshletBounds& bounds : mesh.bounds)
+	{
+		CHECK(!ClusterCuller::IsVisible(bounds, frustum, front));
+	}
+}
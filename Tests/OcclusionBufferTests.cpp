@@ -0,0 +1,118 @@
+#include "Test.h"
+#include "OcclusionBuffer.h"
+#include <vector>
+
+namespace
+{
+	const float IDENTITY[16] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+
+	// row-vector left-handed perspective as XMMatrixPerspectiveFovLH with a
+	// 90 degree field of view and square aspect, the eye at the origin looking down +z
+	void BuildProjection(float nearZ, float farZ, float projection[16])
+	{
+		const float range = farZ / (farZ - nearZ);
+		const float matrix[16] = {
+			1.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, 1.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, range, 1.0f,
+			0.0f, 0.0f, -range * nearZ, 0.0f };
+		for (int i = 0; i < 16; ++i)
+		{
+			projection[i] = matrix[i];
+		}
+	}
+
+	// the rectangle [x0, x1] x [y0, y1] at depth z as two triangles
+	void AddRectangle(OcclusionBuffer& buffer, float x0, float y0, float x1, float y1, float z)
+	{
+		const float positions[12] = { x0, y0, z, x1, y0, z, x1, y1, z, x0, y1, z };
+		const uint32_t indices[6] = { 0, 1, 2, 0, 2, 3 };
+		buffer.AddOccluder(positions, 3 * sizeof(float), indices, 6, IDENTITY);
+	}
+
+	bool IsBoxVisible(const OcclusionBuffer& buffer, float x, float y, float z, float halfSize)
+	{
+		const float boundsMin[3] = { x - halfSize, y - halfSize, z - halfSize };
+		const float boundsMax[3] = { x + halfSize, y + halfSize, z + halfSize };
+		return buffer.IsVisible(boundsMin, boundsMax);
+	}
+}
+
+TEST(OcclusionBuffer_EmptyBufferKeepsEverything)
+{
+	ThreadPool threadPool(2);
+	OcclusionBuffer buffer(&threadPool);
+	float projection[16];
+	BuildProjection(0.1f, 100.0f, projection);
+
+	buffer.BeginFrame(projection);
+	buffer.Rasterize();
+
+	CHECK_EQUAL(static_cast<size_t>(0), buffer.GetOccluderTriangleCount());
+	CHECK(IsBoxVisible(buffer, 0.0f, 0.0f, 50.0f, 1.0f));
+	// outside the view it is rejected without an occluder
+	CHECK(!IsBoxVisible(buffer, 500.0f, 0.0f, 50.0f, 1.0f));
+}
+
+TEST(OcclusionBuffer_RejectsBoxesBehindOccluders)
+{
+	ThreadPool threadPool(2);
+	OcclusionBuffer buffer(&threadPool);
+	float projection[16];
+	BuildProjection(0.1f, 100.0f, projection);
+
+	// a wall over the whole view at z = 30, a nearer one over the left half at z = 10
+	buffer.BeginFrame(projection);
+	AddRectangle(buffer, -100.0f, -100.0f, 100.0f, 100.0f, 30.0f);
+	AddRectangle(buffer, -20.0f, -20.0f, 0.0f, 20.0f, 10.0f);
+	buffer.Rasterize();
+	CHECK_EQUAL(static_cast<size_t>(4), buffer.GetOccluderTriangleCount());
+
+	// between the walls: hidden on the left, in front of the far wall on the right
+	CHECK(!IsBoxVisible(buffer, -5.0f, 0.0f, 20.0f, 1.0f));
+	CHECK(IsBoxVisible(buffer, 5.0f, 0.0f, 20.0f, 1.0f));
+
+	// behind both, the nearer wall does not let the farther one through
+	CHECK(!IsBoxVisible(buffer, -10.0f, 0.0f, 50.0f, 1.0f));
+	CHECK(!IsBoxVisible(buffer, 10.0f, 0.0f, 50.0f, 1.0f));
+
+	// in front of both
+	CHECK(IsBoxVisible(buffer, -2.0f, 0.0f, 5.0f, 1.0f));
+
+	// a box reaching through the near wall is kept
+	CHECK(IsBoxVisible(buffer, -5.0f, 0.0f, 10.0f, 2.0f));
+
+	// TestVisibility agrees with IsVisible
+	const float bounds[12] = { -6.0f, -1.0f, 19.0f, -4.0f, 1.0f, 21.0f, 4.0f, -1.0f, 19.0f, 6.0f, 1.0f, 21.0f };
+	uint8_t visibility[2] = { 0xcd, 0xcd };
+	buffer.TestVisibility(bounds, 2, visibility);
+	CHECK_EQUAL(0, static_cast<int>(visibility[0]));
+	CHECK(visibility[1] != 0);
+}
+
+TEST(OcclusionBuffer_ConservativeAtTheNearPlane)
+{
+	ThreadPool threadPool(2);
+	OcclusionBuffer buffer(&threadPool);
+	float projection[16];
+	BuildProjection(0.1f, 100.0f, projection);
+
+	buffer.BeginFrame(projection);
+	AddRectangle(buffer, -100.0f, -100.0f, 100.0f, 100.0f, 10.0f);
+	buffer.Rasterize();
+
+	// a box reaching behind the eye cannot be projected and is kept, even behind the wall
+	CHECK(!IsBoxVisible(buffer, 0.0f, 0.0f, 20.0f, 1.0f));
+	const float boundsMin[3] = { -1.0f, -1.0f, -1.0f };
+	const float boundsMax[3] = { 1.0f, 1.0f, 20.0f };
+	CHECK(buffer.IsVisible(boundsMin, boundsMax));
+
+	// occluder triangles crossing the eye plane are skipped, so nothing behind them is rejected
+	buffer.BeginFrame(projection);
+	const float positions[12] = { -100.0f, -100.0f, -5.0f, 100.0f, -100.0f, -5.0f, 100.0f, 100.0f, 20.0f, -100.0f, 100.0f, 20.0f };
+	const uint32_t indices[6] = { 0, 1, 2, 0, 2, 3 };
+	buffer.AddOccluder(positions, 3 * sizeof(float), indices, 6, IDENTITY);
+	buffer.Rasterize();
+	CHECK_EQUAL(static_cast<size_t>(0), buffer.GetOccluderTriangleCount());
+	CHECK(IsBoxVisible(buffer, 0.0f, 0.0f, 50.0f, 1.0f));
+}
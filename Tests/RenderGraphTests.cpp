@@ -0,0 +1,296 @@
+#include "Test.h"
+#include "RenderGraph.h"
+#include <map>
+#include <vector>
+
+namespace
+{
+	const uint64_t TARGET_SIZE = 1024 * 1024;
+
+	struct PassUse
+	{
+		RenderGraphPass pass;
+		RenderGraphResource resource;
+		uint32_t state;
+	};
+
+	// where in the event list a pass callback ran
+	struct PassRun
+	{
+		size_t eventIndex;
+		RenderGraphPass pass;
+	};
+
+	// Depth -> Shadow -> Blur -> Compose, each pass reading the target of the one
+	// before. Depth and blur never live at the same time, so they share memory.
+	struct AliasedGraph
+	{
+		RenderGraph graph;
+		RecordingRenderGraphBackend backend;
+		RenderGraphResource backBuffer;
+		RenderGraphResource depth;
+		RenderGraphResource shadow;
+		RenderGraphResource blur;
+		std::vector<PassUse> uses;
+		std::vector<PassRun> runs;
+		RenderGraphPass passCount;
+
+		void Use(RenderGraphPass pass, RenderGraphResource resource, uint32_t state, bool isWrite)
+		{
+			if (isWrite)
+			{
+				graph.Write(pass, resource, state);
+			}
+			else
+			{
+				graph.Read(pass, resource, state);
+			}
+			PassUse use = { pass, resource, state };
+			uses.push_back(use);
+		}
+
+		RenderGraphPass AddPass(const char* name)
+		{
+			RenderGraphPass pass = passCount++;
+			graph.AddPass(name, [this, pass]()
+			{
+				PassRun run = { backend.events.size(), pass };
+				runs.push_back(run);
+			});
+			return pass;
+		}
+
+		AliasedGraph()
+			: passCount(0)
+		{
+			TransientResourceDesc desc = {};
+			desc.sizeInBytes = TARGET_SIZE;
+			desc.alignment = 64 * 1024;
+			desc.isTexture = true;
+
+			backBuffer = graph.ImportResource("Back buffer", ResourceState::Present, ResourceState::Present);
+			depth = graph.CreateTransient("Depth", desc);
+			shadow = graph.CreateTransient("Shadow", desc);
+			blur = graph.CreateTransient("Blur", desc);
+
+			RenderGraphPass depthPass = AddPass("Depth");
+			Use(depthPass, depth, ResourceState::DepthWrite, true);
+
+			RenderGraphPass shadowPass = AddPass("Shadow");
+			Use(shadowPass, depth, ResourceState::PixelShaderResource, false);
+			Use(shadowPass, shadow, ResourceState::RenderTarget, true);
+
+			RenderGraphPass blurPass = AddPass("Blur");
+			Use(blurPass, shadow, ResourceState::PixelShaderResource, false);
+			Use(blurPass, blur, ResourceState::RenderTarget, true);
+
+			RenderGraphPass composePass = AddPass("Compose");
+			Use(composePass, blur, ResourceState::PixelShaderResource, false);
+			Use(composePass, backBuffer, ResourceState::RenderTarget, true);
+
+			graph.Compile();
+			graph.Realize(backend);
+		}
+	};
+
+	bool IsInState(uint32_t current, uint32_t required)
+	{
+		return current == required || (ResourceState::IsReadOnly(current) && ResourceState::IsReadOnly(required) && (current & required) == required);
+	}
+
+	// Replays events [firstEvent, end) like the GPU would track them: every transition has
+	// to start from the current state, every aliasing barrier has to hand over from the
+	// resource that used the memory last, and every pass has to find its resources
+	// active and in the state it declared.
+	void ReplayEvents(TestContext& context, const AliasedGraph& test, size_t firstEvent,
+		std::vector<uint32_t>& states, std::map<uint64_t, RenderGraphResource>& owners, std::map<RenderGraphResource, uint64_t>& offsets)
+	{
+		const std::vector<RecordingRenderGraphBackend::Event>& events = test.backend.events;
+		for (size_t e = firstEvent; e <= events.size(); ++e)
+		{
+			for (const PassRun& run : test.runs)
+			{
+				if (run.eventIndex != e)
+				{
+					continue;
+				}
+				for (const PassUse& use : test.uses)
+				{
+					if (use.pass != run.pass)
+					{
+						continue;
+					}
+					CHECK(IsInState(states[use.resource], use.state));
+					// memory that only one transient uses has no owner
+					if (offsets.count(use.resource) > 0 && owners.count(offsets[use.resource]) > 0)
+					{
+						CHECK_EQUAL(use.resource, owners[offsets[use.resource]]);
+					}
+				}
+			}
+
+			if (e == events.size() || events[e].type != RecordingRenderGraphBackend::Event::Barriers)
+			{
+				continue;
+			}
+
+			for (const RenderGraphBarrier& barrier : events[e].barriers)
+			{
+				if (barrier.type == RenderGraphBarrier::Aliasing)
+				{
+					uint64_t offset = offsets[barrier.resource];
+					CHECK_EQUAL(offset, offsets[barrier.resourceBefore]);
+					if (owners.count(offset) > 0)
+					{
+						CHECK_EQUAL(owners[offset], barrier.resourceBefore);
+					}
+					owners[offset] = barrier.resource;
+				}
+				else
+				{
+					CHECK_EQUAL(states[barrier.resource], barrier.stateBefore);
+					states[barrier.resource] = barrier.stateAfter;
+				}
+			}
+		}
+	}
+
+	bool SameBarriers(const std::vector<RenderGraphBarrier>& a, const std::vector<RenderGraphBarrier>& b)
+	{
+		if (a.size() != b.size())
+		{
+			return false;
+		}
+		for (size_t i = 0; i < a.size(); ++i)
+		{
+			if (a[i].type != b[i].type || a[i].resource != b[i].resource || a[i].resourceBefore != b[i].resourceBefore ||
+				a[i].stateBefore != b[i].stateBefore || a[i].stateAfter != b[i].stateAfter)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+TEST(RenderGraph_AliasesDisjointTransients)
+{
+	AliasedGraph test;
+
+	CHECK_EQUAL(test.graph.GetTransientOffset(test.depth), test.graph.GetTransientOffset(test.blur));
+	CHECK(test.graph.GetTransientOffset(test.shadow) != test.graph.GetTransientOffset(test.depth));
+	CHECK_EQUAL(2 * TARGET_SIZE, test.graph.GetTransientHeapSize());
+	CHECK_EQUAL(1u, test.backend.CountEvents(RecordingRenderGraphBackend::Event::AllocateHeap));
+	CHECK_EQUAL(3u, test.backend.CountEvents(RecordingRenderGraphBackend::Event::CreateTransient));
+}
+
+TEST(RenderGraph_ExecuteTwiceKeepsStatesValid)
+{
+	AliasedGraph test;
+
+	std::vector<uint32_t> states(4, ResourceState::Common);
+	std::vector<uint32_t> createdStates(4, ResourceState::Common);
+	std::map<uint64_t, RenderGraphResource> owners;
+	std::map<RenderGraphResource, uint64_t> offsets;
+	for (const RecordingRenderGraphBackend::Event& event : test.backend.events)
+	{
+		if (event.type == RecordingRenderGraphBackend::Event::CreateTransient)
+		{
+			RenderGraphResource resource = event.barriers[0].resource;
+			states[resource] = event.barriers[0].stateAfter;
+			createdStates[resource] = event.barriers[0].stateAfter;
+			offsets[resource] = event.value;
+		}
+	}
+	states[test.backBuffer] = ResourceState::Present;
+
+	size_t firstExecution = test.backend.events.size();
+	test.graph.Execute(test.backend);
+	ReplayEvents(context, test, firstExecution, states, owners, offsets);
+
+	// everything is back where the next frame expects it
+	CHECK_EQUAL(ResourceState::Present, states[test.backBuffer]);
+	CHECK_EQUAL(createdStates[test.depth], states[test.depth]);
+	CHECK_EQUAL(createdStates[test.shadow], states[test.shadow]);
+	CHECK_EQUAL(createdStates[test.blur], states[test.blur]);
+
+	size_t secondExecution = test.backend.events.size();
+	test.runs.clear();
+	test.graph.Execute(test.backend);
+	ReplayEvents(context, test, secondExecution, states, owners, offsets);
+
+	CHECK_EQUAL(createdStates[test.depth], states[test.depth]);
+	CHECK_EQUAL(createdStates[test.blur], states[test.blur]);
+	CHECK_EQUAL(secondExecution - firstExecution, test.backend.events.size() - secondExecution);
+	for (size_t i = 0; i < secondExecution - firstExecution && secondExecution + i < test.backend.events.size(); ++i)
+	{
+		const RecordingRenderGraphBackend::Event& first = test.backend.events[firstExecution + i];
+		const RecordingRenderGraphBackend::Event& second = test.backend.events[secondExecution + i];
+		CHECK(first.type == second.type && first.name == second.name && SameBarriers(first.barriers, second.barriers));
+	}
+}
+
+TEST(RenderGraph_AliasingBarrierWrapsToPreviousFrame)
+{
+	AliasedGraph test;
+	test.graph.Execute(test.backend);
+
+	// the depth pass is the first user of the shared memory, blur used it last
+	std::vector<RenderGraphBarrier> aliasing;
+	for (const RecordingRenderGraphBackend::Event& event : test.backend.events)
+	{
+		for (const RenderGraphBarrier& barrier : event.barriers)
+		{
+			if (event.type == RecordingRenderGraphBackend::Event::Barriers && barrier.type == RenderGraphBarrier::Aliasing)
+			{
+				aliasing.push_back(barrier);
+			}
+		}
+	}
+
+	CHECK_EQUAL(2u, aliasing.size());
+	if (aliasing.size() == 2)
+	{
+		CHECK_EQUAL(test.depth, aliasing[0].resource);
+		CHECK_EQUAL(test.blur, aliasing[0].resourceBefore);
+		CHECK_EQUAL(test.blur, aliasing[1].resource);
+		CHECK_EQUAL(test.depth, aliasing[1].resourceBefore);
+	}
+}
+
+TEST(RenderGraph_BatchesBarriersAndCullsUnusedPasses)
+{
+	RenderGraph graph;
+	RecordingRenderGraphBackend backend;
+
+	RenderGraphResource backBuffer = graph.ImportResource("Back buffer", ResourceState::Present, ResourceState::Present);
+	RenderGraphResource depth = graph.ImportResource("Depth", ResourceState::DepthRead, ResourceState::DepthRead);
+	TransientResourceDesc desc = {};
+	desc.sizeInBytes = TARGET_SIZE;
+	RenderGraphResource unused = graph.CreateTransient("Unused", desc);
+
+	RenderGraphPass scene = graph.AddPass("Scene", nullptr);
+	graph.Write(scene, backBuffer, ResourceState::RenderTarget);
+	graph.Write(scene, depth, ResourceState::DepthWrite);
+	RenderGraphPass debug = graph.AddPass("Debug", nullptr);
+	graph.Write(debug, unused, ResourceState::RenderTarget);
+
+	graph.Compile();
+	graph.Realize(backend);
+	graph.Execute(backend);
+
+	CHECK(graph.IsPassAlive(scene));
+	CHECK(!graph.IsPassAlive(debug));
+	CHECK_EQUAL(0u, graph.GetTransientHeapSize());
+
+	// one batch entering the scene pass, one handing both resources back
+	CHECK_EQUAL(1u, backend.CountEvents(RecordingRenderGraphBackend::Event::BeginPass));
+	CHECK_EQUAL(2u, backend.CountEvents(RecordingRenderGraphBackend::Event::Barriers));
+	for (const RecordingRenderGraphBackend::Event& event : backend.events)
+	{
+		if (event.type == RecordingRenderGraphBackend::Event::Barriers)
+		{
+			CHECK_EQUAL(2u, event.barriers.size());
+		}
+	}
+}
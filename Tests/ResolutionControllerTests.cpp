@@ -0,0 +1,129 @@
+#include "Test.h"
+#include "ResolutionController.h"
+
+namespace
+{
+	// GPU time of a frame: a fixed part plus a part that grows with the pixel count
+	struct GpuModel
+	{
+		float fixedMs;
+		float fullResolutionMs;	// of the scaled part at scale 1
+
+		float Measure(float scale) const
+		{
+			return fixedMs + fullResolutionMs * scale * scale;
+		}
+	};
+
+	// frames are pipelined, the measurement of a frame arrives one frame after its scale was chosen;
+	// returns the GPU time of the last frame
+	float Run(ResolutionController& controller, const GpuModel& model, int frames)
+	{
+		float renderedScale = controller.GetScale();
+		float gpuMs = 0.0f;
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			gpuMs = model.Measure(renderedScale);
+			renderedScale = controller.Update(gpuMs, renderedScale);
+		}
+		return gpuMs;
+	}
+}
+
+TEST(ResolutionController_ConvergesToTarget)
+{
+	const float targetMs = 14.0f;
+	ResolutionController controller(targetMs, 0.25f, 1.0f);
+	GpuModel model = { 2.0f, 24.0f };
+
+	float gpuMs = Run(controller, model, 200);
+	// under the budget, and close to it once the fixed cost is learnt
+	CHECK(gpuMs <= targetMs);
+	CHECK(gpuMs >= 0.85f * targetMs);
+	CHECK(controller.GetScale() > 0.25f && controller.GetScale() < 1.0f);
+
+	// settled, further frames do not move the scale
+	float settled = controller.GetScale();
+	Run(controller, model, 50);
+	CHECK_EQUAL(settled, controller.GetScale());
+
+	// a heavier scene lowers the scale and still meets the target
+	GpuModel heavier = { 2.0f, 40.0f };
+	float heavierMs = Run(controller, heavier, 200);
+	CHECK(controller.GetScale() < settled);
+	CHECK(heavierMs <= targetMs);
+	CHECK(heavierMs >= 0.85f * targetMs);
+}
+
+TEST(ResolutionController_StaysWithinMinAndMax)
+{
+	const float minScale = 0.5f;
+	const float maxScale = 0.9f;
+
+	// far over budget even at the minimum
+	ResolutionController overloaded(10.0f, minScale, maxScale);
+	CHECK_EQUAL(maxScale, overloaded.GetScale());
+	GpuModel heavy = { 5.0f, 200.0f };
+	for (int frame = 0; frame < 100; ++frame)
+	{
+		float scale = overloaded.Update(heavy.Measure(overloaded.GetScale()), overloaded.GetScale());
+		CHECK(scale >= minScale && scale <= maxScale);
+	}
+	CHECK_EQUAL(minScale, overloaded.GetScale());
+
+	// far under budget, the scale climbs back to the maximum and stays there
+	GpuModel light = { 0.5f, 1.0f };
+	float previous = overloaded.GetScale();
+	for (int frame = 0; frame < 100; ++frame)
+	{
+		float scale = overloaded.Update(light.Measure(overloaded.GetScale()), overloaded.GetScale());
+		CHECK(scale >= minScale && scale <= maxScale);
+		// increases are limited per update, so a measurement spike cannot jump it
+		CHECK(scale <= previous * 1.1f + 1e-6f);
+		previous = scale;
+	}
+	CHECK_EQUAL(maxScale, overloaded.GetScale());
+
+	// Reset clamps as well
+	overloaded.Reset(2.0f);
+	CHECK_EQUAL(maxScale, overloaded.GetScale());
+	overloaded.Reset(0.0f);
+	CHECK_EQUAL(minScale, overloaded.GetScale());
+}
+
+TEST(ResolutionController_IgnoresInvalidMeasurements)
+{
+	ResolutionController controller(14.0f, 0.5f, 1.0f, 4);
+	CHECK_EQUAL(1.0f, controller.Update(0.0f, 1.0f));
+	CHECK_EQUAL(1.0f, controller.Update(20.0f, 0.0f));
+	CHECK_EQUAL(static_cast<size_t>(0), controller.GetTraceCount());
+
+	// the trace keeps the newest samples, oldest first
+	for (int frame = 0; frame < 6; ++frame)
+	{
+		controller.Update(10.0f + frame, controller.GetScale());
+	}
+	CHECK_EQUAL(static_cast<size_t>(4), controller.GetTraceCount());
+	CHECK_EQUAL(12.0f, controller.GetTraceSample(0).gpuMs);
+	CHECK_EQUAL(15.0f, controller.GetTraceSample(3).gpuMs);
+}
+
+TEST(ResolutionController_RenderSize)
+{
+	ResolutionController controller(14.0f, 0.5f, 1.0f);
+	uint32_t width, height;
+
+	controller.GetRenderSize(1920, 1080, &width, &height);
+	CHECK_EQUAL(1920u, width);
+	CHECK_EQUAL(1080u, height);
+
+	controller.Reset(0.5f);
+	controller.GetRenderSize(1001, 17, &width, &height);
+	CHECK_EQUAL(500u, width);
+	CHECK_EQUAL(8u, height);
+
+	// never more than the output
+	controller.GetRenderSize(6, 4, &width, &height);
+	CHECK_EQUAL(6u, width);
+	CHECK_EQUAL(4u, height);
+}
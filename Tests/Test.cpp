@@ -0,0 +1,122 @@
+#include "Test.h"
+#include <cstdio>
+#include <cstring>
+#include <regex>
+#include <vector>
+
+namespace
+{
+	struct RegisteredTest
+	{
+		const char* name;
+		TestFunction function;
+	};
+
+	std::vector<RegisteredTest>& GetRegistry()
+	{
+		static std::vector<RegisteredTest> registry;
+		return registry;
+	}
+
+	bool ParseFlag(const char* arg, const char* name, std::string* value)
+	{
+		size_t length = strlen(name);
+		if (strncmp(arg, name, length) != 0 || arg[length] != '=')
+		{
+			return false;
+		}
+		*value = arg + length + 1;
+		return true;
+	}
+}
+
+TestContext::TestContext()
+	: m_checkCount(0), m_failureCount(0)
+{
+}
+
+bool TestContext::Check(bool passed, const char* expression, const char* file, int line)
+{
+	++m_checkCount;
+	if (!passed)
+	{
+		++m_failureCount;
+		printf("  %s:%d: check failed: %s\n", file, line, expression);
+	}
+	return passed;
+}
+
+uint32_t TestContext::GetCheckCount() const
+{
+	return m_checkCount;
+}
+
+uint32_t TestContext::GetFailureCount() const
+{
+	return m_failureCount;
+}
+
+bool RegisterTest(const char* name, TestFunction function)
+{
+	RegisteredTest test = { name, function };
+	GetRegistry().push_back(test);
+	return true;
+}
+
+int RunTests(int argc, char** argv)
+{
+	std::string filter = ".*";
+	bool listOnly = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (ParseFlag(argv[i], "--test_filter", &filter))
+		{
+			continue;
+		}
+		if (strcmp(argv[i], "--test_list") == 0)
+		{
+			listOnly = true;
+			continue;
+		}
+		fprintf(stderr, "unknown argument %s\n", argv[i]);
+		return 1;
+	}
+
+	std::regex filterRegex(filter);
+	uint32_t testCount = 0;
+	uint32_t failedCount = 0;
+	for (const RegisteredTest& test : GetRegistry())
+	{
+		if (!std::regex_search(test.name, filterRegex))
+		{
+			continue;
+		}
+		if (listOnly)
+		{
+			printf("%s\n", test.name);
+			continue;
+		}
+
+		printf("[ RUN  ] %s\n", test.name);
+		fflush(stdout);
+		TestContext context;
+		test.function(context);
+		++testCount;
+		if (context.GetFailureCount() > 0)
+		{
+			++failedCount;
+			printf("[ FAIL ] %s, %u of %u checks failed\n", test.name, context.GetFailureCount(), context.GetCheckCount());
+		}
+		else
+		{
+			printf("[  OK  ] %s, %u checks\n", test.name, context.GetCheckCount());
+		}
+		fflush(stdout);
+	}
+
+	if (!listOnly)
+	{
+		printf("%u of %u tests passed\n", testCount - failedCount, testCount);
+	}
+	return failedCount > 0 ? 1 : 0;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+// Small test harness in the spirit of the benchmark one, so the checks of the
+// engine's CPU components build with nothing but the compiler. Tests register
+// with TEST and report with CHECK / CHECK_EQUAL, a failed check is printed and
+// the test carries on:
+//
+//	TEST(RangeAllocator_Allocate)
+//	{
+//		RangeAllocator allocator(100);
+//		CHECK_EQUAL(0u, allocator.Allocate(10));
+//	}
+
+class TestContext
+{
+private:
+
+	uint32_t m_checkCount;
+	uint32_t m_failureCount;
+
+public:
+	TestContext();
+
+	bool Check(bool passed, const char* expression, const char* file, int line);
+
+	template<typename Expected, typename Actual>
+	bool CheckEqual(const Expected& expected, const Actual& actual, const char* expression, const char* file, int line);
+
+	uint32_t GetCheckCount() const;
+	uint32_t GetFailureCount() const;
+};
+
+template<typename Expected, typename Actual>
+bool TestContext::CheckEqual(const Expected& expected, const Actual& actual, const char* expression, const char* file, int line)
+{
+	if (expected == actual)
+	{
+		return Check(true, expression, file, line);
+	}
+
+	std::ostringstream message;
+	message << expression << ", expected " << expected << ", got " << actual;
+	return Check(false, message.str().c_str(), file, line);
+}
+
+typedef void (*TestFunction)(TestContext& context);
+
+bool RegisterTest(const char* name, TestFunction function);
+
+#define TEST_CONCAT_(a, b) a##b
+#define TEST_CONCAT(a, b) TEST_CONCAT_(a, b)
+#define TEST(name) \
+	void name(TestContext& context); \
+	static bool TEST_CONCAT(g_test, __LINE__) = RegisterTest(#name, name); \
+	void name(TestContext& context)
+
+#define CHECK(condition) context.Check(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
+#define CHECK_EQUAL(expected, actual) context.CheckEqual((expected), (actual), #actual, __FILE__, __LINE__)
+
+// accepts --test_filter=regex and --test_list; returns the process exit code,
+// nonzero if a check failed
+int RunTests(int argc, char** argv);
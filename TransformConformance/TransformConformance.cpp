@@ -0,0 +1,200 @@
+#include "Test.h"
+#include "TransformCore.h"
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	const uint32_t SEED = 0x9e3779b9;
+	const size_t MATRIX_COUNT = 4097;
+	const size_t ANGLE_COUNT = 65537;
+
+	const SimdLevel LEVELS[] = { SimdLevel::Scalar, SimdLevel::Sse2, SimdLevel::Sse41, SimdLevel::Avx2 };
+
+	// Bounds per tier, in the units of MeasureTransformUlp. A 4 term dot product
+	// rounded in any order stays within 4 of the exact sum, so two orders differ
+	// by at most 8. Against scalar, SSE2 keeps the scalar operation order and is
+	// exact, AVX2 rounds four times instead of seven and gets half the worst case.
+	// Against DirectXMath the order depends on how it was built, so the full 8.
+	struct TierBounds
+	{
+		SimdLevel level;
+		float scalarUlp;
+		float directXMathUlp;
+	};
+
+	const TierBounds MULTIPLY_BOUNDS[] =
+	{
+		{ SimdLevel::Scalar, 0.0f, 8.0f },
+		{ SimdLevel::Sse2, 0.0f, 8.0f },
+		{ SimdLevel::Sse41, 0.0f, 8.0f },
+		{ SimdLevel::Avx2, 4.0f, 8.0f }
+	};
+
+	// absolute, the polynomial error of TransformCore.h with room for the reduction
+	const float SIN_COS_PRECISE_BOUND = 1e-6f;
+	const float SIN_COS_FAST_BOUND = 2e-5f;
+	// three sin/cos products times scales up to 4
+	const float SRT_PRECISE_BOUND = 2e-5f;
+	const float SRT_FAST_BOUND = 4e-4f;
+
+	uint32_t NextRandom(uint32_t& state)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+	float RandomFloat(uint32_t& state)
+	{
+		return (NextRandom(state) >> 8) * (8.0f / 16777216.0f) - 4.0f;
+	}
+
+	float UlpOf(float value)
+	{
+		int exponent;
+		frexpf(value, &exponent);
+		return ldexpf(1.0f, exponent - 24);
+	}
+
+	// the level's kernel against XMMatrixTranspose(XMMatrixMultiply()), in the
+	// units of MeasureTransformUlp
+	float MeasureDirectXMathUlp(SimdLevel level, size_t matrixCount, uint32_t seed)
+	{
+		std::vector<XMFLOAT4X4> matrices(matrixCount);
+		std::vector<XMFLOAT4X4> actual(matrixCount);
+		XMFLOAT4X4 right;
+
+		uint32_t state = seed;
+		for (XMFLOAT4X4& matrix : matrices)
+		{
+			for (int i = 0; i < 16; ++i)
+			{
+				(&matrix._11)[i] = RandomFloat(state);
+			}
+		}
+		for (int i = 0; i < 16; ++i)
+		{
+			(&right._11)[i] = RandomFloat(state);
+		}
+
+		GetTransformKernels(level).multiplyTranspose(matrices.data(), right, actual.data(), matrixCount);
+
+		XMMATRIX rightMat = XMLoadFloat4x4(&right);
+		float maxUlp = 0.0f;
+		for (size_t i = 0; i < matrixCount; ++i)
+		{
+			XMFLOAT4X4 expected;
+			XMStoreFloat4x4(&expected, XMMatrixTranspose(XMMatrixMultiply(XMLoadFloat4x4(&matrices[i]), rightMat)));
+			for (int row = 0; row < 4; ++row)
+			{
+				for (int column = 0; column < 4; ++column)
+				{
+					float magnitude = 0.0f;
+					for (int k = 0; k < 4; ++k)
+					{
+						magnitude += fabsf(matrices[i].m[row][k] * right.m[k][column]);
+					}
+
+					float error = fabsf(actual[i].m[column][row] - expected.m[column][row]);
+					if (error != error)
+					{
+						return INFINITY;
+					}
+
+					float ulp = error / UlpOf(magnitude > 0.0f ? magnitude : 1.0f);
+					maxUlp = ulp > maxUlp ? ulp : maxUlp;
+				}
+			}
+		}
+
+		return maxUlp;
+	}
+
+	// tiers the CPU lacks would silently fall back to a lower one
+	bool IsSupported(SimdLevel level)
+	{
+		return level <= GetCpuSimdLevel();
+	}
+
+	const char* GetAccuracyName(TrigAccuracy accuracy)
+	{
+		return accuracy == TrigAccuracy::Precise ? "precise" : "fast";
+	}
+}
+
+TEST(TransformConformance_MultiplyMatchesScalar)
+{
+	for (const TierBounds& bounds : MULTIPLY_BOUNDS)
+	{
+		if (!IsSupported(bounds.level))
+		{
+			printf("  %s: not supported, skipped\n", GetSimdLevelName(bounds.level));
+			continue;
+		}
+
+		float ulp = MeasureTransformUlp(bounds.level, MATRIX_COUNT, SEED);
+		printf("  %s: %.2f ulp, bound %.2f\n", GetSimdLevelName(bounds.level), ulp, bounds.scalarUlp);
+		CHECK(ulp <= bounds.scalarUlp);
+		CHECK(CheckTransformConformance(bounds.level, bounds.scalarUlp));
+	}
+}
+
+TEST(TransformConformance_MultiplyMatchesDirectXMath)
+{
+	for (const TierBounds& bounds : MULTIPLY_BOUNDS)
+	{
+		if (!IsSupported(bounds.level))
+		{
+			printf("  %s: not supported, skipped\n", GetSimdLevelName(bounds.level));
+			continue;
+		}
+
+		float ulp = MeasureDirectXMathUlp(bounds.level, MATRIX_COUNT, SEED);
+		printf("  %s: %.2f ulp, bound %.2f\n", GetSimdLevelName(bounds.level), ulp, bounds.directXMathUlp);
+		CHECK(ulp <= bounds.directXMathUlp);
+	}
+}
+
+// a few turns either way, the range world and camera angles stay in
+TEST(TransformConformance_SinCosAccuracy)
+{
+	const TrigAccuracy accuracies[] = { TrigAccuracy::Precise, TrigAccuracy::Fast };
+	for (SimdLevel level : LEVELS)
+	{
+		if (!IsSupported(level))
+		{
+			continue;
+		}
+		for (TrigAccuracy accuracy : accuracies)
+		{
+			float bound = accuracy == TrigAccuracy::Precise ? SIN_COS_PRECISE_BOUND : SIN_COS_FAST_BOUND;
+			float error = MeasureSinCosError(level, accuracy, ANGLE_COUNT, 8.0f * XM_PI, SEED);
+			printf("  %s %s: %.3g, bound %.3g\n", GetSimdLevelName(level), GetAccuracyName(accuracy), error, bound);
+			CHECK(error <= bound);
+		}
+	}
+}
+
+TEST(TransformConformance_SrtMatchesDirectXMath)
+{
+	const TrigAccuracy accuracies[] = { TrigAccuracy::Precise, TrigAccuracy::Fast };
+	for (SimdLevel level : LEVELS)
+	{
+		if (!IsSupported(level))
+		{
+			continue;
+		}
+		for (TrigAccuracy accuracy : accuracies)
+		{
+			float bound = accuracy == TrigAccuracy::Precise ? SRT_PRECISE_BOUND : SRT_FAST_BOUND;
+			float error = MeasureSrtError(level, accuracy, MATRIX_COUNT, SEED);
+			printf("  %s %s: %.3g, bound %.3g\n", GetSimdLevelName(level), GetAccuracyName(accuracy), error, bound);
+			CHECK(error <= bound);
+		}
+	}
+}
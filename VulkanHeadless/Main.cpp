@@ -0,0 +1,282 @@
+#include "VulkanRenderer.h"
+#include "Camera.h"
+#include "TransformCore.h"
+#include "TransformPacking.h"
+#include <DirectXMath.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace DirectX;
+using std::chrono::high_resolution_clock;
+using std::chrono::duration;
+
+namespace
+{
+	struct Options
+	{
+		uint32_t width = 800;
+		uint32_t height = 600;
+		uint32_t frames = 1000;
+		bool preferCpu = false;
+		bool reverseZ = false;
+		const char* shaderDir = nullptr;
+		const char* dumpPath = nullptr;
+	};
+
+	void PrintUsage()
+	{
+		printf("usage: VulkanHeadless [--width N] [--height N] [--frames N] [--cpu] [--reverse-z] [--shaders dir] [--dump file.ppm]\n");
+	}
+
+	bool ParseOptions(int argc, char** argv, Options* options)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			bool hasValue = i + 1 < argc;
+			if (strcmp(argv[i], "--width") == 0 && hasValue)
+			{
+				options->width = static_cast<uint32_t>(atoi(argv[++i]));
+			}
+			else if (strcmp(argv[i], "--height") == 0 && hasValue)
+			{
+				options->height = static_cast<uint32_t>(atoi(argv[++i]));
+			}
+			else if (strcmp(argv[i], "--frames") == 0 && hasValue)
+			{
+				options->frames = static_cast<uint32_t>(atoi(argv[++i]));
+			}
+			else if (strcmp(argv[i], "--shaders") == 0 && hasValue)
+			{
+				options->shaderDir = argv[++i];
+			}
+			else if (strcmp(argv[i], "--dump") == 0 && hasValue)
+			{
+				options->dumpPath = argv[++i];
+			}
+			else if (strcmp(argv[i], "--cpu") == 0)
+			{
+				options->preferCpu = true;
+			}
+			else if (strcmp(argv[i], "--reverse-z") == 0)
+			{
+				options->reverseZ = true;
+			}
+			else
+			{
+				return false;
+			}
+		}
+
+		return options->width > 0 && options->height > 0 && options->frames > 0;
+	}
+
+	bool LoadSpirv(const char* dir, const char* name, std::vector<uint32_t>& spirv)
+	{
+		char path[1024];
+		snprintf(path, sizeof(path), "%s/%s", dir, name);
+
+		FILE* file = fopen(path, "rb");
+		if (file == nullptr)
+		{
+			printf("cannot open %s\n", path);
+			return false;
+		}
+
+		fseek(file, 0, SEEK_END);
+		long size = ftell(file);
+		fseek(file, 0, SEEK_SET);
+
+		spirv.resize(size > 0 ? static_cast<size_t>(size) / sizeof(uint32_t) : 0);
+		size_t read = fread(spirv.data(), sizeof(uint32_t), spirv.size(), file);
+		fclose(file);
+
+		return !spirv.empty() && read == spirv.size() && size % sizeof(uint32_t) == 0;
+	}
+
+	// the pre-build step writes the SPIR-V next to the executable
+	std::string GetExecutableDir(const char* argv0)
+	{
+		const char* slash = strrchr(argv0, '/');
+		return slash != nullptr ? std::string(argv0, slash - argv0) : std::string(".");
+	}
+
+	// the cube covers the centre, so a clear colored centre means nothing was drawn or read back
+	bool IsCubeVisible(const uint8_t* rgba, uint32_t width, uint32_t height)
+	{
+		const uint8_t* centre = rgba + (static_cast<size_t>(height / 2) * width + width / 2) * 4;
+		return centre[2] > centre[0] && centre[2] > centre[1];
+	}
+
+	bool WritePpm(const char* path, const uint8_t* rgba, uint32_t width, uint32_t height)
+	{
+		FILE* file = fopen(path, "wb");
+		if (file == nullptr)
+		{
+			return false;
+		}
+
+		fprintf(file, "P6\n%u %u\n255\n", width, height);
+		std::vector<uint8_t> row(width * 3);
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			const uint8_t* source = rgba + static_cast<size_t>(y) * width * 4;
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				row[x * 3 + 0] = source[x * 4 + 0];
+				row[x * 3 + 1] = source[x * 4 + 1];
+				row[x * 3 + 2] = source[x * 4 + 2];
+			}
+			fwrite(row.data(), 1, row.size(), file);
+		}
+
+		fclose(file);
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, &options))
+	{
+		PrintUsage();
+		return -1;
+	}
+
+	// compiled from Shaders.hlsl by the pre-build step
+	std::string shaderDir = options.shaderDir != nullptr ? options.shaderDir : GetExecutableDir(argv[0]);
+	std::vector<uint32_t> vertexShader;
+	std::vector<uint32_t> pixelShader;
+	if (!LoadSpirv(shaderDir.c_str(), "Shaders.vs.spv", vertexShader) || !LoadSpirv(shaderDir.c_str(), "Shaders.ps.spv", pixelShader))
+	{
+		return -1;
+	}
+
+	VulkanRenderer renderer;
+	renderer.Init(options.width, options.height, vertexShader, pixelShader, options.preferCpu, options.reverseZ);
+	printf("device: %s\n", renderer.GetDeviceName());
+
+	// the cube of the D3D12 renderer
+	VulkanVertex vertices[] = {
+
+		{ { -0.5f, -0.5f, -0.5f }, { 0.0f, 0.0f, 1.0f, 1.0f } },
+		{ { 0.5f, -0.5f, -0.5f }, { 0.0f, 0.0f, 1.0f, 1.0f } },
+		{ { 0.5f, 0.5f, -0.5f }, { 0.0f, 0.0f, 1.0f, 1.0f } },
+		{ { -0.5f, 0.5f, -0.5f }, { 0.0f, 0.0f, 1.0f, 1.0f } },
+
+		{ { -0.5f, -0.5f, 0.5f }, { 0.0f, 0.0f, 1.0f, 1.0f } },
+		{ { 0.5f, -0.5f, 0.5f }, { 0.0f, 0.0f, 1.0f, 1.0f } },
+		{ { 0.5f, 0.5f, 0.5f }, { 0.0f, 0.0f, 1.0f, 1.0f } },
+		{ { -0.5f, 0.5f, 0.5f }, { 0.0f, 0.0f, 1.0f, 1.0f } },
+
+	};
+
+	uint32_t indices[] = {
+		// front
+		0, 1, 2,
+		0, 2, 3,
+
+		// back
+		4, 7, 6,
+		4, 6, 5,
+
+		// left
+		0, 3, 7,
+		0, 7, 4,
+
+		// right
+		1, 6, 2,
+		1, 5, 6,
+
+		// up
+		3, 6, 7,
+		3, 2, 6,
+
+		// down
+		0, 4, 5,
+		0, 5, 1
+	};
+
+	renderer.UploadMesh(vertices, sizeof(vertices) / sizeof(vertices[0]), indices, sizeof(indices) / sizeof(indices[0]));
+
+	// same camera as Engine::InitWvp
+	const float fov = 60.0f * (XM_PI / 180.0f);
+	const float aspectRatio = static_cast<float>(options.width) / static_cast<float>(options.height);
+
+	Camera camera;
+	camera.SetPosition(0.0f, 0.0f, -3.0f);
+	camera.SetRotation(0.0f, 0.0f);
+	if (options.reverseZ)
+	{
+		camera.SetPerspectiveReverseZ(fov, aspectRatio, 0.01f);
+	}
+	else
+	{
+		camera.SetPerspective(fov, aspectRatio, 0.01f, 1000.0f);
+	}
+	XMMATRIX viewProjection = camera.GetViewMatrix() * camera.GetProjectionMatrix();
+
+	// fixed time step so runs are comparable
+	const float deltaSec = 1.0f / 60.0f;
+	VulkanFrameTimings totals = {};
+	uint32_t gpuSamples = 0;
+
+	high_resolution_clock::time_point start = high_resolution_clock::now();
+	for (uint32_t frame = 0; frame < options.frames; ++frame)
+	{
+		float time = frame * deltaSec;
+
+		XMFLOAT4X4 worldMat;
+		XMStoreFloat4x4(&worldMat, ComposeWorldMatrix(XMVectorSet(1.0f, 1.0f, 1.0f, 0.0f), XMVectorZero(),
+			XMVectorSet(0.0f, time, 0.0f, 0.0f)));
+
+		XMFLOAT4X4 wvp;
+		PackWvpTransforms(&worldMat, viewProjection, &wvp, 1);
+
+		float pulse = 0.75f + 0.25f * sinf(time);
+		float colorMultiplier[4] = { pulse, pulse, pulse, 1.0f };
+
+		VulkanFrameTimings timings;
+		renderer.Render(colorMultiplier, &wvp.m[0][0], &timings);
+
+		totals.waitSec += timings.waitSec;
+		totals.recordSec += timings.recordSec;
+		totals.submitSec += timings.submitSec;
+		if (timings.gpuSec > 0.0)
+		{
+			totals.gpuSec += timings.gpuSec;
+			++gpuSamples;
+		}
+	}
+	renderer.WaitIdle();
+	double totalSec = duration<double>(high_resolution_clock::now() - start).count();
+
+	double frames = static_cast<double>(options.frames);
+	printf("frames: %u at %ux%u\n", options.frames, options.width, options.height);
+	printf("frame: %.3f ms (%.1f fps)\n", totalSec * 1000.0 / frames, frames / totalSec);
+	printf("wait: %.3f ms, record: %.3f ms, submit: %.3f ms\n",
+		totals.waitSec * 1000.0 / frames, totals.recordSec * 1000.0 / frames, totals.submitSec * 1000.0 / frames);
+	if (gpuSamples > 0)
+	{
+		printf("gpu: %.3f ms\n", totals.gpuSec * 1000.0 / gpuSamples);
+	}
+
+	if (options.dumpPath != nullptr && !WritePpm(options.dumpPath, renderer.GetLastImage(), options.width, options.height))
+	{
+		printf("cannot write %s\n", options.dumpPath);
+		return -1;
+	}
+
+	if (!IsCubeVisible(renderer.GetLastImage(), options.width, options.height))
+	{
+		printf("the last frame does not show the cube\n");
+		return -1;
+	}
+
+	renderer.Destroy();
+	return 0;
+}
@@ -0,0 +1,737 @@
+#include "VulkanRenderer.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+using std::chrono::high_resolution_clock;
+using std::chrono::duration;
+
+namespace
+{
+	const VkFormat COLOR_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+	const VkFormat DEPTH_FORMAT = VK_FORMAT_D32_SFLOAT;
+
+	void Check(VkResult result)
+	{
+		if (result != VK_SUCCESS)
+		{
+			exit(-1);
+		}
+	}
+
+	VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+VulkanRenderer::VulkanRenderer()
+	: m_instance(VK_NULL_HANDLE), m_physicalDevice(VK_NULL_HANDLE), m_deviceProperties{}, m_memoryProperties{},
+	m_device(VK_NULL_HANDLE), m_queue(VK_NULL_HANDLE), m_queueFamily(0), m_commandPool(VK_NULL_HANDLE),
+	m_descriptorSetLayout(VK_NULL_HANDLE), m_pipelineLayout(VK_NULL_HANDLE), m_renderPass(VK_NULL_HANDLE), m_pipeline(VK_NULL_HANDLE),
+	m_descriptorPool(VK_NULL_HANDLE), m_descriptorSet(VK_NULL_HANDLE), m_queryPool(VK_NULL_HANDLE),
+	m_width(0), m_height(0), m_reverseZ(false), m_depth{}, m_frames{}, m_frameIndex(0),
+	m_vertexBuffer{}, m_indexBuffer{}, m_indexCount(0), m_constants{}, m_wvpOffset(0), m_frameConstantsSize(0)
+{
+}
+
+VulkanRenderer::~VulkanRenderer()
+{
+	Destroy();
+}
+
+void VulkanRenderer::CreateDevice(bool preferCpu)
+{
+	// 1.1 for the negative viewport height that matches the D3D clip space
+	VkApplicationInfo applicationInfo = {};
+	applicationInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	applicationInfo.pApplicationName = "VulkanHeadless";
+	applicationInfo.apiVersion = VK_API_VERSION_1_1;
+
+	VkInstanceCreateInfo instanceInfo = {};
+	instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	instanceInfo.pApplicationInfo = &applicationInfo;
+	Check(vkCreateInstance(&instanceInfo, nullptr, &m_instance));
+
+	uint32_t deviceCount = 0;
+	Check(vkEnumeratePhysicalDevices(m_instance, &deviceCount, nullptr));
+	std::vector<VkPhysicalDevice> devices(deviceCount);
+	Check(vkEnumeratePhysicalDevices(m_instance, &deviceCount, devices.data()));
+
+	// first device with a graphics queue, a CPU device wins when asked for
+	for (VkPhysicalDevice device : devices)
+	{
+		uint32_t familyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(device, &familyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> families(familyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(device, &familyCount, families.data());
+
+		for (uint32_t family = 0; family < familyCount; ++family)
+		{
+			if ((families[family].queueFlags & VK_QUEUE_GRAPHICS_BIT) == 0)
+			{
+				continue;
+			}
+
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(device, &properties);
+			bool isCpu = properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU;
+			if (m_physicalDevice == VK_NULL_HANDLE || (preferCpu && isCpu && m_deviceProperties.deviceType != VK_PHYSICAL_DEVICE_TYPE_CPU))
+			{
+				m_physicalDevice = device;
+				m_deviceProperties = properties;
+				m_queueFamily = family;
+			}
+			break;
+		}
+	}
+
+	if (m_physicalDevice == VK_NULL_HANDLE)
+	{
+		exit(-1);
+	}
+	vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &m_memoryProperties);
+
+	float priority = 1.0f;
+	VkDeviceQueueCreateInfo queueInfo = {};
+	queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+	queueInfo.queueFamilyIndex = m_queueFamily;
+	queueInfo.queueCount = 1;
+	queueInfo.pQueuePriorities = &priority;
+
+	VkDeviceCreateInfo deviceInfo = {};
+	deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	deviceInfo.queueCreateInfoCount = 1;
+	deviceInfo.pQueueCreateInfos = &queueInfo;
+	Check(vkCreateDevice(m_physicalDevice, &deviceInfo, nullptr, &m_device));
+	vkGetDeviceQueue(m_device, m_queueFamily, 0, &m_queue);
+
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = m_queueFamily;
+	Check(vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool));
+}
+
+uint32_t VulkanRenderer::FindMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const
+{
+	for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; ++i)
+	{
+		if ((typeBits & (1u << i)) != 0 && (m_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+		{
+			return i;
+		}
+	}
+
+	exit(-1);
+}
+
+void VulkanRenderer::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, Buffer& buffer)
+{
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	Check(vkCreateBuffer(m_device, &bufferInfo, nullptr, &buffer.buffer));
+
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(m_device, buffer.buffer, &requirements);
+
+	VkMemoryAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocateInfo.allocationSize = requirements.size;
+	allocateInfo.memoryTypeIndex = FindMemoryType(requirements.memoryTypeBits, properties);
+	Check(vkAllocateMemory(m_device, &allocateInfo, nullptr, &buffer.memory));
+	Check(vkBindBufferMemory(m_device, buffer.buffer, buffer.memory, 0));
+
+	// host visible buffers stay mapped, like the upload heaps
+	buffer.mapped = nullptr;
+	if ((properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0)
+	{
+		Check(vkMapMemory(m_device, buffer.memory, 0, VK_WHOLE_SIZE, 0, &buffer.mapped));
+	}
+	buffer.size = size;
+}
+
+void VulkanRenderer::CreateImage(VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect, Image& image)
+{
+	VkImageCreateInfo imageInfo = {};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = format;
+	imageInfo.extent = { m_width, m_height, 1 };
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = usage;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	Check(vkCreateImage(m_device, &imageInfo, nullptr, &image.image));
+
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(m_device, image.image, &requirements);
+
+	VkMemoryAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocateInfo.allocationSize = requirements.size;
+	allocateInfo.memoryTypeIndex = FindMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	Check(vkAllocateMemory(m_device, &allocateInfo, nullptr, &image.memory));
+	Check(vkBindImageMemory(m_device, image.image, image.memory, 0));
+
+	VkImageViewCreateInfo viewInfo = {};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = image.image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = format;
+	viewInfo.subresourceRange.aspectMask = aspect;
+	viewInfo.subresourceRange.levelCount = 1;
+	viewInfo.subresourceRange.layerCount = 1;
+	Check(vkCreateImageView(m_device, &viewInfo, nullptr, &image.view));
+}
+
+void VulkanRenderer::DestroyBuffer(Buffer& buffer)
+{
+	if (buffer.buffer != VK_NULL_HANDLE)
+	{
+		vkDestroyBuffer(m_device, buffer.buffer, nullptr);
+		vkFreeMemory(m_device, buffer.memory, nullptr);
+	}
+	buffer = Buffer{};
+}
+
+void VulkanRenderer::DestroyImage(Image& image)
+{
+	if (image.image != VK_NULL_HANDLE)
+	{
+		vkDestroyImageView(m_device, image.view, nullptr);
+		vkDestroyImage(m_device, image.image, nullptr);
+		vkFreeMemory(m_device, image.memory, nullptr);
+	}
+	image = Image{};
+}
+
+VkShaderModule VulkanRenderer::CreateShaderModule(const std::vector<uint32_t>& spirv)
+{
+	VkShaderModuleCreateInfo moduleInfo = {};
+	moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleInfo.codeSize = spirv.size() * sizeof(uint32_t);
+	moduleInfo.pCode = spirv.data();
+
+	VkShaderModule module;
+	Check(vkCreateShaderModule(m_device, &moduleInfo, nullptr, &module));
+	return module;
+}
+
+void VulkanRenderer::CreateRenderPass()
+{
+	// the color image ends up ready for the readback copy that replaces Present
+	VkAttachmentDescription attachments[2] = {};
+	attachments[0].format = COLOR_FORMAT;
+	attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+	attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	attachments[0].finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+	attachments[1].format = DEPTH_FORMAT;
+	attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
+	attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference colorReference = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+	VkAttachmentReference depthReference = { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+
+	VkSubpassDescription subpass = {};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 1;
+	subpass.pColorAttachments = &colorReference;
+	subpass.pDepthStencilAttachment = &depthReference;
+
+	// the shared depth buffer may still be written by the previous frame, and the
+	// color layout transition out of UNDEFINED has to finish before the first color write
+	VkSubpassDependency dependencies[2] = {};
+	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[0].dstSubpass = 0;
+	dependencies[0].srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependencies[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+	dependencies[1].srcSubpass = 0;
+	dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+	VkRenderPassCreateInfo renderPassInfo = {};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = 2;
+	renderPassInfo.pAttachments = attachments;
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpass;
+	renderPassInfo.dependencyCount = 2;
+	renderPassInfo.pDependencies = dependencies;
+	Check(vkCreateRenderPass(m_device, &renderPassInfo, nullptr, &m_renderPass));
+}
+
+void VulkanRenderer::CreatePipeline(const std::vector<uint32_t>& vertexShader, const std::vector<uint32_t>& pixelShader)
+{
+	// root signature: b0 color multiplier and b1 WVP, both read by the vertex shader
+	VkDescriptorSetLayoutBinding bindings[2] = {};
+	for (uint32_t i = 0; i < 2; ++i)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo setLayoutInfo = {};
+	setLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	setLayoutInfo.bindingCount = 2;
+	setLayoutInfo.pBindings = bindings;
+	Check(vkCreateDescriptorSetLayout(m_device, &setLayoutInfo, nullptr, &m_descriptorSetLayout));
+
+	VkPipelineLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.setLayoutCount = 1;
+	layoutInfo.pSetLayouts = &m_descriptorSetLayout;
+	Check(vkCreatePipelineLayout(m_device, &layoutInfo, nullptr, &m_pipelineLayout));
+
+	VkShaderModule vertexModule = CreateShaderModule(vertexShader);
+	VkShaderModule pixelModule = CreateShaderModule(pixelShader);
+
+	VkPipelineShaderStageCreateInfo stages[2] = {};
+	stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	stages[0].module = vertexModule;
+	stages[0].pName = "vsMain";
+	stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	stages[1].module = pixelModule;
+	stages[1].pName = "psMain";
+
+	// input layout, POSITION and COLOR get locations in declaration order
+	VkVertexInputBindingDescription vertexBinding = { 0, sizeof(VulkanVertex), VK_VERTEX_INPUT_RATE_VERTEX };
+	VkVertexInputAttributeDescription vertexAttributes[2] =
+	{
+		{ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0 },
+		{ 1, 0, VK_FORMAT_R32G32B32A32_SFLOAT, 12 }
+	};
+
+	VkPipelineVertexInputStateCreateInfo vertexInput = {};
+	vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInput.vertexBindingDescriptionCount = 1;
+	vertexInput.pVertexBindingDescriptions = &vertexBinding;
+	vertexInput.vertexAttributeDescriptionCount = 2;
+	vertexInput.pVertexAttributeDescriptions = vertexAttributes;
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	VkPipelineViewportStateCreateInfo viewportState = {};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+
+	// D3D12 defaults: back faces culled, clockwise is front. The flipped viewport
+	// keeps the D3D screen orientation, so the winding stays the same
+	VkPipelineRasterizationStateCreateInfo rasterization = {};
+	rasterization.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterization.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterization.cullMode = VK_CULL_MODE_BACK_BIT;
+	rasterization.frontFace = VK_FRONT_FACE_CLOCKWISE;
+	rasterization.depthClampEnable = VK_FALSE;
+	rasterization.lineWidth = 1.0f;
+
+	VkPipelineMultisampleStateCreateInfo multisample = {};
+	multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = VK_TRUE;
+	depthStencil.depthWriteEnable = VK_TRUE;
+	depthStencil.depthCompareOp = m_reverseZ ? VK_COMPARE_OP_GREATER : VK_COMPARE_OP_LESS;
+
+	VkPipelineColorBlendAttachmentState blendAttachment = {};
+	blendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+	VkPipelineColorBlendStateCreateInfo blend = {};
+	blend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	blend.attachmentCount = 1;
+	blend.pAttachments = &blendAttachment;
+
+	VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamic = {};
+	dynamic.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamic.dynamicStateCount = 2;
+	dynamic.pDynamicStates = dynamicStates;
+
+	VkGraphicsPipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount = 2;
+	pipelineInfo.pStages = stages;
+	pipelineInfo.pVertexInputState = &vertexInput;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterization;
+	pipelineInfo.pMultisampleState = &multisample;
+	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.pColorBlendState = &blend;
+	pipelineInfo.pDynamicState = &dynamic;
+	pipelineInfo.layout = m_pipelineLayout;
+	pipelineInfo.renderPass = m_renderPass;
+	Check(vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_pipeline));
+
+	vkDestroyShaderModule(m_device, vertexModule, nullptr);
+	vkDestroyShaderModule(m_device, pixelModule, nullptr);
+}
+
+void VulkanRenderer::CreateFrames()
+{
+	CreateImage(DEPTH_FORMAT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_ASPECT_DEPTH_BIT, m_depth);
+
+	VkCommandBufferAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocateInfo.commandPool = m_commandPool;
+	allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocateInfo.commandBufferCount = 1;
+
+	VkFenceCreateInfo fenceInfo = {};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	for (Frame& frame : m_frames)
+	{
+		Check(vkAllocateCommandBuffers(m_device, &allocateInfo, &frame.commandBuffer));
+		Check(vkCreateFence(m_device, &fenceInfo, nullptr, &frame.fence));
+		frame.submitted = false;
+
+		CreateImage(COLOR_FORMAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_ASPECT_COLOR_BIT, frame.color);
+
+		VkImageView views[] = { frame.color.view, m_depth.view };
+		VkFramebufferCreateInfo framebufferInfo = {};
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass = m_renderPass;
+		framebufferInfo.attachmentCount = 2;
+		framebufferInfo.pAttachments = views;
+		framebufferInfo.width = m_width;
+		framebufferInfo.height = m_height;
+		framebufferInfo.layers = 1;
+		Check(vkCreateFramebuffer(m_device, &framebufferInfo, nullptr, &frame.framebuffer));
+
+		CreateBuffer(static_cast<VkDeviceSize>(m_width) * m_height * 4, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, frame.readback);
+	}
+
+	// timestamps are optional, lavapipe has them
+	if (m_deviceProperties.limits.timestampComputeAndGraphics)
+	{
+		VkQueryPoolCreateInfo queryPoolInfo = {};
+		queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolInfo.queryCount = 2 * FRAME_COUNT;
+		Check(vkCreateQueryPool(m_device, &queryPoolInfo, nullptr, &m_queryPool));
+	}
+}
+
+void VulkanRenderer::CreateDescriptors()
+{
+	// one region per frame slot, each constant buffer at an aligned offset inside it
+	VkDeviceSize alignment = m_deviceProperties.limits.minUniformBufferOffsetAlignment;
+	m_wvpOffset = AlignUp(4 * sizeof(float), alignment);
+	m_frameConstantsSize = AlignUp(m_wvpOffset + 16 * sizeof(float), alignment);
+	CreateBuffer(m_frameConstantsSize * FRAME_COUNT, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_constants);
+
+	VkDescriptorPoolSize poolSize = { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 2 };
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	Check(vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_descriptorPool));
+
+	VkDescriptorSetAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocateInfo.descriptorPool = m_descriptorPool;
+	allocateInfo.descriptorSetCount = 1;
+	allocateInfo.pSetLayouts = &m_descriptorSetLayout;
+	Check(vkAllocateDescriptorSets(m_device, &allocateInfo, &m_descriptorSet));
+
+	// written once, the frame region is picked with dynamic offsets when binding
+	VkDescriptorBufferInfo bufferInfos[2] =
+	{
+		{ m_constants.buffer, 0, 4 * sizeof(float) },
+		{ m_constants.buffer, m_wvpOffset, 16 * sizeof(float) }
+	};
+
+	VkWriteDescriptorSet writes[2] = {};
+	for (uint32_t i = 0; i < 2; ++i)
+	{
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = m_descriptorSet;
+		writes[i].dstBinding = i;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		writes[i].pBufferInfo = &bufferInfos[i];
+	}
+	vkUpdateDescriptorSets(m_device, 2, writes, 0, nullptr);
+}
+
+void VulkanRenderer::Init(uint32_t width, uint32_t height, const std::vector<uint32_t>& vertexShader, const std::vector<uint32_t>& pixelShader,
+	bool preferCpu, bool reverseZ)
+{
+	m_width = width;
+	m_height = height;
+	m_reverseZ = reverseZ;
+
+	CreateDevice(preferCpu);
+	CreateRenderPass();
+	CreatePipeline(vertexShader, pixelShader);
+	CreateFrames();
+	CreateDescriptors();
+}
+
+void VulkanRenderer::UploadBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, Buffer& buffer)
+{
+	Buffer staging;
+	CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging);
+	memcpy(staging.mapped, data, static_cast<size_t>(size));
+
+	CreateBuffer(size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer);
+
+	VkCommandBufferAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocateInfo.commandPool = m_commandPool;
+	allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocateInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer;
+	Check(vkAllocateCommandBuffers(m_device, &allocateInfo, &commandBuffer));
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	Check(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+
+	VkBufferCopy region = { 0, 0, size };
+	vkCmdCopyBuffer(commandBuffer, staging.buffer, buffer.buffer, 1, &region);
+	Check(vkEndCommandBuffer(commandBuffer));
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	Check(vkQueueSubmit(m_queue, 1, &submitInfo, VK_NULL_HANDLE));
+
+	// meshes are uploaded at load time, waiting here keeps the staging lifetime simple
+	Check(vkQueueWaitIdle(m_queue));
+	vkFreeCommandBuffers(m_device, m_commandPool, 1, &commandBuffer);
+	DestroyBuffer(staging);
+}
+
+void VulkanRenderer::UploadMesh(const VulkanVertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount)
+{
+	DestroyBuffer(m_vertexBuffer);
+	DestroyBuffer(m_indexBuffer);
+
+	UploadBuffer(vertices, vertexCount * sizeof(VulkanVertex), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, m_vertexBuffer);
+	UploadBuffer(indices, indexCount * sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, m_indexBuffer);
+	m_indexCount = indexCount;
+}
+
+void VulkanRenderer::Render(const float colorMultiplier[4], const float wvp[16], VulkanFrameTimings* timings)
+{
+	Frame& frame = m_frames[m_frameIndex];
+
+	// like WaitForPreviousFrame, the slot's last submission has to be done
+	high_resolution_clock::time_point waitStart = high_resolution_clock::now();
+	timings->gpuSec = 0.0;
+	if (frame.submitted)
+	{
+		Check(vkWaitForFences(m_device, 1, &frame.fence, VK_TRUE, UINT64_MAX));
+		Check(vkResetFences(m_device, 1, &frame.fence));
+
+		uint64_t timestamps[2];
+		if (m_queryPool != VK_NULL_HANDLE &&
+			vkGetQueryPoolResults(m_device, m_queryPool, 2 * m_frameIndex, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+				VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+		{
+			timings->gpuSec = static_cast<double>(timestamps[1] - timestamps[0]) * m_deviceProperties.limits.timestampPeriod * 1e-9;
+		}
+	}
+	high_resolution_clock::time_point recordStart = high_resolution_clock::now();
+
+	// the constant buffers of this slot are no longer read
+	VkDeviceSize frameOffset = m_frameIndex * m_frameConstantsSize;
+	uint8_t* constants = static_cast<uint8_t*>(m_constants.mapped) + frameOffset;
+	memcpy(constants, colorMultiplier, 4 * sizeof(float));
+	memcpy(constants + m_wvpOffset, wvp, 16 * sizeof(float));
+
+	VkCommandBuffer commandBuffer = frame.commandBuffer;
+	Check(vkResetCommandBuffer(commandBuffer, 0));
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	Check(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+
+	if (m_queryPool != VK_NULL_HANDLE)
+	{
+		vkCmdResetQueryPool(commandBuffer, m_queryPool, 2 * m_frameIndex, 2);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPool, 2 * m_frameIndex);
+	}
+
+	VkClearValue clearValues[2] = {};
+	clearValues[0].color.float32[0] = 0.5f;
+	clearValues[0].color.float32[1] = 0.5f;
+	clearValues[0].color.float32[2] = 0.5f;
+	clearValues[0].color.float32[3] = 1.0f;
+	clearValues[1].depthStencil.depth = m_reverseZ ? 0.0f : 1.0f;
+
+	VkRenderPassBeginInfo renderPassInfo = {};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass = m_renderPass;
+	renderPassInfo.framebuffer = frame.framebuffer;
+	renderPassInfo.renderArea.extent = { m_width, m_height };
+	renderPassInfo.clearValueCount = 2;
+	renderPassInfo.pClearValues = clearValues;
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+	// negative height flips y, so the D3D clip space and matrices are used unchanged
+	VkViewport viewport = { 0.0f, static_cast<float>(m_height), static_cast<float>(m_width), -static_cast<float>(m_height), 0.0f, 1.0f };
+	VkRect2D scissor = { { 0, 0 }, { m_width, m_height } };
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
+	uint32_t dynamicOffsets[2] = { static_cast<uint32_t>(frameOffset), static_cast<uint32_t>(frameOffset) };
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_descriptorSet, 2, dynamicOffsets);
+
+	if (m_indexCount > 0)
+	{
+		VkDeviceSize vertexOffset = 0;
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_vertexBuffer.buffer, &vertexOffset);
+		vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+		vkCmdDrawIndexed(commandBuffer, m_indexCount, 1, 0, 0, 0);
+	}
+
+	vkCmdEndRenderPass(commandBuffer);
+
+	// stands in for Present
+	VkBufferImageCopy region = {};
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.layerCount = 1;
+	region.imageExtent = { m_width, m_height, 1 };
+	vkCmdCopyImageToBuffer(commandBuffer, frame.color.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, frame.readback.buffer, 1, &region);
+
+	// the fence alone does not make the copy visible to the host
+	VkMemoryBarrier hostBarrier = {};
+	hostBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &hostBarrier, 0, nullptr, 0, nullptr);
+
+	if (m_queryPool != VK_NULL_HANDLE)
+	{
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, 2 * m_frameIndex + 1);
+	}
+
+	Check(vkEndCommandBuffer(commandBuffer));
+	high_resolution_clock::time_point submitStart = high_resolution_clock::now();
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	Check(vkQueueSubmit(m_queue, 1, &submitInfo, frame.fence));
+	frame.submitted = true;
+
+	high_resolution_clock::time_point submitEnd = high_resolution_clock::now();
+	timings->waitSec = duration<double>(recordStart - waitStart).count();
+	timings->recordSec = duration<double>(submitStart - recordStart).count();
+	timings->submitSec = duration<double>(submitEnd - submitStart).count();
+
+	m_frameIndex = (m_frameIndex + 1) % FRAME_COUNT;
+}
+
+void VulkanRenderer::WaitIdle()
+{
+	if (m_device != VK_NULL_HANDLE)
+	{
+		Check(vkDeviceWaitIdle(m_device));
+	}
+}
+
+const uint8_t* VulkanRenderer::GetLastImage() const
+{
+	const Frame& frame = m_frames[(m_frameIndex + FRAME_COUNT - 1) % FRAME_COUNT];
+	return static_cast<const uint8_t*>(frame.readback.mapped);
+}
+
+const char* VulkanRenderer::GetDeviceName() const
+{
+	return m_deviceProperties.deviceName;
+}
+
+void VulkanRenderer::Destroy()
+{
+	if (m_device == VK_NULL_HANDLE)
+	{
+		if (m_instance != VK_NULL_HANDLE)
+		{
+			vkDestroyInstance(m_instance, nullptr);
+			m_instance = VK_NULL_HANDLE;
+		}
+		return;
+	}
+
+	vkDeviceWaitIdle(m_device);
+
+	DestroyBuffer(m_vertexBuffer);
+	DestroyBuffer(m_indexBuffer);
+	DestroyBuffer(m_constants);
+
+	for (Frame& frame : m_frames)
+	{
+		DestroyBuffer(frame.readback);
+		if (frame.framebuffer != VK_NULL_HANDLE)
+		{
+			vkDestroyFramebuffer(m_device, frame.framebuffer, nullptr);
+		}
+		DestroyImage(frame.color);
+		if (frame.fence != VK_NULL_HANDLE)
+		{
+			vkDestroyFence(m_device, frame.fence, nullptr);
+		}
+		frame = Frame{};
+	}
+	DestroyImage(m_depth);
+
+	if (m_queryPool != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(m_device, m_queryPool, nullptr);
+	}
+	vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+	vkDestroyPipeline(m_device, m_pipeline, nullptr);
+	vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayout, nullptr);
+	vkDestroyRenderPass(m_device, m_renderPass, nullptr);
+	vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+	vkDestroyDevice(m_device, nullptr);
+	vkDestroyInstance(m_instance, nullptr);
+
+	m_device = VK_NULL_HANDLE;
+	m_instance = VK_NULL_HANDLE;
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+
+// same layout as the Vertex of the D3D12 renderer
+struct VulkanVertex
+{
+	float pos[3];
+	float color[4];
+};
+
+struct VulkanFrameTimings
+{
+	double waitSec;	// for the frame slot to come back, the whole GPU frame on lavapipe
+	double recordSec;
+	double submitSec;
+	double gpuSec;	// timestamps around the render pass and the readback copy, of the frame waited for
+};
+
+// Vulkan version of the D3D12 path in Engine, so the submission pipeline can
+// run and be profiled on Linux machines without a GPU through Mesa's lavapipe.
+// It draws offscreen: one color image per frame slot stands in for the swap
+// chain buffers and is copied to a host visible buffer in place of Present.
+// Binding mirrors the non-bindless root signature: the two constant buffers are
+// dynamic uniform buffers pointing into per-frame regions of one persistently
+// mapped buffer, as the root CBVs point into the upload heaps.
+class VulkanRenderer
+{
+public:
+	static const uint32_t FRAME_COUNT = 2;
+
+private:
+
+	struct Buffer
+	{
+		VkBuffer buffer;
+		VkDeviceMemory memory;
+		void* mapped;
+		VkDeviceSize size;
+	};
+
+	struct Image
+	{
+		VkImage image;
+		VkDeviceMemory memory;
+		VkImageView view;
+	};
+
+	struct Frame
+	{
+		VkCommandBuffer commandBuffer;
+		VkFence fence;
+		Image color;
+		VkFramebuffer framebuffer;
+		Buffer readback;	// RGBA8, tightly packed rows
+		bool submitted;
+	};
+
+	VkInstance m_instance;
+	VkPhysicalDevice m_physicalDevice;
+	VkPhysicalDeviceProperties m_deviceProperties;
+	VkPhysicalDeviceMemoryProperties m_memoryProperties;
+	VkDevice m_device;
+	VkQueue m_queue;
+	uint32_t m_queueFamily;
+	VkCommandPool m_commandPool;
+
+	// root signature and PSO
+	VkDescriptorSetLayout m_descriptorSetLayout;
+	VkPipelineLayout m_pipelineLayout;
+	VkRenderPass m_renderPass;
+	VkPipeline m_pipeline;
+	VkDescriptorPool m_descriptorPool;
+	VkDescriptorSet m_descriptorSet;
+
+	VkQueryPool m_queryPool;	// two timestamps per frame slot, 0 when unsupported
+
+	uint32_t m_width;
+	uint32_t m_height;
+	bool m_reverseZ;
+	Image m_depth;
+	Frame m_frames[FRAME_COUNT];
+	uint32_t m_frameIndex;
+
+	Buffer m_vertexBuffer;
+	Buffer m_indexBuffer;
+	uint32_t m_indexCount;
+
+	// color multiplier and WVP of every frame slot
+	Buffer m_constants;
+	VkDeviceSize m_wvpOffset;	// within a frame region
+	VkDeviceSize m_frameConstantsSize;
+
+	void CreateDevice(bool preferCpu);
+	uint32_t FindMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const;
+	void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, Buffer& buffer);
+	void CreateImage(VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect, Image& image);
+	void DestroyBuffer(Buffer& buffer);
+	void DestroyImage(Image& image);
+	VkShaderModule CreateShaderModule(const std::vector<uint32_t>& spirv);
+	void CreateRenderPass();
+	void CreatePipeline(const std::vector<uint32_t>& vertexShader, const std::vector<uint32_t>& pixelShader);
+	void CreateFrames();
+	void CreateDescriptors();
+	void UploadBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, Buffer& buffer);
+
+public:
+	VulkanRenderer();
+	~VulkanRenderer();
+
+	VulkanRenderer(const VulkanRenderer&) = delete;
+	VulkanRenderer& operator=(const VulkanRenderer&) = delete;
+
+	// shaders are the SPIR-V of vsMain and psMain in Shaders.hlsl, preferCpu picks
+	// lavapipe even when a GPU is present
+	void Init(uint32_t width, uint32_t height, const std::vector<uint32_t>& vertexShader, const std::vector<uint32_t>& pixelShader,
+		bool preferCpu = false, bool reverseZ = false);
+	// device local buffers filled through a staging buffer, like the geometry upload on the copy queue
+	void UploadMesh(const VulkanVertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+
+	// waits for the frame slot, writes the constant buffers, records and submits,
+	// wvp is laid out as PackWvpTransforms writes it
+	void Render(const float colorMultiplier[4], const float wvp[16], VulkanFrameTimings* timings);
+	void WaitIdle();
+
+	// image of the last submitted frame, valid after WaitIdle
+	const uint8_t* GetLastImage() const;
+	const char* GetDeviceName() const;
+	void Destroy();
+};